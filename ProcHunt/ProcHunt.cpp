@@ -3,11 +3,12 @@
 //   cl /EHsc /W4 /permissive- /std:c++17 /DUNICODE /D_UNICODE ProcHunt.cpp proc_peb.cpp print.cpp output.cpp ntdll.lib wintrust.lib crypt32.lib
 #define _CRT_SECURE_NO_WARNINGS
 #include <windows.h>
-#include <tlhelp32.h>
 #include <string>
 #include <vector>
 #include <cwchar>
 #include <cstdio>
+#include <ctime>
+#include <memory>
 
 #include "heuristics.h"
 #include "utils.h"
@@ -15,13 +16,59 @@
 #include "proc_peb.h"
 #include "print.h"
 #include "output.h"
+#include "snapshot.h"
+#include "pipeline.h"
+#include "lineage.h"
+#include "sigcache.h"
+#include "proc_enum.h"
+#include "watch.h"
+#include "rules.h"
+#include "stats.h"
+#include "serializer.h"
+#include "ingest.h"
+#include "binfmt.h"
+#include "serve.h"
+#include "ioc.h"
+#include "scheduler.h"
 
 #define TOOL_NAME   L"ProcHunt - Heuristic Process Hunter"
 #define TOOL_AUTHOR L"Author: @Alessio Carletti"
 
 static bool g_json = false;
+static bool g_ndjson = false;
+static bool g_text = false;   // --format text, only meaningful with --decode
+static bool g_bin = false;
 static int  g_min_score = -1;
 static std::wstring g_out_path;
+static uint64_t g_rotate_bytes = 0;
+static uint64_t g_rotate_records = 0;
+static unsigned g_rotate_keep = 5;
+static std::wstring g_record_path;
+static std::wstring g_replay_path;
+static unsigned g_threads = 1;
+static std::wstring g_sig_cache_path;
+static std::wstring g_rules_path;
+static std::wstring g_ioc_path;
+static std::wstring g_ioc_compile_path;
+static bool g_stats = false;
+static std::vector<std::wstring> g_ingest_paths;
+static std::wstring g_decode_path;
+static std::wstring g_serve_endpoint;
+static DWORD g_watch_ms = 0;
+static double g_cpu_budget = 0;   // --cpu-budget, share of one core (0 = off)
+static HANDLE g_stop_event = nullptr;
+static serve::Server* g_server = nullptr;
+
+namespace {
+    struct PebReader : scan::IProcessReader {
+        bool Read(const scan::ProcEntry& e, ProcParams& out) override {
+            return ReadProcParams(e.pid, e.exeName.c_str(), out);
+        }
+    };
+    struct WinTrustVerifier : scan::ISignatureVerifier {
+        SignInfo Verify(const std::wstring& path) override { return VerifyFileSignature(path); }
+    };
+} // anon
 
 static bool EnablePrivilege(LPCWSTR name) {
     HANDLE tok{};
@@ -34,6 +81,17 @@ static bool EnablePrivilege(LPCWSTR name) {
     return ok && GetLastError() == ERROR_SUCCESS;
 }
 
+static BOOL WINAPI OnConsoleCtrl(DWORD) {
+    if (g_stop_event) SetEvent(g_stop_event);
+    if (g_server) g_server->Stop();
+    return TRUE;
+}
+
+static uint64_t NowFiletime() {
+    FILETIME ft; GetSystemTimeAsFileTime(&ft);
+    return ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+}
+
 static void PrintUsageTop(const wchar_t* exe) {
     OutPrintf(L"\n========================================\n");
     OutPrintf(L"%s\n%s\n", TOOL_NAME, TOOL_AUTHOR);
@@ -46,7 +104,8 @@ int wmain(int argc, wchar_t** argv) {
 
     bool listAll = true;
     DWORD targetPid = 0;
-    std::vector<std::wstring> wlPub, wlPath;
+    std::vector<std::wstring> wlPub, wlPath, protNames;
+    std::vector<std::wstring> wlPubFiles, wlPathFiles, protFiles;   // re-read in --watch and --serve when they change
 
     for (int i = 1; i < argc; ++i) {
         if (!_wcsicmp(argv[i], L"-h") || !_wcsicmp(argv[i], L"--help")) {
@@ -62,13 +121,37 @@ int wmain(int argc, wchar_t** argv) {
         else if (!_wcsicmp(argv[i], L"--json")) {
             g_json = true;
         }
+        else if (!_wcsicmp(argv[i], L"--ndjson")) {
+            g_ndjson = true;
+        }
+        else if (!_wcsicmp(argv[i], L"--format")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            const wchar_t* f = argv[++i];
+            g_json = g_ndjson = g_text = g_bin = false;
+            if (!_wcsicmp(f, L"text")) g_text = true;
+            else if (!_wcsicmp(f, L"json")) g_json = true;
+            else if (!_wcsicmp(f, L"ndjson")) g_ndjson = true;
+            else if (!_wcsicmp(f, L"bin")) g_bin = true;
+            else { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+        }
+        else if (!_wcsicmp(argv[i], L"--decode")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_decode_path = argv[++i];
+        }
         else if (!_wcsicmp(argv[i], L"--whitelist-pub")) {
             if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
-            util::load_list_file(argv[++i], wlPub);
+            wlPubFiles.push_back(argv[++i]);
+            util::load_list_file(wlPubFiles.back(), wlPub);
         }
         else if (!_wcsicmp(argv[i], L"--whitelist-path")) {
             if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
-            util::load_list_file(argv[++i], wlPath);
+            wlPathFiles.push_back(argv[++i]);
+            util::load_list_file(wlPathFiles.back(), wlPath);
+        }
+        else if (!_wcsicmp(argv[i], L"--protected-names")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            protFiles.push_back(argv[++i]);
+            util::load_list_file(protFiles.back(), protNames);
         }
         else if (!_wcsicmp(argv[i], L"--min-score") || !_wcsicmp(argv[i], L"--threshold") || !_wcsicmp(argv[i], L"-t")) {
             if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
@@ -78,61 +161,525 @@ int wmain(int argc, wchar_t** argv) {
             if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
             g_out_path = argv[++i];
         }
+        else if (!_wcsicmp(argv[i], L"--rotate-size")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            double mb = _wtof(argv[++i]);
+            g_rotate_bytes = mb <= 0 ? 0 : (uint64_t)(mb * 1048576);
+        }
+        else if (!_wcsicmp(argv[i], L"--rotate-records")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            long long n = _wtoi64(argv[++i]); g_rotate_records = n < 0 ? 0 : (uint64_t)n;
+        }
+        else if (!_wcsicmp(argv[i], L"--rotate-keep")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            int n = _wtoi(argv[++i]); g_rotate_keep = n < 0 ? 0 : (unsigned)n;
+        }
+        else if (!_wcsicmp(argv[i], L"--threads")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            int n = _wtoi(argv[++i]); g_threads = n < 0 ? 1 : (unsigned)n;
+        }
+        else if (!_wcsicmp(argv[i], L"--sig-cache")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_sig_cache_path = argv[++i];
+        }
+        else if (!_wcsicmp(argv[i], L"--record")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_record_path = argv[++i];
+        }
+        else if (!_wcsicmp(argv[i], L"--replay")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_replay_path = argv[++i];
+        }
+        else if (!_wcsicmp(argv[i], L"--rules")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_rules_path = argv[++i];
+        }
+        else if (!_wcsicmp(argv[i], L"--ioc-hashes")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_ioc_path = argv[++i];
+        }
+        else if (!_wcsicmp(argv[i], L"--ioc-compile")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_ioc_compile_path = argv[++i];
+        }
+        else if (!_wcsicmp(argv[i], L"--dump-rules")) {
+            OutInit(L""); OutPrintf(L"%s", heur::DefaultRulesText()); OutClose(); return 0;
+        }
+        else if (!_wcsicmp(argv[i], L"--stats")) {
+            g_stats = true;
+        }
+        else if (!_wcsicmp(argv[i], L"--ingest")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_ingest_paths.push_back(argv[++i]);
+        }
+        else if (!_wcsicmp(argv[i], L"--serve")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            g_serve_endpoint = argv[++i];
+        }
+        else if (!_wcsicmp(argv[i], L"--watch")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            double sec = _wtof(argv[++i]);
+            g_watch_ms = sec < 0.1 ? 100 : (DWORD)(sec * 1000);
+        }
+        else if (!_wcsicmp(argv[i], L"--cpu-budget")) {
+            if (i + 1 >= argc) { OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1; }
+            double pct = _wtof(argv[++i]);   // "2" or "2%"
+            g_cpu_budget = pct <= 0 ? 0 : (pct > 100 ? 100 : pct) / 100;
+        }
         else {
             OutInit(L""); PrintUsageTop(argv[0]); OutClose(); return 1;
         }
     }
+    if (g_watch_ms && (!listAll || !g_record_path.empty() || !g_replay_path.empty())) {
+        fwprintf(stderr, L"--watch cannot be combined with --pid, --record or --replay\n");
+        return 1;
+    }
+    if (g_cpu_budget > 0 && !g_watch_ms) {
+        fwprintf(stderr, L"--cpu-budget needs --watch <seconds>\n");
+        return 1;
+    }
+    if (!g_ingest_paths.empty() && (g_watch_ms || !listAll || !g_record_path.empty() || !g_replay_path.empty())) {
+        fwprintf(stderr, L"--ingest cannot be combined with --watch, --pid, --record or --replay\n");
+        return 1;
+    }
+    if (g_bin && (g_watch_ms || !g_ingest_paths.empty() || !g_decode_path.empty())) {
+        fwprintf(stderr, L"--format bin cannot be combined with --watch, --ingest or --decode\n");
+        return 1;
+    }
+    if ((g_rotate_bytes || g_rotate_records) && (g_out_path.empty() || !(g_ndjson || g_watch_ms))) {
+        // Files are cut between lines: only NDJSON has one record per line.
+        fwprintf(stderr, L"--rotate-size and --rotate-records need -o <file> and --ndjson or --watch output\n");
+        return 1;
+    }
+    if (!g_serve_endpoint.empty() && (g_watch_ms || !g_ingest_paths.empty() || !g_decode_path.empty() || g_bin
+        || !listAll || !g_record_path.empty() || !g_replay_path.empty())) {
+        fwprintf(stderr, L"--serve cannot be combined with --watch, --ingest, --decode, --format bin, --pid, --record or --replay\n");
+        return 1;
+    }
+    if (!g_ioc_compile_path.empty() && g_ioc_path.empty()) {
+        fwprintf(stderr, L"--ioc-compile needs --ioc-hashes <feed>\n");
+        return 1;
+    }
+    if (!g_ioc_path.empty() && (!g_replay_path.empty() || !g_decode_path.empty())) {
+        // Recordings do not keep image hashes; decoded files are not scored again.
+        fwprintf(stderr, L"--ioc-hashes cannot be combined with --replay or --decode\n");
+        return 1;
+    }
+    if (!g_decode_path.empty()) {
+        // Nothing is scanned or scored: the file already holds the results.
+        if (!g_ingest_paths.empty() || g_watch_ms || !listAll || !g_record_path.empty() || !g_replay_path.empty()) {
+            fwprintf(stderr, L"--decode cannot be combined with --ingest, --watch, --pid, --record or --replay\n");
+            return 1;
+        }
+        OutInit(g_out_path);
+        uint64_t records = 0;
+        std::wstring err;
+        const bool ok = bin::Convert(g_decode_path,
+            g_ndjson ? OutputMode::Ndjson : g_text ? OutputMode::Text : OutputMode::JsonArray, records, &err);
+        OutClose();
+        if (!ok) fwprintf(stderr, L"Cannot decode %s: %s (%llu records read)\n", g_decode_path.c_str(), err.c_str(), records);
+        return ok ? 0 : 1;
+    }
 
     heur::SetPublisherWhitelist(wlPub);
     heur::SetPathWhitelist(wlPath);
+    heur::SetProtectedNames(protNames);
+    if (!g_rules_path.empty()) {
+        std::wstring err;
+        if (!heur::LoadRulesFile(g_rules_path, &err)) {
+            fwprintf(stderr, L"Cannot load rules %s: %s\n", g_rules_path.c_str(), err.c_str());
+            return 1;
+        }
+    }
+    auto loadIoc = [&](std::wstring* err) {
+        auto idx = std::make_shared<ioc::Index>();
+        if (!idx->Load(g_ioc_path, err)) return false;
+        const ioc::LoadStats& ls = idx->Stats();
+        if (ls.compiled) fwprintf(stderr, L"ioc-hashes: %zu hashes (compiled list)\n", idx->Count());
+        else fwprintf(stderr, L"ioc-hashes: %zu hashes from %llu lines (%llu without a SHA-256, %llu duplicates)\n",
+            idx->Count(), ls.lines, ls.skipped, ls.duplicates);
+        if (!g_ioc_compile_path.empty()) {
+            if (!idx->Save(g_ioc_compile_path)) { if (err) *err = L"cannot write " + g_ioc_compile_path; return false; }
+            fwprintf(stderr, L"ioc-hashes: compiled list written to %s\n", g_ioc_compile_path.c_str());
+            return true;
+        }
+        ioc::SetActive(std::move(idx));
+        return true;
+    };
+    if (!g_ioc_path.empty()) {
+        std::wstring err;
+        if (!loadIoc(&err)) {
+            fwprintf(stderr, L"Cannot load IOC hashes %s: %s\n", g_ioc_path.c_str(), err.c_str());
+            return 1;
+        }
+        if (!g_ioc_compile_path.empty()) return 0;
+    }
 
-    // Init output (UTF-8). If path=="" -> stdout, else file.
-    OutInit(g_out_path);
+    if (g_stats) {
+#if !PROCHUNT_STATS
+        fwprintf(stderr, L"--stats: this build has instrumentation compiled out (PROCHUNT_STATS=0)\n");
+#endif
+        stats::Enable(true);
+    }
 
-    bool firstJson = true;
-    if (g_json && listAll) OutPrintf(L"[");
+    // Init output (UTF-8). If path=="" -> stdout, else file.
+    OutInit(g_out_path, g_rotate_bytes, g_rotate_records, g_rotate_keep);
 
-    auto handle_one = [&](DWORD pid, const wchar_t* exeName) {
-        ProcParams pp{};
-        if (!ReadProcParams(pid, exeName, pp)) return;
+    // A single PID in --json mode is printed as one object, not an array.
+    const OutputMode mode = g_bin ? OutputMode::Binary
+        : g_ndjson ? OutputMode::Ndjson
+        : !g_json ? OutputMode::Text
+        : listAll ? OutputMode::JsonArray : OutputMode::Ndjson;
 
-        SignInfo sig{};
-        if (!pp.imagePath.empty()) sig = VerifyFileSignature(pp.imagePath);
+    // --stats: a JSON trailer line in NDJSON output; otherwise on stderr so the result
+    // (text, a JSON array or a binary file) stays as it was.
+    auto printStats = [&] {
+        if (!g_stats) return;
+        const stats::Snapshot s = stats::Collect();
+        if (mode == OutputMode::Ndjson || g_watch_ms) { PrintStats(s); return; }
+        ser::Buffer b(4096);
+        if (mode == OutputMode::JsonArray) { b.Put("{\"stats\":"); stats::WriteJson(b, s); b.Put("}\n"); }
+        else stats::WriteText(b, s);
+        fwrite(b.Data(), 1, b.Size(), stderr);
+    };
 
-        auto res = heur::EvaluateProcess(pp.imagePath, pp.commandLine, pp.currentDirectory, pp.name, sig);
+    // Threshold + print; shared by live scan and --replay.
+    auto emit = [&](const snap::ProcView& v, const heur::Result& res, const lin::Graph& graph) {
         if (g_min_score >= 0 && res.score < g_min_score) return;
+        lin::Chain chain;
+        graph.Ancestry(v.pid, chain);
+        PrintProcess(v.pid, v.name, v.imagePath, v.commandLine, v.currentDirectory,
+            v.windowTitle, v.desktopInfo, v.shellInfo, v.runtimeData, v.sig, res, &chain);
+        };
 
-        if (!g_json) {
-            PrintText(pid, pp.name, pp.imagePath, pp.commandLine, pp.currentDirectory,
-                pp.windowTitle, pp.desktopInfo, pp.shellInfo, pp.runtimeData, sig, res);
+    if (!g_ingest_paths.empty()) {
+        ingest::Options io;
+        io.threads = g_threads;
+        io.minScore = g_min_score;
+        io.mode = mode;
+        ingest::Totals tot;
+        std::wstring err;
+        const ULONGLONG t0 = GetTickCount64();
+        const bool ok = ingest::Run(g_ingest_paths, io, tot, &err);
+        const double sec = (GetTickCount64() - t0) / 1000.0;
+        if (!ok) fwprintf(stderr, L"ingest: %s\n", err.c_str());
+        fwprintf(stderr, L"ingest: %llu files, %llu records, %llu emitted, %llu skipped, %llu malformed, %.1f MB in %.2f s\n",
+            tot.files, tot.records, tot.emitted, tot.skipped, tot.malformed, tot.bytes / 1048576.0, sec);
+        printStats();
+        return OutClose() && ok ? 0 : 1;
+    }
+
+    if (!g_replay_path.empty()) {
+        snap::Reader reader;
+        std::wstring err;
+        if (!reader.Open(g_replay_path, &err)) {
+            fwprintf(stderr, L"Cannot replay %s: %s\n", g_replay_path.c_str(), err.c_str());
+            OutClose(); return 1;
         }
-        else {
-            PrintJsonObject(firstJson, pid, pp.name, pp.imagePath, pp.commandLine, pp.currentDirectory,
-                pp.windowTitle, pp.desktopInfo, pp.shellInfo, pp.runtimeData, sig, res);
+        PrintBegin(mode);
+        // The recorded table, unreadable processes included, is the lineage graph.
+        lin::Graph graph;
+        graph.Reserve(reader.Count());
+        snap::ProcView v;
+        for (size_t i = 0; i < reader.Count(); ++i)
+            if (reader.Get(i, v)) graph.Add(v.pid, v.ppid, v.createTime, v.name);
+        graph.Link();
+        for (size_t i = 0; i < reader.Count(); ++i) {
+            if (!reader.Get(i, v) || !v.readable) continue;
+            heur::Result res;
+            { stats::Timer t(stats::S_EVALUATE); res = heur::EvaluateProcess(v.imagePath, v.commandLine, v.currentDirectory, v.name, v.sig, graph.ParentName(v.pid)); }
+            stats::Timer t(stats::S_OUTPUT);
+            emit(v, res, graph);
+        }
+        PrintEnd();
+        printStats();
+        return OutClose() ? 0 : 1;
+    }
+
+    snap::Writer recorder;
+    bool recording = false;
+    if (!g_record_path.empty()) {
+        if (!recorder.Open(g_record_path)) {
+            fwprintf(stderr, L"Cannot open record file: %s\n", g_record_path.c_str());
+            OutClose(); return 1;
+        }
+        wchar_t host[MAX_COMPUTERNAME_LENGTH + 1]; DWORD cch = _countof(host);
+        recorder.SetOrigin(GetComputerNameW(host, &cch) ? std::wstring_view(host, cch) : std::wstring_view{}, (uint64_t)time(nullptr));
+        recording = true;
+    }
+    auto finish = [&](int rc) {
+        if (recording && !recorder.Close()) {
+            fwprintf(stderr, L"Failed writing record file: %s\n", g_record_path.c_str());
+            if (!rc) rc = 1;
+        }
+        if (!OutClose() && !rc) rc = 1;
+        return rc;
+    };
+
+    PebReader reader;
+    WinTrustVerifier winTrust;
+    scan::ISignatureVerifier* verifier = &winTrust;
+    std::unique_ptr<sig::Cache> sigCache;
+    // Resident: signature results stay cached for the life of the server even without
+    // --sig-cache, which then only seeds and keeps them across restarts.
+    if (!g_sig_cache_path.empty() || !g_serve_endpoint.empty()) {
+        sigCache = std::make_unique<sig::Cache>(winTrust);
+        if (!g_sig_cache_path.empty()) sigCache->Load(g_sig_cache_path);   // missing file = cold cache
+        verifier = sigCache.get();
+    }
+    // --ioc-hashes: the image hash on top of the (cached) signature; hashes are kept for the
+    // run only, so a --sig-cache file never holds them.
+    std::unique_ptr<ioc::Hasher> hasher;
+    if (ioc::Active()) {
+        hasher = std::make_unique<ioc::Hasher>(*verifier);
+        verifier = hasher.get();
+    }
+    scan::Options opt;
+    opt.threads = g_threads;
+    // Processes that cannot reach --min-score skip the signature check; a recording needs
+    // every signature, so it turns this off.
+    if (!recording) opt.minScore = g_min_score;
+    auto saveCaches = [&] {
+        if (hasher) {
+            const ioc::HasherStats hs = hasher->Stats();
+            fwprintf(stderr, L"ioc-hashes: %llu images hashed (%.1f MB, %hs), %llu memoized, %llu unreadable\n",
+                hs.hashed, hs.bytes / 1048576.0, sha::Kernel(), hs.hits, hs.failed);
+        }
+        if (!sigCache || g_sig_cache_path.empty()) return;
+        if (!sigCache->Save(g_sig_cache_path))
+            fwprintf(stderr, L"Cannot write signature cache: %s\n", g_sig_cache_path.c_str());
+        auto st = sigCache->Stats();
+        fwprintf(stderr, L"sig-cache: %llu hits (%llu coalesced), %llu misses, %llu stale, %llu loaded, %zu entries\n",
+            st.hits, st.coalesced, st.misses, st.stale, st.loaded, sigCache->Size());
+    };
+
+    // --watch and --serve: rules, whitelists, protected names and the IOC list are loaded
+    // again when one of their files changes, at a point where no result scored with the
+    // previous ones is still in use (so the ones retired before can be freed).
+    std::vector<std::wstring> rulesFiles;
+    if (!g_rules_path.empty()) rulesFiles.push_back(g_rules_path);
+    std::vector<std::wstring> iocFiles;
+    if (!g_ioc_path.empty()) iocFiles.push_back(g_ioc_path);
+    auto configIds = [&] {
+        std::vector<sig::FileId> ids;
+        for (auto* files : { &rulesFiles, &wlPubFiles, &wlPathFiles, &protFiles, &iocFiles })
+            for (auto& f : *files) { sig::FileId id; sig::QueryFileId(f, id); ids.push_back(id); }
+        return ids;
+    };
+    std::vector<sig::FileId> cfgIds = configIds();
+    auto configChanged = [&] {
+        std::vector<sig::FileId> ids = configIds();
+        if (ids == cfgIds) return false;
+        cfgIds = std::move(ids);
+        return true;
+    };
+    auto reloadConfig = [&] {
+        heur::ReleaseRetiredRules();
+        ioc::ReleaseRetired();
+        std::wstring err;
+        if (!g_rules_path.empty() && !heur::LoadRulesFile(g_rules_path, &err))
+            fwprintf(stderr, L"Cannot reload rules %s: %s (keeping previous rules)\n", g_rules_path.c_str(), err.c_str());
+        if (!g_ioc_path.empty() && !loadIoc(&err))
+            fwprintf(stderr, L"Cannot reload IOC hashes %s: %s (keeping previous list)\n", g_ioc_path.c_str(), err.c_str());
+        wlPub.clear(); wlPath.clear();
+        for (auto& f : wlPubFiles) util::load_list_file(f, wlPub);
+        for (auto& f : wlPathFiles) util::load_list_file(f, wlPath);
+        heur::ResetWhitelists();
+        heur::SetPublisherWhitelist(wlPub);
+        heur::SetPathWhitelist(wlPath);
+        protNames.clear();
+        for (auto& f : protFiles) util::load_list_file(f, protNames);
+        heur::ResetProtectedNames();
+        heur::SetProtectedNames(protNames);
+    };
+
+    if (!g_serve_endpoint.empty()) {
+        serve::Options so;
+        so.scanThreads = g_threads;
+        serve::Handler handler(EnumProcesses, reader, *verifier, so);
+        handler.SetReload({ configChanged, reloadConfig });
+        serve::Server server(handler);
+        std::wstring err;
+        if (!server.Listen(g_serve_endpoint, &err)) {
+            fwprintf(stderr, L"Cannot serve on %s: %s\n", g_serve_endpoint.c_str(), err.c_str());
+            return finish(1);
         }
+        g_server = &server;
+        SetConsoleCtrlHandler(OnConsoleCtrl, TRUE);
+        fwprintf(stderr, L"serve: listening on %s (Ctrl+C to stop)\n", g_serve_endpoint.c_str());
+        server.Run();
+        g_server = nullptr;
+        fwprintf(stderr, L"serve: %llu connections, %llu requests, %llu errors, %llu reloads\n",
+            server.Connections(), handler.Requests(), handler.Errors(), handler.Reloads());
+        saveCaches();
+        printStats();
+        return finish(0);
+    }
+
+    if (g_watch_ms) {
+        // Each tick: one enumeration, diff against the previous one, PEB read + scoring
+        // only for new (PID, creation time) pairs. Rules/whitelist edits trigger a full re-score.
+        // With --cpu-budget the scheduler also re-inspects every live process over time and
+        // paces enumerations and inspections to the budget.
+        g_stop_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        SetConsoleCtrlHandler(OnConsoleCtrl, TRUE);
+
+        sched::SystemClock clock;
+        std::unique_ptr<sched::Scheduler> scheduler;
+        if (g_cpu_budget > 0) {
+            sched::Options so;
+            so.budget = g_cpu_budget;
+            scheduler = std::make_unique<sched::Scheduler>(clock, so);
+        }
+
+        watch::Tracker tracker;
+        std::vector<scan::ProcEntry> now;
+        lin::Graph graph;   // this tick's enumeration
+        uint64_t tickTime = 0;
+        // A full re-score may lower the score of a reported process: it needs exact scores.
+        auto evaluate = [&](std::vector<scan::ProcEntry> list, bool prune) {
+            if (list.empty()) return;
+            scan::ListSource src(std::move(list));
+            scan::Options o = opt;
+            o.lineage = &graph;
+            if (!prune) o.minScore = -1;
+            scan::Run(src, reader, *verifier, o, [&](scan::ScanItem& it) {
+                if (scheduler) scheduler->Done(it.entry, it.ok ? it.res.score : -1);
+                if (!it.ok) return;
+                int prev = -1;
+                watch::Event ev = tracker.Score(it.entry, it.res.score, g_min_score, prev);
+                if (ev == watch::Event::None) return;
+                const ProcParams& pp = it.pp;
+                lin::Chain chain;
+                graph.Ancestry(it.entry.pid, chain);
+                PrintJsonEvent(watch::EventName(ev), tickTime, it.entry.createTime, prev, it.entry.pid,
+                    pp.name, pp.imagePath, pp.commandLine, pp.currentDirectory,
+                    pp.windowTitle, pp.desktopInfo, pp.shellInfo, pp.runtimeData, it.sig, it.res, &chain);
+                });
         };
 
-    if (!listAll && targetPid) {
-        handle_one(targetPid, L"(specified)");
-        if (g_json && listAll) OutPrintf(L"]\n");
-        OutClose();
-        return 0;
+        // One tick: enumeration, exit events, configuration reload. Returns the processes to
+        // score at once (all of them after a reload, else the new ones); `reloaded` tells which.
+        bool reloaded = false;
+        auto tick = [&]() -> const std::vector<scan::ProcEntry>* {
+            if (!EnumProcesses(now)) {
+                fwprintf(stderr, L"Process enumeration failed\n");
+                return nullptr;
+            }
+            tickTime = NowFiletime();
+            graph.Build(now);
+            const watch::Delta& d = tracker.Update(now);
+            for (const auto& t : d.exited)
+                PrintJsonExitEvent(tickTime, t.entry.createTime, t.entry.pid, t.entry.exeName, t.score);
+
+            // Every result of the rules and IOC list replaced last time has been printed.
+            reloaded = configChanged();
+            if (reloaded) reloadConfig();
+            return &d.started;
+        };
+
+        int rc = 0;
+        if (!scheduler) {
+            for (;;) {
+                const std::vector<scan::ProcEntry>* started = tick();
+                if (!started) { rc = 1; break; }
+                if (reloaded) evaluate(tracker.Entries(), false);
+                else evaluate(*started, true);
+                PrintFlush();
+                if (WaitForSingleObject(g_stop_event, g_watch_ms) == WAIT_OBJECT_0) break;
+            }
+        }
+        else {
+            // New processes are scored in the next quantum, the rest when due; a reload makes
+            // everything due. Under overload enumerations alternate with quanta, so both slow
+            // down instead of enumerations taking the whole budget.
+            const uint64_t reportUs = 60000000;
+            uint64_t nextTick = 0, nextReport = clock.WallUs() + reportUs;
+            bool inspected = true;
+            std::vector<scan::ProcEntry> fresh, again;
+            for (;;) {
+                uint64_t t = clock.WallUs();
+                if (t >= nextTick && scheduler->DelayUs() == 0 && (inspected || scheduler->NextDueUs() != 0)) {
+                    if (!tick()) { rc = 1; break; }
+                    scheduler->Update(now);
+                    if (reloaded) scheduler->Expire();
+                    nextTick = t + g_watch_ms * 1000ull;
+                    inspected = false;
+                    PrintFlush();
+                }
+                uint64_t wait = scheduler->DelayUs();
+                if (!wait && scheduler->Begin(fresh, again)) {
+                    tickTime = NowFiletime();
+                    evaluate(fresh, true);
+                    evaluate(again, false);
+                    scheduler->End();
+                    inspected = true;
+                    PrintFlush();
+                    continue;
+                }
+                t = clock.WallUs();
+                if (t >= nextReport) {
+                    PrintJsonCoverageEvent(NowFiletime(), scheduler->GetStats());
+                    PrintFlush();
+                    nextReport = t + reportUs;
+                }
+                if (!wait) wait = scheduler->NextDueUs();
+                if (t < nextTick && nextTick - t < wait) wait = nextTick - t;
+                if (nextReport - t < wait) wait = nextReport - t;
+                if (WaitForSingleObject(g_stop_event, (DWORD)(wait / 1000 + 1)) == WAIT_OBJECT_0) break;
+            }
+            const sched::Stats ss = scheduler->GetStats();
+            PrintJsonCoverageEvent(NowFiletime(), ss);
+            fwprintf(stderr, L"cpu-budget: %llu inspections in %llu quanta, %.2f%% CPU (budget %.2f%%), coverage latency max %.1f s, p99 %.1f s\n",
+                ss.inspections, ss.quanta, ss.wallUs ? 100.0 * (double)ss.cpuUs / (double)ss.wallUs : 0.0, g_cpu_budget * 100,
+                (double)ss.maxLatencyUs / 1e6, (double)ss.latencyUs.Percentile(99) / 1e6);
+        }
+        PrintFlush();
+        printStats();
+        saveCaches();
+        CloseHandle(g_stop_event);
+        return finish(rc);
     }
 
-    HANDLE snap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (snap == INVALID_HANDLE_VALUE) {
-        fwprintf(stderr, L"CreateToolhelp32Snapshot failed: %lu\n", GetLastError());
-        OutClose(); return 1;
+    // The whole table is enumerated even for --pid: lineage needs the other processes.
+    std::vector<scan::ProcEntry> procs;
+    const bool enumerated = EnumProcesses(procs);
+    if (!enumerated && (listAll || !targetPid)) {
+        fwprintf(stderr, L"Process enumeration failed\n");
+        return finish(1);
     }
-    PROCESSENTRY32W pe{}; pe.dwSize = sizeof(pe);
-    if (Process32FirstW(snap, &pe)) {
-        do {
-            handle_one(pe.th32ProcessID, pe.szExeFile);
-        } while (Process32NextW(snap, &pe));
+    lin::Graph graph;
+    graph.Build(procs);
+    opt.lineage = &graph;
+    if (!listAll && targetPid) {
+        const uint32_t slot = graph.Find((uint32_t)targetPid);
+        scan::ProcEntry e;
+        if (slot != lin::kNone) e = procs[slot];
+        else { e.pid = (uint32_t)targetPid; e.exeName = L"(specified)"; }
+        procs.assign(1, std::move(e));
     }
-    CloseHandle(snap);
 
-    if (g_json && listAll) OutPrintf(L"\n]\n");
-    OutClose();
-    return 0;
+    PrintBegin(mode);
+
+    scan::ListSource source(std::move(procs));
+    scan::Run(source, reader, *verifier, opt, [&](scan::ScanItem& it) {
+        if (!it.ok) {
+            if (recording) recorder.AddUnreadable(it.entry.pid, it.entry.ppid, it.entry.createTime, it.entry.exeName);
+            return;
+        }
+        if (recording) recorder.Add(it.entry.pid, it.entry.ppid, it.entry.createTime, it.pp, it.sig);
+        const ProcParams& pp = it.pp;
+        snap::ProcView v;
+        v.pid = it.entry.pid; v.ppid = it.entry.ppid; v.createTime = it.entry.createTime;
+        v.name = pp.name; v.imagePath = pp.imagePath; v.commandLine = pp.commandLine; v.currentDirectory = pp.currentDirectory;
+        v.windowTitle = pp.windowTitle; v.desktopInfo = pp.desktopInfo; v.shellInfo = pp.shellInfo; v.runtimeData = pp.runtimeData;
+        v.sig = it.sig;
+        emit(v, it.res, graph);
+        });
+
+    PrintEnd();
+    printStats();
+
+    saveCaches();
+    return finish(0);
 }
@@ -0,0 +1,436 @@
+// SPDX-License-Identifier: MIT
+#include "binfmt.h"
+#include <cmath>
+#include <cstring>
+#include "utils.h"
+
+namespace {
+    using namespace bin;
+
+    // Column order is the Reader's Field order; the file carries names, not positions.
+    struct ColDef { const char* name; uint8_t type, scale; };
+    const ColDef kColumns[] = {
+        { "pid", T_DELTA, 0 }, { "name", T_STR, 0 }, { "imagePath", T_STR, 0 }, { "commandLine", T_STR, 0 },
+        { "currentDirectory", T_STR, 0 }, { "windowTitle", T_STR, 0 }, { "desktopInfo", T_STR, 0 },
+        { "shellInfo", T_STR, 0 }, { "runtimeData", T_STR, 0 },
+        { "signature.trusted", T_BOOL, 0 }, { "signature.status", T_STR, 0 }, { "signature.publisher", T_STR, 0 },
+        { "signature.thumbprint", T_STR, 0 },
+        { "heuristics.score", T_INT, 0 },
+        { "obfuscation.length", T_UINT, 0 }, { "obfuscation.longestBase64", T_UINT, 0 }, { "obfuscation.longestHex", T_UINT, 0 },
+        { "obfuscation.entropy", T_UINT, 3 }, { "obfuscation.upperRatio", T_UINT, 3 }, { "obfuscation.lowerRatio", T_UINT, 3 },
+        { "obfuscation.digitRatio", T_UINT, 3 }, { "obfuscation.symbolRatio", T_UINT, 3 }, { "obfuscation.nonAsciiRatio", T_UINT, 3 },
+        { "heuristics.reasons", T_STRLIST, 0 }, { "ancestry", T_ANCESTRY, 0 },
+        { "signature.sha256", T_STR, 0 },
+    };
+    constexpr size_t kColumnCount = sizeof(kColumns) / sizeof(kColumns[0]);
+    enum { C_TRUSTED = 9, C_REASONS = 23, C_ANCESTRY = 24, C_SHA256 = 25 };
+
+    constexpr size_t kMaxBlock = 1u << 30;
+    constexpr size_t kMaxBatch = 1u << 16;    // records per batch a reader accepts
+    constexpr size_t kMaxArena = 1u << 28;
+
+    void varint(std::string& b, uint64_t v) {
+        while (v >= 0x80) { b.push_back((char)(v | 0x80)); v >>= 7; }
+        b.push_back((char)v);
+    }
+    void varint(ser::Buffer& b, uint64_t v) {
+        while (v >= 0x80) { b.Put((char)(v | 0x80)); v >>= 7; }
+        b.Put((char)v);
+    }
+    inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+    inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+    inline bool get_varint(const char*& p, const char* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            const uint8_t c = (uint8_t)*p++;
+            v |= (uint64_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // The value Buffer::Fixed(v, 3) prints, times 1000, so decoding prints the same digits.
+    uint64_t milli(double v) {
+        if (!(v > 0)) return 0;
+        const double scaled = v * 1000.0, r = std::nearbyint(scaled);
+        if (scaled < 1e15 && std::fabs(std::fabs(scaled - r) - 0.5) > 1e-6) return (uint64_t)r;
+        char tmp[64];
+        snprintf(tmp, sizeof(tmp), "%.3f", v);   // near a tie: printf decides, as in Fixed()
+        uint64_t q = 0;
+        for (const char* c = tmp; *c; ++c) if (*c >= '0' && *c <= '9') q = q * 10 + (uint64_t)(*c - '0');
+        return q;
+    }
+
+    inline uint32_t hash(std::wstring_view s) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ s.size();
+        const char* p = (const char*)s.data();
+        size_t n = s.size() * sizeof(wchar_t);
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        for (; n; ++p, --n) h = (h ^ (uint8_t)*p) * 0x100000001B3ull;
+        h ^= h >> 29;
+        return (uint32_t)h;
+    }
+} // anon
+
+namespace bin {
+
+    uint32_t Writer::Dict::Intern(std::wstring_view s) {
+        if (s.empty()) return 0;
+        if (slots_.size() < 2 * (spans_.size() + 1)) {
+            slots_.assign(slots_.empty() ? 1024 : slots_.size() * 2, 0);
+            const size_t mask = slots_.size() - 1;
+            for (uint32_t id = 1; id <= spans_.size(); ++id) {
+                size_t b = spans_[id - 1].hash & mask;
+                while (slots_[b]) b = (b + 1) & mask;
+                slots_[b] = id;
+            }
+        }
+        const uint32_t h = hash(s);
+        const size_t mask = slots_.size() - 1;
+        size_t b = h & mask;
+        for (; slots_[b]; b = (b + 1) & mask) {
+            const Span& sp = spans_[slots_[b] - 1];
+            if (sp.hash == h && sp.len == s.size() && !std::wmemcmp(arena_.data() + sp.off, s.data(), s.size())) return slots_[b];
+        }
+        spans_.push_back(Span{ (uint32_t)arena_.size(), (uint32_t)s.size(), h });
+        arena_.append(s);
+        slots_[b] = (uint32_t)spans_.size();
+        return slots_[b];
+    }
+
+    void Writer::Dict::Clear() {
+        arena_.clear(); spans_.clear(); slots_.clear();
+    }
+
+    Writer::Writer(ser::Buffer& out) : out_(out), cols_(kColumnCount) {}
+
+    void Writer::Begin() {
+        dict_.Clear();
+        sent_ = 1; n_ = 0; total_ = 0; prevPid_ = 0;
+        for (auto& c : cols_) c.clear();
+        out_.Put(std::string_view(kMagic, sizeof(kMagic)));
+        out_.Put((char)kVersion);
+        varint(out_, kColumnCount);
+        for (const ColDef& c : kColumns) {
+            varint(out_, strlen(c.name));
+            out_.Put(c.name);
+            out_.Put((char)c.type);
+            out_.Put((char)c.scale);
+        }
+    }
+
+    void Writer::Str(int col, std::wstring_view s) {
+        varint(cols_[col], dict_.Intern(s));
+    }
+
+    void Writer::Add(
+        unsigned long pid, std::wstring_view name,
+        std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+        std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+        const SignView& sig, const heur::Result& heur, const lin::Chain* anc)
+    {
+        if (dict_.Chars() > kMaxDictChars) {
+            Flush();
+            dict_.Clear();
+            sent_ = 1;
+            out_.Put('R'); varint(out_, 0);
+        }
+        varint(cols_[0], zigzag((int64_t)(uint32_t)pid - (int64_t)prevPid_));
+        prevPid_ = (uint32_t)pid;
+        Str(1, name); Str(2, img); Str(3, cmd); Str(4, cwd);
+        Str(5, wtitle); Str(6, desk); Str(7, shell); Str(8, rtd);
+        std::string& bits = cols_[C_TRUSTED];
+        if (n_ % 8 == 0) bits.push_back(0);
+        if (sig.trusted) bits.back() = (char)(bits.back() | (1 << (n_ % 8)));
+        Str(10, sig.trustStatus); Str(11, sig.publisher); Str(12, sig.thumbprint);
+        varint(cols_[13], zigzag(heur.score));
+        const heur::ObfStats& o = heur.obf;
+        varint(cols_[14], o.length); varint(cols_[15], o.longestBase64); varint(cols_[16], o.longestHex);
+        varint(cols_[17], milli(o.entropy)); varint(cols_[18], milli(o.upperRatio)); varint(cols_[19], milli(o.lowerRatio));
+        varint(cols_[20], milli(o.digitRatio)); varint(cols_[21], milli(o.symbolRatio)); varint(cols_[22], milli(o.nonAsciiRatio));
+        varint(cols_[C_REASONS], heur.reasons.size());
+        for (const wchar_t* r : heur.reasons) Str(C_REASONS, r);
+        const size_t na = anc ? anc->n : 0;
+        varint(cols_[C_ANCESTRY], na);
+        for (size_t i = 0; i < na; ++i) { varint(cols_[C_ANCESTRY], anc->v[i].pid); Str(C_ANCESTRY, anc->v[i].name); }
+        Str(C_SHA256, sig.sha256);
+        ++total_;
+        if (++n_ == kBatch) Flush();
+    }
+
+    void Writer::Block(char type) {
+        out_.Put(type);
+        varint(out_, block_.size());
+        out_.Put(std::string_view(block_));
+    }
+
+    void Writer::Flush() {
+        if (sent_ < dict_.Count()) {
+            block_.clear();
+            varint(block_, dict_.Count() - sent_);
+            for (uint32_t id = sent_; id < dict_.Count(); ++id) {
+                utf8_.Clear();
+                utf8_.Text(dict_.At(id));
+                varint(block_, utf8_.Size());
+                block_.append(utf8_.Data(), utf8_.Size());
+            }
+            Block('S');
+            sent_ = (uint32_t)dict_.Count();
+        }
+        if (!n_) return;
+        block_.clear();
+        varint(block_, n_);
+        varint(block_, kColumnCount);
+        for (size_t c = 0; c < kColumnCount; ++c) {
+            varint(block_, c);
+            varint(block_, cols_[c].size());
+            block_ += cols_[c];
+            cols_[c].clear();
+        }
+        Block('B');
+        n_ = 0;
+        prevPid_ = 0;
+    }
+
+    void Writer::End() {
+        Flush();
+        block_.clear();
+        varint(block_, total_);
+        Block('E');
+    }
+
+    bool Reader::Open(const std::wstring& path, std::wstring* err) {
+        Close();
+        f_ = util::open_file(path, "rb");
+        if (!f_) err_ = L"cannot open file";
+        else Header();
+        if (!Ok() && err) *err = err_;
+        return Ok();
+    }
+
+    bool Reader::Open(const char* data, size_t size, std::wstring* err) {
+        Close();
+        mem_ = data; memEnd_ = data + size;
+        Header();
+        if (!Ok() && err) *err = err_;
+        return Ok();
+    }
+
+    void Reader::Close() {
+        if (f_) fclose(f_);
+        f_ = nullptr; mem_ = memEnd_ = nullptr;
+        err_.clear(); schema_.clear();
+        arena_.clear(); strOff_.clear(); strLen_.clear();
+        std::memset(scale_, 0, sizeof(scale_));
+        n_ = at_ = 0; total_ = 0; ended_ = false;
+    }
+
+    bool Reader::Fail(const wchar_t* why) {
+        if (err_.empty()) err_ = why;
+        n_ = at_ = 0;
+        return false;
+    }
+
+    bool Reader::Read(void* dst, size_t n) {
+        if (f_) return fread(dst, 1, n, f_) == n;
+        if ((size_t)(memEnd_ - mem_) < n) return false;
+        std::memcpy(dst, mem_, n);
+        mem_ += n;
+        return true;
+    }
+
+    bool Reader::Header() {
+        char magic[sizeof(kMagic)];
+        uint8_t version;
+        if (!Read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(magic)) != 0) return Fail(L"not a ProcHunt binary file");
+        if (!Read(&version, 1) || version != kVersion) return Fail(L"unsupported version");
+        // The schema is small; read it byte by byte.
+        auto byte = [&](uint8_t& b) { return Read(&b, 1); };
+        auto var = [&](uint64_t& v) {
+            v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t b;
+                if (!byte(b)) return false;
+                v |= (uint64_t)(b & 0x7F) << shift;
+                if (!(b & 0x80)) return true;
+            }
+            return false;
+        };
+        uint64_t count;
+        if (!var(count) || count > 4096) return Fail(L"bad schema");
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t len;
+            std::string name;
+            Column c;
+            if (!var(len) || len > 256) return Fail(L"bad schema");
+            name.resize((size_t)len);
+            if (!Read(&name[0], (size_t)len) || !byte(c.type) || !byte(c.scale) || c.scale > 9) return Fail(L"bad schema");
+            for (size_t k = 0; k < kColumnCount; ++k)
+                if (name == kColumns[k].name && c.type == kColumns[k].type) { c.field = (int)k; scale_[k] = c.scale; }
+            schema_.push_back(c);
+        }
+        return true;
+    }
+
+    bool Reader::ReadBlock(char& type) {
+        uint8_t t;
+        if (!Read(&t, 1)) return Fail(L"file is cut short (no end block)");
+        uint64_t len = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t b;
+            if (shift >= 64 || !Read(&b, 1)) return Fail(L"file is cut short");
+            len |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        if (len > kMaxBlock) return Fail(L"block too large");
+        block_.resize((size_t)len);
+        if (len && !Read(&block_[0], (size_t)len)) return Fail(L"file is cut short");
+        type = (char)t;
+        return true;
+    }
+
+    bool Reader::Strings(const char* p, const char* end) {
+        uint64_t count;
+        if (!get_varint(p, end, count)) return Fail(L"bad string block");
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t len;
+            if (!get_varint(p, end, len) || len > (uint64_t)(end - p)) return Fail(L"bad string block");
+            const size_t off = arena_.size();
+            util::append_from_utf8(arena_, std::string_view(p, (size_t)len));
+            p += len;
+            strOff_.push_back((uint32_t)off);
+            strLen_.push_back((uint32_t)(arena_.size() - off));
+            arena_.push_back(L'\0');
+            if (arena_.size() > kMaxArena) return Fail(L"dictionary too large");
+        }
+        return true;
+    }
+
+    bool Reader::Batch(const char* p, const char* end) {
+        uint64_t n, cols;
+        if (!get_varint(p, end, n) || !get_varint(p, end, cols) || n > kMaxBatch) return Fail(L"bad batch");
+        for (auto& v : vals_) v.assign((size_t)n, 0);
+        for (int l = 0; l < 2; ++l) { listOff_[l].assign((size_t)n + 1, 0); listVals_[l].clear(); }
+        const uint64_t strings = strOff_.size() + 1;
+        for (uint64_t c = 0; c < cols; ++c) {
+            uint64_t idx, len;
+            if (!get_varint(p, end, idx) || !get_varint(p, end, len) || len > (uint64_t)(end - p) || idx >= schema_.size())
+                return Fail(L"bad batch");
+            const char* q = p;
+            const char* qe = p + len;
+            p = qe;
+            const Column& col = schema_[(size_t)idx];
+            if (col.field == F_UNKNOWN) continue;
+            std::vector<uint64_t>& out = vals_[col.field];
+            uint64_t v = 0, prev = 0;
+            switch (col.type) {
+            case T_UINT: case T_INT: case T_STR: case T_DELTA:
+                for (size_t i = 0; i < n; ++i) {
+                    if (!get_varint(q, qe, v)) return Fail(L"bad column");
+                    if (col.type == T_INT) v = (uint64_t)unzigzag(v);
+                    else if (col.type == T_DELTA) v = prev = prev + (uint64_t)unzigzag(v);
+                    else if (col.type == T_STR && v >= strings) return Fail(L"bad string id");
+                    out[i] = v;
+                }
+                break;
+            case T_BOOL:
+                if ((uint64_t)(qe - q) < (n + 7) / 8) return Fail(L"bad column");
+                for (size_t i = 0; i < n; ++i) out[i] = ((uint8_t)q[i / 8] >> (i % 8)) & 1;
+                break;
+            case T_STRLIST: case T_ANCESTRY: {
+                const int l = col.type == T_STRLIST ? 0 : 1;
+                const int per = col.type == T_STRLIST ? 1 : 2;
+                for (size_t i = 0; i < n; ++i) {
+                    uint64_t k;
+                    if (!get_varint(q, qe, k) || k > (uint64_t)(qe - q)) return Fail(L"bad column");
+                    for (uint64_t j = 0; j < k * per; ++j) {
+                        if (!get_varint(q, qe, v)) return Fail(L"bad column");
+                        if ((per == 1 || j % 2 == 1) && v >= strings) return Fail(L"bad string id");
+                        listVals_[l].push_back(v);
+                    }
+                    listOff_[l][i + 1] = (uint32_t)(listVals_[l].size() / per);
+                }
+                break;
+            }
+            default: break;
+            }
+        }
+        n_ = (size_t)n; at_ = 0;
+        return true;
+    }
+
+    std::wstring_view Reader::Str(uint64_t id) const {
+        if (!id) return {};
+        return std::wstring_view(arena_.data() + strOff_[(size_t)id - 1], strLen_[(size_t)id - 1]);
+    }
+
+    bool Reader::Next(Record& out) {
+        while (at_ >= n_) {
+            if (ended_ || !Ok()) return false;
+            char type;
+            if (!ReadBlock(type)) return false;
+            const char* p = block_.data();
+            const char* end = p + block_.size();
+            switch (type) {
+            case 'S': if (!Strings(p, end)) return false; break;
+            case 'R': arena_.clear(); strOff_.clear(); strLen_.clear(); break;
+            case 'B': if (!Batch(p, end)) return false; break;
+            case 'E': {
+                uint64_t count;
+                if (!get_varint(p, end, count) || count != total_) return Fail(L"record count mismatch");
+                ended_ = true;
+                return false;
+            }
+            default: break;   // newer block type: skipped
+            }
+        }
+        const size_t i = at_++;
+        ++total_;
+        auto s = [&](int f) { return Str(vals_[f][i]); };
+        auto dec = [&](int f) {
+            static const double kPow10[] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+            return (double)vals_[f][i] / kPow10[scale_[f]];
+        };
+        out.pid = (uint32_t)vals_[F_PID][i];
+        out.name = s(F_NAME); out.imagePath = s(F_IMAGE); out.commandLine = s(F_CMD); out.currentDirectory = s(F_CWD);
+        out.windowTitle = s(F_WTITLE); out.desktopInfo = s(F_DESK); out.shellInfo = s(F_SHELL); out.runtimeData = s(F_RTD);
+        out.sig.trusted = vals_[F_TRUSTED][i] != 0;
+        out.sig.trustStatus = s(F_STATUS); out.sig.publisher = s(F_PUBLISHER); out.sig.thumbprint = s(F_THUMBPRINT);
+        out.sig.sha256 = s(F_SHA256);
+        out.res = heur::Result();
+        out.res.score = (int)(int64_t)vals_[F_SCORE][i];
+        heur::ObfStats& o = out.res.obf;
+        o.length = (size_t)vals_[F_OBF_LENGTH][i]; o.longestBase64 = (size_t)vals_[F_OBF_B64][i]; o.longestHex = (size_t)vals_[F_OBF_HEX][i];
+        o.entropy = dec(F_OBF_ENTROPY); o.upperRatio = dec(F_OBF_UPPER); o.lowerRatio = dec(F_OBF_LOWER);
+        o.digitRatio = dec(F_OBF_DIGIT); o.symbolRatio = dec(F_OBF_SYMBOL); o.nonAsciiRatio = dec(F_OBF_NONASCII);
+        for (uint32_t k = listOff_[0][i]; k < listOff_[0][i + 1]; ++k) {
+            const uint64_t id = listVals_[0][k];
+            out.res.reasons.push_back(id ? arena_.data() + strOff_[(size_t)id - 1] : L"");
+        }
+        out.ancestry.n = 0;
+        for (uint32_t k = listOff_[1][i]; k < listOff_[1][i + 1] && out.ancestry.n < lin::kMaxDepth; ++k)
+            out.ancestry.v[out.ancestry.n++] = lin::Ancestor{ (uint32_t)listVals_[1][2 * k], Str(listVals_[1][2 * k + 1]) };
+        return true;
+    }
+
+    bool Convert(const std::wstring& path, OutputMode mode, uint64_t& records, std::wstring* err) {
+        Reader r;
+        records = 0;
+        if (!r.Open(path, err)) return false;
+        PrintBegin(mode);
+        Record rec;
+        while (r.Next(rec))
+            PrintProcess(rec.pid, rec.name, rec.imagePath, rec.commandLine, rec.currentDirectory,
+                rec.windowTitle, rec.desktopInfo, rec.shellInfo, rec.runtimeData, rec.sig, rec.res, &rec.ancestry);
+        PrintEnd();
+        records = r.Count();
+        if (!r.Ok() && err) *err = r.Error();
+        return r.Ok();
+    }
+} // namespace bin
@@ -0,0 +1,146 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "codesign.h"
+#include "heuristics.h"
+#include "lineage.h"
+#include "print.h"
+#include "serializer.h"
+
+// Compact binary output (--format bin) and its decoder (--decode). A stream of
+// length-prefixed blocks, readable front to back without seeking:
+//   "PHBIN" version(u8) | schema | block* | 'E' block
+//   schema: varint column count, then per column: name (varint length + ASCII), type (u8),
+//           scale (u8: the value is stored times 10^scale)
+//   block:  type (u8) | varint payload length | payload
+//     'S'  strings: varint count, then count x (varint length + UTF-8); they take the next
+//          ids of the file's dictionary (id 0 is the empty string)
+//     'R'  the dictionary starts over (the writer caps its size)
+//     'B'  batch: varint records, varint columns, then per column: varint schema index,
+//          varint length, data (one value per record, see ColType)
+//     'E'  end: varint record count; a file without it was cut short
+// Varints are LEB128; signed values are zigzag-encoded. Columns a reader does not know are
+// skipped, so columns can be added without breaking older decoders.
+namespace bin {
+    enum ColType : uint8_t {
+        T_UINT = 1,       // varint
+        T_INT = 2,        // zigzag varint
+        T_DELTA = 3,      // zigzag varint, difference to the previous record of the batch
+        T_STR = 4,        // varint string id
+        T_BOOL = 5,       // bitmap, record i is bit i % 8 of byte i / 8
+        T_STRLIST = 6,    // varint count, count string ids
+        T_ANCESTRY = 7,   // varint count, count x (varint pid, varint name id), parent first
+    };
+
+    constexpr char kMagic[5] = { 'P', 'H', 'B', 'I', 'N' };
+    constexpr uint8_t kVersion = 1;
+
+    class Writer {
+    public:
+        static constexpr size_t kBatch = 1024;
+        static constexpr size_t kMaxDictChars = 16u << 20;   // then 'R' and a fresh dictionary
+
+        explicit Writer(ser::Buffer& out);
+
+        void Begin();   // magic + schema; also resets the dictionary
+        void Add(
+            unsigned long pid, std::wstring_view name,
+            std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+            std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+            const SignView& sig, const heur::Result& heur, const lin::Chain* ancestry);
+        void Flush();   // new strings + the pending batch, if any
+        void End();     // Flush() + end block
+
+    private:
+        class Dict {
+        public:
+            uint32_t Intern(std::wstring_view s);   // 0 for ""
+            void Clear();
+            size_t Chars() const { return arena_.size(); }
+            size_t Count() const { return spans_.size() + 1; }
+            std::wstring_view At(uint32_t id) const { return std::wstring_view(arena_.data() + spans_[id - 1].off, spans_[id - 1].len); }
+        private:
+            struct Span { uint32_t off, len, hash; };
+            std::wstring arena_;
+            std::vector<Span> spans_;
+            std::vector<uint32_t> slots_;   // open addressing, ids
+        };
+
+        void Str(int col, std::wstring_view s);
+        void Block(char type);   // block_ as the payload
+
+        ser::Buffer& out_;
+        Dict dict_;
+        uint32_t sent_ = 1;              // ids below this are in the output already
+        size_t n_ = 0;                   // records in the pending batch
+        uint64_t total_ = 0;
+        uint32_t prevPid_ = 0;
+        std::vector<std::string> cols_;
+        std::string block_;
+        ser::Buffer utf8_{ 4096 };
+    };
+
+    // One decoded record. Views (and reason pointers) stay valid until the next Next().
+    struct Record {
+        uint32_t pid = 0;
+        std::wstring_view name, imagePath, commandLine, currentDirectory;
+        std::wstring_view windowTitle, desktopInfo, shellInfo, runtimeData;
+        SignView sig;
+        heur::Result res;      // score, obfuscation stats (3 decimals) and reasons as written
+        lin::Chain ancestry;
+    };
+
+    // Streams a file (or a buffer) block by block; memory is one block plus the dictionary.
+    class Reader {
+    public:
+        ~Reader() { Close(); }
+        bool Open(const std::wstring& path, std::wstring* err = nullptr);
+        bool Open(const char* data, size_t size, std::wstring* err = nullptr);
+        void Close();
+
+        bool Next(Record& out);   // false at the end or on an error (see Ok/Error)
+        bool Ok() const { return err_.empty(); }
+        const std::wstring& Error() const { return err_; }
+        uint64_t Count() const { return total_; }   // records read so far
+
+    private:
+        enum Field {
+            F_PID, F_NAME, F_IMAGE, F_CMD, F_CWD, F_WTITLE, F_DESK, F_SHELL, F_RTD,
+            F_TRUSTED, F_STATUS, F_PUBLISHER, F_THUMBPRINT, F_SCORE,
+            F_OBF_LENGTH, F_OBF_B64, F_OBF_HEX, F_OBF_ENTROPY, F_OBF_UPPER, F_OBF_LOWER, F_OBF_DIGIT, F_OBF_SYMBOL, F_OBF_NONASCII,
+            F_REASONS, F_ANCESTRY, F_SHA256, F_COUNT, F_UNKNOWN = F_COUNT
+        };
+        struct Column { int field = F_UNKNOWN; uint8_t type = 0, scale = 0; };
+
+        bool Header();
+        bool Read(void* dst, size_t n);
+        bool ReadBlock(char& type);
+        bool Strings(const char* p, const char* end);
+        bool Batch(const char* p, const char* end);
+        bool Fail(const wchar_t* why);
+        std::wstring_view Str(uint64_t id) const;
+
+        FILE* f_ = nullptr;
+        const char* mem_ = nullptr;
+        const char* memEnd_ = nullptr;
+        std::wstring err_;
+        std::vector<Column> schema_;
+        std::string block_;
+        std::wstring arena_;                  // dictionary strings, each followed by L'\0'
+        std::vector<uint32_t> strOff_, strLen_;
+        size_t n_ = 0, at_ = 0;               // records in the current batch, next one
+        std::vector<uint64_t> vals_[F_COUNT];            // scalar fields, n_ each
+        std::vector<uint32_t> listOff_[2];               // reasons, ancestry: n_ + 1 offsets
+        std::vector<uint64_t> listVals_[2];
+        uint8_t scale_[F_COUNT] = {};
+        uint64_t total_ = 0;
+        bool ended_ = false;
+    };
+
+    // --decode: a binary file to text/JSON/NDJSON through the regular printers.
+    bool Convert(const std::wstring& path, OutputMode mode, uint64_t& records, std::wstring* err);
+} // namespace bin
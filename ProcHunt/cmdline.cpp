@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: MIT
+#include "cmdline.h"
+#include <algorithm>
+#include <cwctype>
+
+namespace {
+    inline bool space(wchar_t c) { return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n'; }
+    // PowerShell also takes the en dash, em dash and horizontal bar as a parameter prefix.
+    inline bool switch_char(wchar_t c) { return c == L'-' || c == L'/' || c == 0x2013 || c == 0x2014 || c == 0x2015; }
+    inline wchar_t fold(wchar_t c) { return c < 128 ? (c >= L'A' && c <= L'Z' ? (wchar_t)(c + 32) : c) : (wchar_t)::towlower(c); }
+
+    bool iequals(std::wstring_view a, std::wstring_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) if (fold(a[i]) != b[i]) return false;
+        return true;
+    }
+    // a folded: is key (any case) a prefix of it?
+    bool iprefix(std::wstring_view key, std::wstring_view full) {
+        if (key.size() > full.size()) return false;
+        for (size_t i = 0; i < key.size(); ++i) if (fold(key[i]) != full[i]) return false;
+        return true;
+    }
+    std::wstring_view strip_exe(std::wstring_view v) {
+        if (v.size() > 4 && iequals(v.substr(v.size() - 4), L".exe")) v.remove_suffix(4);
+        return v;
+    }
+
+    enum PsNext : uint8_t { PS_PARAMS, PS_VALUE, PS_ENCODED, PS_WINDOWSTYLE, PS_SCRIPT };
+
+    // Windows PowerShell 5.1 parameters in the order its parser tries them; a key matches
+    // an entry when it is a prefix of the name at least as long as `shortest`.
+    struct PsParam { std::wstring_view name, shortest; PsNext next; };
+    const PsParam kPsParams[] = {
+        { L"psconsolefile", L"psc", PS_VALUE }, { L"version", L"v", PS_VALUE },
+        { L"nologo", L"nol", PS_PARAMS }, { L"noexit", L"noe", PS_PARAMS },
+        { L"sta", L"s", PS_PARAMS }, { L"mta", L"m", PS_PARAMS },
+        { L"noprofile", L"nop", PS_PARAMS }, { L"noninteractive", L"noni", PS_PARAMS },
+        { L"inputformat", L"i", PS_VALUE }, { L"outputformat", L"o", PS_VALUE },
+        { L"windowstyle", L"w", PS_WINDOWSTYLE }, { L"encodedcommand", L"e", PS_ENCODED },
+        { L"configurationname", L"config", PS_VALUE }, { L"file", L"f", PS_SCRIPT },
+        { L"executionpolicy", L"ex", PS_VALUE }, { L"command", L"c", PS_SCRIPT },
+        { L"help", L"h", PS_PARAMS },
+    };
+    const struct { std::wstring_view alias; const PsParam* param; } kPsAliases[] = {
+        { L"ec", &kPsParams[11] }, { L"ep", &kPsParams[14] }, { L"?", &kPsParams[16] },
+    };
+
+    const PsParam* ps_param(std::wstring_view key) {
+        for (const auto& a : kPsAliases) if (iequals(key, a.alias)) return a.param;
+        for (const PsParam& p : kPsParams) if (key.size() >= p.shortest.size() && iprefix(key, p.name)) return &p;
+        return nullptr;
+    }
+
+    struct Program { std::wstring_view name; uint8_t kind; };
+    enum : uint8_t { K_POWERSHELL = 1, K_CMD, K_DASH, K_SLASH, K_OTHER };
+    const Program kPrograms[] = {
+        { L"powershell", K_POWERSHELL }, { L"pwsh", K_POWERSHELL }, { L"cmd", K_CMD },
+        { L"certutil", K_DASH },
+        { L"bitsadmin", K_SLASH }, { L"regsvr32", K_SLASH }, { L"schtasks", K_SLASH }, { L"msiexec", K_SLASH }, { L"wmic", K_SLASH },
+        { L"rundll32", K_OTHER }, { L"mshta", K_OTHER }, { L"wscript", K_OTHER }, { L"cscript", K_OTHER },
+        { L"reg", K_OTHER }, { L"netsh", K_OTHER }, { L"curl", K_OTHER }, { L"wget", K_OTHER },
+    };
+
+    // Bit i: some tool name starts with 'a' + i. Most tokens stop there.
+    const uint32_t kInitials = [] {
+        uint32_t m = 0;
+        for (const Program& p : kPrograms) m |= 1u << (p.name[0] - L'a');
+        return m;
+    }();
+
+    // base: the file name part of a token.
+    uint8_t tool_of(std::wstring_view base) {
+        base = strip_exe(base);
+        if (base.size() < 3 || base.size() > 10) return 0;
+        const wchar_t c = fold(base[0]);
+        if (c < L'a' || c > L'z' || !(kInitials >> (c - L'a') & 1)) return 0;
+        for (const Program& p : kPrograms) if (iequals(base, p.name)) return p.kind;
+        return 0;
+    }
+
+    uint8_t program_of(std::wstring_view v) {
+        size_t b = v.size();
+        while (b && v[b - 1] != L'\\' && v[b - 1] != L'/') --b;
+        return tool_of(v.substr(b));
+    }
+
+    // Case folding of a run: ASCII without a call per character, the rest (rare) after.
+    void fold_into(wchar_t* d, std::wstring_view v) {
+        unsigned wide = 0;   // not bool: that keeps the loop from vectorizing
+        for (size_t i = 0; i < v.size(); ++i) {
+            const wchar_t c = v[i];
+            wide |= (unsigned)c >> 7;
+            d[i] = (wchar_t)(c + ((unsigned)(c - L'A') < 26u ? 32 : 0));
+        }
+        if (wide) for (size_t i = 0; i < v.size(); ++i) if (v[i] >= 128) d[i] = (wchar_t)::towlower(v[i]);
+    }
+
+    // Past the characters that neither end nor escape an argument: anything above '"' but
+    // the backslash. Eight at a time first; arguments such as base64 payloads run long.
+    size_t skip_plain(std::wstring_view s, size_t i) {
+        const size_t n = s.size();
+        for (; i + 8 <= n; i += 8) {
+            unsigned stop = 0;
+            for (size_t k = 0; k < 8; ++k) stop |= (unsigned)(s[i + k] <= L'"') | (unsigned)(s[i + k] == L'\\');
+            if (stop) break;
+        }
+        while (i < n && s[i] > L'"' && s[i] != L'\\') ++i;
+        return i;
+    }
+
+    bool has_switch(std::wstring_view v) {
+        for (size_t i = 1; i < v.size(); ++i) if (switch_char(v[i]) && space(v[i - 1])) return true;
+        return false;
+    }
+
+    // cmd.exe: ^x -> x (so ^^ -> ^).
+    void strip_carets(std::wstring_view v, std::wstring& out) {
+        out.clear();
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (v[i] == L'^' && i + 1 < v.size()) ++i;
+            out.push_back(v[i]);
+        }
+    }
+
+    struct B64Table {
+        int8_t v[128];
+        B64Table() {
+            for (auto& x : v) x = -1;
+            for (int i = 0; i < 26; ++i) { v['A' + i] = (int8_t)i; v['a' + i] = (int8_t)(26 + i); }
+            for (int i = 0; i < 10; ++i) v['0' + i] = (int8_t)(52 + i);
+            v['+'] = v['-'] = 62;
+            v['/'] = v['_'] = 63;
+        }
+    };
+    const B64Table kB64;
+} // anon
+
+namespace cmdline {
+    void Tokenize(std::wstring_view s, std::vector<Token>& out, bool firstIsProgram) {
+        out.clear();
+        const size_t n = s.size();
+        size_t i = 0;
+        bool first = firstIsProgram;
+        for (;;) {
+            while (i < n && space(s[i])) ++i;
+            if (i >= n) break;
+            Token t;
+            t.off = (uint32_t)i;
+            if (first) {
+                first = false;
+                t.program = true;
+                if (s[i] == L'"') {
+                    const size_t e = s.find(L'"', i + 1);
+                    i = e == std::wstring_view::npos ? n : e + 1;
+                    t.plain = false;
+                }
+                else while (i < n && !space(s[i])) ++i;
+            }
+            else {
+                bool quoted = false;
+                while (i < n) {
+                    const wchar_t c = s[i];
+                    if (c > L'"' && c != L'\\') { i = skip_plain(s, i + 1); continue; }
+                    if (c == L'\\') {
+                        size_t k = 0;
+                        while (i < n && s[i] == L'\\') { ++i; ++k; }
+                        if (i < n && s[i] == L'"') {
+                            t.plain = false;
+                            if (k % 2) ++i;   // escaped quote: literal
+                        }
+                        continue;
+                    }
+                    if (c == L'"') {
+                        t.plain = false;
+                        if (quoted && i + 1 < n && s[i + 1] == L'"') { i += 2; continue; }
+                        quoted = !quoted;
+                        ++i;
+                        continue;
+                    }
+                    if (!quoted && space(c)) break;
+                    ++i;
+                }
+            }
+            t.len = (uint32_t)(i - t.off);
+            out.push_back(t);
+        }
+    }
+
+    std::wstring_view Value(std::wstring_view s, const Token& t, std::wstring& scratch) {
+        const std::wstring_view raw = s.substr(t.off, t.len);
+        if (t.plain) return raw;
+        if (t.program) {   // "path" (the closing quote may be missing)
+            const std::wstring_view v = raw.substr(1);
+            return !v.empty() && v.back() == L'"' ? v.substr(0, v.size() - 1) : v;
+        }
+        scratch.clear();
+        bool quoted = false;
+        for (size_t i = 0; i < raw.size();) {
+            const wchar_t c = raw[i];
+            if (c == L'\\') {
+                size_t k = 0;
+                while (i < raw.size() && raw[i] == L'\\') { ++i; ++k; }
+                if (i < raw.size() && raw[i] == L'"') {
+                    scratch.append(k / 2, L'\\');
+                    if (k % 2) { scratch.push_back(L'"'); ++i; }
+                }
+                else scratch.append(k, L'\\');
+                continue;
+            }
+            if (c == L'"') {
+                if (quoted && i + 1 < raw.size() && raw[i + 1] == L'"') { scratch.push_back(L'"'); i += 2; continue; }
+                quoted = !quoted;
+                ++i;
+                continue;
+            }
+            scratch.push_back(c);
+            ++i;
+        }
+        return scratch;
+    }
+
+    bool DecodeBase64Utf16(std::wstring_view b64, std::wstring& out) {
+        out.clear();
+        uint32_t acc = 0;
+        int bits = 0;
+        int lo = -1;            // low byte of the code unit being assembled
+        uint32_t high = 0;      // pending high surrogate (32-bit wchar_t)
+        bool padding = false;
+        auto unit = [&](uint32_t u) {
+            if (sizeof(wchar_t) == 2) { out.push_back((wchar_t)u); return; }
+            if (high) {
+                if (u >= 0xDC00 && u <= 0xDFFF) { out.push_back((wchar_t)(0x10000 + ((high - 0xD800) << 10) + (u - 0xDC00))); high = 0; return; }
+                out.push_back((wchar_t)high);
+                high = 0;
+            }
+            if (u >= 0xD800 && u <= 0xDBFF) high = u;
+            else out.push_back((wchar_t)u);
+        };
+        for (wchar_t c : b64) {
+            if (space(c)) continue;
+            if (c == L'=') { padding = true; continue; }
+            const int v = c < 128 ? kB64.v[c] : -1;
+            if (v < 0 || padding) return false;
+            acc = (acc << 6) | (uint32_t)v;
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                const int byte = (int)((acc >> bits) & 0xFF);
+                if (lo < 0) lo = byte;
+                else { unit((uint32_t)lo | (uint32_t)byte << 8); lo = -1; }
+            }
+        }
+        if (high) out.push_back((wchar_t)high);
+        return lo < 0;
+    }
+
+    std::wstring_view Normalizer::Normalize(std::wstring_view cmd) {
+        out_.clear();
+        payloadRaw_.clear();
+        hasPayload_ = decoded_ = false;
+        if (!Fold(cmd)) {
+            out_.clear();
+            Render(cmd, 0);
+        }
+        return out_;
+    }
+
+    // What Render makes of a line whose arguments are all plain and none a known tool: the
+    // program name without its quotes and each argument, folded, one space between them.
+    // False as soon as the line is not like that.
+    bool Normalizer::Fold(std::wstring_view cmd) {
+        size_t i = 0;
+        while (i < cmd.size() && space(cmd[i])) ++i;
+        std::wstring_view program;
+        if (i < cmd.size() && cmd[i] == L'"') {   // as Tokenize reads a quoted program name
+            const size_t e = cmd.find(L'"', i + 1);
+            program = cmd.substr(i + 1, (e == std::wstring_view::npos ? cmd.size() : e) - i - 1);
+            if (program_of(program)) return false;
+            i = e == std::wstring_view::npos ? cmd.size() : e + 1;
+        }
+        if (cmd.find(L'"', i) != std::wstring_view::npos) return false;
+
+        // The arguments are folded in one go behind the program name (and room for a space,
+        // the opening quote's), then squeezed to one space between tokens in place.
+        out_.resize(cmd.size());
+        wchar_t* d = &out_[0];
+        fold_into(d, program);
+        size_t n = program.size(), r = program.empty() ? 0 : n + 1;
+        const size_t end = r + cmd.size() - i;
+        fold_into(d + r, cmd.substr(i));
+        while (r < end) {
+            if (space(d[r])) { ++r; continue; }
+            const size_t start = r;
+            size_t base = r;
+            for (; r < end && !space(d[r]); ++r) if (d[r] == L'\\' || d[r] == L'/') base = r + 1;
+            if (tool_of(std::wstring_view(d + base, r - base))) return false;
+            if (n) d[n++] = L' ';
+            if (n != start) std::copy(d + start, d + r, d + n);
+            n += r - start;
+        }
+        out_.resize(n);
+        return true;
+    }
+
+    std::wstring_view Normalizer::Payload() {
+        if (!decoded_) {
+            decoded_ = true;
+            if (!hasPayload_ || !DecodeBase64Utf16(payloadRaw_, payload_)) payload_.clear();
+            for (auto& c : payload_) c = fold(c);
+        }
+        return payload_;
+    }
+
+    void Normalizer::Emit(std::wstring_view v) {
+        const size_t at = out_.size() + !out_.empty();
+        out_.resize(at + v.size(), L' ');
+        fold_into(&out_[at], v);
+    }
+
+    void Normalizer::EmitSwitch(wchar_t ch, std::wstring_view name) {
+        if (!out_.empty()) out_.push_back(L' ');
+        out_.push_back(ch);
+        for (wchar_t c : name) out_.push_back(fold(c));
+    }
+
+    void Normalizer::Render(std::wstring_view cmd, int depth) {
+        std::vector<Token>& toks = tokens_[depth];
+        Tokenize(cmd, toks);
+        uint8_t prog = 0;
+        PsNext ps = PS_PARAMS;
+        for (size_t i = 0; i < toks.size(); ++i) {
+            std::wstring_view v = Value(cmd, toks[i], scratch_[depth]);
+            if (prog == K_CMD && v.find(L'^') != std::wstring_view::npos) { strip_carets(v, carets_[depth]); v = carets_[depth]; }
+            if (v.empty()) continue;
+
+            // A tool name starts its own arguments (cmd /c x, start y, a pipeline), except
+            // inside a PowerShell script or parameter value.
+            if (prog != K_POWERSHELL || ps == PS_PARAMS) {
+                if (const uint8_t p = program_of(v)) {
+                    prog = p;
+                    ps = PS_PARAMS;
+                    Emit(strip_exe(v));
+                    continue;
+                }
+            }
+            switch (prog) {
+            case K_CMD:
+                if (v.size() == 2 && switch_char(v[0]) && (fold(v[1]) == L'c' || fold(v[1]) == L'k' || fold(v[1]) == L'r')) {
+                    EmitSwitch(L'/', fold(v[1]) == L'k' ? L"k" : L"c");   // /r is /c
+                    if (depth + 1 == kMaxDepth) break;
+                    // The rest of the line is a command of its own. cmd keeps the quotes around
+                    // a lone program name ("C:\a b\x.exe": two quotes, nothing after, which we
+                    // take as ending in .exe with no switches inside); otherwise it drops the
+                    // first and the last quote. Then it reads carets again.
+                    std::wstring_view rest = cmd.substr(toks[i].off + toks[i].len);
+                    while (!rest.empty() && space(rest.front())) rest.remove_prefix(1);
+                    if (rest.empty()) return;   // "cmd /c" alone
+                    std::wstring& n = nested_[depth];
+                    const size_t last = rest.rfind(L'"');
+                    const bool program = last != std::wstring_view::npos && last > 0 && last + 1 == rest.size()
+                        && rest.find(L'"', 1) == last
+                        && strip_exe(rest.substr(1, last - 1)).size() != last - 1 && !has_switch(rest.substr(1, last - 1));
+                    if (rest.front() == L'"' && !program) {
+                        strip_carets(rest.substr(1, last - 1), n);
+                        if (last != 0) { strip_carets(rest.substr(last + 1), tail_); n += tail_; }
+                    }
+                    else strip_carets(rest, n);
+                    Render(n, depth + 1);
+                    return;
+                }
+                Emit(v);
+                break;
+            case K_POWERSHELL:
+                if (ps == PS_SCRIPT) { Emit(v); break; }
+                if (ps == PS_ENCODED) { payloadRaw_.assign(v); hasPayload_ = true; Emit(v); ps = PS_PARAMS; break; }
+                if (ps == PS_WINDOWSTYLE) {
+                    static const wchar_t* const kStyles[] = { L"normal", L"hidden", L"minimized", L"maximized" };
+                    if (v.size() == 1 && v[0] >= L'0' && v[0] <= L'3') Emit(kStyles[v[0] - L'0']);
+                    else Emit(v);
+                    ps = PS_PARAMS;
+                    break;
+                }
+                if (ps == PS_VALUE) { Emit(v); ps = PS_PARAMS; break; }
+                if (v.size() > 1 && switch_char(v[0])) {
+                    if (const PsParam* p = ps_param(v.substr(1))) { EmitSwitch(L'-', p->name); ps = p->next; break; }
+                    Emit(v);   // not a parameter powershell.exe knows: as written
+                    break;
+                }
+                ps = PS_SCRIPT;   // the first other argument is the command
+                Emit(v);
+                break;
+            case K_DASH: case K_SLASH:
+                if (v.size() > 1 && switch_char(v[0])) EmitSwitch(prog == K_DASH ? L'-' : L'/', v.substr(1));
+                else Emit(v);
+                break;
+            default:
+                Emit(v);
+                break;
+            }
+        }
+    }
+} // namespace cmdline
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Command lines as the rules see them (field cmd). The command line is split once into
+// argv-style tokens (spans over the original text, unquoted only when they need it) and
+// rendered as one case-folded string: quotes and cmd.exe carets removed, one space between
+// tokens, PowerShell parameters spelled out (-e, -ec, /enc, -EncodedC -> -encodedcommand;
+// -w 1 -> -windowstyle hidden) and switch characters made uniform for tools that accept
+// both - and / (certutil -, schtasks/bitsadmin/regsvr32 /). Known tools lose ".exe", so
+// "certutil.exe /urlcache" reads "certutil -urlcache". The command after cmd /c or /k is
+// rendered the same way. A PowerShell -EncodedCommand payload is only decoded when asked.
+// A line whose arguments have no quotes and name none of those tools renders as itself,
+// folded with one space between tokens, and takes a single pass instead of the tokenizer.
+namespace cmdline {
+    struct Token {
+        uint32_t off = 0, len = 0;   // raw span, quotes included
+        bool plain = true;           // no quotes or escapes: the span is the value
+        bool program = false;        // first token: quotes are not escapes
+    };
+
+    // The program name (first token) ends at the closing quote or at white space, without
+    // escapes; the arguments follow the msvcrt rules: 2n backslashes + quote -> n backslashes
+    // and the quote toggles quoting, 2n+1 -> n backslashes and a literal quote, "" inside
+    // quotes -> a literal quote. Other backslashes are literal.
+    void Tokenize(std::wstring_view cmd, std::vector<Token>& out, bool firstIsProgram = true);
+    // The argument: a view into cmd for a plain token, else unescaped into scratch.
+    std::wstring_view Value(std::wstring_view cmd, const Token& t, std::wstring& scratch);
+
+    // Base64 (standard or URL-safe alphabet, padding optional, white space ignored) of
+    // UTF-16LE text. False on other characters or an odd number of bytes.
+    bool DecodeBase64Utf16(std::wstring_view b64, std::wstring& out);
+
+    // One per thread; buffers keep their capacity between calls.
+    class Normalizer {
+    public:
+        static constexpr int kMaxDepth = 4;   // cmd /c nesting rendered as commands
+
+        // Valid until the next call.
+        std::wstring_view Normalize(std::wstring_view cmd);
+        bool HasEncodedCommand() const { return hasPayload_; }
+        // The -EncodedCommand script of the last Normalize, decoded and case-folded on the
+        // first call; empty when there is none or it is not valid base64 UTF-16LE.
+        std::wstring_view Payload();
+
+    private:
+        bool Fold(std::wstring_view cmd);
+        void Render(std::wstring_view cmd, int depth);
+        void Emit(std::wstring_view v);
+        void EmitSwitch(wchar_t ch, std::wstring_view name);
+
+        std::wstring out_;
+        std::vector<Token> tokens_[kMaxDepth];
+        std::wstring scratch_[kMaxDepth], carets_[kMaxDepth], nested_[kMaxDepth], tail_;
+        std::wstring payloadRaw_, payload_;
+        bool hasPayload_ = false, decoded_ = false;
+    };
+} // namespace cmdline
@@ -1,11 +1,25 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 struct SignInfo {
     bool trusted = false;            // WinVerifyTrust == ERROR_SUCCESS
     std::wstring trustStatus;        // textual status / code
     std::wstring publisher;          // Subject (simple display)
     std::wstring thumbprint;         // SHA1 hex
+    std::wstring sha256;             // image SHA-256 hex, only with --ioc-hashes (ioc::Hasher)
+};
+
+// Non-owning view of a SignInfo (or of signature fields stored elsewhere, e.g. a snapshot).
+struct SignView {
+    bool trusted = false;
+    std::wstring_view trustStatus;
+    std::wstring_view publisher;
+    std::wstring_view thumbprint;
+    std::wstring_view sha256;
+
+    SignView() = default;
+    SignView(const SignInfo& s) : trusted(s.trusted), trustStatus(s.trustStatus), publisher(s.publisher), thumbprint(s.thumbprint), sha256(s.sha256) {}
 };
 
 // Verify file signature and extract publisher/thumbprint.
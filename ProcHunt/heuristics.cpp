@@ -1,146 +1,395 @@
 #include "heuristics.h"
+#include "cmdline.h"
+#include "ioc.h"
+#include "lookalike.h"
+#include "rules.h"
 #include "utils.h"
+#include "whitelist.h"
 #include <algorithm>
-#include <regex>
+#include <cstring>
+#include <cwctype>
 
 using std::wstring;
 
 namespace {
-    std::vector<wstring> g_pub_wl = {
+    const std::vector<wstring> kDefaultPubWl = {
         L"Microsoft Windows", L"Microsoft Corporation", L"Microsoft Windows Publisher"
     };
-    std::vector<wstring> g_path_wl = {
+    const std::vector<wstring> kDefaultPathWl = {
         L"C:\\Windows\\System32", L"C:\\Windows\\SysWOW64",
         L"C:\\Program Files", L"C:\\Program Files (x86)"
     };
+    // Indexed once when loaded: publishers in a hash set, path prefixes in a component trie.
+    struct Whitelists {
+        heur::FoldedSet pubs;
+        heur::PathPrefixSet paths;
+        Whitelists() { Reset(); }
+        void Reset() {
+            pubs.Clear(); paths.Clear();
+            for (auto& p : kDefaultPubWl) pubs.Add(p);
+            for (auto& p : kDefaultPathWl) paths.Add(p);
+        }
+    };
+    Whitelists g_wl;
+
+    const wchar_t kDefaultProtectedNames[] =
+#include "protected_names.inc"
+        ;
+    struct ProtectedNames {
+        heur::NameIndex index;
+        ProtectedNames() { Reset(); }
+        void Reset() {
+            index.Clear();
+            std::wstring_view t = kDefaultProtectedNames;
+            while (!t.empty()) {
+                const size_t nl = t.find(L'\n');
+                index.Add(t.substr(0, nl));
+                t.remove_prefix(nl == std::wstring_view::npos ? t.size() : nl + 1);
+            }
+        }
+    };
+    ProtectedNames g_protected;
+
+    size_t last_slash(std::wstring_view p) { return p.find_last_of(L"\\/"); }
+    std::wstring_view dirname_view(std::wstring_view p) {
+        size_t i = last_slash(p);
+        return i == std::wstring_view::npos ? std::wstring_view{} : p.substr(0, i);
+    }
+    std::wstring_view basename_view(std::wstring_view p) {
+        size_t i = last_slash(p);
+        return i == std::wstring_view::npos ? p : p.substr(i + 1);
+    }
+    std::wstring_view rstrip_slash_view(std::wstring_view p) {
+        while (!p.empty() && (p.back() == L'\\' || p.back() == L'/')) p.remove_suffix(1);
+        return p;
+    }
+
+    // Case-folded copies of the short fields, packed into one per-thread buffer whose
+    // capacity is kept between evaluations.
+    struct EvalContext {
+        wstring arena;
+        std::wstring_view img, cwd, name, pub, parent;
+        cmdline::Normalizer cmd;
+
+        void Fold(std::wstring_view i, std::wstring_view c, std::wstring_view n, std::wstring_view p, std::wstring_view par) {
+            arena.resize(i.size() + c.size() + n.size() + p.size() + par.size());
+            wchar_t* d = &arena[0];
+            auto fold = [&](std::wstring_view s) {
+                wchar_t* b = d;
+                for (wchar_t ch : s) *d++ = (wchar_t)::towlower(ch);
+                return std::wstring_view(b, s.size());
+            };
+            img = fold(i); cwd = fold(c); name = fold(n); pub = fold(p); parent = fold(par);
+        }
+    };
+    thread_local EvalContext t_ctx;
+
+    void fill_input(const EvalContext& ctx, heur::RuleInput& in) {
+        using namespace heur;
+        in.fields[F_IMAGE] = ctx.img;
+        in.fields[F_CWD] = ctx.cwd;
+        in.fields[F_NAME] = ctx.name.empty() ? basename_view(ctx.img) : ctx.name;
+        in.fields[F_PUBLISHER] = ctx.pub;
+        in.fields[F_PARENT] = ctx.parent;
+    }
+
+    // The command line as tokens rendered by the normalizer; the encoded payload is only
+    // decoded when a rule looks at it.
+    void cmd_fields(EvalContext& ctx, std::wstring_view commandLine, uint32_t usedFields, heur::RuleInput& in) {
+        using namespace heur;
+        if (!(usedFields & (1u << F_CMD | 1u << F_PAYLOAD))) return;
+        in.fields[F_CMD] = ctx.cmd.Normalize(commandLine);
+        if ((usedFields & (1u << F_PAYLOAD)) && ctx.cmd.HasEncodedCommand()) in.fields[F_PAYLOAD] = ctx.cmd.Payload();
+    }
+
+    // Built-in tests on the image path, CWD and name; whitelist and protected-name lookups
+    // only when a rule refers to them.
+    void path_tests(const EvalContext& ctx, uint32_t used, heur::RuleInput& in) {
+        using namespace heur;
+        const std::wstring_view img = ctx.img, cwd = ctx.cwd, name = ctx.name;
+        uint32_t t = 0;
+        if (!img.empty() && !name.empty() && name != basename_view(img)) t |= T_NAME_MISMATCH;
+        if (!img.empty() && !cwd.empty() && rstrip_slash_view(dirname_view(img)) != rstrip_slash_view(cwd)) t |= T_CWD_OUTSIDE_IMAGE_DIR;
+        if ((used & T_PATH_WHITELISTED) && g_wl.paths.Match(img)) t |= T_PATH_WHITELISTED;
+        NameIndex::Hit hit;
+        if ((used & T_NAME_LOOKALIKE) && g_protected.index.Lookalike(in.fields[F_NAME], hit)) {
+            t |= T_NAME_LOOKALIKE;
+            in.detail[TestIndex(T_NAME_LOOKALIKE)] = hit.reason;
+        }
+        in.tests |= t;
+    }
+
+    // EvaluateBatch works through the batch in tiles of kTile records: each tile's folded
+    // columns and per-record masks stay in cache while every field and test passes over them.
+    constexpr size_t kTile = 256;
+
+    // Command-line results by distinct line for the whole batch: fleet batches repeat the
+    // same service and tool lines many times. Lines longer than kMemoLine (mostly encoded
+    // payloads, nearly always unique) are not memoized.
+    constexpr size_t kMemoLine = 512;
+    constexpr size_t kMemoSlots = 1u << 16;
+    struct CmdMemo {
+        std::wstring_view line;
+        uint32_t hash;
+        uint64_t match;   // command-line and payload rules
+        heur::ObfStats obf;
+    };
+
+    inline uint32_t hash_line(std::wstring_view s) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ s.size();
+        const char* p = (const char*)s.data();
+        size_t n = s.size() * sizeof(wchar_t);
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        for (; n; ++p, --n) h = (h ^ (uint8_t)*p) * 0x100000001B3ull;
+        h ^= h >> 29;
+        return (uint32_t)h;
+    }
+
+    struct BatchContext {
+        wstring arena;
+        std::vector<std::wstring_view> col[heur::F_COUNT];   // folded; F_NAME falls back to the image basename
+        std::vector<uint64_t> match;
+        std::vector<uint32_t> tests;
+        cmdline::Normalizer cmd;
+        std::vector<CmdMemo> memo;
+        std::vector<uint32_t> slots;   // power of two, memo index + 1, 0 = free
+
+        BatchContext() {
+            for (auto& c : col) c.resize(kTile);
+            match.resize(kTile); tests.resize(kTile);
+        }
+        void ResetMemo(size_t n) {
+            size_t want = 64;
+            while (want < 2 * n && want < kMemoSlots) want <<= 1;
+            memo.clear();
+            slots.assign(want, 0);
+        }
+        // Memoized entry for line, or null; `h` is its hash either way.
+        const CmdMemo* Find(std::wstring_view line, uint32_t& h) const {
+            h = hash_line(line);
+            const size_t mask = slots.size() - 1;
+            for (size_t i = h & mask; slots[i]; i = (i + 1) & mask) {
+                const CmdMemo& m = memo[slots[i] - 1];
+                if (m.hash == h && m.line == line) return &m;
+            }
+            return nullptr;
+        }
+        void Add(const CmdMemo& m) {
+            if (2 * (memo.size() + 1) > slots.size()) return;   // full: the rest is computed
+            const size_t mask = slots.size() - 1;
+            size_t i = m.hash & mask;
+            while (slots[i]) i = (i + 1) & mask;
+            memo.push_back(m);
+            slots[i] = (uint32_t)memo.size();
+        }
+    };
+    thread_local BatchContext t_batch;
 
-    bool any_starts_with(const wstring& val, const std::vector<wstring>& prefixes) {
-        auto lc = util::lcase(val);
-        for (auto p : prefixes) {
-            auto lcp = util::lcase(util::rstrip_slash(p));
-            if (!lcp.empty() && lc.rfind(lcp, 0) == 0) return true;
+    void batch_tile(BatchContext& ctx, const heur::RuleSet& rules, const heur::BatchView& in, size_t b, size_t n, heur::BatchResult& out) {
+        using namespace heur;
+        const uint32_t used = rules.UsedTests(), fields = rules.UsedFields();
+        const std::wstring_view* pubSrc = (fields & (1u << F_PUBLISHER)) || (used & T_PUBLISHER_WHITELISTED) ? in.publisher : nullptr;
+        const std::wstring_view* parentSrc = (fields & (1u << F_PARENT)) ? in.parentName : nullptr;
+
+        size_t total = 0;
+        for (const std::wstring_view* src : { in.imagePath, in.currentDir, in.processName, pubSrc, parentSrc })
+            if (src) for (size_t i = 0; i < n; ++i) total += src[b + i].size();
+        ctx.arena.resize(total);
+        wchar_t* d = &ctx.arena[0];
+        auto fold = [&](const std::wstring_view* src, std::vector<std::wstring_view>& dst) {
+            for (size_t i = 0; i < n; ++i) {
+                const std::wstring_view s = src ? src[b + i] : std::wstring_view{};
+                wchar_t* f = d;
+                for (wchar_t ch : s) *d++ = (wchar_t)::towlower(ch);
+                dst[i] = std::wstring_view(f, s.size());
+            }
+        };
+        std::wstring_view* const img = ctx.col[F_IMAGE].data();
+        std::wstring_view* const cwd = ctx.col[F_CWD].data();
+        std::wstring_view* const name = ctx.col[F_NAME].data();
+        std::wstring_view* const pub = ctx.col[F_PUBLISHER].data();
+        fold(in.imagePath, ctx.col[F_IMAGE]);
+        fold(in.currentDir, ctx.col[F_CWD]);
+        fold(in.processName, ctx.col[F_NAME]);
+        fold(pubSrc, ctx.col[F_PUBLISHER]);
+        fold(parentSrc, ctx.col[F_PARENT]);
+        for (size_t i = 0; i < n; ++i) if (name[i].empty()) name[i] = basename_view(img[i]);
+
+        // Field rules, one field across the tile at a time.
+        uint64_t* const match = ctx.match.data();
+        for (size_t i = 0; i < n; ++i) match[i] = rules.Always();
+        for (Field f : { F_IMAGE, F_CWD, F_NAME, F_PUBLISHER, F_PARENT }) {
+            if (!(fields & (1u << f))) continue;
+            const std::wstring_view* v = ctx.col[f].data();
+            for (size_t i = 0; i < n; ++i) match[i] |= rules.MatchField(f, v[i]);
+        }
+
+        // Command line: rules on the normalized line and payload, and the obfuscation
+        // statistics, once per distinct line. The normalizer reuses its buffer, so each line
+        // is matched as soon as it is rendered.
+        uint32_t* const tests = ctx.tests.data();
+        const bool cmdRules = (fields & (1u << F_CMD | 1u << F_PAYLOAD)) != 0;
+        for (size_t i = 0; i < n; ++i) {
+            const std::wstring_view line = in.commandLine[b + i];
+            uint32_t h = 0;
+            const CmdMemo* hit = line.size() <= kMemoLine ? ctx.Find(line, h) : nullptr;
+            CmdMemo m{ line, h, 0, {} };
+            if (hit) m = *hit;
+            else {
+                if (cmdRules) {
+                    m.match = rules.MatchField(F_CMD, ctx.cmd.Normalize(line));
+                    if ((fields & (1u << F_PAYLOAD)) && ctx.cmd.HasEncodedCommand()) m.match |= rules.MatchField(F_PAYLOAD, ctx.cmd.Payload());
+                }
+                m.obf = AnalyzeCommandLine(line);
+                if (line.size() <= kMemoLine) ctx.Add(m);
+            }
+            match[i] |= m.match;
+            out.obf[b + i] = m.obf;
+            tests[i] = m.obf.Obfuscated() ? (uint32_t)T_OBFUSCATED : 0u;
+        }
+
+        // The other tests, one at a time; the name (with its basename fallback) only differs
+        // from the image basename when a name was given.
+        for (size_t i = 0; i < n; ++i) if (!img[i].empty() && name[i] != basename_view(img[i])) tests[i] |= T_NAME_MISMATCH;
+        for (size_t i = 0; i < n; ++i)
+            if (!img[i].empty() && !cwd[i].empty() && rstrip_slash_view(dirname_view(img[i])) != rstrip_slash_view(cwd[i])) tests[i] |= T_CWD_OUTSIDE_IMAGE_DIR;
+        if (used & T_PATH_WHITELISTED)
+            for (size_t i = 0; i < n; ++i) if (g_wl.paths.Match(img[i])) tests[i] |= T_PATH_WHITELISTED;
+        for (size_t i = 0; i < n; ++i) out.lookalike[b + i] = nullptr;
+        if (used & T_NAME_LOOKALIKE) {
+            NameIndex::Hit hit;
+            for (size_t i = 0; i < n; ++i) {
+                if (!g_protected.index.Lookalike(name[i], hit)) continue;
+                tests[i] |= T_NAME_LOOKALIKE;
+                out.lookalike[b + i] = hit.reason;
+            }
+        }
+        if (in.trusted)
+            for (size_t i = 0; i < n; ++i) if (in.trusted[b + i]) tests[i] |= T_SIGNED;
+        if (used & T_PUBLISHER_WHITELISTED)
+            for (size_t i = 0; i < n; ++i) if (!pub[i].empty() && g_wl.pubs.Contains(pub[i])) tests[i] |= T_PUBLISHER_WHITELISTED;
+        if (in.sha256 && (used & T_IOC_HASH))
+            for (size_t i = 0; i < n; ++i) if (!in.sha256[b + i].empty() && ioc::Listed(in.sha256[b + i])) tests[i] |= T_IOC_HASH;
+
+        for (size_t i = 0; i < n; ++i) {
+            int score = 0;
+            out.held[b + i] = rules.Hold(match[i] | rules.MatchTests(tests[i]), score);
+            out.scores[b + i] = score < 0 ? 0 : (score > 100 ? 100 : score);
         }
-        return false;
-    }
-    bool any_equals_ci(const wstring& val, const std::vector<wstring>& items) {
-        for (auto& it : items) if (util::iequals(val, it)) return true;
-        return false;
-    }
-    bool has_any(const wstring& s, std::initializer_list<const wchar_t*> needles) {
-        auto ls = util::lcase(s);
-        for (auto n : needles) if (ls.find(util::lcase(n)) != wstring::npos) return true;
-        return false;
-    }
-    bool path_in_user_writable(const wstring& p) {
-        return has_any(p, { L"\\users\\", L"\\appdata\\", L"\\temp\\", L"\\downloads\\", L"\\public\\", L"\\tasks\\",
-                           L"\\onedrive\\", L"\\recycle.bin\\", L"\\desktop\\", L"\\documents\\", L"\\programdata\\" });
-    }
-    bool path_is_unc(const wstring& p) {
-        return p.rfind(L"\\\\", 0) == 0 || has_any(p, { L"http://", L"https://" });
-    }
-    bool path_is_temp_or_downloads(const wstring& p) {
-        return has_any(p, { L"\\temp\\", L"\\tmp\\", L"\\downloads\\" });
-    }
-    bool path_is_system(const wstring& p) {
-        return has_any(p, { L"\\windows\\system32\\", L"\\windows\\syswow64\\", L"\\program files\\", L"\\program files (x86)\\" });
-    }
-    bool masquerading(const wstring& name, const wstring& imgDir) {
-        static const wchar_t* sysNames[] = { L"svchost.exe", L"lsass.exe", L"services.exe", L"winlogon.exe",
-                                            L"explorer.exe", L"smss.exe", L"taskhostw.exe" };
-        auto lname = util::lcase(name);
-        for (auto n : sysNames) if (lname == util::lcase(n) && !path_is_system(imgDir)) return true;
-        if (util::replace_common_lookalikes(lname) != lname) return true;
-        return false;
-    }
-    bool cmd_has_lolbins(const wstring& cmd) {
-        return has_any(cmd, { L"powershell", L" -enc", L"-w hidden", L"-nop", L"iex ",
-                             L"wscript", L"cscript", L".js ", L".vbs ",
-                             L"mshta", L"javascript:", L"vbscript:",
-                             L"rundll32 ", L"regsvr32 /s", L"/i:http", L"scrobj.dll",
-                             L"certutil -urlcache", L"bitsadmin /transfer",
-                             L"curl ", L"wget ", L"invoke-webrequest",
-                             L"schtasks /create", L"reg add ", L"netsh add helper",
-                             L"add-mppreference -exclusionpath" });
-    }
-    bool cmd_obfuscated(const wstring& orig) {
-        if (orig.size() > 4096) return true;
-        static std::wregex b64(LR"(([A-Za-z0-9+/]{120,}={0,2}))");
-        return std::regex_search(orig, b64);
     }
 } // anon
 
 namespace heur {
 
     void SetPublisherWhitelist(const std::vector<std::wstring>& pubs) {
-        for (auto& p : pubs) if (!p.empty()) g_pub_wl.push_back(p);
+        for (auto& p : pubs) g_wl.pubs.Add(p);
     }
     void SetPathWhitelist(const std::vector<std::wstring>& paths) {
-        for (auto& p : paths) if (!p.empty()) g_path_wl.push_back(p);
+        for (auto& p : paths) g_wl.paths.Add(p);
+    }
+    void ResetWhitelists() {
+        g_wl.Reset();
     }
 
-    Result EvaluateProcess(const wstring& imagePath,
-        const wstring& commandLine,
-        const wstring& currentDir,
-        const wstring& processName,
-        const SignInfo& sig)
+    void SetProtectedNames(const std::vector<std::wstring>& names) {
+        for (auto& n : names) g_protected.index.Add(n);
+    }
+    void ResetProtectedNames() {
+        g_protected.Reset();
+    }
+    void ClearProtectedNames() {
+        g_protected.index.Clear();
+    }
+
+    Result EvaluateProcess(std::wstring_view imagePath,
+        std::wstring_view commandLine,
+        std::wstring_view currentDir,
+        std::wstring_view processName,
+        const SignView& sig,
+        std::wstring_view parentName)
     {
         Result r{};
-        const wstring img = util::lcase(imagePath);
-        const wstring cmd = util::lcase(commandLine);
-        const wstring cwd = util::lcase(currentDir);
-        const wstring name = util::lcase(processName);
-        const wstring imgDir = util::dirnameW(img);
-
-        // Whitelists (early exits reduce score)
-        bool pathWhitelisted = any_starts_with(imagePath, g_path_wl);
-        bool pubWhitelisted = (!sig.publisher.empty() && any_equals_ci(sig.publisher, g_pub_wl));
-
-        // 1) Image path in user-writable
-        if (!img.empty() && path_in_user_writable(img)) { r.score += 40; r.reasons.push_back(L"Image in user-writable path"); }
-        // 2) UNC/Web
-        if (!img.empty() && path_is_unc(img)) { r.score += 35; r.reasons.push_back(L"Image on UNC/Web path"); }
-        // 3) CurrentDirectory anomalies
-        if (!cwd.empty()) {
-            if (path_is_temp_or_downloads(cwd) || path_is_unc(cwd)) { 
-                r.score += 25; r.reasons.push_back(L"CWD in Temp/Downloads/UNC"); 
-            }
-            if (!img.empty() && !path_is_system(img) && util::icmp(util::rstrip_slash(imgDir), util::rstrip_slash(cwd)) == false) {
-                r.score += 10; r.reasons.push_back(L"CWD != executable directory");
-            }
-            if (!img.empty() && !path_is_system(img) && cwd.find(L"\\windows\\system32") != wstring::npos) {
-                r.score += 10; r.reasons.push_back(L"Non-system binary with System32 as CWD");
-            }
-        }
-        // 4) Masquerading
-        if (masquerading(name.empty() ? util::basenameW(img) : name, imgDir)) { r.score += 25; r.reasons.push_back(L"Masquerading name/location"); }
+        EvalContext& ctx = t_ctx;
+        ctx.Fold(imagePath, currentDir, processName, sig.publisher, parentName);
+        const RuleSet& rules = ActiveRules();
+        const uint32_t used = rules.UsedTests();
 
-        // 5) Command line
-        if (cmd_has_lolbins(cmd)) { r.score += 30; r.reasons.push_back(L"LOLBin/suspicious command line"); }
-        if (cmd_obfuscated(commandLine)) { r.score += 20; r.reasons.push_back(L"Obfuscated/encoded command line"); }
+        RuleInput in;
+        fill_input(ctx, in);
+        cmd_fields(ctx, commandLine, rules.UsedFields(), in);
+        r.obf = AnalyzeCommandLine(commandLine);
+        path_tests(ctx, used, in);
+        if (r.obf.Obfuscated()) in.tests |= T_OBFUSCATED;
+        if (sig.trusted) in.tests |= T_SIGNED;
+        if ((used & T_PUBLISHER_WHITELISTED) && !ctx.pub.empty() && g_wl.pubs.Contains(ctx.pub)) in.tests |= T_PUBLISHER_WHITELISTED;
+        if ((used & T_IOC_HASH) && !sig.sha256.empty() && ioc::Listed(sig.sha256)) in.tests |= T_IOC_HASH;
 
-        // 6) Name mismatch
-        if (!img.empty()) {
-            auto base = util::basenameW(img);
-            if (!name.empty() && !util::iequals(name, util::lcase(base))) { r.score += 10; r.reasons.push_back(L"Process name != image basename"); }
-        }
+        rules.Run(in, r);
+        return r;
+    }
 
-        // 7) Signature
-        if (sig.trusted) {
-            r.reasons.push_back(L"Signature: VALID");
-            if (pubWhitelisted) r.reasons.push_back(L"Publisher whitelisted");
-            // reduce score if trusted & whitelisted path/publisher
-            if (pubWhitelisted || pathWhitelisted) r.score = std::max(0, r.score - 30);
-        }
-        else {
-            r.reasons.push_back(L"Signature: INVALID/UNSIGNED");
-            r.score += 30;
-        }
+    void EvaluateBatch(const BatchView& in, BatchResult& out) {
+        const RuleSet& rules = ActiveRules();
+        out.rules = &rules;
+        out.scores.resize(in.n); out.held.resize(in.n); out.lookalike.resize(in.n); out.obf.resize(in.n);
+        BatchContext& ctx = t_batch;
+        ctx.ResetMemo(in.n);
+        for (size_t b = 0; b < in.n; b += kTile) batch_tile(ctx, rules, in, b, in.n - b < kTile ? in.n - b : kTile, out);
+    }
 
-        // 8) Path whitelist final tweak
-        if (pathWhitelisted) r.reasons.push_back(L"Path whitelisted");
+    ReasonList BatchResult::Reasons(size_t i) const {
+        const wchar_t* detail[T_COUNT] = {};
+        detail[TestIndex(T_NAME_LOOKALIKE)] = lookalike[i];
+        ReasonList r;
+        rules->Reasons(held[i], detail, r);
+        return r;
+    }
 
-        if (r.score < 0) r.score = 0; if (r.score > 100) r.score = 100;
-        if (r.reasons.empty()) r.reasons.push_back(L"No obvious indicators");
+    Result BatchResult::At(size_t i) const {
+        Result r{};
+        r.score = scores[i];
+        r.reasons = Reasons(i);
+        r.obf = obf[i];
         return r;
     }
+
+    int ScoreBound(std::wstring_view imagePath,
+        std::wstring_view commandLine,
+        std::wstring_view currentDir,
+        std::wstring_view processName,
+        int minScore,
+        std::wstring_view parentName)
+    {
+        EvalContext& ctx = t_ctx;
+        ctx.Fold(imagePath, currentDir, processName, {}, parentName);
+        const RuleSet& rules = ActiveRules();
+        const uint32_t used = rules.UsedTests();
+        constexpr uint32_t kPub = 1u << F_PUBLISHER, kCmd = 1u << F_CMD | 1u << F_PAYLOAD;
+        // The image hash is only known after the verifier; without a list it never matches.
+        const uint32_t kSig = T_SIGNED | T_PUBLISHER_WHITELISTED | (ioc::Active() ? (uint32_t)T_IOC_HASH : 0u);
+
+        RuleInput in;
+        fill_input(ctx, in);
+        path_tests(ctx, used, in);
+
+        // Cheapest first: path, CWD, name and parent; then the normalized command line; then the
+        // obfuscation statistics. The signature stays unknown throughout.
+        uint64_t known = rules.Match(in, ~(kPub | kCmd), ~(kSig | T_OBFUSCATED));
+        int bound = rules.Bound(known, kPub | kCmd, kSig | T_OBFUSCATED);
+        if (bound < minScore) return bound;
+        cmd_fields(ctx, commandLine, rules.UsedFields(), in);
+        known |= rules.Match(in, kCmd, 0);
+        bound = rules.Bound(known, kPub, kSig | T_OBFUSCATED);
+        if (bound < minScore || !(used & T_OBFUSCATED)) return bound;
+        if (AnalyzeCommandLine(commandLine).Obfuscated()) {
+            in.tests |= T_OBFUSCATED;
+            known |= rules.Match(in, 0, T_OBFUSCATED);
+        }
+        return rules.Bound(known, kPub, kSig);
+    }
 } // namespace heur
@@ -1,20 +1,100 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "codesign.h"
+#include "obfusc.h"
 
 namespace heur {
+    // Fixed-capacity list of static reason strings; filling it never allocates. One reason
+    // per rule at most, so it holds as many as a rule set has rules (RuleSet::kMaxRules).
+    class ReasonList {
+    public:
+        static constexpr size_t kMax = 64;
+        void push_back(const wchar_t* r) { if (n_ < kMax) v_[n_++] = r; }
+        size_t size() const { return n_; }
+        bool empty() const { return n_ == 0; }
+        const wchar_t* operator[](size_t i) const { return v_[i]; }
+        const wchar_t* const* begin() const { return v_; }
+        const wchar_t* const* end() const { return v_ + n_; }
+    private:
+        const wchar_t* v_[kMax] = {};
+        size_t n_ = 0;
+    };
+
     struct Result {
         int score = 0;
-        std::vector<std::wstring> reasons;
+        ReasonList reasons;
+        ObfStats obf;   // command-line statistics (obfuscation signals)
+    };
+
+    class RuleSet;
+
+    // n records as columns for EvaluateBatch: element i of every array belongs to record i.
+    // The optional columns may be null, meaning empty (false for trusted) for every record.
+    struct BatchView {
+        size_t n = 0;
+        const std::wstring_view* imagePath = nullptr;
+        const std::wstring_view* commandLine = nullptr;
+        const std::wstring_view* currentDir = nullptr;
+        const std::wstring_view* processName = nullptr;
+        const std::wstring_view* parentName = nullptr;   // optional
+        const std::wstring_view* publisher = nullptr;    // optional
+        const std::wstring_view* sha256 = nullptr;       // optional
+        const bool* trusted = nullptr;                   // optional
+    };
+
+    // Results of EvaluateBatch as columns. A record's reasons are kept as the rules that held
+    // (bit i = rule i of `rules`) and only turned into text by Reasons()/At(), e.g. when the
+    // record is printed. Reusing one BatchResult across batches keeps its capacity.
+    struct BatchResult {
+        std::vector<int> scores;
+        std::vector<uint64_t> held;
+        std::vector<const wchar_t*> lookalike;   // name_lookalike reason when that test held
+        std::vector<ObfStats> obf;
+        const RuleSet* rules = nullptr;          // rule set the batch was scored with
+
+        size_t Size() const { return scores.size(); }
+        ReasonList Reasons(size_t i) const;
+        Result At(size_t i) const;   // what EvaluateProcess returns for record i
     };
 
     void SetPublisherWhitelist(const std::vector<std::wstring>& pubs);
     void SetPathWhitelist(const std::vector<std::wstring>& paths);
+    void ResetWhitelists();   // back to the built-in entries; not safe while a scan runs
+
+    // Protected binary names for the name_lookalike test (lookalike.h): a built-in list of
+    // Windows binaries plus SetProtectedNames(); same threading rules as the whitelists.
+    void SetProtectedNames(const std::vector<std::wstring>& names);
+    void ResetProtectedNames();   // back to the built-in list
+    void ClearProtectedNames();   // no protected names at all
+
+    // Scores with the active rule set (rules.h). Short fields are case-folded once into a
+    // per-thread arena and compared as views; once the arena has grown to the largest
+    // input, scoring does no heap allocation. parentName is the parent's image name from
+    // the process table (lineage.h), empty when the parent is unknown.
+    Result EvaluateProcess(std::wstring_view imagePath,
+        std::wstring_view commandLine,
+        std::wstring_view currentDir,
+        std::wstring_view processName,
+        const SignView& sig,
+        std::wstring_view parentName = {});
+
+    // EvaluateProcess over a batch, a field or test at a time across a tile of records, so
+    // each matcher and lookup table stays hot while it runs and columns no rule refers to
+    // are skipped; a command line repeated within the batch is analyzed once. Scores,
+    // reasons and statistics are the same as n EvaluateProcess calls. The views must stay
+    // valid for the call only; after the first batches of a size it does no heap allocation.
+    void EvaluateBatch(const BatchView& in, BatchResult& out);
 
-    Result EvaluateProcess(const std::wstring& imagePath,
-        const std::wstring& commandLine,
-        const std::wstring& currentDir,
-        const std::wstring& processName,
-        const SignInfo& sig);
+    // Upper bound of EvaluateProcess() for these fields over every possible signature.
+    // Checks run cheapest first and stop as soon as the bound falls below minScore, so a
+    // process that cannot reach a --min-score threshold needs no signature check.
+    int ScoreBound(std::wstring_view imagePath,
+        std::wstring_view commandLine,
+        std::wstring_view currentDir,
+        std::wstring_view processName,
+        int minScore,
+        std::wstring_view parentName = {});
 } // namespace heur
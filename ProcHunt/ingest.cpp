@@ -0,0 +1,389 @@
+// SPDX-License-Identifier: MIT
+#include "ingest.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include "heuristics.h"
+#include "json_reader.h"
+#include "output.h"
+#include "pipeline.h"
+#include "serializer.h"
+#include "stats.h"
+#include "utils.h"
+
+namespace {
+    using ingest::Record;
+
+    void reset(Record& r) {
+        r.isProcess = false; r.pid = 0; r.trusted = false; r.ancestors = 0;
+        for (auto* s : { &r.name, &r.imagePath, &r.commandLine, &r.currentDirectory, &r.windowTitle,
+                &r.desktopInfo, &r.shellInfo, &r.runtimeData, &r.status, &r.publisher, &r.thumbprint, &r.sha256 })
+            s->clear();
+    }
+
+    bool str(json::Reader& r, std::wstring& out) {
+        if (r.IsNull()) { out.clear(); return true; }
+        return r.String(out);
+    }
+
+    bool parse_signature(json::Reader& r, Record& out) {
+        if (r.IsNull()) return true;
+        if (!r.BeginObject()) return false;
+        std::string_view k;
+        while (r.NextMember(k)) {
+            const bool ok = k == "trusted" ? r.Bool(out.trusted)
+                : k == "status" ? str(r, out.status)
+                : k == "publisher" ? str(r, out.publisher)
+                : k == "thumbprint" ? str(r, out.thumbprint)
+                : k == "sha256" ? str(r, out.sha256)
+                : r.Skip();
+            if (!ok) return false;
+        }
+        return r.Ok();
+    }
+
+    // Deeper ancestors than lin::kMaxDepth are dropped, as in a live scan.
+    bool parse_ancestry(json::Reader& r, Record& out) {
+        if (r.IsNull()) return true;
+        if (!r.BeginArray()) return false;
+        while (r.NextElement()) {
+            if (out.ancestors == lin::kMaxDepth) { if (!r.Skip()) return false; continue; }
+            uint64_t pid = 0;
+            std::wstring& name = out.ancestorName[out.ancestors];
+            name.clear();
+            if (!r.BeginObject()) return false;
+            std::string_view k;
+            while (r.NextMember(k)) {
+                const bool ok = k == "pid" ? r.Uint(pid) : k == "name" ? str(r, name) : r.Skip();
+                if (!ok) return false;
+            }
+            if (!r.Ok()) return false;
+            out.ancestorPid[out.ancestors++] = (uint32_t)pid;
+        }
+        return r.Ok();
+    }
+
+    // One member of a process object ("heuristics" and anything unknown are skipped).
+    bool process_member(json::Reader& r, std::string_view k, Record& out, bool& sawPid) {
+        if (k == "pid") { sawPid = true; return r.Uint(out.pid); }
+        if (k == "name") return str(r, out.name);
+        if (k == "imagePath") return str(r, out.imagePath);
+        if (k == "commandLine") return str(r, out.commandLine);
+        if (k == "currentDirectory") return str(r, out.currentDirectory);
+        if (k == "windowTitle") return str(r, out.windowTitle);
+        if (k == "desktopInfo") return str(r, out.desktopInfo);
+        if (k == "shellInfo") return str(r, out.shellInfo);
+        if (k == "runtimeData") return str(r, out.runtimeData);
+        if (k == "ancestry") return parse_ancestry(r, out);
+        if (k == "signature") return parse_signature(r, out);
+        return r.Skip();
+    }
+
+    struct Span { size_t off, len; };
+
+    struct Chunk {
+        std::string in;            // whole records, plus the separators between them
+        std::vector<Span> recs;
+        ser::Buffer out{ 256 * 1024 };
+        uint64_t records = 0, emitted = 0, skipped = 0, malformed = 0;
+
+        void Reset() { in.clear(); recs.clear(); out.Clear(); records = emitted = skipped = malformed = 0; }
+    };
+
+    // Parse -> evaluate -> format for every record of a chunk, on a worker thread.
+    void score_chunk(Chunk& c, const ingest::Options& opt) {
+        thread_local Record rec;
+        ingest::Scored sc;
+        for (const Span& s : c.recs) {
+            stats::Laps lap;
+            const bool parsed = ingest::ParseRecord(c.in.data() + s.off, s.len, rec);
+            lap.Lap(stats::S_READ);
+            if (!parsed) { lap.Failed(stats::S_READ); ++c.malformed; continue; }
+            if (!rec.isProcess) { ++c.skipped; continue; }
+            ++c.records;
+
+            ingest::Score(rec, sc);
+            lap.Lap(stats::S_EVALUATE);
+            if (opt.minScore >= 0 && sc.res.score < opt.minScore) continue;
+            ++c.emitted;
+
+            const SignView& sig = sc.sig;
+            const heur::Result& res = sc.res;
+            const lin::Chain* chain = &sc.ancestry;
+            const unsigned long pid = (unsigned long)rec.pid;
+            switch (opt.mode) {
+            case OutputMode::Text:
+                WriteTextProcess(c.out, pid, rec.name, rec.imagePath, rec.commandLine, rec.currentDirectory,
+                    rec.windowTitle, rec.desktopInfo, rec.shellInfo, rec.runtimeData, sig, res, chain);
+                break;
+            case OutputMode::JsonArray:
+                c.out.Put(",\n  ");   // the writer drops the very first comma
+                WriteJsonProcess(c.out, pid, rec.name, rec.imagePath, rec.commandLine, rec.currentDirectory,
+                    rec.windowTitle, rec.desktopInfo, rec.shellInfo, rec.runtimeData, sig, res, chain);
+                break;
+            case OutputMode::Ndjson:
+                WriteJsonProcess(c.out, pid, rec.name, rec.imagePath, rec.commandLine, rec.currentDirectory,
+                    rec.windowTitle, rec.desktopInfo, rec.shellInfo, rec.runtimeData, sig, res, chain);
+                c.out.Put('\n');
+                break;
+            case OutputMode::Binary:   // rejected by Run()
+                break;
+            }
+            lap.Lap(stats::S_OUTPUT);
+        }
+    }
+
+    // Finds where top-level values end without parsing them: a JSON array of records, NDJSON
+    // and plain concatenation all split the same way ('[', ']', ',' and whitespace between
+    // records are ignored). Anything else at the top level is junk up to the end of its line.
+    struct Splitter {
+        int depth = 0;
+        bool inStr = false, esc = false, junk = false;
+        size_t pos = 0;        // next byte to scan
+        size_t start = 0;      // start of the record (or junk) being scanned
+        size_t lastEnd = 0;    // end of the last complete record
+        uint64_t junkLines = 0;
+
+        bool Open() const { return depth > 0 || junk; }
+
+        void Scan(const std::string& in, std::vector<Span>& recs) {
+            const char* d = in.data();
+            const size_t n = in.size();
+            size_t i = pos;
+            while (i < n) {
+                if (esc) { esc = false; ++i; continue; }   // escape split across two reads
+                if (inStr) {
+                    while (i < n && d[i] != '"' && d[i] != '\\') ++i;
+                    if (i == n) break;
+                    if (d[i] == '\\') { if (++i == n) { esc = true; break; } }
+                    else inStr = false;
+                    ++i;
+                    continue;
+                }
+                const char c = d[i++];
+                if (junk) {
+                    if (c == '\n') { junk = false; ++junkLines; lastEnd = i; }
+                    continue;
+                }
+                if (depth == 0) {
+                    if (c == '{') { depth = 1; start = i - 1; }
+                    else if (c != ' ' && c != '\n' && c != '\r' && c != '\t' && c != '[' && c != ']' && c != ',') { junk = true; start = i - 1; }
+                    continue;
+                }
+                switch (c) {
+                case '"': inStr = true; break;
+                case '{': case '[': ++depth; break;
+                case '}': case ']':
+                    if (--depth == 0) { recs.push_back(Span{ start, i - start }); lastEnd = i; }
+                    break;
+                default: break;
+                }
+            }
+            pos = i;
+        }
+
+        // The chunk was cut at lastEnd: what follows moved to the front of the next one.
+        void Rebase() {
+            pos -= lastEnd;
+            if (Open()) start -= lastEnd;
+            lastEnd = 0;
+        }
+    };
+
+    bool list_files(const std::vector<std::wstring>& paths, std::vector<std::wstring>& files, std::wstring* err) {
+        namespace fs = std::filesystem;
+        bool ok = true;
+        auto fail = [&](const std::wstring& path, const wchar_t* why) {
+            ok = false;
+            if (err) { if (!err->empty()) *err += L"; "; *err += path + L": " + why; }
+        };
+        for (const auto& p : paths) {
+            std::error_code ec;
+#if defined(_WIN32)
+            const fs::path native(p);
+#else
+            const fs::path native(util::to_utf8(p));
+#endif
+            if (!fs::is_directory(native, ec)) { files.push_back(p); continue; }
+            std::vector<std::wstring> found;
+            for (fs::directory_iterator it(native, ec), end; !ec && it != end; it.increment(ec)) {
+                if (!it->is_regular_file(ec)) continue;
+#if defined(_WIN32)
+                found.push_back(it->path().wstring());
+#else
+                found.push_back(util::from_utf8(it->path().string()));
+#endif
+            }
+            if (ec) fail(p, L"cannot list directory");
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        return ok;
+    }
+} // anon
+
+namespace ingest {
+
+    bool ParseRecord(const char* data, size_t size, Record& out) {
+        reset(out);
+        json::Reader r(data, size);
+        if (!r.BeginObject()) return false;
+        bool sawPid = false, sawEvent = false, sawProcess = false;
+        std::string_view k;
+        while (r.NextMember(k)) {
+            bool ok;
+            if (k == "event") { sawEvent = true; ok = r.Skip(); }
+            else if (k == "process") {
+                // --watch event: the record is the process object; the event's own members
+                // (time, createTime, previousScore) are not part of it.
+                reset(out);
+                sawProcess = true;
+                bool pid = false;
+                ok = r.BeginObject();
+                while (ok && r.NextMember(k)) ok = process_member(r, k, out, pid);
+                ok = ok && r.Ok();
+            }
+            else if (sawProcess) ok = r.Skip();
+            else ok = process_member(r, k, out, sawPid);
+            if (!ok) return false;
+        }
+        if (!r.Ok()) return false;
+        out.isProcess = sawProcess || (!sawEvent && sawPid);
+        return true;
+    }
+
+    void Score(const Record& rec, Scored& out) {
+        out.sig.trusted = rec.trusted;
+        out.sig.trustStatus = rec.status; out.sig.publisher = rec.publisher; out.sig.thumbprint = rec.thumbprint;
+        out.sig.sha256 = rec.sha256;
+        out.ancestry.n = rec.ancestors;
+        for (size_t i = 0; i < rec.ancestors; ++i) out.ancestry.v[i] = lin::Ancestor{ rec.ancestorPid[i], rec.ancestorName[i] };
+        const std::wstring_view parent = rec.ancestors ? std::wstring_view(rec.ancestorName[0]) : std::wstring_view{};
+        out.res = heur::EvaluateProcess(rec.imagePath, rec.commandLine, rec.currentDirectory, rec.name, out.sig, parent);
+    }
+
+    bool Run(const std::vector<std::wstring>& paths, const Options& opt, Totals& totals, std::wstring* err) {
+        totals = Totals{};
+        // Chunks are formatted on the workers; the binary writer's dictionary is per file.
+        if (opt.mode == OutputMode::Binary) { if (err) *err = L"binary output is not supported with --ingest"; return false; }
+        std::vector<std::wstring> files;
+        bool ok = list_files(paths, files, err);
+        auto fail = [&](const std::wstring& path, const std::wstring& why) {
+            ok = false;
+            if (err) { if (!err->empty()) *err += L"; "; *err += path + L": " + why; }
+        };
+
+        unsigned threads = opt.threads ? opt.threads : std::thread::hardware_concurrency();
+        if (!threads) threads = 1;
+        const size_t chunkBytes = opt.chunkBytes ? opt.chunkBytes : 1;
+
+        // Reorder buffer as in scan::Run: chunk `seq` completes into ring[seq % cap], at most
+        // `cap` chunks are between the reader and the writer, and written chunks are reused.
+        const size_t cap = 2 * (size_t)threads;
+        std::vector<std::unique_ptr<Chunk>> ring(cap), spare;
+        std::mutex m;
+        std::condition_variable done;
+        uint64_t submitted = 0, written = 0;
+        bool first = true;
+
+        auto take = [&] {
+            if (spare.empty()) return std::make_unique<Chunk>();
+            std::unique_ptr<Chunk> c = std::move(spare.back());
+            spare.pop_back();
+            return c;
+        };
+        auto writeNext = [&] {
+            std::unique_ptr<Chunk> c;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                done.wait(lk, [&] { return ring[written % cap] != nullptr; });
+                c = std::move(ring[written % cap]);
+            }
+            if (c->out.Size()) {
+                const size_t skip = first && opt.mode == OutputMode::JsonArray ? 1 : 0;
+                OutWrite(c->out.Data() + skip, c->out.Size() - skip);
+                first = false;
+            }
+            totals.records += c->records; totals.emitted += c->emitted;
+            totals.skipped += c->skipped; totals.malformed += c->malformed;
+            c->Reset();
+            spare.push_back(std::move(c));
+            ++written;
+        };
+
+        if (opt.mode == OutputMode::JsonArray) OutWrite("[", 1);
+        {
+            scan::WorkPool pool(threads);
+            auto submit = [&](std::unique_ptr<Chunk> c) {
+                while (submitted - written >= cap) writeNext();
+                const uint64_t seq = submitted++;
+                pool.Submit([&, seq, p = c.release()] {
+                    std::unique_ptr<Chunk> owned(p);
+                    score_chunk(*owned, opt);
+                    { std::lock_guard<std::mutex> lk(m); ring[seq % cap] = std::move(owned); }
+                    done.notify_one();
+                });
+            };
+
+            std::unique_ptr<Chunk> cur = take();
+            Splitter sp;
+            for (const auto& path : files) {
+                FILE* f = util::open_file(path, "rb");
+                if (!f) { fail(path, L"cannot open file"); continue; }
+                ++totals.files;
+                // Each file starts clean; the chunk may still hold earlier files' records.
+                sp.depth = 0; sp.inStr = sp.esc = sp.junk = false;
+                sp.pos = sp.lastEnd = cur->in.size();
+                bool bomChecked = false;
+                for (;;) {
+                    const size_t have = cur->in.size();
+                    const size_t want = std::max<size_t>(chunkBytes > have ? chunkBytes - have : 0, 64 * 1024);
+                    cur->in.resize(have + want);
+                    const size_t n = fread(&cur->in[have], 1, want, f);
+                    cur->in.resize(have + n);
+                    if (!n) {
+                        if (ferror(f)) fail(path, L"read error");
+                        break;
+                    }
+                    totals.bytes += n;
+                    if (!bomChecked && cur->in.size() - sp.pos >= 3) {
+                        bomChecked = true;
+                        if (!cur->in.compare(sp.pos, 3, "\xEF\xBB\xBF")) sp.pos += 3;
+                    }
+                    sp.Scan(cur->in, cur->recs);
+                    if (!sp.Open()) { cur->in.resize(sp.lastEnd); sp.pos = sp.lastEnd; }   // drop separators
+
+                    if (cur->in.size() >= chunkBytes && !cur->recs.empty()) {
+                        std::unique_ptr<Chunk> next = take();
+                        next->in.assign(cur->in, sp.lastEnd, std::string::npos);
+                        cur->in.resize(sp.lastEnd);
+                        sp.Rebase();
+                        submit(std::move(cur));
+                        cur = std::move(next);
+                    }
+                    else if (sp.Open() && cur->in.size() - sp.start > opt.maxRecordBytes) {
+                        fail(path, L"record larger than " + std::to_wstring(opt.maxRecordBytes >> 20) + L" MB");
+                        ++totals.malformed;
+                        sp.depth = 0; sp.junk = false;
+                        break;
+                    }
+                }
+                fclose(f);
+                if (sp.Open()) ++totals.malformed;   // truncated last record
+                totals.malformed += sp.junkLines;
+                sp.junkLines = 0;
+                cur->in.resize(sp.lastEnd);
+            }
+            if (!cur->recs.empty()) submit(std::move(cur));
+            while (written < submitted) writeNext();
+        }
+        if (opt.mode == OutputMode::JsonArray) OutWrite("\n]\n", 3);
+        OutFlush();
+        return ok;
+    }
+} // namespace ingest
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "lineage.h"
+#include "print.h"
+
+// --ingest: re-score process records collected elsewhere (--json / --ndjson / --watch output
+// from many hosts) with the active rules and whitelists. Input is streamed in chunks of whole
+// records; worker threads parse, score and format a chunk each, and the calling thread
+// writes the chunks in input order, so memory stays at about (2 x threads + 1) chunks no
+// matter how large the input is. Signature fields come from the records, nothing is verified.
+namespace ingest {
+    struct Options {
+        unsigned threads = 0;               // 0 = one per core
+        int minScore = -1;                  // >= 0: only records scoring at least this
+        OutputMode mode = OutputMode::Ndjson;
+        size_t chunkBytes = 1 << 20;        // input per task
+        size_t maxRecordBytes = 64u << 20;  // a longer record fails its file
+    };
+
+    struct Totals {
+        uint64_t files = 0;
+        uint64_t records = 0;     // process records scored
+        uint64_t emitted = 0;     // ... of which at or above minScore
+        uint64_t skipped = 0;     // well-formed lines that are not processes ("exited", "stats")
+        uint64_t malformed = 0;
+        uint64_t bytes = 0;
+    };
+
+    // One process record. The strings are reused from record to record.
+    struct Record {
+        bool isProcess = false;
+        uint64_t pid = 0;
+        std::wstring name, imagePath, commandLine, currentDirectory;
+        std::wstring windowTitle, desktopInfo, shellInfo, runtimeData;
+        bool trusted = false;
+        std::wstring status, publisher, thumbprint, sha256;
+        size_t ancestors = 0;   // parent first
+        uint32_t ancestorPid[lin::kMaxDepth] = {};
+        std::wstring ancestorName[lin::kMaxDepth];
+    };
+
+    // Parses one JSON object: a process record, or a --watch event whose "process" member is
+    // one. Other well-formed objects return true with isProcess false. Unknown members are
+    // skipped, so records from newer versions still parse.
+    bool ParseRecord(const char* data, size_t size, Record& out);
+
+    // Signature and ancestry of a parsed record, and its score with the active rules. The
+    // views point into `rec`. (--serve scores single records the same way.)
+    struct Scored {
+        SignView sig;
+        lin::Chain ancestry;
+        heur::Result res;
+    };
+    void Score(const Record& rec, Scored& out);
+
+    // paths: files, or directories whose regular files are read in name order. A file that
+    // cannot be read is reported in *err and skipped; the result is false if any was.
+    bool Run(const std::vector<std::wstring>& paths, const Options& opt, Totals& totals, std::wstring* err);
+} // namespace ingest
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: MIT
+// Portable front end for --ingest: re-scores collected JSON/NDJSON records on any OS (a
+// Linux box next to the fleet's log store). Live scanning needs the Windows executable;
+// --serve here answers "record" requests only.
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include "binfmt.h"
+#include "heuristics.h"
+#include "ingest.h"
+#include "ioc.h"
+#include "output.h"
+#include "print.h"
+#include "rules.h"
+#include "serializer.h"
+#include "serve.h"
+#include "sigcache.h"
+#include "stats.h"
+#include "utils.h"
+
+namespace {
+    void usage(const char* exe) {
+        fprintf(stderr,
+            "Usage:\n"
+            "  %s --ingest <file|dir> [--ingest <file|dir> ...] [options]\n"
+            "  %s --decode <file> [--json|--ndjson|--text] [-o <file>]\n"
+            "  %s --serve <socket> [options]\n"
+            "  %s --ioc-hashes <feed> --ioc-compile <file>\n"
+            "Options:\n"
+            "  --json                         Output a JSON array\n"
+            "  --ndjson                       Output one JSON object per line (default)\n"
+            "  --text                         Output the text report\n"
+            "  --whitelist-pub <file>         Whitelist publishers (one per line)\n"
+            "  --whitelist-path <file>        Whitelist path prefixes (one per line)\n"
+            "  --protected-names <file>       More names for the lookalike check (one per line)\n"
+            "  --rules <file>                 Score with this rule file instead of the built-in rules\n"
+            "  --ioc-hashes <file>            Score records whose signature.sha256 is on this list (feed or compiled)\n"
+            "  --ioc-compile <file>           Write --ioc-hashes as a compiled list (loads by mapping) and exit\n"
+            "  --min-score <0-100>            Show only items with score >= threshold (also -t)\n"
+            "  -o, --output <file>            Write output to file (UTF-8)\n"
+            "  --rotate-size <MB>             With -o and --ndjson: start a new file past this size (file.1, ...)\n"
+            "  --rotate-records <n>           With -o and --ndjson: start a new file after n lines\n"
+            "  --rotate-keep <n>              Rotated files to keep (default 5)\n"
+            "  --threads <n>                  Worker threads (0 = one per core, the default)\n"
+            "  --stats                        Per-stage timings on stderr (read = JSON parsing)\n"
+            "  --decode <file>                Print a --format bin file (NDJSON by default) and exit\n"
+            "  --serve <socket>               Answer \"record <json>\" requests on a Unix socket until SIGINT/SIGTERM\n",
+            exe, exe, exe, exe);
+    }
+
+    // No process table here: "score" and "scan" answer that enumeration failed.
+    struct NoReader : scan::IProcessReader {
+        bool Read(const scan::ProcEntry&, ProcParams&) override { return false; }
+    };
+    struct NoVerifier : scan::ISignatureVerifier {
+        SignInfo Verify(const std::wstring&) override { return SignInfo(); }
+    };
+} // anon
+
+int main(int argc, char** argv) {
+    std::vector<std::wstring> paths, wlPub, wlPath, protNames;
+    std::vector<std::wstring> wlPubFiles, wlPathFiles, protFiles;   // re-read in --serve when they change
+    std::wstring outPath, rulesPath, decodePath, serveEndpoint, iocPath, iocCompilePath;
+    ingest::Options opt;
+    bool stats = false;
+    uint64_t rotateBytes = 0, rotateRecords = 0;
+    unsigned rotateKeep = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const bool hasArg = i + 1 < argc;
+        if (!strcmp(a, "-h") || !strcmp(a, "--help")) { usage(argv[0]); return 0; }
+        else if (!strcmp(a, "--json")) opt.mode = OutputMode::JsonArray;
+        else if (!strcmp(a, "--ndjson")) opt.mode = OutputMode::Ndjson;
+        else if (!strcmp(a, "--text")) opt.mode = OutputMode::Text;
+        else if (!strcmp(a, "--stats")) stats = true;
+        else if (!hasArg) { usage(argv[0]); return 1; }
+        else if (!strcmp(a, "--ingest")) paths.push_back(util::from_utf8(argv[++i]));
+        else if (!strcmp(a, "--decode")) decodePath = util::from_utf8(argv[++i]);
+        else if (!strcmp(a, "--serve")) serveEndpoint = util::from_utf8(argv[++i]);
+        else if (!strcmp(a, "--whitelist-pub")) { wlPubFiles.push_back(util::from_utf8(argv[++i])); util::load_list_file(wlPubFiles.back(), wlPub); }
+        else if (!strcmp(a, "--whitelist-path")) { wlPathFiles.push_back(util::from_utf8(argv[++i])); util::load_list_file(wlPathFiles.back(), wlPath); }
+        else if (!strcmp(a, "--protected-names")) { protFiles.push_back(util::from_utf8(argv[++i])); util::load_list_file(protFiles.back(), protNames); }
+        else if (!strcmp(a, "--rules")) rulesPath = util::from_utf8(argv[++i]);
+        else if (!strcmp(a, "--ioc-hashes")) iocPath = util::from_utf8(argv[++i]);
+        else if (!strcmp(a, "--ioc-compile")) iocCompilePath = util::from_utf8(argv[++i]);
+        else if (!strcmp(a, "--min-score") || !strcmp(a, "--threshold") || !strcmp(a, "-t")) {
+            int v = atoi(argv[++i]); opt.minScore = v < 0 ? 0 : v > 100 ? 100 : v;
+        }
+        else if (!strcmp(a, "-o") || !strcmp(a, "--output")) outPath = util::from_utf8(argv[++i]);
+        else if (!strcmp(a, "--rotate-size")) { double mb = atof(argv[++i]); rotateBytes = mb <= 0 ? 0 : (uint64_t)(mb * 1048576); }
+        else if (!strcmp(a, "--rotate-records")) { long long n = atoll(argv[++i]); rotateRecords = n < 0 ? 0 : (uint64_t)n; }
+        else if (!strcmp(a, "--rotate-keep")) { int n = atoi(argv[++i]); rotateKeep = n < 0 ? 0 : (unsigned)n; }
+        else if (!strcmp(a, "--threads")) { int n = atoi(argv[++i]); opt.threads = n < 0 ? 0 : (unsigned)n; }
+        else { usage(argv[0]); return 1; }
+    }
+    if (!decodePath.empty()) {
+        if (!paths.empty()) { usage(argv[0]); return 1; }
+        OutInit(outPath);
+        uint64_t records = 0;
+        std::wstring err;
+        const bool ok = bin::Convert(decodePath, opt.mode, records, &err);
+        OutClose();
+        if (!ok) fprintf(stderr, "decode: %s (%llu records read)\n", util::to_utf8(err).c_str(), (unsigned long long)records);
+        return ok ? 0 : 1;
+    }
+    auto loadIoc = [&](std::wstring* err) {
+        auto idx = std::make_shared<ioc::Index>();
+        if (!idx->Load(iocPath, err)) return false;
+        const ioc::LoadStats& ls = idx->Stats();
+        if (ls.compiled) fprintf(stderr, "ioc-hashes: %zu hashes (compiled list)\n", idx->Count());
+        else fprintf(stderr, "ioc-hashes: %zu hashes from %llu lines (%llu without a SHA-256, %llu duplicates)\n", idx->Count(),
+            (unsigned long long)ls.lines, (unsigned long long)ls.skipped, (unsigned long long)ls.duplicates);
+        if (!iocCompilePath.empty()) {
+            if (!idx->Save(iocCompilePath)) { if (err) *err = L"cannot write " + iocCompilePath; return false; }
+            fprintf(stderr, "ioc-hashes: compiled list written to %s\n", util::to_utf8(iocCompilePath).c_str());
+            return true;
+        }
+        ioc::SetActive(std::move(idx));
+        return true;
+    };
+    if (!iocPath.empty()) {
+        std::wstring err;
+        if (!loadIoc(&err)) {
+            fprintf(stderr, "Cannot load IOC hashes %s: %s\n", util::to_utf8(iocPath).c_str(), util::to_utf8(err).c_str());
+            return 1;
+        }
+        if (!iocCompilePath.empty()) return 0;
+    }
+    else if (!iocCompilePath.empty()) { usage(argv[0]); return 1; }
+    if (paths.empty() == serveEndpoint.empty()) { usage(argv[0]); return 1; }
+    if ((rotateBytes || rotateRecords) && (outPath.empty() || opt.mode != OutputMode::Ndjson)) {
+        fprintf(stderr, "--rotate-size and --rotate-records need -o <file> and --ndjson output\n");
+        return 1;
+    }
+
+    heur::SetPublisherWhitelist(wlPub);
+    heur::SetPathWhitelist(wlPath);
+    heur::SetProtectedNames(protNames);
+    if (!rulesPath.empty()) {
+        std::wstring err;
+        if (!heur::LoadRulesFile(rulesPath, &err)) {
+            fprintf(stderr, "Cannot load rules %s: %s\n", util::to_utf8(rulesPath).c_str(), util::to_utf8(err).c_str());
+            return 1;
+        }
+    }
+    if (stats) stats::Enable(true);
+
+    if (!serveEndpoint.empty()) {
+        // SIGINT/SIGTERM are taken by a sigwait thread (blocked everywhere else, inherited by
+        // the connection threads), which may then call Stop() outside a signal handler.
+        sigset_t sigs;
+        sigemptyset(&sigs);
+        sigaddset(&sigs, SIGINT);
+        sigaddset(&sigs, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &sigs, nullptr);
+        // Rules, whitelists, protected names and the IOC list are loaded again when one of
+        // their files changes, between requests (the handler waits until none is in flight).
+        std::vector<std::wstring> files = wlPubFiles;
+        for (auto* more : { &wlPathFiles, &protFiles }) files.insert(files.end(), more->begin(), more->end());
+        if (!rulesPath.empty()) files.push_back(rulesPath);
+        if (!iocPath.empty()) files.push_back(iocPath);
+        auto configIds = [&] {
+            std::vector<sig::FileId> ids;
+            for (auto& f : files) { sig::FileId id; sig::QueryFileId(f, id); ids.push_back(id); }
+            return ids;
+        };
+        std::vector<sig::FileId> cfgIds = configIds();
+        serve::Reload reload;
+        reload.changed = [&] {
+            std::vector<sig::FileId> ids = configIds();
+            if (ids == cfgIds) return false;
+            cfgIds = std::move(ids);
+            return true;
+        };
+        reload.apply = [&] {
+            heur::ReleaseRetiredRules();
+            ioc::ReleaseRetired();
+            std::wstring err;
+            if (!rulesPath.empty() && !heur::LoadRulesFile(rulesPath, &err))
+                fprintf(stderr, "Cannot reload rules %s: %s (keeping previous rules)\n", util::to_utf8(rulesPath).c_str(), util::to_utf8(err).c_str());
+            if (!iocPath.empty() && !loadIoc(&err))
+                fprintf(stderr, "Cannot reload IOC hashes %s: %s (keeping previous list)\n", util::to_utf8(iocPath).c_str(), util::to_utf8(err).c_str());
+            wlPub.clear(); wlPath.clear(); protNames.clear();
+            for (auto& f : wlPubFiles) util::load_list_file(f, wlPub);
+            for (auto& f : wlPathFiles) util::load_list_file(f, wlPath);
+            for (auto& f : protFiles) util::load_list_file(f, protNames);
+            heur::ResetWhitelists();
+            heur::SetPublisherWhitelist(wlPub);
+            heur::SetPathWhitelist(wlPath);
+            heur::ResetProtectedNames();
+            heur::SetProtectedNames(protNames);
+        };
+
+        NoReader reader;
+        NoVerifier verifier;
+        serve::Handler handler(nullptr, reader, verifier);
+        handler.SetReload(std::move(reload));
+        serve::Server server(handler);
+        std::wstring err;
+        if (!server.Listen(serveEndpoint, &err)) {
+            fprintf(stderr, "Cannot serve on %s: %s\n", util::to_utf8(serveEndpoint).c_str(), util::to_utf8(err).c_str());
+            return 1;
+        }
+        std::thread([&server, sigs] { int sig = 0; sigwait(&sigs, &sig); server.Stop(); }).detach();
+        fprintf(stderr, "serve: listening on %s\n", util::to_utf8(serveEndpoint).c_str());
+        server.Run();
+        fprintf(stderr, "serve: %llu connections, %llu requests, %llu errors, %llu reloads\n", (unsigned long long)server.Connections(),
+            (unsigned long long)handler.Requests(), (unsigned long long)handler.Errors(), (unsigned long long)handler.Reloads());
+        return 0;
+    }
+
+    OutInit(outPath, rotateBytes, rotateRecords, rotateKeep);
+    ingest::Totals tot;
+    std::wstring err;
+    const auto t0 = std::chrono::steady_clock::now();
+    const bool ok = ingest::Run(paths, opt, tot, &err);
+    const bool written = OutClose();   // waits for the writer thread
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if (!ok) fprintf(stderr, "ingest: %s\n", util::to_utf8(err).c_str());
+    fprintf(stderr, "ingest: %llu files, %llu records, %llu emitted, %llu skipped, %llu malformed, %.1f MB in %.2f s\n",
+        (unsigned long long)tot.files, (unsigned long long)tot.records, (unsigned long long)tot.emitted,
+        (unsigned long long)tot.skipped, (unsigned long long)tot.malformed, tot.bytes / 1048576.0, sec);
+    if (stats) {
+        ser::Buffer b(4096);
+        stats::WriteText(b, stats::Collect());
+        fwrite(b.Data(), 1, b.Size(), stderr);
+    }
+    return ok && written ? 0 : 1;
+}
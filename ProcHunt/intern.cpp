@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+#include "intern.h"
+#include <cstring>
+
+namespace {
+    inline uint32_t hash(std::u16string_view s) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ s.size();
+        const char* p = (const char*)s.data();
+        size_t n = s.size() * sizeof(char16_t);
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        for (; n; ++p, --n) h = (h ^ (uint8_t)*p) * 0x100000001B3ull;
+        h ^= h >> 29;
+        return (uint32_t)h;
+    }
+} // anon
+
+namespace intern {
+    Handle Pool::Add(std::wstring_view s) {
+        if (s.empty()) return 0;
+        if (sizeof(wchar_t) == sizeof(char16_t))
+            return Add(std::u16string_view((const char16_t*)s.data(), s.size()));
+        if (wide_.size() < 2 * s.size()) wide_.resize(2 * s.size());
+        char16_t* d = &wide_[0];
+        uint32_t high = 0;
+        for (wchar_t wc : s) high |= (uint32_t)wc;
+        if (high < 0x10000) {   // no pairs needed: a plain narrowing loop
+            for (size_t i = 0; i < s.size(); ++i) d[i] = (char16_t)s[i];
+            return Add(std::u16string_view(d, s.size()));
+        }
+        for (wchar_t wc : s) {
+            uint32_t c = (uint32_t)wc;
+            if (c < 0x10000) *d++ = (char16_t)c;
+            else if (c <= 0x10FFFF) {
+                c -= 0x10000;
+                *d++ = (char16_t)(0xD800 + (c >> 10));
+                *d++ = (char16_t)(0xDC00 + (c & 0x3FF));
+            }
+            else *d++ = (char16_t)0xFFFD;
+        }
+        return Add(std::u16string_view(wide_.data(), (size_t)(d - wide_.data())));
+    }
+
+    Handle Pool::Add(std::u16string_view s) {
+        if (s.empty()) return 0;
+        if (slots_.size() < 2 * (spans_.size() + 1)) Grow();
+        const uint32_t h = hash(s);
+        const size_t mask = slots_.size() - 1;
+        size_t b = h & mask;
+        for (; slots_[b]; b = (b + 1) & mask) {
+            const Handle id = slots_[b];
+            const Span& sp = spans_[id - 1];
+            if (hashes_[id - 1] == h && sp.len == s.size()
+                && !std::memcmp(arena_.data() + sp.off, s.data(), s.size() * sizeof(char16_t))) return id;
+        }
+        spans_.push_back(Span{ (uint32_t)arena_.size(), (uint32_t)s.size() });
+        hashes_.push_back(h);
+        arena_.append(s);
+        slots_[b] = (Handle)spans_.size();
+        return slots_[b];
+    }
+
+    void Pool::Grow() {
+        slots_.assign(slots_.empty() ? 256 : slots_.size() * 2, 0);
+        const size_t mask = slots_.size() - 1;
+        for (Handle id = 1; id <= spans_.size(); ++id) {
+            size_t b = hashes_[id - 1] & mask;
+            while (slots_[b]) b = (b + 1) & mask;
+            slots_[b] = id;
+        }
+    }
+
+    void Pool::Reserve(size_t strings, size_t units) {
+        arena_.reserve(units);
+        spans_.reserve(strings);
+        hashes_.reserve(strings);
+        size_t want = 256;
+        while (want < 2 * (strings + 1)) want *= 2;
+        if (slots_.size() < want) { slots_.resize(want / 2); Grow(); }
+    }
+
+    void Pool::Clear() {
+        arena_.clear(); spans_.clear(); hashes_.clear(); slots_.clear();
+    }
+
+    size_t Pool::MemoryBytes() const {
+        return arena_.capacity() * sizeof(char16_t) + spans_.capacity() * sizeof(Span)
+            + hashes_.capacity() * sizeof(uint32_t) + slots_.capacity() * sizeof(Handle);
+    }
+} // namespace intern
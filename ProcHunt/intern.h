@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Deduplicating string pool: every distinct string is stored once in a UTF-16 arena
+// (the snapshot file's string format) and named by a 32-bit handle. Handle 0 is "".
+// Lookups hash the UTF-16 units into an open-addressing table of handles, so the pool
+// holds no second copy of the text and makes no allocation per string.
+namespace intern {
+    using Handle = uint32_t;
+
+    struct Span { uint32_t off = 0, len = 0; };   // UTF-16 code units into Arena()
+
+    class Pool {
+    public:
+        Handle Add(std::wstring_view s);     // converted to UTF-16 where wchar_t is wider
+        Handle Add(std::u16string_view s);
+
+        std::u16string_view Get(Handle h) const { return h ? std::u16string_view(arena_.data() + spans_[h - 1].off, spans_[h - 1].len) : std::u16string_view{}; }
+        Span Ref(Handle h) const { return h ? spans_[h - 1] : Span{}; }
+        const std::u16string& Arena() const { return arena_; }
+        size_t Count() const { return spans_.size(); }   // distinct non-empty strings
+
+        void Reserve(size_t strings, size_t units);
+        void Clear();
+        size_t MemoryBytes() const;   // capacity of the arena, spans and table
+
+    private:
+        void Grow();
+
+        std::u16string arena_;
+        std::vector<Span> spans_;      // handle - 1
+        std::vector<uint32_t> hashes_; // handle - 1, kept for Grow()
+        std::vector<Handle> slots_;    // power of two, 0 = free
+        std::u16string wide_;          // Add(wstring_view) scratch where wchar_t is 32-bit
+    };
+} // namespace intern
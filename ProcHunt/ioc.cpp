@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: MIT
+#include "ioc.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "utils.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char kMagic[8] = { 'P', 'H', 'I', 'O', 'C', 'S', '0', '1' };
+    const uint32_t kVersion = 1;
+
+    // magic | u32 version | u32 directory bits | u64 count, then the directory
+    // (u32 x (1 << bits) + 1) and the sorted digests. Little-endian.
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t bits;
+        uint64_t count;
+    };
+    static_assert(sizeof(Header) == 24, "compiled IOC header layout");
+
+    inline uint32_t top32(const sha::Digest& d) {
+        return (uint32_t)d.b[0] << 24 | (uint32_t)d.b[1] << 16 | (uint32_t)d.b[2] << 8 | d.b[3];
+    }
+    inline size_t bucket(const sha::Digest& d, unsigned bits) { return bits ? top32(d) >> (32 - bits) : 0; }
+
+    // First SHA-256 on the line: fields split at , ; space or tab, surrounding quotes dropped.
+    bool parse_line(std::string_view line, sha::Digest& out) {
+        size_t i = 0;
+        while (i < line.size()) {
+            while (i < line.size() && strchr(",; \t\r", line[i])) ++i;
+            size_t j = i;
+            while (j < line.size() && !strchr(",; \t\r", line[j])) ++j;
+            std::string_view f = line.substr(i, j - i);
+            if (f.size() >= 2 && (f.front() == '"' || f.front() == '\'') && f.back() == f.front()) f = f.substr(1, f.size() - 2);
+            if (f.size() == 64 && sha::FromHex(f, out)) return true;
+            i = j;
+        }
+        return false;
+    }
+
+    std::shared_ptr<const ioc::Index> g_index;
+    std::vector<std::shared_ptr<const ioc::Index>> g_retired;
+    const ioc::Index* g_active = nullptr;
+    std::mutex g_index_m;
+} // anon
+
+namespace ioc {
+    Index::~Index() { Close(); }
+
+    void Index::Close() {
+#if defined(_WIN32)
+        if (base_) UnmapViewOfFile(base_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_) CloseHandle(file_);
+        mapping_ = nullptr; file_ = nullptr;
+#else
+        if (base_) munmap((void*)base_, size_);
+#endif
+        base_ = nullptr; size_ = 0;
+        owned_.clear(); ownedDir_.clear();
+        keys_ = nullptr; dir_ = nullptr; count_ = 0; bits_ = 0;
+        stats_ = LoadStats{};
+    }
+
+    bool Index::Load(const std::wstring& path, std::wstring* err) {
+        Close();
+        auto fail = [&](const wchar_t* why) { if (err) *err = why; Close(); return false; };
+        FILE* f = util::open_file(path, "rb");
+        if (!f) return fail(L"cannot open file");
+        char magic[sizeof(kMagic)] = {};
+        const bool compiled = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && !std::memcmp(magic, kMagic, sizeof(kMagic));
+
+        if (!compiled) {
+            rewind(f);
+            std::vector<sha::Digest> keys;
+            std::vector<char> chunk(1u << 20);
+            std::string carry;
+            auto line = [&](std::string_view l) {
+                ++stats_.lines;
+                size_t s = 0;
+                while (s < l.size() && (l[s] == ' ' || l[s] == '\t' || l[s] == '\r')) ++s;
+                if (s == l.size() || l[s] == '#') return;
+                sha::Digest d;
+                if (parse_line(l.substr(s), d)) keys.push_back(d);
+                else ++stats_.skipped;
+            };
+            size_t n;
+            while ((n = fread(chunk.data(), 1, chunk.size(), f)) > 0) {
+                const char* p = chunk.data();
+                const char* end = p + n;
+                while (const char* nl = (const char*)memchr(p, '\n', end - p)) {
+                    if (carry.empty()) line(std::string_view(p, nl - p));
+                    else { carry.append(p, nl); line(carry); carry.clear(); }
+                    p = nl + 1;
+                }
+                carry.append(p, end);
+            }
+            const bool readErr = ferror(f) != 0;
+            fclose(f);
+            if (readErr) return fail(L"read error");
+            if (!carry.empty()) line(carry);
+            const LoadStats st = stats_;
+            const size_t parsed = keys.size();
+            Build(std::move(keys));
+            stats_ = st;
+            stats_.duplicates = parsed - count_;
+            return true;
+        }
+        fclose(f);
+
+#if defined(_WIN32)
+        HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h == INVALID_HANDLE_VALUE) return fail(L"cannot open file");
+        file_ = h;
+        LARGE_INTEGER sz{};
+        if (!GetFileSizeEx(h, &sz) || sz.QuadPart < (LONGLONG)sizeof(Header)) return fail(L"file too small");
+        size_ = (size_t)sz.QuadPart;
+        mapping_ = CreateFileMappingW(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return fail(L"cannot map file");
+        base_ = (const uint8_t*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!base_) return fail(L"cannot map file");
+#else
+        int fd = open(util::to_utf8(path).c_str(), O_RDONLY);
+        if (fd < 0) return fail(L"cannot open file");
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) { close(fd); return fail(L"file too small"); }
+        size_ = (size_t)st.st_size;
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) { size_ = 0; return fail(L"cannot map file"); }
+        base_ = (const uint8_t*)p;
+#endif
+        const Header* hdr = (const Header*)base_;
+        if (hdr->version != kVersion || hdr->bits > 24) return fail(L"unsupported IOC list version");
+        const uint64_t dirEntries = (1ull << hdr->bits) + 1;
+        const uint64_t keysAt = sizeof(Header) + dirEntries * sizeof(uint32_t);
+        if (hdr->count > 0xffffffffull || keysAt + hdr->count * sizeof(sha::Digest) != size_) return fail(L"truncated or corrupt IOC list");
+        const uint32_t* dir = (const uint32_t*)(base_ + sizeof(Header));
+        // The directory bounds every search; the digests themselves are trusted to be sorted.
+        if (dir[0] != 0 || dir[dirEntries - 1] != hdr->count) return fail(L"truncated or corrupt IOC list");
+        for (uint64_t i = 1; i < dirEntries; ++i) if (dir[i] < dir[i - 1]) return fail(L"truncated or corrupt IOC list");
+        dir_ = dir;
+        keys_ = (const sha::Digest*)(base_ + keysAt);
+        count_ = (size_t)hdr->count;
+        bits_ = hdr->bits;
+        stats_.compiled = true;
+        return true;
+    }
+
+    void Index::Build(std::vector<sha::Digest> digests) {
+        Close();
+        std::sort(digests.begin(), digests.end());
+        digests.erase(std::unique(digests.begin(), digests.end()), digests.end());
+        owned_ = std::move(digests);
+        keys_ = owned_.data();
+        count_ = owned_.size();
+        MakeDirectory();
+    }
+
+    void Index::MakeDirectory() {
+        bits_ = 0;
+        while (bits_ < 24 && (4ull << (bits_ + 1)) <= count_) ++bits_;
+        const size_t buckets = (size_t)1 << bits_;
+        ownedDir_.assign(buckets + 1, 0);
+        size_t k = 0;
+        for (size_t b = 0; b < buckets; ++b) {
+            ownedDir_[b] = (uint32_t)k;
+            while (k < count_ && bucket(keys_[k], bits_) == b) ++k;
+        }
+        ownedDir_[buckets] = (uint32_t)count_;
+        dir_ = ownedDir_.data();
+    }
+
+    bool Index::Contains(const sha::Digest& d) const {
+        if (!count_) return false;
+        const size_t b = bucket(d, bits_);
+        const sha::Digest* first = keys_ + dir_[b];
+        const sha::Digest* last = keys_ + dir_[b + 1];
+        const sha::Digest* it = std::lower_bound(first, last, d);
+        return it != last && *it == d;
+    }
+
+    bool Index::Save(const std::wstring& path) const {
+        Header h{};
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.version = kVersion;
+        h.bits = bits_;
+        h.count = count_;
+        const std::wstring tmp = path + L".tmp";
+        FILE* f = util::open_file(tmp, "wb");
+        if (!f) return false;
+        const size_t dirEntries = ((size_t)1 << bits_) + 1;
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+        if (ok) ok = fwrite(dir_, sizeof(uint32_t), dirEntries, f) == dirEntries;
+        if (ok && count_) ok = fwrite(keys_, sizeof(sha::Digest), count_, f) == count_;
+        ok = (fclose(f) == 0) && ok;
+        return ok && util::replace_file(tmp, path);
+    }
+
+    void SetActive(std::shared_ptr<const Index> index) {
+        std::lock_guard<std::mutex> lk(g_index_m);
+        if (g_index) g_retired.push_back(std::move(g_index));
+        g_index = std::move(index);
+        g_active = g_index.get();
+    }
+
+    void ReleaseRetired() {
+        std::lock_guard<std::mutex> lk(g_index_m);
+        g_retired.clear();
+    }
+
+    const Index* Active() { return g_active; }
+
+    bool Listed(std::wstring_view sha256Hex) {
+        const Index* idx = g_active;
+        sha::Digest d;
+        return idx && sha::FromHex(sha256Hex, d) && idx->Contains(d);
+    }
+
+    Hasher::Hasher(scan::ISignatureVerifier& inner, sig::Cache::IdFn id)
+        : inner_(inner), id_(std::move(id)) {}
+
+    SignInfo Hasher::Verify(const std::wstring& path) {
+        SignInfo s = inner_.Verify(path);
+        s.sha256 = Hash(path);
+        return s;
+    }
+
+    std::wstring Hasher::Compute(const std::wstring& path) {
+        sha::Digest d;
+        uint64_t size = 0;
+        if (!sha::HashFile(path, d, &size)) { ++failed_; return {}; }
+        ++hashed_;
+        bytes_ += size;
+        return sha::ToHex(d);
+    }
+
+    std::wstring Hasher::Hash(const std::wstring& path) {
+        if (path.empty()) return {};
+        sig::FileId id;
+        if (!id_(path, id)) { ++uncached_; return Compute(path); }
+
+        const std::wstring key = sig::NormalizePath(path);
+        std::promise<std::wstring> prom;
+        std::shared_future<std::wstring> fut;
+        uint64_t seq = 0;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            auto it = map_.find(key);
+            if (it != map_.end() && it->second.id == id) {
+                fut = it->second.hex;
+                if (fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready) ++coalesced_;
+                ++hits_;
+            }
+            else {
+                if (it != map_.end()) ++stale_;
+                Entry e;
+                e.id = id;
+                e.seq = seq = ++seq_;
+                e.hex = prom.get_future().share();
+                fut = e.hex;
+                map_[key] = std::move(e);
+            }
+        }
+        if (seq) {
+            std::wstring hex = Compute(path);
+            if (hex.empty()) {   // unreadable now (locked, gone): try again next time
+                // Only drop our own entry; another call may have replaced it meanwhile.
+                std::lock_guard<std::mutex> lk(m_);
+                auto it = map_.find(key);
+                if (it != map_.end() && it->second.seq == seq) map_.erase(it);
+            }
+            prom.set_value(std::move(hex));
+        }
+        return fut.get();
+    }
+
+    HasherStats Hasher::Stats() const {
+        HasherStats s;
+        s.hashed = hashed_; s.hits = hits_; s.coalesced = coalesced_; s.stale = stale_;
+        s.uncached = uncached_; s.failed = failed_; s.bytes = bytes_;
+        return s;
+    }
+} // namespace ioc
@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "pipeline.h"
+#include "sha256.h"
+#include "sigcache.h"
+
+// Image hash IOCs (--ioc-hashes <file>). The list is a sorted array of SHA-256 digests
+// with a directory over the leading bits of the digest (about four entries per bucket),
+// so a lookup is one directory read and a short search in one or two cache lines. A
+// compiled list (--ioc-compile) is mapped as is; a text feed is parsed and sorted at load.
+namespace ioc {
+    struct LoadStats {
+        uint64_t lines = 0;        // feed lines read (0 for a compiled list)
+        uint64_t skipped = 0;      // lines with text but no SHA-256 on them (headers, MD5, ...)
+        uint64_t duplicates = 0;
+        bool compiled = false;
+    };
+
+    class Index {
+    public:
+        Index() = default;
+        ~Index();
+        Index(const Index&) = delete;
+        Index& operator=(const Index&) = delete;
+
+        // Feed format: one hash per line, the first field (separated by , ; space or tab,
+        // optionally quoted) that is 64 hex digits; '#' starts a comment line.
+        bool Load(const std::wstring& path, std::wstring* err = nullptr);
+        void Build(std::vector<sha::Digest> digests);   // sorted and deduplicated here
+        bool Save(const std::wstring& path) const;      // compiled form, write-to-temp + rename
+
+        bool Contains(const sha::Digest& d) const;
+        size_t Count() const { return count_; }
+        bool Mapped() const { return base_ != nullptr; }
+        const LoadStats& Stats() const { return stats_; }
+
+    private:
+        void Close();
+        void MakeDirectory();
+
+        std::vector<sha::Digest> owned_;
+        std::vector<uint32_t> ownedDir_;
+        const sha::Digest* keys_ = nullptr;
+        const uint32_t* dir_ = nullptr;   // (1 << bits_) + 1 entries: first key of each bucket
+        size_t count_ = 0;
+        unsigned bits_ = 0;
+        LoadStats stats_;
+
+        const uint8_t* base_ = nullptr;
+        size_t size_ = 0;
+#if defined(_WIN32)
+        void* file_ = nullptr;
+        void* mapping_ = nullptr;
+#endif
+    };
+
+    // List used by EvaluateProcess (test ioc_hash); none until SetActive. Replacing it is
+    // not safe while a scan runs; replaced lists stay alive until ReleaseRetired(), which
+    // is only called when no scan runs (--watch: before a reload).
+    void SetActive(std::shared_ptr<const Index> index);
+    void ReleaseRetired();
+    const Index* Active();
+    bool Listed(std::wstring_view sha256Hex);   // false without a list or for a malformed hash
+
+    struct HasherStats {
+        uint64_t hashed = 0;      // files read and hashed
+        uint64_t hits = 0;        // answered from memory (file unchanged)
+        uint64_t coalesced = 0;   // waited on a hash already in flight (also counted as hits)
+        uint64_t stale = 0;       // memoized hash dropped because the file changed
+        uint64_t uncached = 0;    // file identity unavailable; hashed without memoizing
+        uint64_t failed = 0;      // file could not be read
+        uint64_t bytes = 0;       // bytes hashed
+    };
+
+    // Wraps the signature verifier and fills SignInfo::sha256 with the image hash. Hashes
+    // are kept per normalized path while the file identity (size, last write, volume/file
+    // id) is unchanged; concurrent requests for one image wait for a single read. Wrap it
+    // around sig::Cache, not inside it: hashes are not persisted.
+    class Hasher : public scan::ISignatureVerifier {
+    public:
+        explicit Hasher(scan::ISignatureVerifier& inner, sig::Cache::IdFn id = sig::QueryFileId);
+
+        SignInfo Verify(const std::wstring& path) override;
+        std::wstring Hash(const std::wstring& path);   // hex, empty when unreadable
+
+        HasherStats Stats() const;
+
+    private:
+        struct Entry {
+            sig::FileId id;
+            uint64_t seq = 0;   // which Hash call created the entry
+            std::shared_future<std::wstring> hex;
+        };
+        std::wstring Compute(const std::wstring& path);
+
+        scan::ISignatureVerifier& inner_;
+        sig::Cache::IdFn id_;
+        mutable std::mutex m_;
+        std::unordered_map<std::wstring, Entry> map_;
+        uint64_t seq_ = 0;
+        std::atomic<uint64_t> hashed_{ 0 }, hits_{ 0 }, coalesced_{ 0 }, stale_{ 0 }, uncached_{ 0 }, failed_{ 0 }, bytes_{ 0 };
+    };
+} // namespace ioc
@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: MIT
+#include "json_reader.h"
+#include <cstring>
+
+namespace {
+    int hex(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Any byte of w that ends a plain ASCII run: control, non-ASCII, '"' or '\\'.
+    inline bool special8(uint64_t w) {
+        const uint64_t k01 = 0x0101010101010101ull, k80 = 0x8080808080808080ull;
+        auto zero = [&](uint64_t v) { return (v - k01) & ~v & k80; };
+        return ((w & k80) | ((w - k01 * 0x20) & ~w & k80) | zero(w ^ (k01 * '"')) | zero(w ^ (k01 * '\\'))) != 0;
+    }
+
+    // Appends one code point (UTF-16 surrogates where wchar_t is 16-bit).
+    inline void put_cp(std::wstring& out, uint32_t cp) {
+        if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+            cp -= 0x10000;
+            out.push_back((wchar_t)(0xD800 + (cp >> 10)));
+            out.push_back((wchar_t)(0xDC00 + (cp & 0x3FF)));
+        }
+        else out.push_back((wchar_t)cp);
+    }
+
+    // One UTF-8 sequence at p (non-ASCII lead byte); malformed input gives U+FFFD and
+    // consumes one byte.
+    uint32_t utf8(const char*& p, const char* end) {
+        const unsigned char c = (unsigned char)*p;
+        int n = c >= 0xF0 && c < 0xF5 ? 3 : c >= 0xE0 ? 2 : c >= 0xC2 && c < 0xE0 ? 1 : -1;
+        if (c >= 0xF5) n = -1;
+        if (n < 0 || end - p <= n) { ++p; return 0xFFFD; }
+        uint32_t cp = c & (0x3F >> n);
+        for (int i = 1; i <= n; ++i) {
+            const unsigned char k = (unsigned char)p[i];
+            if ((k & 0xC0) != 0x80) { ++p; return 0xFFFD; }
+            cp = cp << 6 | (k & 0x3F);
+        }
+        static const uint32_t kMin[] = { 0, 0x80, 0x800, 0x10000 };
+        if (cp < kMin[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp < 0xE000)) { ++p; return 0xFFFD; }
+        p += n + 1;
+        return cp;
+    }
+} // anon
+
+namespace json {
+
+    bool Reader::BeginObject() {
+        if (!ok_ || !Expect('{')) return false;
+        first_ = true;
+        return true;
+    }
+
+    bool Reader::NextMember(std::string_view& key) {
+        if (!ok_) return false;
+        Ws();
+        if (p_ < end_ && *p_ == '}') { ++p_; first_ = false; return false; }
+        if (!first_ && !Expect(',')) return false;
+        if (!Expect('"')) return false;
+        const char* b = p_;
+        while (p_ < end_ && *p_ != '"') p_ += *p_ == '\\' ? 2 : 1;
+        if (p_ >= end_) return Fail();
+        key = std::string_view(b, (size_t)(p_ - b));
+        ++p_;
+        first_ = false;
+        return Expect(':');
+    }
+
+    bool Reader::BeginArray() {
+        if (!ok_ || !Expect('[')) return false;
+        first_ = true;
+        return true;
+    }
+
+    bool Reader::NextElement() {
+        if (!ok_) return false;
+        Ws();
+        if (p_ < end_ && *p_ == ']') { ++p_; first_ = false; return false; }
+        if (!first_ && !Expect(',')) return false;
+        first_ = false;
+        return true;
+    }
+
+    bool Reader::String(std::wstring& out) {
+        out.clear();
+        if (!ok_ || !Expect('"')) return false;
+        for (;;) {
+            // Plain ASCII runs go straight through, found 8 bytes at a time.
+            const char* run = p_;
+            for (uint64_t w; end_ - p_ >= 8; p_ += 8) {
+                std::memcpy(&w, p_, 8);
+                if (special8(w)) break;
+            }
+            while (p_ < end_ && (unsigned char)*p_ >= 0x20 && (unsigned char)*p_ < 0x80 && *p_ != '"' && *p_ != '\\') ++p_;
+            if (p_ != run) {
+                const size_t at = out.size(), n = (size_t)(p_ - run);
+                out.resize(at + n);
+                wchar_t* d = &out[at];
+                for (size_t i = 0; i < n; ++i) d[i] = (wchar_t)(unsigned char)run[i];
+            }
+            if (p_ >= end_) return Fail();
+            const unsigned char c = (unsigned char)*p_;
+            if (c == '"') { ++p_; return true; }
+            if (c < 0x20) return Fail();
+            if (c >= 0x80) { put_cp(out, utf8(p_, end_)); continue; }
+            // escape
+            if (end_ - p_ < 2) return Fail();
+            const char e = p_[1];
+            p_ += 2;
+            switch (e) {
+            case '"': out.push_back(L'"'); break;
+            case '\\': out.push_back(L'\\'); break;
+            case '/': out.push_back(L'/'); break;
+            case 'b': out.push_back(L'\b'); break;
+            case 'f': out.push_back(L'\f'); break;
+            case 'n': out.push_back(L'\n'); break;
+            case 'r': out.push_back(L'\r'); break;
+            case 't': out.push_back(L'\t'); break;
+            case 'u': {
+                auto u4 = [&](uint32_t& v) {
+                    if (end_ - p_ < 4) return false;
+                    v = 0;
+                    for (int i = 0; i < 4; ++i) { const int h = hex(p_[i]); if (h < 0) return false; v = v << 4 | (uint32_t)h; }
+                    p_ += 4;
+                    return true;
+                };
+                uint32_t cp;
+                if (!u4(cp)) return Fail();
+                if (cp >= 0xD800 && cp < 0xDC00 && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+                    const char* save = p_;
+                    p_ += 2;
+                    uint32_t lo;
+                    if (u4(lo) && lo >= 0xDC00 && lo < 0xE000) cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    else p_ = save;   // lone high surrogate, kept as is
+                }
+                put_cp(out, cp);
+                break;
+            }
+            default: return Fail();
+            }
+        }
+    }
+
+    bool Reader::Uint(uint64_t& v) {
+        if (!ok_) return false;
+        Ws();
+        if (p_ >= end_ || *p_ < '0' || *p_ > '9') return Fail();
+        v = 0;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') {
+            if (v > (UINT64_MAX - 9) / 10) return Fail();
+            v = v * 10 + (uint64_t)(*p_++ - '0');
+        }
+        if (p_ < end_ && (*p_ == '.' || *p_ == 'e' || *p_ == 'E')) return Fail();
+        return true;
+    }
+
+    bool Reader::Literal(std::string_view word) {
+        if ((size_t)(end_ - p_) < word.size() || std::memcmp(p_, word.data(), word.size()) != 0) return false;
+        p_ += word.size();
+        return true;
+    }
+
+    bool Reader::Bool(bool& v) {
+        if (!ok_) return false;
+        Ws();
+        if (Literal("true")) { v = true; return true; }
+        if (Literal("false")) { v = false; return true; }
+        return Fail();
+    }
+
+    bool Reader::IsNull() {
+        if (!ok_) return false;
+        Ws();
+        return Literal("null");
+    }
+
+    bool Reader::SkipString() {
+        ++p_;   // opening quote
+        for (;;) {
+            const void* q = std::memchr(p_, '"', (size_t)(end_ - p_));
+            if (!q) return Fail();
+            const char* e = (const char*)q;
+            size_t bs = 0;   // an odd run of backslashes escapes the quote
+            while (e - bs > p_ && e[-1 - (ptrdiff_t)bs] == '\\') ++bs;
+            p_ = e + 1;
+            if (!(bs & 1)) return true;
+        }
+    }
+
+    bool Reader::SkipValue(int depth) {
+        if (depth > kMaxDepth) return Fail();
+        Ws();
+        if (p_ >= end_) return Fail();
+        switch (*p_) {
+        case '"': return SkipString();
+        case '{': case '[': {
+            const char close = *p_ == '{' ? '}' : ']';
+            ++p_;
+            Ws();
+            if (p_ < end_ && *p_ == close) { ++p_; return true; }
+            for (;;) {
+                if (close == '}') {
+                    Ws();
+                    if (p_ >= end_ || *p_ != '"' || !SkipString() || !Expect(':')) return Fail();
+                }
+                if (!SkipValue(depth + 1)) return false;
+                Ws();
+                if (p_ < end_ && *p_ == ',') { ++p_; continue; }
+                if (p_ < end_ && *p_ == close) { ++p_; return true; }
+                return Fail();
+            }
+        }
+        case 't': if (Literal("true")) return true; return Fail();
+        case 'f': if (Literal("false")) return true; return Fail();
+        case 'n': if (Literal("null")) return true; return Fail();
+        default: {
+            const char* b = p_;
+            if (*p_ == '-') ++p_;
+            while (p_ < end_ && ((*p_ >= '0' && *p_ <= '9') || *p_ == '.' || *p_ == 'e' || *p_ == 'E' || *p_ == '+' || *p_ == '-')) ++p_;
+            return p_ != b ? true : Fail();
+        }
+        }
+    }
+
+    bool Reader::Skip() {
+        if (!ok_) return false;
+        return SkipValue(0);
+    }
+} // namespace json
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Pull reader over one JSON text in memory (--ingest). Nothing is built: the caller walks
+// objects and arrays member by member and decodes only the values it wants, into string
+// buffers it owns and reuses, so once those have grown reading allocates nothing.
+// Any syntax error makes every later call return false (Ok() tells it apart from the end).
+namespace json {
+    class Reader {
+    public:
+        Reader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+        bool BeginObject();                          // consumes '{'
+        bool NextMember(std::string_view& key);      // false at '}' (consumed); key is raw, not unescaped
+        bool BeginArray();                           // consumes '['
+        bool NextElement();                          // false at ']' (consumed)
+
+        bool String(std::wstring& out);              // escapes and UTF-8 decoded
+        bool Uint(uint64_t& v);                      // non-negative integer
+        bool Bool(bool& v);
+        bool Skip();                                 // any value, nested ones included
+
+        bool IsNull();                               // consumes `null` if it is next
+        bool Ok() const { return ok_; }
+        const char* Pos() const { return p_; }
+
+    private:
+        static constexpr int kMaxDepth = 64;
+
+        void Ws() { while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_; }
+        bool Fail() { ok_ = false; p_ = end_; return false; }
+        bool Expect(char c) { Ws(); if (p_ < end_ && *p_ == c) { ++p_; return true; } return Fail(); }
+        bool Literal(std::string_view word);
+        bool SkipString();
+        bool SkipValue(int depth);
+
+        const char* p_;
+        const char* end_;
+        bool ok_ = true;
+        bool first_ = true;   // no member/element read yet at the current level
+    };
+} // namespace json
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: MIT
+#include "lineage.h"
+
+namespace {
+    // Windows PIDs are multiples of 4; the multiplier spreads them over the table.
+    inline size_t bucket(uint32_t pid, size_t mask) { return (size_t)((pid >> 2) * 0x9E3779B1u) & mask; }
+} // anon
+
+namespace lin {
+
+    void Graph::Clear() {
+        nodes_.clear(); children_.clear(); index_.clear(); names_.clear();
+    }
+
+    void Graph::Reserve(size_t n) {
+        nodes_.reserve(n);
+        names_.reserve(n * 16);
+    }
+
+    uint32_t Graph::Add(uint32_t pid, uint32_t ppid, uint64_t createTime, std::wstring_view name) {
+        Node n;
+        n.pid = pid; n.ppid = ppid; n.createTime = createTime;
+        n.nameOff = (uint32_t)names_.size(); n.nameLen = (uint32_t)name.size();
+        names_.append(name);
+        nodes_.push_back(n);
+        return (uint32_t)(nodes_.size() - 1);
+    }
+
+    void Graph::Link() {
+        const size_t n = nodes_.size();
+        size_t cap = 16;
+        while (cap < 2 * n) cap <<= 1;
+        index_.assign(cap, 0);
+        for (size_t i = 0; i < n; ++i) {   // a duplicate PID keeps its first slot
+            size_t b = bucket(nodes_[i].pid, cap - 1);
+            while (index_[b] && nodes_[index_[b] - 1].pid != nodes_[i].pid) b = (b + 1) & (cap - 1);
+            if (!index_[b]) index_[b] = (uint32_t)i + 1;
+        }
+
+        std::vector<uint32_t> count(n + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            Node& c = nodes_[i];
+            c.parent = kNone; c.childCount = 0;
+            if (c.pid == c.ppid) continue;   // Idle (0 <- 0)
+            const uint32_t p = Find(c.ppid);
+            if (p == kNone || p == i) continue;
+            const Node& par = nodes_[p];
+            if (c.createTime && par.createTime && par.createTime > c.createTime) continue;   // PID reused
+            c.parent = p;
+            ++count[p];
+        }
+        // Children as one array ordered by parent (counting sort); within a parent, by slot.
+        uint32_t off = 0;
+        for (size_t i = 0; i < n; ++i) { nodes_[i].firstChild = off; off += count[i]; }
+        children_.assign(off, 0);
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t p = nodes_[i].parent;
+            if (p == kNone) continue;
+            Node& par = nodes_[p];
+            children_[par.firstChild + par.childCount++] = (uint32_t)i;
+        }
+    }
+
+    void Graph::Build(const std::vector<scan::ProcEntry>& procs) {
+        Clear();
+        Reserve(procs.size());
+        for (const auto& e : procs) Add(e.pid, e.ppid, e.createTime, e.exeName);
+        Link();
+    }
+
+    uint32_t Graph::Find(uint32_t pid) const {
+        if (index_.empty()) return kNone;
+        const size_t mask = index_.size() - 1;
+        for (size_t b = bucket(pid, mask); index_[b]; b = (b + 1) & mask)
+            if (nodes_[index_[b] - 1].pid == pid) return index_[b] - 1;
+        return kNone;
+    }
+
+    std::wstring_view Graph::ParentName(uint32_t pid) const {
+        const uint32_t s = Find(pid);
+        if (s == kNone || nodes_[s].parent == kNone) return {};
+        return Name(nodes_[s].parent);
+    }
+
+    void Graph::Ancestry(uint32_t pid, Chain& out) const {
+        out.n = 0;
+        uint32_t s = Find(pid);
+        if (s == kNone) return;
+        // Without creation times a chain can loop (two PIDs naming each other as parent).
+        for (uint32_t p = nodes_[s].parent; p != kNone && p != s && out.n < kMaxDepth; p = nodes_[p].parent) {
+            bool seen = false;
+            for (size_t i = 0; i < out.n; ++i) seen |= out.v[i].pid == nodes_[p].pid;
+            if (seen) break;
+            out.v[out.n++] = Ancestor{ nodes_[p].pid, Name(p) };
+        }
+    }
+} // namespace lin
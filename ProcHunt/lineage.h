@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "pipeline.h"
+
+// Process lineage: one enumeration as a flat table. Every process has a slot; parents and
+// children are slot indices (children of a slot are a contiguous range), so walking up or
+// down the tree is array indexing. PIDs are reused: a parent created after its child is
+// a different process that got the old PID, and the child is left without a parent.
+namespace lin {
+    constexpr uint32_t kNone = 0xFFFFFFFFu;
+    constexpr size_t kMaxDepth = 8;   // ancestors reported per process
+
+    struct Node {
+        uint32_t pid = 0, ppid = 0;
+        uint64_t createTime = 0;      // FILETIME units, 0 = unknown (no reuse check)
+        uint32_t parent = kNone;      // slot
+        uint32_t firstChild = 0, childCount = 0;   // range in Children()
+        uint32_t nameOff = 0, nameLen = 0;
+    };
+
+    struct Ancestor { uint32_t pid = 0; std::wstring_view name; };
+    struct Chain {   // parent first
+        size_t n = 0;
+        Ancestor v[kMaxDepth];
+    };
+
+    class Graph {
+    public:
+        // Add every process, then Link() once; slots follow the order of Add().
+        void Clear();
+        void Reserve(size_t n);
+        uint32_t Add(uint32_t pid, uint32_t ppid, uint64_t createTime, std::wstring_view name);
+        void Link();
+        void Build(const std::vector<scan::ProcEntry>& procs);   // Clear + Add each + Link
+
+        size_t Size() const { return nodes_.size(); }
+        uint32_t Find(uint32_t pid) const;   // slot or kNone
+        const Node& At(uint32_t slot) const { return nodes_[slot]; }
+        std::wstring_view Name(uint32_t slot) const {
+            const Node& n = nodes_[slot];
+            return std::wstring_view(names_.data() + n.nameOff, n.nameLen);
+        }
+        const uint32_t* Children(uint32_t slot) const { return children_.data() + nodes_[slot].firstChild; }
+
+        // Name of the parent of `pid`, empty when unknown (not in the table, reused PID).
+        std::wstring_view ParentName(uint32_t pid) const;
+        // Ancestors of `pid` up to kMaxDepth, stopping at a process already on the chain.
+        void Ancestry(uint32_t pid, Chain& out) const;
+
+    private:
+        std::vector<Node> nodes_;
+        std::vector<uint32_t> children_;
+        std::vector<uint32_t> index_;   // open addressing: slot + 1, 0 = empty
+        std::wstring names_;
+    };
+} // namespace lin
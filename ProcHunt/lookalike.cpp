@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: MIT
+#include "lookalike.h"
+#include <algorithm>
+#include <cwctype>
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+    inline unsigned popcnt64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return (unsigned)__builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return (unsigned)((x * 0x0101010101010101ull) >> 56);
+#endif
+    }
+
+    uint64_t char_bits(std::wstring_view s) {
+        uint64_t b = 0;
+        for (wchar_t c : s) b |= 1ull << ((unsigned)c & 63);
+        return b;
+    }
+
+    // Per-character match masks of the pattern (bit i: pattern[i] == c).
+    struct Pattern {
+        uint64_t ascii[128] = {};
+        wchar_t wide[heur::NameIndex::kMaxLen] = {};
+        uint64_t wideMask[heur::NameIndex::kMaxLen] = {};
+        wchar_t text[heur::NameIndex::kMaxLen] = {};
+        size_t nWide = 0, m = 0;
+        uint64_t chars = 0;
+
+        void Set(std::wstring_view p) {   // p.size() <= kMaxLen
+            for (size_t i = 0; i < m; ++i) if ((unsigned)text[i] < 128) ascii[text[i]] = 0;   // only what the last pattern set
+            nWide = 0;
+            m = p.size(); chars = char_bits(p);
+            for (size_t i = 0; i < m; ++i) {
+                const wchar_t c = text[i] = p[i];
+                if ((unsigned)c < 128) { ascii[c] |= 1ull << i; continue; }
+                size_t k = 0;
+                while (k < nWide && wide[k] != c) ++k;
+                if (k == nWide) { wide[nWide] = c; wideMask[nWide++] = 0; }
+                wideMask[k] |= 1ull << i;
+            }
+        }
+        uint64_t Eq(wchar_t c) const {
+            if ((unsigned)c < 128) return ascii[c];
+            for (size_t k = 0; k < nWide; ++k) if (wide[k] == c) return wideMask[k];
+            return 0;
+        }
+    };
+    thread_local Pattern t_pat;
+
+    // Hyyro's bit-vector OSA distance: columns of the DP matrix as +1/-1 delta vectors.
+    int osa(const Pattern& p, std::wstring_view t, int max) {
+        const size_t m = p.m, n = t.size();
+        if (!m) return (int)std::min<size_t>(n, (size_t)max + 1);
+        const uint64_t last = 1ull << (m - 1);
+        uint64_t pv = m == 64 ? ~0ull : (1ull << m) - 1, mv = 0, d0 = 0, prevX = 0;
+        int score = (int)m;
+        for (size_t j = 0; j < n; ++j) {
+            const uint64_t x = p.Eq(t[j]);
+            const uint64_t tr = ((~d0 & x) << 1) & prevX;
+            d0 = (((x & pv) + pv) ^ pv) | x | mv | tr;
+            uint64_t hp = mv | ~(d0 | pv);
+            uint64_t hn = pv & d0;
+            if (hp & last) ++score;
+            else if (hn & last) --score;
+            hp = (hp << 1) | 1;
+            hn <<= 1;
+            pv = hn | ~(d0 | hp);
+            mv = hp & d0;
+            prevX = x;
+            if (score - (int)(n - 1 - j) > max) return max + 1;   // each column lowers it by at most 1
+        }
+        return score > max ? max + 1 : score;
+    }
+
+    // Plain DP for names too long for one machine word.
+    int osa_dp(std::wstring_view a, std::wstring_view b, int max) {
+        std::vector<int> pp(b.size() + 1), prev(b.size() + 1), cur(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); ++j) prev[j] = (int)j;
+        for (size_t i = 1; i <= a.size(); ++i) {
+            cur[0] = (int)i;
+            for (size_t j = 1; j <= b.size(); ++j) {
+                const int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+                int v = std::min({ prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + cost });
+                if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) v = std::min(v, pp[j - 2] + 1);
+                cur[j] = v;
+            }
+            std::swap(pp, prev); std::swap(prev, cur);
+        }
+        return std::min(prev[b.size()], max + 1);
+    }
+
+    // Reason strings are handed out as raw pointers, so they are never freed; identical
+    // texts are shared, which keeps reloads from growing the pool.
+    const wchar_t* intern(std::wstring s) {
+        static std::mutex m;
+        static std::unordered_set<std::wstring> pool;
+        std::lock_guard<std::mutex> lk(m);
+        return pool.insert(std::move(s)).first->c_str();
+    }
+} // anon
+
+namespace heur {
+
+    int NameIndex::Budget(std::wstring_view name) {
+        const size_t dot = name.find_last_of(L'.');
+        const size_t stem = dot == std::wstring_view::npos ? name.size() : dot;
+        return stem <= 4 ? 0 : stem <= 7 ? 1 : 2;
+    }
+
+    bool NameIndex::Add(std::wstring_view name) {
+        if (name.empty() || name.size() > kMaxLen) return false;
+        Entry e;
+        e.name.resize(name.size());
+        for (size_t i = 0; i < name.size(); ++i) e.name[i] = (wchar_t)::towlower(name[i]);
+        auto& bucket = byLen_[name.size()];
+        for (auto& x : bucket) if (x.name == e.name) return false;
+        e.chars = char_bits(e.name);
+        e.budget = Budget(e.name);
+        e.reason[0] = nullptr;
+        for (int d = 1; d <= 2; ++d)
+            e.reason[d] = intern(L"Name resembles " + e.name + L" (edit distance " + std::to_wstring(d) + L")");
+        bucket.push_back(std::move(e));
+        ++size_;
+        return true;
+    }
+
+    void NameIndex::Clear() {
+        for (auto& b : byLen_) b.clear();
+        size_ = 0;
+    }
+
+    int NameIndex::Distance(std::wstring_view a, std::wstring_view b, int max) {
+        if (a.size() > b.size()) std::swap(a, b);
+        if (b.size() - a.size() > (size_t)max) return max + 1;
+        if (a.size() > kMaxLen) return osa_dp(a, b, max);
+        Pattern& p = t_pat;
+        p.Set(a);
+        return osa(p, b, max);
+    }
+
+    bool NameIndex::Lookalike(std::wstring_view name, Hit& hit) const {
+        if (name.empty() || name.size() > kMaxLen || !size_) return false;
+        Pattern& p = t_pat;
+        p.Set(name);
+        const size_t len = name.size();
+        int best = 3;
+        const Entry* found = nullptr;
+        for (size_t l = len > 2 ? len - 2 : 1; l <= len + 2 && l <= kMaxLen; ++l) {
+            const int diff = (int)(l > len ? l - len : len - l);
+            for (const Entry& e : byLen_[l]) {
+                if (diff > e.budget) continue;
+                // Each character present on one side only needs its own edit.
+                const int lower = (int)std::max(popcnt64(p.chars & ~e.chars), popcnt64(e.chars & ~p.chars));
+                // Ties go to the longer name: svhost.exe imitates svchost.exe rather than sihost.exe.
+                const int max = std::min(e.budget, best);
+                if (std::max(lower, diff) > max) continue;
+                const int d = osa(p, e.name, max);
+                if (d == 0) return false;   // the name is protected itself
+                if (d <= e.budget && (d < best || (d == best && e.name.size() > found->name.size()))) { best = d; found = &e; }
+            }
+        }
+        if (!found) return false;
+        hit.name = found->name;
+        hit.distance = best;
+        hit.reason = found->reason[best];
+        return true;
+    }
+} // namespace heur
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Protected binary names and a fuzzy lookup for process names imitating them
+// (svch0st.exe, scvhost.exe, lsasss.exe, expl0rer.exe). The distance is the optimal
+// string alignment form of Damerau-Levenshtein (insert, delete, substitute, swap two
+// adjacent characters), computed bit-parallel with the process name as the pattern
+// (Hyyro 2003): one pass of a few word operations per character of each candidate.
+namespace heur {
+    class NameIndex {
+    public:
+        static constexpr size_t kMaxLen = 64;   // longer names are neither indexed nor matched
+
+        bool Add(std::wstring_view name);   // case-folded here; false if empty, too long or present
+        size_t Size() const { return size_; }
+        void Clear();
+
+        // Edits tolerated around a protected name: none for a stem (name without extension)
+        // of up to 4 characters, 1 up to 7, 2 beyond.
+        static int Budget(std::wstring_view name);
+
+        struct Hit {
+            std::wstring_view name;          // the protected name
+            int distance = 0;                // 1..Budget(name)
+            const wchar_t* reason = nullptr; // "Name resembles <name> (edit distance <d>)", static
+        };
+        // Closest protected name within its budget. A name that is itself protected is not
+        // a lookalike. foldedName must be case-folded.
+        bool Lookalike(std::wstring_view foldedName, Hit& hit) const;
+
+        // OSA distance between a and b, or max + 1 once it is known to exceed max.
+        static int Distance(std::wstring_view a, std::wstring_view b, int max);
+
+    private:
+        struct Entry {
+            std::wstring name;
+            uint64_t chars;   // bit (c & 63) for every character
+            int budget;
+            const wchar_t* reason[3];   // by distance; interned, outlive the index
+        };
+        std::vector<Entry> byLen_[kMaxLen + 1];
+        size_t size_ = 0;
+    };
+} // namespace heur
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: MIT
+#include "matcher.h"
+#include <algorithm>
+#include <cwctype>
+#include <string>
+
+namespace {
+    inline wchar_t fold(wchar_t c) {
+        if ((uint32_t)c < 128) return (c >= L'A' && c <= L'Z') ? (wchar_t)(c + 32) : c;
+        return (wchar_t)::towlower(c);
+    }
+} // anon
+
+namespace heur {
+
+    void Matcher::Add(std::wstring_view needle, uint32_t tags) {
+        if (needle.empty() || !tags) return;
+        std::wstring n(needle);
+        for (auto& c : n) c = fold(c);
+        needles_.emplace_back(std::move(n), tags);
+    }
+
+    uint32_t Matcher::ClassOf(wchar_t c) const {
+        if ((uint32_t)c < 128) return asciiClass_[c];   // upper-case ASCII pre-folded in Build()
+        c = fold(c);
+        if ((uint32_t)c < 128) return asciiClass_[c];
+        auto it = std::lower_bound(wideClass_.begin(), wideClass_.end(), std::make_pair(c, (uint16_t)0));
+        return (it != wideClass_.end() && it->first == c) ? it->second : 0;
+    }
+
+    void Matcher::Build() {
+        // Alphabet: one class per distinct folded needle char, everything else is class 0.
+        std::fill(std::begin(asciiClass_), std::end(asciiClass_), (uint16_t)0);
+        wideClass_.clear();
+        classes_ = 1;
+        for (auto& n : needles_) {
+            for (wchar_t c : n.first) {
+                if (ClassOf(c)) continue;
+                if ((uint32_t)c < 128) {
+                    asciiClass_[c] = (uint16_t)classes_;
+                    if (c >= L'a' && c <= L'z') asciiClass_[c - 32] = (uint16_t)classes_;
+                    ++classes_;
+                }
+                else {
+                    wideClass_.emplace_back(c, (uint16_t)classes_++);
+                    std::sort(wideClass_.begin(), wideClass_.end());
+                }
+            }
+        }
+
+        // Trie
+        const uint32_t K = classes_;
+        delta_.assign(K, 0);
+        out_.assign(1, 0);
+        allTags_ = 0;
+        for (auto& n : needles_) {
+            int32_t s = 0;
+            for (wchar_t c : n.first) {
+                size_t slot = (size_t)s * K + ClassOf(c);
+                if (!delta_[slot]) {
+                    delta_[slot] = (int32_t)out_.size();
+                    out_.push_back(0);
+                    delta_.resize(out_.size() * K, 0);
+                }
+                s = delta_[slot];
+            }
+            out_[s] |= n.second;
+            allTags_ |= n.second;
+        }
+
+        // Failure links folded into the transition table (BFS), outputs merged along them.
+        std::vector<int32_t> fail(out_.size(), 0), queue;
+        queue.reserve(out_.size());
+        for (uint32_t k = 0; k < K; ++k) if (delta_[k]) queue.push_back(delta_[k]);
+        for (size_t qi = 0; qi < queue.size(); ++qi) {
+            int32_t s = queue[qi];
+            out_[s] |= out_[fail[s]];
+            for (uint32_t k = 0; k < K; ++k) {
+                int32_t& t = delta_[(size_t)s * K + k];
+                int32_t f = delta_[(size_t)fail[s] * K + k];
+                if (t) { fail[t] = f; queue.push_back(t); }
+                else t = f;
+            }
+        }
+    }
+
+    uint32_t Matcher::Scan(std::wstring_view text) const {
+        if (delta_.empty()) return 0;
+        const uint32_t K = classes_;
+        const int32_t* d = delta_.data();
+        uint32_t tags = 0;
+        int32_t s = 0;
+        for (wchar_t c : text) {
+            s = d[(size_t)s * K + ClassOf(c)];
+            if (out_[s]) {
+                tags |= out_[s];
+                if (tags == allTags_) break;
+            }
+        }
+        return tags;
+    }
+} // namespace heur
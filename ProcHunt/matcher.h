@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace heur {
+    // Case-insensitive multi-pattern matcher (Aho-Corasick compiled to a dense DFA
+    // over the needle alphabet). Each needle carries a tag bitmask; Scan() returns
+    // the OR of the tags of every needle occurring in the text, in a single pass.
+    class Matcher {
+    public:
+        void Add(std::wstring_view needle, uint32_t tags);
+        void Build();
+        uint32_t Scan(std::wstring_view text) const;
+        bool Empty() const { return needles_.empty(); }
+
+    private:
+        uint32_t ClassOf(wchar_t c) const;
+
+        std::vector<std::pair<std::wstring, uint32_t>> needles_;
+        uint16_t asciiClass_[128] = {};
+        std::vector<std::pair<wchar_t, uint16_t>> wideClass_;  // sorted, non-ASCII folded chars
+        uint32_t classes_ = 1;                                 // class 0 = not in any needle
+        std::vector<int32_t> delta_;                           // states_ x classes_
+        std::vector<uint32_t> out_;                            // tags emitted per state
+        uint32_t allTags_ = 0;
+    };
+} // namespace heur
@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: MIT
+#include "obfusc.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#define PH_OBF_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PH_OBF_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    struct Acc {
+        size_t upper = 0, lower = 0, digit = 0, symbol = 0, nonAscii = 0;
+        size_t b64Cur = 0, b64Best = 0, hexCur = 0, hexBest = 0;
+        uint32_t hist[129] = {};   // ASCII + one bin for everything else
+    };
+
+    inline unsigned popcnt64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return (unsigned)__builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return (unsigned)((x * 0x0101010101010101ull) >> 56);
+#endif
+    }
+    inline unsigned ctz64(uint64_t x) {   // x != 0
+#if defined(__GNUC__) || defined(__clang__)
+        return (unsigned)__builtin_ctzll(x);
+#elif defined(_M_X64)
+        unsigned long i; _BitScanForward64(&i, x); return (unsigned)i;
+#else
+        unsigned long i;
+        if ((uint32_t)x) { _BitScanForward(&i, (uint32_t)x); return (unsigned)i; }
+        _BitScanForward(&i, (uint32_t)(x >> 32)); return (unsigned)i + 32;
+#endif
+    }
+
+    inline void run_step(bool in, size_t& cur, size_t& best) {
+        if (in) ++cur;
+        else { if (cur > best) best = cur; cur = 0; }
+    }
+
+    inline void scalar_step(Acc& a, wchar_t wc) {
+        const uint32_t c = (uint32_t)wc;
+        const bool up = c - L'A' < 26u, lo = c - L'a' < 26u, dg = c - L'0' < 10u;
+        const bool hexAlpha = (c - L'a' < 6u) || (c - L'A' < 6u);
+        a.upper += up; a.lower += lo; a.digit += dg;
+        a.symbol += (c >= 0x21 && c <= 0x7E && !up && !lo && !dg);
+        a.nonAscii += (c >= 128);
+        a.hist[c < 128 ? c : 128]++;
+        run_step(up || lo || dg || c == L'+' || c == L'/', a.b64Cur, a.b64Best);
+        run_step(dg || hexAlpha, a.hexCur, a.hexBest);
+    }
+
+    // Feeds a block's lane mask (`bpl` bits per lane, `bits` valid bits, lane order) into a run counter.
+    inline void run_block(uint64_t m, unsigned bits, unsigned bpl, size_t& cur, size_t& best) {
+        unsigned pos = 0;
+        while (pos < bits) {
+            const uint64_t rest = m >> pos;
+            unsigned ones = (~rest == 0) ? 64 : ctz64(~rest);
+            if (ones > bits - pos) ones = bits - pos;
+            cur += ones / bpl; pos += ones;
+            if (pos >= bits) break;
+            if (cur > best) best = cur;
+            cur = 0;
+            const uint64_t z = rest >> ones;
+            pos += z ? ctz64(z) : bits - pos;
+        }
+    }
+
+#if PH_OBF_AVX2 || PH_OBF_SSE2
+#if PH_OBF_AVX2
+    struct Vec {
+        using T = __m256i;
+        static constexpr unsigned kBytes = 32;
+        static T load(const wchar_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+        static T set1(int v) { return sizeof(wchar_t) == 2 ? _mm256_set1_epi16((short)v) : _mm256_set1_epi32(v); }
+        static T gt(T a, T b) { return sizeof(wchar_t) == 2 ? _mm256_cmpgt_epi16(a, b) : _mm256_cmpgt_epi32(a, b); }
+        static T eq(T a, T b) { return sizeof(wchar_t) == 2 ? _mm256_cmpeq_epi16(a, b) : _mm256_cmpeq_epi32(a, b); }
+        static T and_(T a, T b) { return _mm256_and_si256(a, b); }
+        static T or_(T a, T b) { return _mm256_or_si256(a, b); }
+        static T andnot(T a, T b) { return _mm256_andnot_si256(a, b); }
+        static uint64_t mask(T a) { return (uint32_t)_mm256_movemask_epi8(a); }
+    };
+#else
+    struct Vec {
+        using T = __m128i;
+        static constexpr unsigned kBytes = 16;
+        static T load(const wchar_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+        static T set1(int v) { return sizeof(wchar_t) == 2 ? _mm_set1_epi16((short)v) : _mm_set1_epi32(v); }
+        static T gt(T a, T b) { return sizeof(wchar_t) == 2 ? _mm_cmpgt_epi16(a, b) : _mm_cmpgt_epi32(a, b); }
+        static T eq(T a, T b) { return sizeof(wchar_t) == 2 ? _mm_cmpeq_epi16(a, b) : _mm_cmpeq_epi32(a, b); }
+        static T and_(T a, T b) { return _mm_and_si128(a, b); }
+        static T or_(T a, T b) { return _mm_or_si128(a, b); }
+        static T andnot(T a, T b) { return _mm_andnot_si128(a, b); }
+        static uint64_t mask(T a) { return (uint32_t)_mm_movemask_epi8(a); }
+    };
+#endif
+
+    // Signed lane compares: 16-bit chars >= 0x8000 read as negative and fall outside every ASCII range.
+    inline Vec::T in_range(Vec::T v, int lo, int hi) {
+        return Vec::and_(Vec::gt(v, Vec::set1(lo - 1)), Vec::gt(Vec::set1(hi + 1), v));
+    }
+
+    size_t simd_blocks(const wchar_t* p, size_t n, Acc& a) {
+        constexpr unsigned bpl = sizeof(wchar_t);
+        constexpr size_t lanes = Vec::kBytes / bpl;
+        const Vec::T plus = Vec::set1(L'+'), slash = Vec::set1(L'/');
+        const Vec::T zero = Vec::set1(0), c127 = Vec::set1(127);
+        size_t i = 0;
+        for (; i + lanes <= n; i += lanes) {
+            const Vec::T v = Vec::load(p + i);
+            const Vec::T up = in_range(v, L'A', L'Z');
+            const Vec::T lo = in_range(v, L'a', L'z');
+            const Vec::T dg = in_range(v, L'0', L'9');
+            const Vec::T alnum = Vec::or_(Vec::or_(up, lo), dg);
+            const Vec::T b64 = Vec::or_(alnum, Vec::or_(Vec::eq(v, plus), Vec::eq(v, slash)));
+            const Vec::T hex = Vec::or_(dg, Vec::or_(in_range(v, L'a', L'f'), in_range(v, L'A', L'F')));
+            const Vec::T sym = Vec::andnot(alnum, in_range(v, 0x21, 0x7E));
+            const Vec::T wide = Vec::or_(Vec::gt(zero, v), Vec::gt(v, c127));
+
+            a.upper += popcnt64(Vec::mask(up)) / bpl;
+            a.lower += popcnt64(Vec::mask(lo)) / bpl;
+            a.digit += popcnt64(Vec::mask(dg)) / bpl;
+            a.symbol += popcnt64(Vec::mask(sym)) / bpl;
+            a.nonAscii += popcnt64(Vec::mask(wide)) / bpl;
+            run_block(Vec::mask(b64), Vec::kBytes, bpl, a.b64Cur, a.b64Best);
+            run_block(Vec::mask(hex), Vec::kBytes, bpl, a.hexCur, a.hexBest);
+            for (size_t k = 0; k < lanes; ++k) {
+                const uint32_t c = (uint32_t)p[i + k];
+                a.hist[c < 128 ? c : 128]++;
+            }
+        }
+        return i;
+    }
+#endif
+
+    heur::ObfStats finish(Acc& a, size_t n) {
+        heur::ObfStats st{};
+        st.length = n;
+        st.longestBase64 = a.b64Cur > a.b64Best ? a.b64Cur : a.b64Best;
+        st.longestHex = a.hexCur > a.hexBest ? a.hexCur : a.hexBest;
+        if (!n) return st;
+        const double dn = (double)n;
+        for (uint32_t h : a.hist) if (h) { double p = h / dn; st.entropy -= p * std::log2(p); }
+        st.upperRatio = a.upper / dn;
+        st.lowerRatio = a.lower / dn;
+        st.digitRatio = a.digit / dn;
+        st.symbolRatio = a.symbol / dn;
+        st.nonAsciiRatio = a.nonAscii / dn;
+        return st;
+    }
+} // anon
+
+namespace heur {
+
+    ObfStats AnalyzeCommandLine(std::wstring_view s) {
+        Acc a;
+        size_t i = 0;
+#if PH_OBF_AVX2 || PH_OBF_SSE2
+        i = simd_blocks(s.data(), s.size(), a);
+#endif
+        for (; i < s.size(); ++i) scalar_step(a, s[i]);
+        return finish(a, s.size());
+    }
+
+    ObfStats AnalyzeCommandLineScalar(std::wstring_view s) {
+        Acc a;
+        for (wchar_t c : s) scalar_step(a, c);
+        return finish(a, s.size());
+    }
+
+    const char* ObfKernelName() {
+#if PH_OBF_AVX2
+        return "avx2";
+#elif PH_OBF_SSE2
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+} // namespace heur
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+namespace heur {
+    // Command-line statistics gathered in one pass, exposed as obfuscation signals.
+    struct ObfStats {
+        size_t length = 0;
+        size_t longestBase64 = 0;   // longest run of [A-Za-z0-9+/]
+        size_t longestHex = 0;      // longest run of [0-9A-Fa-f]
+        double entropy = 0.0;       // Shannon entropy, bits per char (ASCII + one non-ASCII bin)
+        double upperRatio = 0.0;
+        double lowerRatio = 0.0;
+        double digitRatio = 0.0;
+        double symbolRatio = 0.0;   // printable ASCII punctuation
+        double nonAsciiRatio = 0.0;
+
+        // Same verdict as the former regex ([A-Za-z0-9+/]{120,}={0,2}) plus the length cap.
+        bool Obfuscated() const { return length > 4096 || longestBase64 >= 120; }
+    };
+
+    // Vectorized (AVX2/SSE2, chosen at compile time) with a scalar tail/fallback.
+    ObfStats AnalyzeCommandLine(std::wstring_view s);
+    // Scalar reference path, same results as AnalyzeCommandLine().
+    ObfStats AnalyzeCommandLineScalar(std::wstring_view s);
+    // "avx2", "sse2" or "scalar".
+    const char* ObfKernelName();
+} // namespace heur
@@ -1,15 +1,21 @@
 // SPDX-License-Identifier: MIT
 #define _CRT_SECURE_NO_WARNINGS
-#include <windows.h>
-#include <io.h>
-#include <fcntl.h>
 #include <cstdarg>
 #include <cstdio>
+#include <memory>
 #include <string>
 
 #include "output.h"
+#include "sink.h"
 
-static FILE* g_out = stdout;
+// Everything goes through a sink::Async: the writer thread owns the FILE.
+static std::unique_ptr<sink::Async> g_sink;
+static void u8write(const std::string& u8);
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
 
 static std::string W2U8(const std::wstring& w) {
     if (w.empty()) return {};
@@ -18,7 +24,7 @@ static std::string W2U8(const std::wstring& w) {
     WideCharToMultiByte(CP_UTF8, 0, w.c_str(), (int)w.size(), &s[0], n, nullptr, nullptr);
     return s;
 }
-static void u8vprint(FILE* f, const wchar_t* fmt, va_list ap) {
+static void u8vprint(const wchar_t* fmt, va_list ap) {
     va_list ap_len;
 #ifdef _MSC_VER
     ap_len = ap;
@@ -33,27 +39,83 @@ static void u8vprint(FILE* f, const wchar_t* fmt, va_list ap) {
     std::wstring w((size_t)need + 1, L'\0');
     vswprintf_s(&w[0], w.size(), fmt, ap);
     w.resize((size_t)need);
-    auto u8 = W2U8(w);
-    fwrite(u8.data(), 1, u8.size(), f);
+    u8write(W2U8(w));
 }
 
-void OutInit(const std::wstring& outPath) {
+void OutInit(const std::wstring& outPath, uint64_t rotateBytes, uint64_t rotateRecords, unsigned rotateKeep) {
+    OutClose();
     _setmode(_fileno(stdout), _O_BINARY);
+    auto target = std::make_unique<sink::FileTarget>();
     if (outPath.empty()) {
-        g_out = stdout;
         SetConsoleOutputCP(CP_UTF8); // best-effort console UTF-8
     }
-    else {
-        if (_wfopen_s(&g_out, outPath.c_str(), L"wb") != 0 || !g_out) {
-            fwprintf(stderr, L"Cannot open output file: %s\n", outPath.c_str());
-            g_out = stdout;
-        }
+    else if (!target->Open(outPath, rotateBytes, rotateRecords, rotateKeep)) {
+        fwprintf(stderr, L"Cannot open output file: %s\n", outPath.c_str());
+    }
+    g_sink = std::make_unique<sink::Async>(std::move(target));
+}
+#else
+#include <cwchar>
+#include "utils.h"
+
+// Format strings are written for MSVC, where %s/%c in a wide format take wide arguments;
+// glibc needs %ls/%lc for that.
+static std::wstring portable_format(const wchar_t* fmt) {
+    std::wstring o;
+    for (const wchar_t* p = fmt; *p; ++p) {
+        o.push_back(*p);
+        if (*p != L'%') continue;
+        if (p[1] == L'%') { o.push_back(*++p); continue; }
+        while (p[1] && wcschr(L"-+ #0123456789.*", p[1])) o.push_back(*++p);
+        if (p[1] == L's' || p[1] == L'c') o.push_back(L'l');
+    }
+    return o;
+}
+static void u8vprint(const wchar_t* fmt, va_list ap) {
+    const std::wstring pf = portable_format(fmt);
+    std::wstring w(256, L'\0');
+    for (;;) {
+        va_list aq;
+        va_copy(aq, ap);
+        int n = vswprintf(&w[0], w.size(), pf.c_str(), aq);
+        va_end(aq);
+        if (n >= 0) { w.resize((size_t)n); break; }
+        if (w.size() >= (1u << 24)) return;
+        w.resize(w.size() * 2);
     }
+    u8write(util::to_utf8(w));
+}
+
+void OutInit(const std::wstring& outPath, uint64_t rotateBytes, uint64_t rotateRecords, unsigned rotateKeep) {
+    OutClose();
+    auto target = std::make_unique<sink::FileTarget>();
+    if (!outPath.empty() && !target->Open(outPath, rotateBytes, rotateRecords, rotateKeep))
+        fprintf(stderr, "Cannot open output file: %s\n", util::to_utf8(outPath).c_str());
+    g_sink = std::make_unique<sink::Async>(std::move(target));
+}
+#endif
+
+// Before OutInit (or after OutClose) output goes straight to stdout.
+void OutWrite(const char* data, size_t n) {
+    if (!n) return;
+    if (g_sink) g_sink->Write(data, n);
+    else fwrite(data, 1, n, stdout);
+}
+static void u8write(const std::string& u8) { OutWrite(u8.data(), u8.size()); }
+void OutFlush() {
+    if (g_sink) g_sink->Flush();
+    else fflush(stdout);
+}
+bool OutSync() {
+    return g_sink ? g_sink->Sync() : fflush(stdout) == 0;
 }
-void OutClose() {
-    if (g_out && g_out != stdout) { fclose(g_out); g_out = stdout; }
-    fflush(stdout);
+bool OutClose() {
+    if (!g_sink) { fflush(stdout); return true; }
+    const bool ok = g_sink->Close();
+    g_sink.reset();
+    if (!ok) fprintf(stderr, "Failed writing output\n");
+    return ok;
 }
 void OutPrintf(const wchar_t* fmt, ...) {
-    va_list ap; va_start(ap, fmt); u8vprint(g_out, fmt, ap); va_end(ap);
+    va_list ap; va_start(ap, fmt); u8vprint(fmt, ap); va_end(ap);
 }
@@ -1,11 +1,25 @@
 ﻿#pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
-// Inizializza output: "" => stdout, altrimenti file UTF-8 (wb). Setta console CP=UTF-8.
-void OutInit(const std::wstring& outPath);
+// Inizializza output: "" => stdout, altrimenti file UTF-8 (wb). Su Windows setta console CP=UTF-8.
+// La scrittura avviene su un thread dedicato (sink.h): un disco lento o una pipe bloccata
+// non fermano la scansione. rotateBytes > 0 o rotateRecords > 0: il file ruota tra una riga
+// e l'altra (path.1 .. path.rotateKeep), solo per output NDJSON.
+void OutInit(const std::wstring& outPath, uint64_t rotateBytes = 0, uint64_t rotateRecords = 0, unsigned rotateKeep = 5);
 
-// Flush/chiude file se necessario.
-void OutClose();
+// Flush senza chiudere (--watch: un evento per riga); non attende la scrittura.
+void OutFlush();
+
+// Punto di durabilità: attende che tutto sia scritto e sincronizzato su disco.
+bool OutSync();
+
+// Flush/chiude file se necessario; false se una scrittura è fallita.
+bool OutClose();
+
+// Scrive byte UTF-8 già codificati (serializer di print.cpp)
+void OutWrite(const char* data, size_t n);
 
 // printf wide → bytes UTF-8 (stdout/file)
 void OutPrintf(const wchar_t* fmt, ...);
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: MIT
+#include "peb_parse.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    //                                ptr  us  buf  peb  fixed  curDir image  cmd  title  desk  shell  rtd
+    const peb::Offsets kX64 = { 8, 16, 8, 0x20, 0xF0, 0x38, 0x60, 0x70, 0xB0, 0xC0, 0xD0, 0xE0 };
+    const peb::Offsets kX86 = { 4,  8, 4, 0x10, 0x90, 0x24, 0x38, 0x40, 0x70, 0x78, 0x80, 0x88 };
+
+    constexpr uint64_t kPage = 4096;
+
+    uint32_t le16(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8; }
+    uint32_t le32(const uint8_t* p) { return le16(p) | le16(p + 2) << 16; }
+    uint64_t le_ptr(const uint8_t* p, uint32_t size) {
+        return size == 8 ? (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32 : (uint64_t)le32(p);
+    }
+
+    // UTF-16LE bytes -> wide string, stopping at the first NUL code unit.
+    void assign_utf16(const uint8_t* p, size_t units, std::wstring& out) {
+        size_t n = 0;
+        while (n < units && le16(p + 2 * n)) ++n;
+        if constexpr (sizeof(wchar_t) == 2) {
+            out.resize(n);
+            if (n) memcpy(&out[0], p, n * 2);   // p may be unaligned
+        }
+        else {
+            out.resize(n);
+            size_t k = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t c = le16(p + 2 * i);
+                if (c >= 0xD800 && c < 0xDC00 && i + 1 < n) {
+                    const uint32_t lo = le16(p + 2 * i + 2);
+                    if (lo >= 0xDC00 && lo < 0xE000) { c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00); ++i; }
+                }
+                out[k++] = (wchar_t)c;
+            }
+            out.resize(k);
+        }
+    }
+
+    // Reused per thread: pool threads parse one process after another.
+    thread_local std::vector<uint8_t> t_block, t_field;
+
+    void read_string(peb::IRemoteMemory& mem, const peb::Offsets& o, const uint8_t* us,
+                     uint64_t base, size_t have, bool normalized, std::wstring& out) {
+        const size_t len = le16(us) & ~1u;   // bytes; odd lengths are not valid UTF-16
+        uint64_t buf = le_ptr(us + o.usBuffer, o.ptrSize);
+        out.clear();
+        if (!len || !buf) return;
+        if (!normalized) buf += base;    // not yet normalized: Buffer is an offset into the block
+        if (buf >= base && buf - base <= have && len <= have - (buf - base)) {
+            assign_utf16(t_block.data() + (buf - base), len / 2, out);
+            return;
+        }
+        t_field.resize(len);
+        if (mem.Read(buf, t_field.data(), len)) assign_utf16(t_field.data(), len / 2, out);
+    }
+} // anon
+
+namespace peb {
+
+    const Offsets& OffsetsOf(Layout l) { return l == Layout::X64 ? kX64 : kX86; }
+
+    bool ReadParams(IRemoteMemory& mem, uint64_t pebAddr, Layout layout, ProcParams& out) {
+        const Offsets& o = OffsetsOf(layout);
+        uint8_t ptr[8];
+        if (!pebAddr || !mem.Read(pebAddr + o.pebParams, ptr, o.ptrSize)) return false;
+        const uint64_t base = le_ptr(ptr, o.ptrSize);
+        if (!base) return false;
+
+        // First read: up to the end of the page, which is readable whenever the fixed part
+        // is and usually holds the whole block; the rest only if Length says there is more.
+        size_t have = (size_t)(kPage - base % kPage);
+        if (have < o.fixedSize) have = o.fixedSize;
+        t_block.resize(have);
+        if (!mem.Read(base, t_block.data(), have)) {
+            have = o.fixedSize;
+            if (!mem.Read(base, t_block.data(), have)) return false;
+        }
+        const uint32_t length = le32(t_block.data() + 4);
+        if (length > have && length <= kMaxBlock) {
+            t_block.resize(length);
+            if (mem.Read(base + have, t_block.data() + have, length - have)) have = length;
+        }
+        const bool normalized = (le32(t_block.data() + 8) & kParamsNormalized) != 0;
+
+        const uint8_t* p = t_block.data();
+        read_string(mem, o, p + o.imagePath, base, have, normalized, out.imagePath);
+        read_string(mem, o, p + o.commandLine, base, have, normalized, out.commandLine);
+        read_string(mem, o, p + o.curDir, base, have, normalized, out.currentDirectory);
+        read_string(mem, o, p + o.windowTitle, base, have, normalized, out.windowTitle);
+        read_string(mem, o, p + o.desktopInfo, base, have, normalized, out.desktopInfo);
+        read_string(mem, o, p + o.shellInfo, base, have, normalized, out.shellInfo);
+        read_string(mem, o, p + o.runtimeData, base, have, normalized, out.runtimeData);
+        return true;
+    }
+} // namespace peb
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "proc_peb.h"
+
+// PEB -> RTL_USER_PROCESS_PARAMETERS walking, independent of how the target's memory is
+// read: ReadProcessMemory in proc_peb.cpp, synthetic address-space images in the benches.
+// Everything read from the target is treated as untrusted (lengths, pointers, offsets).
+namespace peb {
+    class IRemoteMemory {
+    public:
+        virtual ~IRemoteMemory() = default;
+        // All-or-nothing: false unless all n bytes at addr were copied into buf.
+        virtual bool Read(uint64_t addr, void* buf, size_t n) = 0;
+    };
+
+    enum class Layout { X86, X64 };   // pointer size of the target's PEB (X86: WOW64 PEB)
+
+    // Structure offsets (winternl.h only declares part of these structures).
+    struct Offsets {
+        uint32_t ptrSize, usSize, usBuffer;   // UNICODE_STRING: size, offset of Buffer
+        uint32_t pebParams;                   // PEB.ProcessParameters
+        uint32_t fixedSize;                   // RTL_USER_PROCESS_PARAMETERS up to RuntimeData
+        uint32_t curDir, imagePath, commandLine, windowTitle, desktopInfo, shellInfo, runtimeData;
+    };
+    const Offsets& OffsetsOf(Layout l);
+
+    constexpr uint32_t kParamsNormalized = 0x1;       // RTL_USER_PROC_PARAMS_NORMALIZED
+    constexpr uint32_t kMaxBlock = 1u << 20;          // larger Length values are not trusted
+
+    // Reads PEB.ProcessParameters, then the parameters block (its Length field) in one call
+    // when possible, and slices the strings out of it; a string whose buffer lies outside
+    // the block is read on its own. Fills every ProcParams field except `name`. Strings
+    // stop at the first NUL. False if the PEB or the fixed part of the block is unreadable;
+    // an unreadable string is left empty.
+    bool ReadParams(IRemoteMemory& mem, uint64_t pebAddr, Layout layout, ProcParams& out);
+} // namespace peb
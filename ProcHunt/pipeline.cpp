@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: MIT
+#include "pipeline.h"
+#include "lineage.h"
+#include "stats.h"
+
+namespace {
+    // collect -> verify -> evaluate for one item.
+    void process(scan::ScanItem& it, scan::IProcessReader& reader, scan::ISignatureVerifier& verifier, const scan::Options& opt) {
+        stats::Laps lap;
+        it.ok = reader.Read(it.entry, it.pp);
+        lap.Lap(stats::S_READ);
+        if (!it.ok) { lap.Failed(stats::S_READ); return; }
+        const std::wstring_view parent = opt.lineage ? opt.lineage->ParentName(it.entry.pid) : std::wstring_view{};
+        const int minScore = opt.minScore;
+        if (minScore > 0) {
+            const int bound = heur::ScoreBound(it.pp.imagePath, it.pp.commandLine, it.pp.currentDirectory, it.pp.name, minScore, parent);
+            if (bound < minScore) {
+                it.pruned = true;
+                it.res.score = bound;
+                lap.Lap(stats::S_EVALUATE);
+                return;
+            }
+        }
+        if (!it.pp.imagePath.empty()) {
+            it.sig = verifier.Verify(it.pp.imagePath);
+            lap.Lap(stats::S_VERIFY);
+        }
+        it.res = heur::EvaluateProcess(it.pp.imagePath, it.pp.commandLine, it.pp.currentDirectory, it.pp.name, it.sig, parent);
+        lap.Lap(stats::S_EVALUATE);
+    }
+    void emit_timed(const scan::EmitFn& emit, scan::ScanItem& it) {
+        if (!it.ok) { emit(it); return; }
+        stats::Timer t(stats::S_OUTPUT);
+        emit(it);
+    }
+} // anon
+
+namespace scan {
+
+    WorkPool::WorkPool(unsigned threads) {
+        if (!threads) threads = 1;
+        for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+        for (unsigned i = 0; i < threads; ++i) threads_.emplace_back([this, i] { Worker(i); });
+    }
+
+    WorkPool::~WorkPool() {
+        { std::lock_guard<std::mutex> lk(idleM_); stop_ = true; }
+        idleCv_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    void WorkPool::Submit(std::function<void()> task) {
+        // pending_ is raised before the push so it never under-counts queued tasks.
+        pending_.fetch_add(1);
+        Queue& q = *queues_[next_.fetch_add(1) % queues_.size()];
+        { std::lock_guard<std::mutex> lk(q.m); q.q.push_back(std::move(task)); }
+        { std::lock_guard<std::mutex> lk(idleM_); }
+        idleCv_.notify_one();
+    }
+
+    bool WorkPool::TryPop(unsigned self, std::function<void()>& out) {
+        const size_t n = queues_.size();
+        for (size_t k = 0; k < n; ++k) {
+            Queue& q = *queues_[(self + k) % n];
+            std::lock_guard<std::mutex> lk(q.m);
+            if (q.q.empty()) continue;
+            if (k == 0) { out = std::move(q.q.front()); q.q.pop_front(); }   // own queue: FIFO
+            else { out = std::move(q.q.back()); q.q.pop_back(); }            // steal from the tail
+            pending_.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    void WorkPool::Worker(unsigned self) {
+        std::function<void()> task;
+        for (;;) {
+            if (TryPop(self, task)) { task(); task = nullptr; continue; }
+            std::unique_lock<std::mutex> lk(idleM_);
+            idleCv_.wait(lk, [&] { return stop_ || pending_.load() > 0; });
+            if (stop_ && pending_.load() == 0) return;
+        }
+    }
+
+    void Run(IProcessSource& src, IProcessReader& reader, ISignatureVerifier& verifier,
+        const Options& opt, const EmitFn& emit)
+    {
+        unsigned threads = opt.threads ? opt.threads : std::thread::hardware_concurrency();
+        if (threads <= 1) {
+            ScanItem it;
+            while (src.Next(it.entry)) {
+                process(it, reader, verifier, opt);
+                emit_timed(emit, it);
+                it = ScanItem{};
+            }
+            return;
+        }
+
+        // Reorder buffer: item `seq` completes into ring[seq % cap]; at most `cap` items
+        // are between Next() and emit, so ring slots never collide.
+        const size_t cap = opt.maxInFlight ? opt.maxInFlight : 1;
+        std::vector<std::unique_ptr<ScanItem>> ring(cap);
+        std::mutex m;
+        std::condition_variable done;
+        uint64_t submitted = 0, emitted = 0;
+        bool exhausted = false;
+
+        WorkPool pool(threads);
+        for (;;) {
+            while (!exhausted && submitted - emitted < cap) {
+                auto item = std::make_unique<ScanItem>();
+                if (!src.Next(item->entry)) { exhausted = true; break; }
+                const uint64_t seq = submitted++;
+                pool.Submit([&, seq, p = item.release()] {
+                    std::unique_ptr<ScanItem> owned(p);
+                    process(*owned, reader, verifier, opt);
+                    { std::lock_guard<std::mutex> lk(m); ring[seq % cap] = std::move(owned); }
+                    done.notify_one();
+                });
+            }
+            if (exhausted && emitted == submitted) break;
+
+            std::unique_ptr<ScanItem> next;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                done.wait(lk, [&] { return ring[emitted % cap] != nullptr; });
+                next = std::move(ring[emitted % cap]);
+            }
+            emit_timed(emit, *next);
+            ++emitted;
+        }
+    }
+} // namespace scan
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "codesign.h"
+#include "heuristics.h"
+#include "proc_peb.h"
+
+// Parallel scan pipeline: collect (read PEB) -> verify (signature) -> evaluate (heuristics)
+// run on a work-stealing pool, emit runs on the calling thread in enumeration order.
+// Process access sits behind interfaces so the pipeline builds and runs without Windows.
+namespace lin { class Graph; }
+
+namespace scan {
+    struct ProcEntry {
+        uint32_t pid = 0, ppid = 0;
+        std::wstring exeName;
+        uint64_t createTime = 0;   // FILETIME units, 0 = unknown
+    };
+
+    struct ScanItem {
+        ProcEntry entry;
+        bool ok = false;        // false: process could not be read (protected, exited, ...)
+        bool pruned = false;    // cannot reach Options::minScore: not verified, res.score is an upper bound
+        ProcParams pp;
+        SignInfo sig;
+        heur::Result res;
+    };
+
+    class IProcessSource {
+    public:
+        virtual ~IProcessSource() = default;
+        virtual bool Next(ProcEntry& out) = 0;
+    };
+    class IProcessReader {
+    public:
+        virtual ~IProcessReader() = default;
+        virtual bool Read(const ProcEntry& e, ProcParams& out) = 0;
+    };
+    class ISignatureVerifier {
+    public:
+        virtual ~ISignatureVerifier() = default;
+        virtual SignInfo Verify(const std::wstring& path) = 0;   // called concurrently
+    };
+
+    // Source over a pre-collected list (toolhelp snapshot, single PID, synthetic tables).
+    class ListSource : public IProcessSource {
+    public:
+        explicit ListSource(std::vector<ProcEntry> list) : list_(std::move(list)) {}
+        bool Next(ProcEntry& out) override {
+            if (pos_ >= list_.size()) return false;
+            out = std::move(list_[pos_++]);
+            return true;
+        }
+    private:
+        std::vector<ProcEntry> list_;
+        size_t pos_ = 0;
+    };
+
+    // Fixed-size pool; each worker owns a deque, idle workers steal from the others.
+    class WorkPool {
+    public:
+        explicit WorkPool(unsigned threads);
+        ~WorkPool();   // runs every queued task, then joins
+        void Submit(std::function<void()> task);
+        unsigned Size() const { return (unsigned)threads_.size(); }
+
+    private:
+        struct Queue { std::mutex m; std::deque<std::function<void()>> q; };
+        bool TryPop(unsigned self, std::function<void()>& out);
+        void Worker(unsigned self);
+
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> threads_;
+        std::mutex idleM_;
+        std::condition_variable idleCv_;
+        std::atomic<size_t> pending_{ 0 };
+        std::atomic<unsigned> next_{ 0 };
+        bool stop_ = false;
+    };
+
+    struct Options {
+        unsigned threads = 1;       // 1 = run inline on the calling thread, 0 = one per core
+        size_t maxInFlight = 256;   // items between collect and emit
+        int minScore = -1;          // > 0: skip verify + evaluate when heur::ScoreBound is below it
+        const lin::Graph* lineage = nullptr;   // parent names for the `parent` rule field
+    };
+
+    // Emit is called on the calling thread, once per item, in source order.
+    using EmitFn = std::function<void(ScanItem&)>;
+
+    void Run(IProcessSource& src, IProcessReader& reader, ISignatureVerifier& verifier,
+        const Options& opt, const EmitFn& emit);
+} // namespace scan
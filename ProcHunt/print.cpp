@@ -1,7 +1,10 @@
 // SPDX-License-Identifier: MIT
 #include <string>
 #include "print.h"
+#include "binfmt.h"
 #include "output.h"
+#include "serializer.h"
+#include "stats.h"
 #include "utils.h"
 
 void PrintUsage(const wchar_t* exe) {
@@ -13,63 +16,234 @@ void PrintUsage(const wchar_t* exe) {
     OutPrintf(L"  %s --pid <pid>\n", me);
     OutPrintf(L"Options:\n");
     OutPrintf(L"  --json                         Output JSON\n");
+    OutPrintf(L"  --ndjson                       Output one JSON object per line\n");
+    OutPrintf(L"  --format <text|json|ndjson|bin>  Output format; bin is the compact binary format for fleet collection\n");
+    OutPrintf(L"  --decode <file>                Print a --format bin file as JSON (or --ndjson / --format text) and exit\n");
     OutPrintf(L"  --whitelist-pub <file>         Whitelist publishers (one per line)\n");
     OutPrintf(L"  --whitelist-path <file>        Whitelist path prefixes (one per line)\n");
+    OutPrintf(L"  --protected-names <file>       More names for the lookalike check (one per line)\n");
     OutPrintf(L"  --min-score <0-100>            Show only items with score >= threshold\n");
     OutPrintf(L"  --threshold <0-100>            Alias of --min-score\n");
     OutPrintf(L"  -t <0-100>                     Alias of --min-score\n");
     OutPrintf(L"  -o, --output <file>            Write output to file (UTF-8)\n");
+    OutPrintf(L"  --rotate-size <MB>             With -o and --ndjson/--watch: start a new file past this size (file.1, ...)\n");
+    OutPrintf(L"  --rotate-records <n>           With -o and --ndjson/--watch: start a new file after n lines\n");
+    OutPrintf(L"  --rotate-keep <n>              Rotated files to keep (default 5)\n");
+    OutPrintf(L"  --threads <n>                  Scan with n worker threads (0 = one per core, default 1)\n");
+    OutPrintf(L"  --sig-cache <file>             Persist signature results between runs\n");
+    OutPrintf(L"  --record <file>                Also save the raw scan to a binary snapshot\n");
+    OutPrintf(L"  --replay <file>                Re-score a snapshot instead of scanning live\n");
+    OutPrintf(L"  --rules <file>                 Score with this rule file instead of the built-in rules\n");
+    OutPrintf(L"  --dump-rules                   Print the built-in rule file and exit\n");
+    OutPrintf(L"  --ioc-hashes <file>            Hash each image (SHA-256) and score those on this list (feed or compiled)\n");
+    OutPrintf(L"  --ioc-compile <file>           Write --ioc-hashes as a compiled list (loads by mapping) and exit\n");
+    OutPrintf(L"  --stats                        Print per-stage timings (read, verify, evaluate, output) at the end\n");
+    OutPrintf(L"  --ingest <file|dir>            Re-score JSON/NDJSON records from other hosts instead of scanning (repeatable)\n");
+    OutPrintf(L"  --serve <pipe>                 Stay resident and answer score/scan/record requests on a named pipe\n");
+    OutPrintf(L"  --watch <seconds>              Keep running; print NDJSON events for new/exited processes\n");
+    OutPrintf(L"  --cpu-budget <percent>         With --watch: also re-inspect every process over time, within this share of one core\n");
 }
 
-void PrintText(
-    unsigned long pid, const std::wstring& name,
-    const std::wstring& img, const std::wstring& cmd, const std::wstring& cwd,
-    const std::wstring& wtitle, const std::wstring& desk, const std::wstring& shell, const std::wstring& rtd,
-    const SignInfo& sig, const heur::Result& heur)
+namespace {
+    ser::Buffer g_buf;
+    OutputMode g_mode = OutputMode::Text;
+    bin::Writer g_bin(g_buf);
+    bool g_first = true;
+    const size_t kFlushAt = 60 * 1024;
+
+    void flush_if_full() {
+        if (g_buf.Size() >= kFlushAt) { OutWrite(g_buf.Data(), g_buf.Size()); g_buf.Clear(); }
+    }
+
+    void text_field(ser::Buffer& b, const char* label, std::wstring_view v) {
+        if (v.empty()) return;
+        b.Put(label); b.Text(v); b.Put('\n');
+    }
+
+    void json_field(ser::Buffer& b, const char* key, std::wstring_view v) {
+        b.Put(key); b.Quoted(v); b.Put(',');
+    }
+
+    void put_time(const char* key, uint64_t filetime) {
+        g_buf.Put(key); g_buf.Put('"'); g_buf.Text(util::filetime_iso8601(filetime)); g_buf.Put("\",");
+    }
+} // anon
+
+void WriteTextProcess(ser::Buffer& b,
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* anc)
+{
+    if (name.empty()) name = L"(unknown)";
+    b.Put("\nPID "); b.UintPadded(pid, 6); b.Put("  "); b.TextPadded(name, 30); b.Put('\n');
+    text_field(b, "  ImagePathName    : ", img);
+    text_field(b, "  CommandLine      : ", cmd);
+    text_field(b, "  CurrentDirectory : ", cwd);
+    text_field(b, "  WindowTitle      : ", wtitle);
+    text_field(b, "  DesktopInfo      : ", desk);
+    text_field(b, "  ShellInfo        : ", shell);
+    text_field(b, "  RuntimeData      : ", rtd);
+    if (anc && anc->n) {
+        b.Put("  Ancestry         : ");
+        for (size_t i = 0; i < anc->n; ++i) {
+            if (i) b.Put(" < ");
+            b.Text(anc->v[i].name.empty() ? std::wstring_view(L"(unknown)") : anc->v[i].name);
+            b.Put(" ("); b.Uint(anc->v[i].pid); b.Put(')');
+        }
+        b.Put('\n');
+    }
+    b.Put("  Signature        : "); b.Put(sig.trusted ? "VALID (" : "INVALID/UNSIGNED (");
+    b.Text(sig.trustStatus); b.Put(")\n");
+    text_field(b, "  Publisher        : ", sig.publisher);
+    text_field(b, "  Thumbprint       : ", sig.thumbprint);
+    text_field(b, "  SHA256           : ", sig.sha256);
+    if (heur.obf.length) {
+        b.Put("  Obfuscation      : base64Run="); b.Uint(heur.obf.longestBase64);
+        b.Put(" hexRun="); b.Uint(heur.obf.longestHex);
+        b.Put(" entropy="); b.Fixed(heur.obf.entropy, 2); b.Put('\n');
+    }
+    b.Put("  SuspicionScore   : "); b.Int(heur.score); b.Put('\n');
+    for (const auto& r : heur.reasons) { b.Put("    - "); b.Text(r); b.Put('\n'); }
+}
+
+void WriteJsonProcess(ser::Buffer& b,
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* anc)
 {
-    OutPrintf(L"\nPID %-6lu  %-30s\n", pid, name.empty() ? L"(unknown)" : name.c_str());
-    if (!img.empty())    OutPrintf(L"  ImagePathName    : %s\n", img.c_str());
-    if (!cmd.empty())    OutPrintf(L"  CommandLine      : %s\n", cmd.c_str());
-    if (!cwd.empty())    OutPrintf(L"  CurrentDirectory : %s\n", cwd.c_str());
-    if (!wtitle.empty()) OutPrintf(L"  WindowTitle      : %s\n", wtitle.c_str());
-    if (!desk.empty())   OutPrintf(L"  DesktopInfo      : %s\n", desk.c_str());
-    if (!shell.empty())  OutPrintf(L"  ShellInfo        : %s\n", shell.c_str());
-    if (!rtd.empty())    OutPrintf(L"  RuntimeData      : %s\n", rtd.c_str());
-    OutPrintf(L"  Signature        : %s (%s)\n", sig.trusted ? L"VALID" : L"INVALID/UNSIGNED", sig.trustStatus.c_str());
-    if (!sig.publisher.empty())  OutPrintf(L"  Publisher        : %s\n", sig.publisher.c_str());
-    if (!sig.thumbprint.empty()) OutPrintf(L"  Thumbprint       : %s\n", sig.thumbprint.c_str());
-    OutPrintf(L"  SuspicionScore   : %d\n", heur.score);
-    for (const auto& r : heur.reasons) OutPrintf(L"    - %s\n", r.c_str());
+    b.Put("{\"pid\":"); b.Uint(pid); b.Put(',');
+    json_field(b, "\"name\":", name);
+    b.Put("\"ancestry\":[");
+    for (size_t i = 0; anc && i < anc->n; ++i) {
+        b.Put(i ? ",{\"pid\":" : "{\"pid\":"); b.Uint(anc->v[i].pid);
+        b.Put(",\"name\":"); b.Quoted(anc->v[i].name); b.Put('}');
+    }
+    b.Put("],");
+    json_field(b, "\"imagePath\":", img);
+    json_field(b, "\"commandLine\":", cmd);
+    json_field(b, "\"currentDirectory\":", cwd);
+    json_field(b, "\"windowTitle\":", wtitle);
+    json_field(b, "\"desktopInfo\":", desk);
+    json_field(b, "\"shellInfo\":", shell);
+    json_field(b, "\"runtimeData\":", rtd);
+    b.Put("\"signature\":{\"trusted\":"); b.Put(sig.trusted ? "true," : "false,");
+    json_field(b, "\"status\":", sig.trustStatus);
+    json_field(b, "\"publisher\":", sig.publisher);
+    b.Put("\"thumbprint\":"); b.Quoted(sig.thumbprint);
+    if (!sig.sha256.empty()) { b.Put(",\"sha256\":"); b.Quoted(sig.sha256); }
+    b.Put("},");
+    b.Put("\"heuristics\":{\"score\":"); b.Int(heur.score);
+    const heur::ObfStats& o = heur.obf;
+    b.Put(",\"obfuscation\":{\"length\":"); b.Uint(o.length);
+    b.Put(",\"longestBase64\":"); b.Uint(o.longestBase64);
+    b.Put(",\"longestHex\":"); b.Uint(o.longestHex);
+    b.Put(",\"entropy\":"); b.Fixed(o.entropy, 3);
+    b.Put(",\"upperRatio\":"); b.Fixed(o.upperRatio, 3);
+    b.Put(",\"lowerRatio\":"); b.Fixed(o.lowerRatio, 3);
+    b.Put(",\"digitRatio\":"); b.Fixed(o.digitRatio, 3);
+    b.Put(",\"symbolRatio\":"); b.Fixed(o.symbolRatio, 3);
+    b.Put(",\"nonAsciiRatio\":"); b.Fixed(o.nonAsciiRatio, 3);
+    b.Put("},\"reasons\":[");
+    for (size_t i = 0; i < heur.reasons.size(); ++i) {
+        if (i) b.Put(',');
+        b.Quoted(heur.reasons[i]);
+    }
+    b.Put("]}}");
+}
+
+void PrintBegin(OutputMode mode) {
+    g_mode = mode;
+    g_first = true;
+    if (mode == OutputMode::JsonArray) g_buf.Put('[');
+    else if (mode == OutputMode::Binary) g_bin.Begin();
 }
 
-void PrintJsonObject(
-    bool& first,
-    unsigned long pid, const std::wstring& name,
-    const std::wstring& img, const std::wstring& cmd, const std::wstring& cwd,
-    const std::wstring& wtitle, const std::wstring& desk, const std::wstring& shell, const std::wstring& rtd,
-    const SignInfo& sig, const heur::Result& heur)
+void PrintProcess(
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* ancestry)
 {
-    if (!first) OutPrintf(L",");
-    first = false;
-    OutPrintf(L"\n  {");
-    OutPrintf(L"\"pid\":%lu,", pid);
-    OutPrintf(L"\"name\":\"%s\",", util::json_escape(name).c_str());
-    OutPrintf(L"\"imagePath\":\"%s\",", util::json_escape(img).c_str());
-    OutPrintf(L"\"commandLine\":\"%s\",", util::json_escape(cmd).c_str());
-    OutPrintf(L"\"currentDirectory\":\"%s\",", util::json_escape(cwd).c_str());
-    OutPrintf(L"\"windowTitle\":\"%s\",", util::json_escape(wtitle).c_str());
-    OutPrintf(L"\"desktopInfo\":\"%s\",", util::json_escape(desk).c_str());
-    OutPrintf(L"\"shellInfo\":\"%s\",", util::json_escape(shell).c_str());
-    OutPrintf(L"\"runtimeData\":\"%s\",", util::json_escape(rtd).c_str());
-    OutPrintf(L"\"signature\":{");
-    OutPrintf(L"\"trusted\":%s,", sig.trusted ? L"true" : L"false");
-    OutPrintf(L"\"status\":\"%s\",", util::json_escape(sig.trustStatus).c_str());
-    OutPrintf(L"\"publisher\":\"%s\",", util::json_escape(sig.publisher).c_str());
-    OutPrintf(L"\"thumbprint\":\"%s\"},", util::json_escape(sig.thumbprint).c_str());
-    OutPrintf(L"\"heuristics\":{");
-    OutPrintf(L"\"score\":%d,", heur.score);
-    OutPrintf(L"\"reasons\":[");
-    for (size_t i = 0; i < heur.reasons.size(); ++i)
-        OutPrintf(L"\"%s\"%s", util::json_escape(heur.reasons[i]).c_str(), (i + 1 < heur.reasons.size()) ? L"," : L"");
-    OutPrintf(L"]}}");
+    switch (g_mode) {
+    case OutputMode::Text:
+        WriteTextProcess(g_buf, pid, name, img, cmd, cwd, wtitle, desk, shell, rtd, sig, heur, ancestry);
+        break;
+    case OutputMode::JsonArray:
+        g_buf.Put(g_first ? "\n  " : ",\n  ");
+        WriteJsonProcess(g_buf, pid, name, img, cmd, cwd, wtitle, desk, shell, rtd, sig, heur, ancestry);
+        break;
+    case OutputMode::Ndjson:
+        WriteJsonProcess(g_buf, pid, name, img, cmd, cwd, wtitle, desk, shell, rtd, sig, heur, ancestry);
+        g_buf.Put('\n');
+        break;
+    case OutputMode::Binary:
+        g_bin.Add(pid, name, img, cmd, cwd, wtitle, desk, shell, rtd, sig, heur, ancestry);
+        break;
+    }
+    g_first = false;
+    flush_if_full();
+}
+
+void PrintEnd() {
+    if (g_mode == OutputMode::JsonArray) g_buf.Put("\n]\n");
+    else if (g_mode == OutputMode::Binary) g_bin.End();
+    PrintFlush();
+}
+
+void PrintFlush() {
+    if (g_buf.Size()) { OutWrite(g_buf.Data(), g_buf.Size()); g_buf.Clear(); }
+    OutFlush();
+}
+
+void PrintJsonEvent(
+    const wchar_t* event, uint64_t eventTime, uint64_t createTime, int previousScore,
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* ancestry)
+{
+    g_buf.Put("{\"event\":"); g_buf.Quoted(event); g_buf.Put(',');
+    put_time("\"time\":", eventTime);
+    g_buf.Put("\"pid\":"); g_buf.Uint(pid); g_buf.Put(',');
+    put_time("\"createTime\":", createTime);
+    if (previousScore >= 0) { g_buf.Put("\"previousScore\":"); g_buf.Int(previousScore); g_buf.Put(','); }
+    g_buf.Put("\"process\":");
+    WriteJsonProcess(g_buf, pid, name, img, cmd, cwd, wtitle, desk, shell, rtd, sig, heur, ancestry);
+    g_buf.Put("}\n");
+    flush_if_full();
+}
+
+void PrintJsonExitEvent(uint64_t eventTime, uint64_t createTime, unsigned long pid, std::wstring_view name, int lastScore) {
+    g_buf.Put("{\"event\":\"exited\",");
+    put_time("\"time\":", eventTime);
+    g_buf.Put("\"pid\":"); g_buf.Uint(pid); g_buf.Put(',');
+    put_time("\"createTime\":", createTime);
+    json_field(g_buf, "\"name\":", name);
+    g_buf.Put("\"score\":"); g_buf.Int(lastScore); g_buf.Put("}\n");
+    flush_if_full();
+}
+
+void PrintJsonCoverageEvent(uint64_t eventTime, const sched::Stats& s) {
+    g_buf.Put("{\"event\":\"coverage\",");
+    put_time("\"time\":", eventTime);
+    g_buf.Put("\"live\":"); g_buf.Uint(s.live);
+    g_buf.Put(",\"overdue\":"); g_buf.Uint(s.overdue);
+    g_buf.Put(",\"inspections\":"); g_buf.Uint(s.inspections);
+    g_buf.Put(",\"quanta\":"); g_buf.Uint(s.quanta);
+    g_buf.Put(",\"cpuPercent\":"); g_buf.Fixed(s.wallUs ? 100.0 * (double)s.cpuUs / (double)s.wallUs : 0, 2);
+    g_buf.Put(",\"backoff\":"); g_buf.Fixed(s.backoff, 2);
+    g_buf.Put(",\"maxLatencyMs\":"); g_buf.Uint(s.maxLatencyUs / 1000);
+    g_buf.Put(",\"p50LatencyMs\":"); g_buf.Uint(s.latencyUs.Percentile(50) / 1000);
+    g_buf.Put(",\"p99LatencyMs\":"); g_buf.Uint(s.latencyUs.Percentile(99) / 1000);
+    g_buf.Put("}\n");
+    flush_if_full();
+}
+
+void PrintStats(const stats::Snapshot& s) {
+    g_buf.Put("{\"stats\":");
+    stats::WriteJson(g_buf, s);
+    g_buf.Put("}\n");
+    PrintFlush();
 }
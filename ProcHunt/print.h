@@ -1,19 +1,55 @@
 #pragma once
-#include <string>
+#include <cstdint>
+#include <string_view>
 #include "codesign.h"
 #include "heuristics.h"
+#include "lineage.h"
+#include "scheduler.h"
+#include "stats.h"
+
+namespace ser { class Buffer; }
 
 void PrintUsage(const wchar_t* exe);
 
-void PrintText(
-    unsigned long pid, const std::wstring& name,
-    const std::wstring& img, const std::wstring& cmd, const std::wstring& cwd,
-    const std::wstring& wtitle, const std::wstring& desk, const std::wstring& shell, const std::wstring& rtd,
-    const SignInfo& sig, const heur::Result& heur);
-
-void PrintJsonObject(
-    bool& first,
-    unsigned long pid, const std::wstring& name,
-    const std::wstring& img, const std::wstring& cmd, const std::wstring& cwd,
-    const std::wstring& wtitle, const std::wstring& desk, const std::wstring& shell, const std::wstring& rtd,
-    const SignInfo& sig, const heur::Result& heur);
+// Records are serialized into one reusable UTF-8 buffer and written in large chunks.
+// Binary is the dictionary-encoded columnar format of binfmt.h (--format bin).
+enum class OutputMode { Text, JsonArray, Ndjson, Binary };
+
+void PrintBegin(OutputMode mode);   // JsonArray: opens the array; Binary: writes the header
+// ancestry: parent first; JSON always has the "ancestry" array (empty when unknown).
+void PrintProcess(
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* ancestry = nullptr);
+void PrintEnd();     // closes the array (Binary: last batch + end block), then PrintFlush()
+void PrintFlush();   // hands buffered records to the output and flushes it
+
+// One record into a caller-owned buffer, same bytes as PrintProcess (--ingest formats on
+// worker threads). The JSON form has no framing: no separator, no trailing newline.
+void WriteTextProcess(ser::Buffer& b,
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* ancestry = nullptr);
+void WriteJsonProcess(ser::Buffer& b,
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* ancestry = nullptr);
+
+// --watch: one NDJSON line per event ("started", "score_changed"). Times are FILETIME;
+// previousScore < 0 is omitted. The process object matches --json.
+void PrintJsonEvent(
+    const wchar_t* event, uint64_t eventTime, uint64_t createTime, int previousScore,
+    unsigned long pid, std::wstring_view name,
+    std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+    std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+    const SignView& sig, const heur::Result& heur, const lin::Chain* ancestry = nullptr);
+
+void PrintJsonExitEvent(uint64_t eventTime, uint64_t createTime, unsigned long pid, std::wstring_view name, int lastScore);
+// --cpu-budget: {"event":"coverage",...} with the scheduler's counters since it started.
+void PrintJsonCoverageEvent(uint64_t eventTime, const sched::Stats& s);
+
+// --stats trailer: one {"stats":{...}} line (NDJSON output), flushed.
+void PrintStats(const stats::Snapshot& s);
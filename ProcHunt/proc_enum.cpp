@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: MIT
+#include <windows.h>
+#include <winternl.h>
+#include <vector>
+#include "proc_enum.h"
+
+#pragma comment(lib, "ntdll.lib")
+
+#ifndef STATUS_INFO_LENGTH_MISMATCH
+#define STATUS_INFO_LENGTH_MISMATCH ((NTSTATUS)0xC0000004L)
+#endif
+
+// Leading part of SYSTEM_PROCESS_INFORMATION (winternl.h hides CreateTime and the parent PID).
+typedef struct _MY_SYSTEM_PROCESS_INFORMATION {
+    ULONG NextEntryOffset;
+    ULONG NumberOfThreads;
+    LARGE_INTEGER WorkingSetPrivateSize;
+    ULONG HardFaultCount;
+    ULONG NumberOfThreadsHighWatermark;
+    ULONGLONG CycleTime;
+    LARGE_INTEGER CreateTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER KernelTime;
+    UNICODE_STRING ImageName;
+    LONG BasePriority;
+    HANDLE UniqueProcessId;
+    HANDLE InheritedFromUniqueProcessId;
+} MY_SYSTEM_PROCESS_INFORMATION;
+
+bool EnumProcesses(std::vector<scan::ProcEntry>& out) {
+    static std::vector<BYTE> buf(512 * 1024);
+    out.clear();
+
+    NTSTATUS st;
+    for (int tries = 0; tries < 8; ++tries) {
+        ULONG need = 0;
+        st = NtQuerySystemInformation(SystemProcessInformation, buf.data(), (ULONG)buf.size(), &need);
+        if (st != STATUS_INFO_LENGTH_MISMATCH) break;
+        buf.resize((need > buf.size() ? need : buf.size()) + 64 * 1024);   // processes may appear meanwhile
+    }
+    if (st < 0) return false;
+
+    const BYTE* p = buf.data();
+    for (;;) {
+        auto spi = (const MY_SYSTEM_PROCESS_INFORMATION*)p;
+        scan::ProcEntry e;
+        e.pid = (uint32_t)(ULONG_PTR)spi->UniqueProcessId;
+        e.ppid = (uint32_t)(ULONG_PTR)spi->InheritedFromUniqueProcessId;
+        e.createTime = (uint64_t)spi->CreateTime.QuadPart;
+        if (spi->ImageName.Buffer && spi->ImageName.Length)
+            e.exeName.assign(spi->ImageName.Buffer, spi->ImageName.Length / sizeof(wchar_t));
+        else if (e.pid == 0)
+            e.exeName = L"[System Process]";
+        out.push_back(std::move(e));
+        if (!spi->NextEntryOffset) break;
+        p += spi->NextEntryOffset;
+    }
+    return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <vector>
+#include "pipeline.h"
+
+// Enumerates running processes (PID, PPID, image name, creation time) with a single
+// NtQuerySystemInformation(SystemProcessInformation) call. The query buffer is kept
+// between calls, so periodic enumeration does not reallocate in steady state; callers on
+// several threads must serialize their calls.
+bool EnumProcesses(std::vector<scan::ProcEntry>& out);
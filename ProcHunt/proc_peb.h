@@ -1,5 +1,4 @@
 ﻿#pragma once
-#include <windows.h>
 #include <string>
 
 struct ProcParams {
@@ -14,4 +13,4 @@ struct ProcParams {
 };
 
 // Legge PEB → RTL_USER_PROCESS_PARAMETERS e risolve `name`.
-bool ReadProcParams(DWORD pid, const wchar_t* exeNameHint, ProcParams& out);
+bool ReadProcParams(unsigned long pid, const wchar_t* exeNameHint, ProcParams& out);
@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: MIT
+#include "rules.h"
+#include <algorithm>
+#include <mutex>
+#include "utils.h"
+
+namespace {
+    const wchar_t kDefaultRules[] =
+#include "default_rules.inc"
+        ;
+
+    const wchar_t* kFieldNames[heur::F_COUNT] = { L"image", L"cwd", L"cmd", L"name", L"publisher", L"parent", L"payload" };
+    const wchar_t* kTestNames[heur::T_COUNT] = { L"obfuscated", L"name_mismatch", L"cwd_outside_image_dir",
+                                                 L"signed", L"publisher_whitelisted", L"path_whitelisted",
+                                                 L"name_lookalike", L"ioc_hash" };
+
+    enum MatchKind { M_NONE, M_CONTAINS, M_PREFIX, M_EQUALS, M_PRESENT };
+
+    std::wstring_view trim(std::wstring_view s) {
+        while (!s.empty() && (s.front() == L' ' || s.front() == L'\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == L' ' || s.back() == L'\t' || s.back() == L'\r')) s.remove_suffix(1);
+        return s;
+    }
+    std::wstring_view unquote(std::wstring_view s) {
+        if (s.size() >= 2 && s.front() == L'"' && s.back() == L'"') return s.substr(1, s.size() - 2);
+        return s;
+    }
+
+    bool starts_with(std::wstring_view hay, std::wstring_view needle) {
+        return hay.size() >= needle.size() && hay.compare(0, needle.size(), needle) == 0;
+    }
+
+    // One [rule] section while parsing.
+    struct Pending {
+        std::wstring name;
+        size_t line = 0;
+        int field = -1;
+        MatchKind match = M_NONE;
+        int test = -1;
+        std::vector<std::wstring> needles;
+        std::vector<std::pair<std::wstring, size_t>> require, any, unless;   // name, line
+        int weight = 0;
+        std::wstring reason;
+    };
+
+    std::mutex g_rules_m;
+    std::shared_ptr<const heur::RuleSet> g_rules;
+    std::vector<std::shared_ptr<const heur::RuleSet>> g_retired;
+    const heur::RuleSet* g_active = nullptr;
+} // anon
+
+namespace heur {
+
+    const wchar_t* DefaultRulesText() { return kDefaultRules; }
+
+    void RuleSet::Clear() {
+        for (auto& fp : fields_) fp = FieldProgram{};
+        for (auto& r : fieldRules_) r = 0;
+        for (auto& r : testRules_) r = 0;
+        always_ = 0;
+        usedTests_ = usedFields_ = 0;
+        rules_.clear(); names_.clear(); reasons_.clear();
+    }
+
+    bool RuleSet::Compile(std::wstring_view text, std::wstring* err) {
+        Clear();
+        std::vector<Pending> pend;
+        size_t lineNo = 0;
+        auto fail = [&](size_t line, const std::wstring& why) {
+            if (err) *err = L"line " + std::to_wstring(line) + L": " + why;
+            Clear();
+            return false;
+        };
+        auto split_names = [](std::wstring_view v, size_t line, std::vector<std::pair<std::wstring, size_t>>& out) {
+            while (!v.empty()) {
+                size_t c = v.find(L',');
+                std::wstring_view n = trim(v.substr(0, c));
+                if (!n.empty()) out.emplace_back(std::wstring(n), line);
+                if (c == std::wstring_view::npos) break;
+                v.remove_prefix(c + 1);
+            }
+        };
+
+        // Parse
+        while (!text.empty()) {
+            size_t nl = text.find(L'\n');
+            std::wstring_view line = trim(text.substr(0, nl));
+            text.remove_prefix(nl == std::wstring_view::npos ? text.size() : nl + 1);
+            ++lineNo;
+            if (lineNo == 1 && !line.empty() && line.front() == 0xFEFF) line.remove_prefix(1);
+            if (line.empty() || line.front() == L'#' || line.front() == L';') continue;
+
+            if (line.front() == L'[') {
+                if (line.back() != L']' || line.substr(1, 5) != L"rule ")
+                    return fail(lineNo, L"expected [rule <name>]");
+                std::wstring_view name = trim(line.substr(6, line.size() - 7));
+                if (name.empty()) return fail(lineNo, L"rule without a name");
+                for (auto& p : pend) if (p.name == name) return fail(lineNo, L"duplicate rule '" + std::wstring(name) + L"'");
+                Pending p;
+                p.name = name; p.line = lineNo;
+                pend.push_back(std::move(p));
+                continue;
+            }
+            size_t eq = line.find(L'=');
+            if (eq == std::wstring_view::npos) return fail(lineNo, L"expected key = value");
+            if (pend.empty()) return fail(lineNo, L"key outside of a [rule] section");
+            Pending& p = pend.back();
+            const std::wstring key = util::lcase(trim(line.substr(0, eq)));
+            const std::wstring_view val = unquote(trim(line.substr(eq + 1)));
+
+            if (key == L"field") {
+                p.field = -1;
+                for (int f = 0; f < F_COUNT; ++f) if (util::iequals(val, kFieldNames[f])) p.field = f;
+                if (p.field < 0) return fail(lineNo, L"unknown field '" + std::wstring(val) + L"'");
+            }
+            else if (key == L"match") {
+                if (util::iequals(val, L"contains")) p.match = M_CONTAINS;
+                else if (util::iequals(val, L"prefix")) p.match = M_PREFIX;
+                else if (util::iequals(val, L"equals")) p.match = M_EQUALS;
+                else if (util::iequals(val, L"present")) p.match = M_PRESENT;
+                else return fail(lineNo, L"unknown match '" + std::wstring(val) + L"'");
+            }
+            else if (key == L"needle") {
+                if (val.empty()) return fail(lineNo, L"empty needle");
+                p.needles.push_back(util::lcase(val));
+            }
+            else if (key == L"test") {
+                p.test = -1;
+                for (int t = 0; t < (int)T_COUNT; ++t) if (util::iequals(val, kTestNames[t])) p.test = t;
+                if (p.test < 0) return fail(lineNo, L"unknown test '" + std::wstring(val) + L"'");
+            }
+            else if (key == L"require") split_names(val, lineNo, p.require);
+            else if (key == L"any") split_names(val, lineNo, p.any);
+            else if (key == L"unless") split_names(val, lineNo, p.unless);
+            else if (key == L"weight") {
+                const std::wstring v(val);
+                wchar_t* end = nullptr;
+                long w = wcstol(v.c_str(), &end, 10);
+                if (v.empty() || *end || w < -1000 || w > 1000) return fail(lineNo, L"weight must be an integer in -1000..1000");
+                p.weight = (int)w;
+            }
+            else if (key == L"reason") p.reason = val;
+            else return fail(lineNo, L"unknown key '" + key + L"'");
+        }
+
+        // Compile
+        if (pend.size() > kMaxRules) return fail(pend[kMaxRules].line, L"too many rules (max 64)");
+        for (size_t i = 0; i < pend.size(); ++i) {
+            const Pending& p = pend[i];
+            const uint64_t bit = 1ull << i;
+            if (p.field >= 0 && p.test >= 0) return fail(p.line, L"rule '" + p.name + L"' has both field and test");
+            if (p.field >= 0 && p.match == M_NONE) return fail(p.line, L"rule '" + p.name + L"' has a field but no match");
+            if (p.field < 0 && (p.match != M_NONE || !p.needles.empty())) return fail(p.line, L"rule '" + p.name + L"' has no field");
+            if (p.field >= 0 && (p.match == M_PRESENT) != p.needles.empty()) {
+                return fail(p.line, p.match == M_PRESENT ? L"rule '" + p.name + L"': match = present takes no needles"
+                                                         : L"rule '" + p.name + L"' has no needles");
+            }
+
+            Rule r;
+            auto resolve = [&](const std::vector<std::pair<std::wstring, size_t>>& refs, uint64_t& mask, size_t& badLine) {
+                for (auto& ref : refs) {
+                    size_t k = 0;
+                    while (k < i && names_[k] != ref.first) ++k;
+                    if (k == i) { badLine = ref.second; return ref.first; }
+                    mask |= 1ull << k;
+                }
+                return std::wstring();
+            };
+            size_t badLine = 0;
+            std::wstring bad;
+            names_.push_back(p.name);
+            if (!(bad = resolve(p.require, r.require, badLine)).empty() || !(bad = resolve(p.any, r.any, badLine)).empty()
+                || !(bad = resolve(p.unless, r.unless, badLine)).empty())
+                return fail(badLine, L"unknown rule '" + bad + L"' (rules can only refer to earlier rules)");
+            r.weight = p.weight;
+            r.test = p.test;
+            rules_.push_back(r);
+            reasons_.push_back(p.reason);
+
+            if (p.test >= 0) { testRules_[p.test] |= bit; usedTests_ |= 1u << p.test; continue; }
+            if (p.field < 0) { always_ |= bit; continue; }
+            FieldProgram& fp = fields_[p.field];
+            fp.used = true;
+            usedFields_ |= 1u << p.field;
+            fieldRules_[p.field] |= bit;
+            switch (p.match) {
+            case M_CONTAINS:
+                // Single characters: one find_first_of instead of a matcher pass.
+                if (std::all_of(p.needles.begin(), p.needles.end(), [](const std::wstring& n) { return n.size() == 1; })) {
+                    std::wstring set;
+                    for (auto& n : p.needles) set += n;
+                    fp.charsets.push_back({ set, bit });
+                    break;
+                }
+                if (fp.slots == 32) return fail(p.line, L"too many contains rules on field " + std::wstring(kFieldNames[p.field]) + L" (max 32)");
+                for (auto& n : p.needles) fp.contains.Add(n, 1u << fp.slots);
+                fp.slotRule[fp.slots++] = bit;
+                break;
+            case M_PREFIX: for (auto& n : p.needles) fp.prefixes.push_back({ n, bit }); break;
+            case M_EQUALS: for (auto& n : p.needles) fp.equals.push_back({ n, bit }); break;
+            case M_PRESENT: fp.present |= bit; break;
+            default: break;
+            }
+        }
+        for (auto& fp : fields_) if (!fp.contains.Empty()) fp.contains.Build();
+        // reasons_ no longer grows: the pointers stay valid.
+        for (size_t i = 0; i < rules_.size(); ++i) if (!reasons_[i].empty()) rules_[i].reason = reasons_[i].c_str();
+        return true;
+    }
+
+    uint64_t RuleSet::MatchField(Field f, std::wstring_view v) const {
+        const FieldProgram& fp = fields_[f];
+        if (!fp.used || v.empty()) return 0;   // nothing matches an empty field
+        uint64_t match = fp.present;
+        if (fp.slots) {
+            uint32_t tags = fp.contains.Scan(v);
+            for (unsigned s = 0; tags; ++s, tags >>= 1) if (tags & 1) match |= fp.slotRule[s];
+        }
+        for (auto& l : fp.prefixes) if (starts_with(v, l.text)) match |= l.rule;
+        for (auto& l : fp.equals) if (v == l.text) match |= l.rule;
+        for (auto& l : fp.charsets) if (v.find_first_of(l.text) != std::wstring_view::npos) match |= l.rule;
+        return match;
+    }
+
+    uint64_t RuleSet::MatchTests(uint32_t tests) const {
+        uint64_t match = 0;
+        for (unsigned t = 0; tests; ++t, tests >>= 1) if (tests & 1) match |= testRules_[t];
+        return match;
+    }
+
+    uint64_t RuleSet::Match(const RuleInput& in, uint32_t fieldMask, uint32_t testMask) const {
+        uint64_t match = always_;
+        for (int f = 0; f < F_COUNT; ++f) if (fieldMask & (1u << f)) match |= MatchField((Field)f, in.fields[f]);
+        return match | MatchTests(in.tests & testMask);
+    }
+
+    uint64_t RuleSet::Hold(uint64_t match, int& score) const {
+        // Rules in file order; require/any/unless only see earlier rules.
+        uint64_t held = 0;
+        for (size_t i = 0; i < rules_.size(); ++i) {
+            const uint64_t bit = 1ull << i;
+            const Rule& ru = rules_[i];
+            if (!(match & bit) || (held & ru.require) != ru.require
+                || (ru.any && !(held & ru.any)) || (held & ru.unless)) continue;
+            held |= bit;
+            score += ru.weight;
+        }
+        return held;
+    }
+
+    void RuleSet::Reasons(uint64_t held, const wchar_t* const detail[T_COUNT], ReasonList& out) const {
+        for (size_t i = 0; held; ++i, held >>= 1) {
+            if (!(held & 1)) continue;
+            const Rule& ru = rules_[i];
+            const wchar_t* why = ru.reason ? ru.reason : ru.test >= 0 ? detail[ru.test] : nullptr;
+            if (why) out.push_back(why);
+        }
+        if (out.empty()) out.push_back(L"No obvious indicators");
+    }
+
+    void RuleSet::Run(const RuleInput& in, Result& r) const {
+        int score = r.score;
+        const uint64_t held = Hold(Match(in, ~0u, ~0u), score);
+        r.score = score < 0 ? 0 : (score > 100 ? 100 : score);
+        Reasons(held, in.detail, r.reasons);
+    }
+
+    int RuleSet::Bound(uint64_t known, uint32_t unknownFields, uint32_t unknownTests) const {
+        uint64_t maybe = known;
+        for (int f = 0; f < F_COUNT; ++f) if (unknownFields & (1u << f)) maybe |= fieldRules_[f];
+        for (unsigned t = 0; t < T_COUNT; ++t) if (unknownTests & (1u << t)) maybe |= testRules_[t];
+
+        // The rules that will hold lie between `must` (hold whatever the unknowns are) and
+        // `may` (hold for some value of them): positive weights count when a rule may hold,
+        // negative ones only when it must.
+        uint64_t may = 0, must = 0;
+        int score = 0;
+        for (size_t i = 0; i < rules_.size(); ++i) {
+            const uint64_t bit = 1ull << i;
+            const Rule& ru = rules_[i];
+            if ((maybe & bit) && (may & ru.require) == ru.require && (!ru.any || (may & ru.any)) && !(must & ru.unless)) {
+                may |= bit;
+                if (ru.weight > 0) score += ru.weight;
+            }
+            if ((known & bit) && (must & ru.require) == ru.require && (!ru.any || (must & ru.any)) && !(may & ru.unless)) {
+                must |= bit;
+                if (ru.weight < 0) score += ru.weight;
+            }
+        }
+        return score < 0 ? 0 : (score > 100 ? 100 : score);
+    }
+
+    const RuleSet& ActiveRules() {
+        static const bool init = [] {
+            auto rs = std::make_shared<RuleSet>();
+            rs->Compile(kDefaultRules);
+            std::lock_guard<std::mutex> lk(g_rules_m);
+            if (!g_active) { g_rules = rs; g_active = rs.get(); }
+            return true;
+        }();
+        (void)init;
+        return *g_active;
+    }
+
+    void SetRules(std::shared_ptr<const RuleSet> rules) {
+        ActiveRules();
+        std::lock_guard<std::mutex> lk(g_rules_m);
+        g_retired.push_back(std::move(g_rules));
+        g_rules = std::move(rules);
+        g_active = g_rules.get();
+    }
+
+    void ReleaseRetiredRules() {
+        std::lock_guard<std::mutex> lk(g_rules_m);
+        g_retired.clear();
+    }
+
+    bool LoadRulesFile(const std::wstring& path, std::wstring* err) {
+        std::wstring text;
+        if (!util::read_text_file(path, text)) { if (err) *err = L"cannot read " + path; return false; }
+        auto rs = std::make_shared<RuleSet>();
+        if (!rs->Compile(text, err)) return false;
+        SetRules(std::move(rs));
+        return true;
+    }
+} // namespace heur
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "heuristics.h"
+#include "matcher.h"
+
+// Data-driven scoring (--rules <file>). A rule file is compiled into a flat program:
+// the needles of every rule on a field share one matcher pass, each rule becomes a
+// few bitmask tests over the rules that already held, and the score is the clamped
+// sum of the weights of the rules that hold. See default_rules.inc for the syntax.
+namespace heur {
+    enum Field : uint8_t { F_IMAGE, F_CWD, F_CMD, F_NAME, F_PUBLISHER, F_PARENT, F_PAYLOAD, F_COUNT };
+
+    enum Test : uint32_t {
+        T_OBFUSCATED             = 1u << 0,
+        T_NAME_MISMATCH          = 1u << 1,
+        T_CWD_OUTSIDE_IMAGE_DIR  = 1u << 2,
+        T_SIGNED                 = 1u << 3,
+        T_PUBLISHER_WHITELISTED  = 1u << 4,
+        T_PATH_WHITELISTED       = 1u << 5,
+        T_NAME_LOOKALIKE         = 1u << 6,
+        T_IOC_HASH               = 1u << 7,
+        T_COUNT                  = 8
+    };
+
+    constexpr int TestIndex(uint32_t t) { return t > 1 ? 1 + TestIndex(t >> 1) : 0; }   // T_* bit -> 0..T_COUNT-1
+
+    struct RuleInput {
+        std::wstring_view fields[F_COUNT];   // case-folded (F_CMD and F_PAYLOAD: cmdline::Normalizer)
+        uint32_t tests = 0;                  // T_* that hold
+        const wchar_t* detail[T_COUNT] = {}; // reason of a test rule that has none (by test index)
+    };
+
+    // Rules keep pointers into the set's own strings, so a set is neither copied nor moved;
+    // share it through shared_ptr (SetRules).
+    class RuleSet {
+    public:
+        static constexpr size_t kMaxRules = 64;
+        static_assert(ReasonList::kMax >= kMaxRules, "every rule that holds must fit its reason");
+
+        RuleSet() = default;
+        RuleSet(const RuleSet&) = delete;
+        RuleSet& operator=(const RuleSet&) = delete;
+
+        // On error returns false and sets err to "line N: ...".
+        bool Compile(std::wstring_view text, std::wstring* err = nullptr);
+
+        // Tests referenced by the rules; the caller only computes these.
+        uint32_t UsedTests() const { return usedTests_; }
+        // Fields referenced by the rules (bit 1 << Field).
+        uint32_t UsedFields() const { return usedFields_; }
+        size_t Size() const { return rules_.size(); }
+
+        // Adds the score and reasons (pointing into this set) to r.
+        void Run(const RuleInput& in, Result& r) const;
+
+        // Run in pieces, for callers that match a field or test at a time (EvaluateBatch):
+        // Match() is Always() | MatchField() over the fields | MatchTests(); Hold() picks the
+        // rules that hold in file order and adds their weights to score (unclamped); Reasons()
+        // appends their reasons, or "No obvious indicators" when there are none.
+        uint64_t Always() const { return always_; }
+        uint64_t MatchField(Field f, std::wstring_view v) const;
+        uint64_t MatchTests(uint32_t tests) const;
+        uint64_t Hold(uint64_t match, int& score) const;
+        void Reasons(uint64_t held, const wchar_t* const detail[T_COUNT], ReasonList& out) const;
+
+        // Rules whose own field or test holds, looking only at the fields and tests in the
+        // masks (bit 1 << Field, T_*).
+        uint64_t Match(const RuleInput& in, uint32_t fieldMask, uint32_t testMask) const;
+        // Upper bound of the score Run can give when `known` = Match() over every field and
+        // test except `unknownFields` / `unknownTests`, whatever those turn out to be.
+        int Bound(uint64_t known, uint32_t unknownFields, uint32_t unknownTests) const;
+
+    private:
+        void Clear();
+
+        struct Literal { std::wstring text; uint64_t rule; };   // folded
+        struct FieldProgram {
+            Matcher contains;
+            uint64_t slotRule[32] = {};   // matcher tag bit -> rule bit
+            unsigned slots = 0;
+            std::vector<Literal> prefixes, equals, charsets;   // charsets: any of the characters
+            uint64_t present = 0;
+            bool used = false;
+        };
+        struct Rule {
+            uint64_t require = 0, any = 0, unless = 0;
+            int weight = 0;
+            int test = -1;
+            const wchar_t* reason = nullptr;
+        };
+
+        FieldProgram fields_[F_COUNT];
+        uint64_t fieldRules_[F_COUNT] = {};
+        uint64_t testRules_[T_COUNT] = {};
+        uint64_t always_ = 0;   // rules without field/test
+        uint32_t usedTests_ = 0, usedFields_ = 0;
+        std::vector<Rule> rules_;
+        std::vector<std::wstring> names_, reasons_;
+    };
+
+    const wchar_t* DefaultRulesText();
+
+    // Rule set used by EvaluateProcess: the default rules until SetRules/LoadRulesFile.
+    // Replacing it is not safe while a scan runs; replaced sets stay alive so reasons
+    // already handed out remain valid, until ReleaseRetiredRules().
+    const RuleSet& ActiveRules();
+    void SetRules(std::shared_ptr<const RuleSet> rules);
+    bool LoadRulesFile(const std::wstring& path, std::wstring* err = nullptr);
+    // Frees the sets SetRules replaced. Only when no scan runs and no Result or BatchResult
+    // scored with them is still used (--watch: before a reload, once the last scan is printed).
+    void ReleaseRetiredRules();
+} // namespace heur
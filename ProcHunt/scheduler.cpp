@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: MIT
+#include "scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+namespace {
+#if defined(_WIN32)
+    uint64_t ft64(const FILETIME& ft) { return (uint64_t)ft.dwHighDateTime << 32 | ft.dwLowDateTime; }
+#endif
+} // anon
+
+namespace sched {
+    uint64_t SystemClock::WallUs() {
+        using namespace std::chrono;
+        return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t SystemClock::CpuUs() {
+#if defined(_WIN32)
+        FILETIME c, e, k, u;
+        if (!GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u)) return 0;
+        return (ft64(k) + ft64(u)) / 10;
+#else
+        timespec ts{};
+        if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+        return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+#endif
+    }
+
+    double SystemClock::HostBusy() {
+        uint64_t idle = 0, total = 0;
+#if defined(_WIN32)
+        FILETIME i, k, u;
+        if (!GetSystemTimes(&i, &k, &u)) return -1;
+        idle = ft64(i);
+        total = ft64(k) + ft64(u);   // kernel time includes idle time
+#else
+        FILE* f = std::fopen("/proc/stat", "r");
+        if (!f) return -1;
+        unsigned long long v[8] = {};
+        const int n = std::fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+        std::fclose(f);
+        if (n < 4) return -1;
+        for (int j = 0; j < 8; ++j) total += v[j];
+        idle = v[3] + v[4];   // idle + iowait
+#endif
+        const uint64_t di = idle - idle_, dt = total - total_;
+        const bool first = total_ == 0;
+        idle_ = idle; total_ = total;
+        if (first || dt == 0 || di > dt) return -1;
+        return 1.0 - (double)di / (double)dt;
+    }
+
+    Scheduler::Scheduler(IClock& clock, Options opt) : clock_(clock), opt_(opt) {
+        if (opt_.budget <= 0) opt_.budget = 0.01;
+        if (!opt_.quantumUs) opt_.quantumUs = 1;
+        startWall_ = lastWall_ = clock_.WallUs();
+        startCpu_ = lastCpu_ = clock_.CpuUs();
+        lastBusy_ = startWall_;
+        credit_ = (double)opt_.quantumUs;   // the first quantum starts at once
+        clock_.HostBusy();
+    }
+
+    uint64_t Scheduler::Interval(int score) const {
+        // 0 -> rescanUs, 25 -> 1/2, 100 -> 1/5.
+        return score <= 0 ? opt_.rescanUs : opt_.rescanUs * 25 / (25 + (uint64_t)score);
+    }
+
+    void Scheduler::Push(const Key& k, Proc& p) {
+        ++p.version;
+        queue_.push(Slot{ p.due, seq_++, k, p.version });
+    }
+
+    void Scheduler::Account() {
+        const uint64_t wall = clock_.WallUs(), cpu = clock_.CpuUs();
+        credit_ += opt_.budget / backoff_ * (double)(wall - lastWall_) - (double)(cpu - lastCpu_);
+        if (credit_ > (double)opt_.quantumUs) credit_ = (double)opt_.quantumUs;
+        lastWall_ = wall;
+        lastCpu_ = cpu;
+        // Host load once a second: halve the rate while busy, recover gradually.
+        if (wall - lastBusy_ >= 1000000) {
+            lastBusy_ = wall;
+            const double busy = clock_.HostBusy();
+            if (busy > opt_.busyHigh) backoff_ = std::min(8.0, backoff_ * 2);
+            else if (busy >= 0) backoff_ = std::max(1.0, backoff_ * 0.8);
+        }
+    }
+
+    void Scheduler::Update(const std::vector<scan::ProcEntry>& now) {
+        const uint64_t t = clock_.WallUs();
+        ++gen_;
+        for (const auto& e : now) {
+            const Key k{ e.pid, e.createTime };
+            auto ins = live_.try_emplace(k);
+            Proc& p = ins.first->second;
+            p.seen = gen_;
+            if (!ins.second) continue;
+            p.entry = e;
+            p.since = t;
+            p.due = 0;   // before anything already inspected
+            Push(k, p);
+        }
+        for (auto it = live_.begin(); it != live_.end();) {
+            if (it->second.seen != gen_) it = live_.erase(it);
+            else ++it;
+        }
+        // Exited processes and reschedules leave stale slots behind; rebuild when they dominate.
+        if (queue_.size() > 2 * live_.size() + 1024) {
+            queue_ = {};
+            for (auto& kv : live_) if (!kv.second.inFlight) Push(kv.first, kv.second);
+        }
+    }
+
+    void Scheduler::Expire() {
+        const uint64_t t = clock_.WallUs();
+        for (auto& kv : live_) {
+            Proc& p = kv.second;
+            if (p.inFlight || p.due <= t) continue;
+            p.due = t;
+            Push(kv.first, p);
+        }
+    }
+
+    uint64_t Scheduler::DelayUs() {
+        Account();
+        if (credit_ >= 0) return 0;
+        return (uint64_t)(-credit_ * backoff_ / opt_.budget) + 1;
+    }
+
+    uint64_t Scheduler::NextDueUs() {
+        while (!queue_.empty()) {
+            const Slot& s = queue_.top();
+            auto it = live_.find(s.key);
+            if (it != live_.end() && it->second.version == s.version && !it->second.inFlight) break;
+            queue_.pop();
+        }
+        if (queue_.empty()) return UINT64_MAX;
+        const uint64_t t = clock_.WallUs(), due = queue_.top().due;
+        return due <= t ? 0 : due - t;
+    }
+
+    bool Scheduler::Begin(std::vector<scan::ProcEntry>& fresh, std::vector<scan::ProcEntry>& again) {
+        fresh.clear();
+        again.clear();
+        batch_.clear();
+        Account();
+        const uint64_t t = lastWall_;
+        quantumWall_ = t;
+        quantumCpu_ = lastCpu_;
+        const size_t n = (size_t)std::min(4096.0, std::max(1.0, (double)opt_.quantumUs / costUs_));
+        while (batch_.size() < n && NextDueUs() == 0) {
+            const Key k = queue_.top().key;
+            queue_.pop();
+            Proc& p = live_.find(k)->second;
+            const uint64_t waited = t - p.since;
+            stats_.latencyUs.Record(waited);
+            stats_.maxLatencyUs = std::max(stats_.maxLatencyUs, waited);
+            p.since = t;
+            p.inFlight = true;
+            p.done = false;
+            (p.inspected ? again : fresh).push_back(p.entry);
+            batch_.push_back(k);
+        }
+        return !batch_.empty();
+    }
+
+    void Scheduler::Done(const scan::ProcEntry& e, int score) {
+        auto it = live_.find(Key{ e.pid, e.createTime });
+        if (it == live_.end() || !it->second.inFlight) return;
+        it->second.score = score;
+        it->second.done = true;
+    }
+
+    void Scheduler::End() {
+        Account();
+        if (batch_.empty()) return;
+        const double per = (double)(lastCpu_ - quantumCpu_) / (double)batch_.size();
+        costUs_ = std::max(1.0, costUs_ * 0.75 + per * 0.25);
+        for (const Key& k : batch_) {
+            auto it = live_.find(k);
+            if (it == live_.end()) continue;   // exited during the quantum
+            Proc& p = it->second;
+            p.inFlight = false;
+            p.inspected = true;
+            p.due = p.since + Interval(p.done ? p.score : -1);
+            Push(k, p);
+        }
+        stats_.inspections += batch_.size();
+        ++stats_.quanta;
+        batch_.clear();
+    }
+
+    Stats Scheduler::GetStats() {
+        Account();
+        const uint64_t t = lastWall_;
+        Stats s = stats_;
+        s.wallUs = t - startWall_;
+        s.cpuUs = lastCpu_ - startCpu_;
+        s.live = live_.size();
+        s.backoff = backoff_;
+        for (auto& kv : live_) {
+            const Proc& p = kv.second;
+            if (p.inFlight) continue;
+            if (p.due <= t) ++s.overdue;
+            s.maxLatencyUs = std::max(s.maxLatencyUs, t - p.since);
+        }
+        return s;
+    }
+} // namespace sched
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "pipeline.h"
+#include "stats.h"
+
+// --cpu-budget: --watch re-inspects every live process over time without using more than a
+// set share of one core. Processes wait in a queue ordered by due time: a new process is
+// due at once, an inspected one again after an interval that shrinks with its last score.
+// Work runs in quanta sized from the measured CPU cost per process; a token bucket charged
+// with this process's whole CPU time (enumeration and output included) decides when the
+// next quantum may start, and the rate halves each second the host is busy. Time and CPU are
+// read through an IClock, so the scheduler also runs on a simulated clock.
+namespace sched {
+    class IClock {
+    public:
+        virtual ~IClock() = default;
+        virtual uint64_t WallUs() = 0;   // monotonic
+        virtual uint64_t CpuUs() = 0;    // CPU time of this process, all threads, user + kernel
+        virtual double HostBusy() = 0;   // busy share of all CPUs since the previous call; < 0 unknown
+    };
+
+    // steady_clock; GetProcessTimes/GetSystemTimes, or CLOCK_PROCESS_CPUTIME_ID and /proc/stat.
+    class SystemClock : public IClock {
+    public:
+        uint64_t WallUs() override;
+        uint64_t CpuUs() override;
+        double HostBusy() override;
+    private:
+        uint64_t idle_ = 0, total_ = 0;
+    };
+
+    struct Options {
+        double budget = 0.02;             // CPU time per wall time, share of one core
+        uint64_t quantumUs = 20000;       // CPU per quantum; also the most credit the bucket holds
+        uint64_t rescanUs = 300000000;    // interval for a score of 0 (or unreadable): 5 minutes
+        double busyHigh = 0.9;            // host busier than this: halve the rate, down to 1/8
+    };
+
+    struct Stats {
+        uint64_t inspections = 0, quanta = 0;
+        uint64_t wallUs = 0, cpuUs = 0;   // since the scheduler started (all of this process's CPU)
+        size_t live = 0, overdue = 0;     // tracked now / past their due time now
+        uint64_t maxLatencyUs = 0;        // longest a live process went uninspected, waits still open included
+        stats::Histogram latencyUs;       // per inspection: time since arrival or the previous inspection
+        double backoff = 1;               // current rate divisor (1..8)
+    };
+
+    class Scheduler {
+    public:
+        explicit Scheduler(IClock& clock, Options opt = {});
+
+        // A fresh enumeration: new (PID, creation time) pairs are due now, ahead of every
+        // other process; processes missing from it are dropped.
+        void Update(const std::vector<scan::ProcEntry>& now);
+        // Every live process due now (rules or whitelists changed).
+        void Expire();
+
+        // Microseconds until the budget allows the next quantum; 0 = now.
+        uint64_t DelayUs();
+        // Microseconds until the next process is due; UINT64_MAX when none is tracked.
+        uint64_t NextDueUs();
+
+        // Takes the next quantum's processes, most urgent first: never inspected ones into
+        // `fresh`, the others into `again`. False when nothing is due. Report each result
+        // with Done(), then call End().
+        bool Begin(std::vector<scan::ProcEntry>& fresh, std::vector<scan::ProcEntry>& again);
+        void Done(const scan::ProcEntry& e, int score);   // score < 0: could not be read
+        void End();
+
+        Stats GetStats();
+        size_t Size() const { return live_.size(); }
+
+    private:
+        struct Key {
+            uint32_t pid; uint64_t createTime;
+            bool operator==(const Key& o) const { return pid == o.pid && createTime == o.createTime; }
+        };
+        struct KeyHash {
+            size_t operator()(const Key& k) const {
+                uint64_t h = (k.createTime ^ ((uint64_t)k.pid << 32 | k.pid)) * 0x9E3779B97F4A7C15ull;
+                return (size_t)(h ^ (h >> 29));
+            }
+        };
+        struct Proc {
+            scan::ProcEntry entry;
+            uint64_t since = 0;      // arrival or start of the last inspection
+            uint64_t due = 0;
+            uint32_t version = 0;    // bumped on every reschedule: older heap slots are stale
+            int score = -1;
+            bool inspected = false, inFlight = false, done = false;
+            uint64_t seen = 0;
+        };
+        struct Slot {
+            uint64_t due, seq;
+            Key key;
+            uint32_t version;
+            bool operator>(const Slot& o) const { return due != o.due ? due > o.due : seq > o.seq; }
+        };
+
+        void Account();
+        void Push(const Key& k, Proc& p);
+        uint64_t Interval(int score) const;
+
+        IClock& clock_;
+        Options opt_;
+        std::unordered_map<Key, Proc, KeyHash> live_;
+        std::priority_queue<Slot, std::vector<Slot>, std::greater<Slot>> queue_;
+        std::vector<Key> batch_;
+        uint64_t gen_ = 0, seq_ = 0;
+
+        // Token bucket, in CPU microseconds.
+        double credit_ = 0, costUs_ = 1000, backoff_ = 1;
+        uint64_t startWall_ = 0, startCpu_ = 0, lastWall_ = 0, lastCpu_ = 0, lastBusy_ = 0;
+        uint64_t quantumWall_ = 0, quantumCpu_ = 0;
+        Stats stats_;
+    };
+} // namespace sched
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: MIT
+#include "serializer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    // JSON escape per ASCII code unit: 0 = copy, 'u' = \u00XX, else the letter after '\'.
+    struct EscTable {
+        char t[128];
+        EscTable() : t{} {
+            for (int c = 0; c < 0x20; ++c) t[c] = 'u';
+            t['\b'] = 'b'; t['\f'] = 'f'; t['\n'] = 'n'; t['\r'] = 'r'; t['\t'] = 't';
+            t['"'] = '"'; t['\\'] = '\\';
+        }
+    };
+    const EscTable kEsc;
+    const char kHex[] = "0123456789ABCDEF";
+
+    // Code point at w[i] (surrogate pairs combined, invalid -> U+FFFD); advances i past it.
+    inline uint32_t next_cp(std::wstring_view w, size_t& i) {
+        uint32_t cp = (uint32_t)w[i++];
+        if (cp < 0xD800) return cp;
+        if (cp <= 0xDBFF && i < w.size() && (uint32_t)w[i] >= 0xDC00 && (uint32_t)w[i] <= 0xDFFF)
+            return 0x10000 + ((cp - 0xD800) << 10) + ((uint32_t)w[i++] - 0xDC00);
+        if (cp <= 0xDFFF || cp > 0x10FFFF) return 0xFFFD;
+        return cp;
+    }
+
+    inline char* put_utf8(char* p, uint32_t cp) {
+        if (cp < 0x800) {
+            *p++ = (char)(0xC0 | (cp >> 6)); *p++ = (char)(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000) {
+            *p++ = (char)(0xE0 | (cp >> 12)); *p++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+            *p++ = (char)(0x80 | (cp & 0x3F));
+        }
+        else {
+            *p++ = (char)(0xF0 | (cp >> 18)); *p++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+            *p++ = (char)(0x80 | ((cp >> 6) & 0x3F)); *p++ = (char)(0x80 | (cp & 0x3F));
+        }
+        return p;
+    }
+
+    // Digits of v, written backwards ending at `end`; returns the first digit.
+    inline char* u64_digits(char* end, uint64_t v) {
+        do { *--end = (char)('0' + v % 10); v /= 10; } while (v);
+        return end;
+    }
+} // anon
+
+namespace ser {
+
+    Buffer::Buffer(size_t reserve) : buf_(new char[reserve ? reserve : 1]), cap_(reserve ? reserve : 1) {}
+
+    void Buffer::Grow(size_t need) {
+        size_t cap = cap_ * 2;
+        if (cap - n_ < need) cap = n_ + need;
+        std::unique_ptr<char[]> b(new char[cap]);
+        std::memcpy(b.get(), buf_.get(), n_);
+        buf_ = std::move(b);
+        cap_ = cap;
+    }
+
+    void Buffer::Put(std::string_view ascii) {
+        char* p = Reserve(ascii.size());
+        std::memcpy(p, ascii.data(), ascii.size());
+        n_ += ascii.size();
+    }
+
+    // Worst cases per code unit: 4 bytes of UTF-8 (a UTF-32 unit) or 6 bytes of \u00XX.
+    void Buffer::Text(std::wstring_view w) {
+        char* p = Reserve(w.size() * 4);
+        for (size_t i = 0; i < w.size();) {
+            const uint32_t c = (uint32_t)w[i];
+            if (c < 0x80) { *p++ = (char)c; ++i; continue; }
+            p = put_utf8(p, next_cp(w, i));
+        }
+        Commit(p);
+    }
+
+    void Buffer::TextPadded(std::wstring_view w, size_t width) {
+        Text(w);
+        if (w.size() < width) { char* p = Reserve(width - w.size()); std::memset(p, ' ', width - w.size()); n_ += width - w.size(); }
+    }
+
+    void Buffer::Json(std::wstring_view w) {
+        char* p = Reserve(w.size() * 6);
+        for (size_t i = 0; i < w.size();) {
+            const uint32_t c = (uint32_t)w[i];
+            if (c >= 0x80) { p = put_utf8(p, next_cp(w, i)); continue; }
+            ++i;
+            const char e = kEsc.t[c];
+            if (!e) { *p++ = (char)c; continue; }
+            *p++ = '\\';
+            if (e != 'u') { *p++ = e; continue; }
+            *p++ = 'u'; *p++ = '0'; *p++ = '0'; *p++ = kHex[c >> 4]; *p++ = kHex[c & 15];
+        }
+        Commit(p);
+    }
+
+    void Buffer::Uint(uint64_t v) {
+        char tmp[20];
+        char* b = u64_digits(tmp + sizeof(tmp), v);
+        Put(std::string_view(b, (size_t)(tmp + sizeof(tmp) - b)));
+    }
+
+    void Buffer::UintPadded(uint64_t v, size_t width) {
+        const size_t start = n_;
+        Uint(v);
+        const size_t len = n_ - start;
+        if (len < width) { char* p = Reserve(width - len); std::memset(p, ' ', width - len); n_ += width - len; }
+    }
+
+    void Buffer::Int(int64_t v) {
+        if (v < 0) { Put('-'); Uint(0 - (uint64_t)v); }
+        else Uint((uint64_t)v);
+    }
+
+    void Buffer::Fixed(double v, int decimals) {
+        // Integer path unless the scaled value is near a rounding tie, where only printf
+        // (exact decimal expansion) is guaranteed to match.
+        static const double kPow10[] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6 };
+        if (decimals >= 0 && decimals <= 6 && std::fabs(v) < 1e12) {
+            const double scaled = std::fabs(v) * kPow10[decimals];
+            const double r = std::nearbyint(scaled);
+            if (std::fabs(std::fabs(scaled - r) - 0.5) > 1e-6) {
+                uint64_t q = (uint64_t)r;
+                char tmp[32];
+                char* end = tmp + sizeof(tmp);
+                char* b = end;
+                for (int k = 0; k < decimals; ++k) { *--b = (char)('0' + q % 10); q /= 10; }
+                if (decimals) *--b = '.';
+                b = u64_digits(b, q);
+                if (std::signbit(v)) *--b = '-';
+                Put(std::string_view(b, (size_t)(end - b)));
+                return;
+            }
+        }
+        char tmp[64];
+        int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+        if (n > 0) Put(std::string_view(tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1));
+    }
+} // namespace ser
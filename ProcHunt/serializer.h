@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// Output serializer: wide strings are escaped (JSON) and transcoded to UTF-8 in one pass,
+// straight into a reusable byte buffer. Nothing is allocated per field; the buffer only
+// grows until it fits the largest batch written between Clear() calls.
+namespace ser {
+    class Buffer {
+    public:
+        explicit Buffer(size_t reserve = 64 * 1024);
+
+        const char* Data() const { return buf_.get(); }
+        size_t Size() const { return n_; }
+        void Clear() { n_ = 0; }
+
+        void Put(char c) { if (n_ == cap_) Grow(1); buf_[n_++] = c; }
+        void Put(std::string_view ascii);                // bytes as-is (literals, keys)
+        void Text(std::wstring_view w);                  // UTF-8
+        void TextPadded(std::wstring_view w, size_t width);   // left-aligned, like %-*s
+        void Json(std::wstring_view w);                  // JSON string body, no quotes
+        void Quoted(std::wstring_view w) { Put('"'); Json(w); Put('"'); }
+        void Uint(uint64_t v);
+        void UintPadded(uint64_t v, size_t width);       // left-aligned, like %-*lu
+        void Int(int64_t v);
+        void Fixed(double v, int decimals);              // like %.*f
+
+    private:
+        char* Reserve(size_t n) { if (cap_ - n_ < n) Grow(n); return buf_.get() + n_; }
+        void Commit(const char* end) { n_ = (size_t)(end - buf_.get()); }
+        void Grow(size_t need);
+
+        std::unique_ptr<char[]> buf_;
+        size_t n_ = 0, cap_ = 0;
+    };
+} // namespace ser
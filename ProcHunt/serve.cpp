@@ -0,0 +1,429 @@
+// SPDX-License-Identifier: MIT
+#include "serve.h"
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "ingest.h"
+#include "print.h"
+#include "utils.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Transport: a connected stream, a socket fd or a pipe HANDLE; -1 = none.
+#if defined(_WIN32)
+    HANDLE H(intptr_t c) { return (HANDLE)c; }
+
+    std::wstring pipe_name(const std::wstring& endpoint) {
+        return endpoint.rfind(L"\\\\.\\pipe\\", 0) == 0 ? endpoint : L"\\\\.\\pipe\\" + endpoint;
+    }
+
+    HANDLE new_instance(const std::wstring& name, bool first) {
+        return CreateNamedPipeW(name.c_str(), PIPE_ACCESS_DUPLEX | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            PIPE_UNLIMITED_INSTANCES, 64 * 1024, 64 * 1024, 0, nullptr);
+    }
+
+    bool read_full(intptr_t c, void* dst, size_t n) {
+        char* p = (char*)dst;
+        while (n) {
+            DWORD got = 0;
+            if (!ReadFile(H(c), p, (DWORD)(n > (1u << 30) ? (1u << 30) : n), &got, nullptr) || !got) return false;
+            p += got; n -= got;
+        }
+        return true;
+    }
+
+    bool write_full(intptr_t c, const void* src, size_t n) {
+        const char* p = (const char*)src;
+        while (n) {
+            DWORD put = 0;
+            if (!WriteFile(H(c), p, (DWORD)(n > (1u << 30) ? (1u << 30) : n), &put, nullptr) || !put) return false;
+            p += put; n -= put;
+        }
+        return true;
+    }
+
+    void cut(intptr_t c) { CancelIoEx(H(c), nullptr); DisconnectNamedPipe(H(c)); }
+    void close_conn(intptr_t c) { CloseHandle(H(c)); }
+#else
+    bool socket_addr(const std::wstring& endpoint, sockaddr_un& addr) {
+        const std::string path = util::to_utf8(endpoint);
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    bool read_full(intptr_t c, void* dst, size_t n) {
+        char* p = (char*)dst;
+        while (n) {
+            const ssize_t got = recv((int)c, p, n, 0);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            p += got; n -= (size_t)got;
+        }
+        return true;
+    }
+
+    bool write_full(intptr_t c, const void* src, size_t n) {
+        const char* p = (const char*)src;
+        while (n) {
+            const ssize_t put = send((int)c, p, n, MSG_NOSIGNAL);
+            if (put < 0 && errno == EINTR) continue;
+            if (put <= 0) return false;
+            p += put; n -= (size_t)put;
+        }
+        return true;
+    }
+
+    void cut(intptr_t c) { shutdown((int)c, SHUT_RDWR); }
+    void close_conn(intptr_t c) { close((int)c); }
+#endif
+
+    bool read_frame(intptr_t c, std::string& out, uint32_t limit) {
+        unsigned char len[4];
+        if (!read_full(c, len, 4)) return false;
+        const uint32_t n = len[0] | (uint32_t)len[1] << 8 | (uint32_t)len[2] << 16 | (uint32_t)len[3] << 24;
+        if (n > limit) return false;
+        out.resize(n);
+        return !n || read_full(c, &out[0], n);
+    }
+
+    bool write_frame(intptr_t c, const char* data, size_t n) {
+        if (n > 0xFFFFFFFFu) return false;
+        const unsigned char len[4] = { (unsigned char)n, (unsigned char)(n >> 8), (unsigned char)(n >> 16), (unsigned char)(n >> 24) };
+        return write_full(c, len, 4) && (!n || write_full(c, data, n));
+    }
+
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r' || s.back() == '\n')) s.remove_suffix(1);
+        return s;
+    }
+
+    bool parse_uint(std::string_view s, uint64_t max, uint64_t& out) {
+        if (s.empty() || s.size() > 20) return false;
+        out = 0;
+        for (char c : s) {
+            if (c < '0' || c > '9') return false;
+            out = out * 10 + (uint64_t)(c - '0');
+            if (out > max) return false;
+        }
+        return true;
+    }
+} // anon
+
+namespace serve {
+
+    Handler::Handler(EnumFn enumerate, scan::IProcessReader& reader, scan::ISignatureVerifier& verifier, Options opt)
+        : enumerate_(std::move(enumerate)), reader_(reader), verifier_(verifier), opt_(opt) {}
+
+    bool Handler::Error(ser::Buffer& out, const char* message) {
+        ++errors_;
+        out.Put("{\"error\":\""); out.Put(message); out.Put("\"}\n");
+        return false;
+    }
+
+    // A reload waits for the requests in flight to finish and holds new ones back, so the
+    // rules and lists it replaces are not in use, and neither are the retired ones it frees.
+    void Handler::Handle(std::string_view request, ser::Buffer& out) {
+        PollReload();
+        {
+            std::unique_lock<std::mutex> lk(gateM_);
+            gate_.wait(lk, [&] { return !reloading_; });
+            ++inFlight_;
+        }
+        Dispatch(request, out);
+        std::lock_guard<std::mutex> lk(gateM_);
+        if (--inFlight_ == 0 && reloading_) gate_.notify_all();
+    }
+
+    void Handler::PollReload() {
+        if (!reload_.changed) return;
+        std::unique_lock<std::mutex> poll(pollM_, std::try_to_lock);
+        if (!poll.owns_lock()) return;   // another request is checking
+        const auto now = std::chrono::steady_clock::now();
+        if (now < nextCheck_) return;
+        nextCheck_ = now + std::chrono::milliseconds(opt_.reloadCheckMs);
+        if (!reload_.changed()) return;
+        {
+            std::unique_lock<std::mutex> lk(gateM_);
+            reloading_ = true;
+            gate_.wait(lk, [&] { return inFlight_ == 0; });
+        }
+        reload_.apply();
+        ++reloads_;
+        std::lock_guard<std::mutex> lk(gateM_);
+        reloading_ = false;
+        gate_.notify_all();
+    }
+
+    void Handler::Dispatch(std::string_view request, ser::Buffer& out) {
+        ++requests_;
+        const std::string_view req = trim(request);
+        const size_t sp = req.find(' ');
+        const std::string_view cmd = req.substr(0, sp);
+        const std::string_view arg = sp == std::string_view::npos ? std::string_view{} : trim(req.substr(sp + 1));
+        uint64_t n = 0;
+        if (cmd == "ping" && arg.empty()) {
+            out.Put("{\"ok\":true,\"requests\":"); out.Uint(requests_);
+            out.Put(",\"errors\":"); out.Uint(errors_); out.Put("}\n");
+        }
+        else if (cmd == "score") {
+            if (!parse_uint(arg, 0xFFFFFFFFu, n)) { Error(out, "usage: score <pid>"); return; }
+            Score((uint32_t)n, out);
+        }
+        else if (cmd == "scan") {
+            if (!arg.empty() && !parse_uint(arg, 100, n)) { Error(out, "usage: scan [<min-score 0-100>]"); return; }
+            Scan(arg.empty() ? -1 : (int)n, out);
+        }
+        else if (cmd == "record") {
+            Record(arg, out);
+        }
+        else Error(out, "unknown request (ping, score <pid>, scan [<min-score>], record <json>)");
+    }
+
+    // The last enumeration while it is fresh enough, else a new one. Requests running on
+    // an older table keep it alive through their shared_ptr. The enumerator runs for one
+    // request at a time (EnumProcesses keeps one query buffer); a request that waited for
+    // it takes the table of an enumeration that started after the request arrived.
+    std::shared_ptr<const Handler::Table> Handler::Current(bool refresh) {
+        const auto now = std::chrono::steady_clock::now();
+        if (!refresh) {
+            std::lock_guard<std::mutex> lk(m_);
+            if (table_ && now - table_->at < std::chrono::milliseconds(opt_.tableMaxAgeMs)) return table_;
+        }
+        std::lock_guard<std::mutex> en(enumM_);
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            if (table_ && table_->at > now) return table_;
+        }
+        auto t = std::make_shared<Table>();
+        t->at = std::chrono::steady_clock::now();
+        if (!enumerate_ || !enumerate_(t->procs)) return nullptr;
+        t->graph.Build(t->procs);
+        std::lock_guard<std::mutex> lk(m_);
+        table_ = t;
+        return t;
+    }
+
+    bool Handler::Score(uint32_t pid, ser::Buffer& out) {
+        std::shared_ptr<const Table> t = Current(false);
+        uint32_t slot = t ? t->graph.Find(pid) : lin::kNone;
+        if (slot == lin::kNone && t) {   // a process newer than the table
+            t = Current(true);
+            slot = t ? t->graph.Find(pid) : lin::kNone;
+        }
+        if (!t) return Error(out, "process enumeration failed");
+        if (slot == lin::kNone) return Error(out, "no such process");
+
+        scan::ListSource src({ t->procs[slot] });
+        scan::Options o;
+        o.lineage = &t->graph;
+        bool ok = false;
+        scan::Run(src, reader_, verifier_, o, [&](scan::ScanItem& it) {
+            if (!it.ok) return;
+            const ProcParams& pp = it.pp;
+            lin::Chain chain;
+            t->graph.Ancestry(it.entry.pid, chain);
+            WriteJsonProcess(out, it.entry.pid, pp.name, pp.imagePath, pp.commandLine, pp.currentDirectory,
+                pp.windowTitle, pp.desktopInfo, pp.shellInfo, pp.runtimeData, it.sig, it.res, &chain);
+            out.Put('\n');
+            ok = true;
+            });
+        return ok || Error(out, "cannot read process");
+    }
+
+    bool Handler::Scan(int minScore, ser::Buffer& out) {
+        const std::shared_ptr<const Table> t = Current(true);
+        if (!t) return Error(out, "process enumeration failed");
+        scan::ListSource src(t->procs);
+        scan::Options o;
+        o.threads = opt_.scanThreads;
+        o.minScore = minScore;
+        o.lineage = &t->graph;
+        scan::Run(src, reader_, verifier_, o, [&](scan::ScanItem& it) {
+            if (!it.ok || (minScore >= 0 && it.res.score < minScore)) return;
+            const ProcParams& pp = it.pp;
+            lin::Chain chain;
+            t->graph.Ancestry(it.entry.pid, chain);
+            WriteJsonProcess(out, it.entry.pid, pp.name, pp.imagePath, pp.commandLine, pp.currentDirectory,
+                pp.windowTitle, pp.desktopInfo, pp.shellInfo, pp.runtimeData, it.sig, it.res, &chain);
+            out.Put('\n');
+            });
+        return true;
+    }
+
+    bool Handler::Record(std::string_view json, ser::Buffer& out) {
+        thread_local ingest::Record rec;
+        ingest::Scored sc;
+        if (!ingest::ParseRecord(json.data(), json.size(), rec)) return Error(out, "malformed record");
+        if (!rec.isProcess) return Error(out, "not a process record");
+        ingest::Score(rec, sc);
+        WriteJsonProcess(out, (unsigned long)rec.pid, rec.name, rec.imagePath, rec.commandLine, rec.currentDirectory,
+            rec.windowTitle, rec.desktopInfo, rec.shellInfo, rec.runtimeData, sc.sig, sc.res, &sc.ancestry);
+        out.Put('\n');
+        return true;
+    }
+
+    Server::~Server() {
+        Stop();
+        if (listen_ != -1) close_conn(listen_);
+    }
+
+    bool Server::Listen(const std::wstring& endpoint, std::wstring* err) {
+        auto fail = [&](const wchar_t* why) { if (err) *err = why; return false; };
+#if defined(_WIN32)
+        endpoint_ = pipe_name(endpoint);
+        HANDLE h = new_instance(endpoint_, true);
+        if (h == INVALID_HANDLE_VALUE)
+            return fail(GetLastError() == ERROR_ACCESS_DENIED ? L"pipe name already in use" : L"cannot create pipe");
+        listen_ = (intptr_t)h;
+#else
+        sockaddr_un addr;
+        if (!socket_addr(endpoint, addr)) return fail(L"socket path is empty or too long");
+        struct stat st {};
+        if (lstat(addr.sun_path, &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) return fail(L"path exists and is not a socket");
+            // A socket nobody answers on is left over from an earlier run.
+            const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            const bool live = probe >= 0 && connect(probe, (const sockaddr*)&addr, sizeof(addr)) == 0;
+            if (probe >= 0) close(probe);
+            if (live) return fail(L"another server is listening on this socket");
+            unlink(addr.sun_path);
+        }
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return fail(L"cannot create socket");
+        const mode_t old = umask(077);
+        const bool bound = bind(fd, (const sockaddr*)&addr, sizeof(addr)) == 0;
+        umask(old);
+        if (!bound || listen(fd, 64) != 0) { close(fd); return fail(L"cannot bind socket"); }
+        endpoint_ = endpoint;
+        listen_ = fd;
+#endif
+        stop_ = false;
+        return true;
+    }
+
+    void Server::Run() {
+        while (!stop_) {
+#if defined(_WIN32)
+            const HANDLE h = H(listen_);
+            const bool connected = ConnectNamedPipe(h, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED;
+            if (stop_) break;
+            // The next instance is created before this one is handed off, so a client never
+            // finds the name missing.
+            const HANDLE next = new_instance(endpoint_, false);
+            if (next == INVALID_HANDLE_VALUE) { if (connected) DisconnectNamedPipe(h); continue; }
+            listen_ = (intptr_t)next;
+            if (!connected) { CloseHandle(h); continue; }
+            const intptr_t conn = (intptr_t)h;
+#else
+            const int fd = accept((int)listen_, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE || errno == ENFILE) {
+                    if (errno == EMFILE || errno == ENFILE) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                break;   // Stop() shut the socket down
+            }
+            const intptr_t conn = fd;
+#endif
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                if (stop_) { close_conn(conn); break; }
+                open_.push_back(conn);
+            }
+            ++connections_;
+            std::thread([this, conn] { Serve(conn); }).detach();
+        }
+        std::unique_lock<std::mutex> lk(m_);
+        idle_.wait(lk, [&] { return open_.empty(); });
+#if !defined(_WIN32)
+        sockaddr_un addr;
+        if (socket_addr(endpoint_, addr)) unlink(addr.sun_path);
+#endif
+    }
+
+    void Server::Stop() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            if (stop_ || listen_ == -1) { stop_ = true; return; }
+            stop_ = true;
+            for (intptr_t c : open_) cut(c);
+        }
+#if defined(_WIN32)
+        // ConnectNamedPipe only returns for a client: be that client.
+        HANDLE self = CreateFileW(endpoint_.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (self != INVALID_HANDLE_VALUE) CloseHandle(self);
+#else
+        shutdown((int)listen_, SHUT_RDWR);
+#endif
+    }
+
+    void Server::Serve(intptr_t conn) {
+        std::string req;
+        ser::Buffer resp(64 * 1024);
+        while (!stop_ && read_frame(conn, req, kMaxRequest)) {
+            resp.Clear();
+            handler_.Handle(req, resp);
+            if (!write_frame(conn, resp.Data(), resp.Size())) break;
+        }
+#if defined(_WIN32)
+        FlushFileBuffers(H(conn));
+        DisconnectNamedPipe(H(conn));
+#endif
+        std::lock_guard<std::mutex> lk(m_);
+        for (size_t i = 0; i < open_.size(); ++i)
+            if (open_[i] == conn) { open_[i] = open_.back(); open_.pop_back(); break; }
+        close_conn(conn);
+        idle_.notify_all();
+    }
+
+    bool Client::Connect(const std::wstring& endpoint, std::wstring* err) {
+        Close();
+#if defined(_WIN32)
+        const std::wstring name = pipe_name(endpoint);
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            HANDLE h = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+            if (h != INVALID_HANDLE_VALUE) { conn_ = (intptr_t)h; return true; }
+            if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeW(name.c_str(), 2000)) break;
+        }
+        if (err) *err = L"cannot connect to pipe";
+        return false;
+#else
+        sockaddr_un addr;
+        if (!socket_addr(endpoint, addr)) { if (err) *err = L"socket path is empty or too long"; return false; }
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+            if (fd >= 0) close(fd);
+            if (err) *err = L"cannot connect to socket";
+            return false;
+        }
+        conn_ = fd;
+        return true;
+#endif
+    }
+
+    bool Client::Call(std::string_view request, std::string& response) {
+        if (conn_ == -1) return false;
+        if (write_frame(conn_, request.data(), request.size()) && read_frame(conn_, response, 0xFFFFFFFFu)) return true;
+        Close();
+        return false;
+    }
+
+    void Client::Close() {
+        if (conn_ != -1) close_conn(conn_);
+        conn_ = -1;
+    }
+} // namespace serve
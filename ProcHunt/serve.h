@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "lineage.h"
+#include "pipeline.h"
+#include "serializer.h"
+
+// --serve: a resident scorer for EDR integrations. Whitelists, compiled rules and matchers
+// are loaded once (and again when their files change), signature results stay in a
+// sig::Cache and the process table is reused for a short while, so a query costs one PEB
+// read and one evaluation instead of a process start. Clients talk over a local stream: a
+// Unix socket, or a named pipe on Windows.
+//
+// Each request and response is a frame: payload length (u32, little-endian), then the
+// payload. A connection may carry any number of requests, answered in order. Requests are
+// one line of UTF-8:
+//   ping                  {"ok":true,"requests":N,"errors":N}
+//   score <pid>           the process as one --ndjson line (with ancestry)
+//   scan [<min-score>]    every readable process, --ndjson lines, enumeration order
+//   record <json>         a --json/--ndjson process object re-scored, as --ingest does
+// Anything else, or a process that cannot be found or read, gets {"error":"..."}.
+namespace serve {
+    constexpr uint32_t kMaxRequest = 16u << 20;   // a longer frame closes the connection
+
+    using EnumFn = std::function<bool(std::vector<scan::ProcEntry>&)>;
+
+    struct Options {
+        unsigned scanThreads = 1;     // "scan": workers for PEB reads and verification (0 = one per core)
+        unsigned tableMaxAgeMs = 500; // "score": reuse the last enumeration this long, unless the PID is new
+        unsigned reloadCheckMs = 1000; // how often a request asks Reload::changed
+    };
+
+    // Configuration reload between requests. A request that finds a check due calls
+    // changed(); when it returns true, apply() runs once no request is in flight, and new
+    // requests wait for it. Both run on one thread at a time.
+    struct Reload {
+        std::function<bool()> changed;
+        std::function<void()> apply;
+    };
+
+    // Request handling, independent of the transport. Handle() may run on many threads at
+    // once; the reader and verifier must allow that (as for scan::Run with threads > 1).
+    class Handler {
+    public:
+        Handler(EnumFn enumerate, scan::IProcessReader& reader, scan::ISignatureVerifier& verifier, Options opt = {});
+
+        void SetReload(Reload reload) { reload_ = std::move(reload); }   // before serving
+        void Handle(std::string_view request, ser::Buffer& response);
+        uint64_t Requests() const { return requests_; }
+        uint64_t Errors() const { return errors_; }
+        uint64_t Reloads() const { return reloads_; }
+
+    private:
+        struct Table {
+            std::vector<scan::ProcEntry> procs;
+            lin::Graph graph;
+            std::chrono::steady_clock::time_point at;
+        };
+
+        std::shared_ptr<const Table> Current(bool refresh);
+        bool Score(uint32_t pid, ser::Buffer& out);
+        bool Scan(int minScore, ser::Buffer& out);
+        bool Record(std::string_view json, ser::Buffer& out);
+        bool Error(ser::Buffer& out, const char* message);
+        void Dispatch(std::string_view request, ser::Buffer& out);
+        void PollReload();
+
+        EnumFn enumerate_;
+        scan::IProcessReader& reader_;
+        scan::ISignatureVerifier& verifier_;
+        Options opt_;
+        std::mutex m_, enumM_;   // enumM_: held while enumerate_ runs
+        std::shared_ptr<const Table> table_;
+        std::atomic<uint64_t> requests_{ 0 }, errors_{ 0 }, reloads_{ 0 };
+
+        Reload reload_;
+        std::mutex pollM_;   // held by the request checking for a reload
+        std::chrono::steady_clock::time_point nextCheck_{};
+        std::mutex gateM_;   // requests in flight vs a reload
+        std::condition_variable gate_;
+        unsigned inFlight_ = 0;
+        bool reloading_ = false;
+    };
+
+    // Accepts clients until Stop(); one thread per connection.
+    class Server {
+    public:
+        explicit Server(Handler& handler) : handler_(handler) {}
+        ~Server();
+
+        // Unix: a socket path (created 0600, a stale socket there is replaced). Windows: a
+        // pipe name, with or without the \\.\pipe\ prefix; remote clients are rejected.
+        bool Listen(const std::wstring& endpoint, std::wstring* err = nullptr);
+        void Run();    // returns after Stop(), once every connection is closed
+        void Stop();   // any thread, or a signal/console handler
+        uint64_t Connections() const { return connections_; }
+
+    private:
+        void Serve(intptr_t conn);
+
+        Handler& handler_;
+        std::wstring endpoint_;
+        intptr_t listen_ = -1;
+        std::atomic<bool> stop_{ false };
+        std::mutex m_;
+        std::condition_variable idle_;
+        std::vector<intptr_t> open_;   // live connections, cut by Stop()
+        std::atomic<uint64_t> connections_{ 0 };
+    };
+
+    // One connection to a server; Call() sends a request and waits for its response.
+    class Client {
+    public:
+        ~Client() { Close(); }
+        bool Connect(const std::wstring& endpoint, std::wstring* err = nullptr);
+        bool Call(std::string_view request, std::string& response);
+        void Close();
+
+    private:
+        intptr_t conn_ = -1;
+    };
+} // namespace serve
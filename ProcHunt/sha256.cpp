@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: MIT
+#include "sha256.h"
+#include <cstdio>
+#include <vector>
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PROCHUNT_SHA_NI 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SHA_NI_TARGET
+#else
+#include <cpuid.h>
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#endif
+#endif
+
+namespace {
+    alignas(16) const uint32_t kK[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    using BlockFn = void (*)(uint32_t* h, const uint8_t* p, size_t blocks);
+
+    inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void blocks_portable(uint32_t* h, const uint8_t* p, size_t blocks) {
+        for (; blocks; --blocks, p += 64) {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i)
+                w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+            for (int i = 16; i < 64; ++i) {
+                const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+            for (int i = 0; i < 64; ++i) {
+                const uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kK[i] + w[i];
+                const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                hh = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+        }
+    }
+
+#if PROCHUNT_SHA_NI
+    // Rounds 4g..4g+3. The message schedule lives in four registers: w[g & 3] holds W[4g..4g+3];
+    // W for group g+1 is finished here (msg2) and the one for g+3 started (msg1).
+    template <int g>
+    SHA_NI_TARGET inline void quad(__m128i& s0, __m128i& s1, __m128i (&w)[4], const uint8_t* p, __m128i mask) {
+        if constexpr (g < 4) w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 16 * g)), mask);
+        __m128i msg = _mm_add_epi32(w[g & 3], _mm_load_si128((const __m128i*)&kK[4 * g]));
+        s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+        if constexpr (g >= 3 && g <= 14) {
+            w[(g + 1) & 3] = _mm_add_epi32(w[(g + 1) & 3], _mm_alignr_epi8(w[g & 3], w[(g + 3) & 3], 4));
+            w[(g + 1) & 3] = _mm_sha256msg2_epu32(w[(g + 1) & 3], w[g & 3]);
+        }
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        s0 = _mm_sha256rnds2_epu32(s0, s1, msg);
+        if constexpr (g >= 1 && g <= 12) w[(g + 3) & 3] = _mm_sha256msg1_epu32(w[(g + 3) & 3], w[g & 3]);
+    }
+
+    SHA_NI_TARGET void blocks_shani(uint32_t* h, const uint8_t* p, size_t blocks) {
+        const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        // The instructions want the state as ABEF / CDGH.
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xB1);   // CDAB
+        __m128i s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1B);    // EFGH
+        __m128i s0 = _mm_alignr_epi8(tmp, s1, 8);                                         // ABEF
+        s1 = _mm_blend_epi16(s1, tmp, 0xF0);                                              // CDGH
+        for (; blocks; --blocks, p += 64) {
+            const __m128i abef = s0, cdgh = s1;
+            __m128i w[4];
+            quad<0>(s0, s1, w, p, mask);  quad<1>(s0, s1, w, p, mask);  quad<2>(s0, s1, w, p, mask);  quad<3>(s0, s1, w, p, mask);
+            quad<4>(s0, s1, w, p, mask);  quad<5>(s0, s1, w, p, mask);  quad<6>(s0, s1, w, p, mask);  quad<7>(s0, s1, w, p, mask);
+            quad<8>(s0, s1, w, p, mask);  quad<9>(s0, s1, w, p, mask);  quad<10>(s0, s1, w, p, mask); quad<11>(s0, s1, w, p, mask);
+            quad<12>(s0, s1, w, p, mask); quad<13>(s0, s1, w, p, mask); quad<14>(s0, s1, w, p, mask); quad<15>(s0, s1, w, p, mask);
+            s0 = _mm_add_epi32(s0, abef);
+            s1 = _mm_add_epi32(s1, cdgh);
+        }
+        tmp = _mm_shuffle_epi32(s0, 0x1B);          // FEBA
+        s1 = _mm_shuffle_epi32(s1, 0xB1);           // DCHG
+        _mm_storeu_si128((__m128i*)&h[0], _mm_blend_epi16(tmp, s1, 0xF0));   // DCBA
+        _mm_storeu_si128((__m128i*)&h[4], _mm_alignr_epi8(s1, tmp, 8));      // HGFE
+    }
+
+    bool has_sha_ni() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int r[4];
+        __cpuid(r, 0);
+        if (r[0] < 7) return false;
+        __cpuid(r, 1);
+        const bool sse = (r[2] >> 19 & 1) && (r[2] >> 9 & 1);   // SSE4.1, SSSE3
+        __cpuidex(r, 7, 0);
+        return sse && (r[1] >> 29 & 1);
+#else
+        unsigned a, b, c, d;
+        if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+        const bool sse = (c >> 19 & 1) && (c >> 9 & 1);
+        if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return false;
+        return sse && (b >> 29 & 1);
+#endif
+    }
+#endif
+
+    BlockFn pick() {
+#if PROCHUNT_SHA_NI
+        if (has_sha_ni()) return blocks_shani;
+#endif
+        return blocks_portable;
+    }
+
+    BlockFn g_blocks = pick();
+
+    template <class C>
+    bool from_hex(std::basic_string_view<C> s, sha::Digest& out) {
+        if (s.size() != 64) return false;
+        for (size_t i = 0; i < 64; ++i) {
+            const C c = s[i];
+            const int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (v < 0) return false;
+            out.b[i / 2] = (uint8_t)(i % 2 ? (out.b[i / 2] << 4) | v : v);
+        }
+        return true;
+    }
+} // anon
+
+namespace sha {
+    void Sha256::Reset() {
+        static const uint32_t kInit[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+        std::memcpy(h_, kInit, sizeof(h_));
+        used_ = 0;
+        total_ = 0;
+    }
+
+    void Sha256::Update(const void* data, size_t n) {
+        const uint8_t* p = (const uint8_t*)data;
+        total_ += n;
+        if (used_) {
+            const size_t take = n < 64 - used_ ? n : 64 - used_;
+            std::memcpy(buf_ + used_, p, take);
+            used_ += take; p += take; n -= take;
+            if (used_ < 64) return;
+            g_blocks(h_, buf_, 1);
+            used_ = 0;
+        }
+        if (n >= 64) {
+            g_blocks(h_, p, n / 64);
+            p += n / 64 * 64;
+            n %= 64;
+        }
+        if (n) { std::memcpy(buf_, p, n); used_ = n; }
+    }
+
+    Digest Sha256::Final() {
+        const uint64_t bits = total_ * 8;
+        buf_[used_++] = 0x80;
+        if (used_ > 56) {
+            std::memset(buf_ + used_, 0, 64 - used_);
+            g_blocks(h_, buf_, 1);
+            used_ = 0;
+        }
+        std::memset(buf_ + used_, 0, 56 - used_);
+        for (int i = 0; i < 8; ++i) buf_[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+        g_blocks(h_, buf_, 1);
+        Digest d;
+        for (int i = 0; i < 8; ++i) {
+            d.b[4 * i] = (uint8_t)(h_[i] >> 24); d.b[4 * i + 1] = (uint8_t)(h_[i] >> 16);
+            d.b[4 * i + 2] = (uint8_t)(h_[i] >> 8); d.b[4 * i + 3] = (uint8_t)h_[i];
+        }
+        return d;
+    }
+
+    Digest Hash(const void* data, size_t n) {
+        Sha256 s;
+        s.Update(data, n);
+        return s.Final();
+    }
+
+    bool HashFile(const std::wstring& path, Digest& out, uint64_t* size) {
+        FILE* f = util::open_file(path, "rb");
+        if (!f) return false;
+        setvbuf(f, nullptr, _IONBF, 0);   // blocks go straight into buf
+        thread_local std::vector<uint8_t> buf(1u << 20);
+        Sha256 s;
+        uint64_t total = 0;
+        size_t got;
+        while ((got = fread(buf.data(), 1, buf.size(), f)) > 0) { s.Update(buf.data(), got); total += got; }
+        const bool ok = !ferror(f);
+        fclose(f);
+        if (!ok) return false;
+        if (size) *size = total;
+        out = s.Final();
+        return true;
+    }
+
+    std::wstring ToHex(const Digest& d) {
+        static const wchar_t kHex[] = L"0123456789abcdef";
+        std::wstring s(64, L'0');
+        for (size_t i = 0; i < 32; ++i) { s[2 * i] = kHex[d.b[i] >> 4]; s[2 * i + 1] = kHex[d.b[i] & 15]; }
+        return s;
+    }
+
+    bool FromHex(std::string_view hex, Digest& out) { return from_hex(hex, out); }
+    bool FromHex(std::wstring_view hex, Digest& out) { return from_hex(hex, out); }
+
+    const char* Kernel() {
+#if PROCHUNT_SHA_NI
+        if (g_blocks == blocks_shani) return "sha-ni";
+#endif
+        return "portable";
+    }
+
+    void UsePortable(bool portable) {
+        g_blocks = portable ? blocks_portable : pick();
+    }
+} // namespace sha
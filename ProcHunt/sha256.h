@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// SHA-256 for image hashes (--ioc-hashes). Blocks go through the x86 SHA extensions when
+// the CPU has them (checked once at startup), else through a portable implementation.
+namespace sha {
+    struct Digest {
+        uint8_t b[32] = {};
+        bool operator==(const Digest& o) const { return std::memcmp(b, o.b, 32) == 0; }
+        bool operator!=(const Digest& o) const { return !(*this == o); }
+        bool operator<(const Digest& o) const { return std::memcmp(b, o.b, 32) < 0; }
+    };
+
+    class Sha256 {
+    public:
+        Sha256() { Reset(); }
+        void Reset();
+        void Update(const void* data, size_t n);
+        Digest Final();   // the object must be Reset() before it is used again
+
+    private:
+        uint32_t h_[8];
+        uint8_t buf_[64];
+        size_t used_ = 0;
+        uint64_t total_ = 0;
+    };
+
+    Digest Hash(const void* data, size_t n);
+
+    // Streams the file in 1 MB blocks. size (optional) gets the number of bytes hashed.
+    bool HashFile(const std::wstring& path, Digest& out, uint64_t* size = nullptr);
+
+    std::wstring ToHex(const Digest& d);                 // 64 lowercase digits
+    bool FromHex(std::string_view hex, Digest& out);     // exactly 64 digits, either case
+    bool FromHex(std::wstring_view hex, Digest& out);
+
+    const char* Kernel();              // "sha-ni" or "portable"
+    void UsePortable(bool portable);   // force the portable kernel (benchmarks); not while hashing
+} // namespace sha
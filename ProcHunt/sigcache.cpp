@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: MIT
+#include "sigcache.h"
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "utils.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+    const char kMagic[8] = { 'P', 'H', 'S', 'I', 'G', 'C', '0', '1' };
+
+    void put_u64(std::vector<uint8_t>& b, uint64_t v) { for (int i = 0; i < 8; ++i) b.push_back((uint8_t)(v >> (8 * i))); }
+    void put_u32(std::vector<uint8_t>& b, uint32_t v) { for (int i = 0; i < 4; ++i) b.push_back((uint8_t)(v >> (8 * i))); }
+    void put_str(std::vector<uint8_t>& b, std::wstring_view s) {
+        auto u = util::to_u16(s);
+        put_u32(b, (uint32_t)u.size());
+        for (char16_t c : u) { b.push_back((uint8_t)c); b.push_back((uint8_t)(c >> 8)); }
+    }
+
+    struct Cursor {
+        const uint8_t* p; const uint8_t* end;
+        bool u64(uint64_t& v) {
+            if (end - p < 8) return false;
+            v = 0; for (int i = 0; i < 8; ++i) v |= (uint64_t)p[i] << (8 * i);
+            p += 8; return true;
+        }
+        bool u32(uint32_t& v) {
+            if (end - p < 4) return false;
+            v = 0; for (int i = 0; i < 4; ++i) v |= (uint32_t)p[i] << (8 * i);
+            p += 4; return true;
+        }
+        bool str(std::wstring& s) {
+            uint32_t n = 0;
+            if (!u32(n) || (uint64_t)(end - p) < (uint64_t)n * 2) return false;
+            std::u16string u(n, u'\0');
+            for (uint32_t i = 0; i < n; ++i) u[i] = (char16_t)(p[2 * i] | (p[2 * i + 1] << 8));
+            p += (size_t)n * 2;
+            s = util::from_u16(u);
+            return true;
+        }
+    };
+} // anon
+
+namespace sig {
+
+    bool QueryFileId(const std::wstring& path, FileId& out) {
+#if defined(_WIN32)
+        HANDLE h = CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+        if (h == INVALID_HANDLE_VALUE) return false;
+        BY_HANDLE_FILE_INFORMATION fi{};
+        BOOL ok = GetFileInformationByHandle(h, &fi);
+        CloseHandle(h);
+        if (!ok) return false;
+        out.size = ((uint64_t)fi.nFileSizeHigh << 32) | fi.nFileSizeLow;
+        out.lastWrite = ((uint64_t)fi.ftLastWriteTime.dwHighDateTime << 32) | fi.ftLastWriteTime.dwLowDateTime;
+        out.volume = fi.dwVolumeSerialNumber;
+        out.fileIndex = ((uint64_t)fi.nFileIndexHigh << 32) | fi.nFileIndexLow;
+        return true;
+#else
+        struct stat st {};
+        if (stat(util::to_utf8(path).c_str(), &st) != 0) return false;
+        out.size = (uint64_t)st.st_size;
+        out.lastWrite = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+        out.volume = (uint64_t)st.st_dev;
+        out.fileIndex = (uint64_t)st.st_ino;
+        return true;
+#endif
+    }
+
+    std::wstring NormalizePath(std::wstring_view path) {
+        if (path.rfind(L"\\\\?\\", 0) == 0 || path.rfind(L"\\??\\", 0) == 0) path.remove_prefix(4);
+        std::wstring o = util::lcase(path);
+        for (auto& c : o) if (c == L'/') c = L'\\';
+        return o;
+    }
+
+    Cache::Cache(scan::ISignatureVerifier& inner, IdFn id, ClockFn clock)
+        : inner_(inner), id_(std::move(id)), clock_(std::move(clock)) {
+        if (!clock_) clock_ = [] { return (uint64_t)time(nullptr); };
+    }
+
+    SignInfo Cache::Verify(const std::wstring& path) {
+        FileId id;
+        if (!id_(path, id)) { ++uncached_; return inner_.Verify(path); }
+
+        const std::wstring key = NormalizePath(path);
+        std::promise<SignInfo> prom;
+        std::shared_future<SignInfo> fut;
+        uint64_t seq = 0;
+        {
+            const uint64_t now = clock_();
+            std::lock_guard<std::mutex> lk(m_);
+            auto it = map_.find(key);
+            // An entry still being verified is fresh whatever its age.
+            bool fresh = it != map_.end() && it->second.id == id;
+            if (fresh && it->second.verifiedAt + maxAge_ < now)
+                fresh = it->second.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+            if (fresh) {
+                fut = it->second.result;
+                if (fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready) ++coalesced_;
+                ++hits_;
+            }
+            else {
+                if (it != map_.end()) ++stale_;
+                Entry e;
+                e.id = id;
+                e.verifiedAt = now;
+                e.seq = seq = ++seq_;
+                e.result = prom.get_future().share();
+                fut = e.result;
+                map_[key] = std::move(e);
+                ++misses_;
+            }
+        }
+        if (seq) {
+            try {
+                prom.set_value(inner_.Verify(path));
+            }
+            catch (...) {
+                prom.set_exception(std::current_exception());
+                // Only drop our own entry; another call may have replaced it meanwhile.
+                std::lock_guard<std::mutex> lk(m_);
+                auto it = map_.find(key);
+                if (it != map_.end() && it->second.seq == seq) map_.erase(it);
+            }
+        }
+        return fut.get();
+    }
+
+    bool Cache::Load(const std::wstring& file, uint64_t maxAgeSeconds) {
+        FILE* f = util::open_file(file, "rb");
+        if (!f) return false;
+        std::vector<uint8_t> buf;
+        uint8_t chunk[65536];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) buf.insert(buf.end(), chunk, chunk + n);
+        fclose(f);
+
+        Cursor c{ buf.data(), buf.data() + buf.size() };
+        uint32_t version = 0, count = 0;
+        if (buf.size() < sizeof(kMagic) || std::memcmp(buf.data(), kMagic, sizeof(kMagic)) != 0) return false;
+        c.p += sizeof(kMagic);
+        if (!c.u32(version) || version != 1 || !c.u32(count)) return false;
+
+        const uint64_t now = clock_();
+        std::lock_guard<std::mutex> lk(m_);
+        maxAge_ = maxAgeSeconds;
+        for (uint32_t i = 0; i < count; ++i) {
+            Entry e;
+            uint32_t trusted = 0;
+            std::wstring key;
+            SignInfo si;
+            if (!c.u64(e.id.size) || !c.u64(e.id.lastWrite) || !c.u64(e.id.volume) || !c.u64(e.id.fileIndex)
+                || !c.u64(e.verifiedAt) || !c.u32(trusted)
+                || !c.str(key) || !c.str(si.trustStatus) || !c.str(si.publisher) || !c.str(si.thumbprint))
+                return false;   // truncated: keep what was read so far
+            if (e.verifiedAt + maxAgeSeconds < now || key.empty()) continue;
+            si.trusted = trusted != 0;
+            std::promise<SignInfo> p;
+            p.set_value(std::move(si));
+            e.result = p.get_future().share();
+            map_[key] = std::move(e);
+            ++loaded_;
+        }
+        return true;
+    }
+
+    bool Cache::Save(const std::wstring& file) const {
+        std::vector<uint8_t> buf(kMagic, kMagic + sizeof(kMagic));
+        put_u32(buf, 1);
+        const size_t countPos = buf.size();
+        put_u32(buf, 0);
+        uint32_t count = 0;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            for (auto& kv : map_) {
+                const Entry& e = kv.second;
+                if (e.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+                const SignInfo& si = e.result.get();
+                put_u64(buf, e.id.size); put_u64(buf, e.id.lastWrite); put_u64(buf, e.id.volume); put_u64(buf, e.id.fileIndex);
+                put_u64(buf, e.verifiedAt);
+                put_u32(buf, si.trusted ? 1 : 0);
+                put_str(buf, kv.first); put_str(buf, si.trustStatus); put_str(buf, si.publisher); put_str(buf, si.thumbprint);
+                ++count;
+            }
+        }
+        for (int i = 0; i < 4; ++i) buf[countPos + i] = (uint8_t)(count >> (8 * i));
+
+        const std::wstring tmp = file + L".tmp";
+        FILE* f = util::open_file(tmp, "wb");
+        if (!f) return false;
+        bool ok = fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+        ok = (fclose(f) == 0) && ok;
+        return ok && util::replace_file(tmp, file);
+    }
+
+    CacheStats Cache::Stats() const {
+        CacheStats s;
+        s.hits = hits_; s.misses = misses_; s.coalesced = coalesced_;
+        s.stale = stale_; s.uncached = uncached_;
+        std::lock_guard<std::mutex> lk(m_);
+        s.loaded = loaded_;
+        return s;
+    }
+
+    size_t Cache::Size() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return map_.size();
+    }
+} // namespace sig
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "codesign.h"
+#include "pipeline.h"
+
+// Signature verification cache (--sig-cache <file>).
+// Keyed by normalized image path; an entry is only reused while the file identity
+// (size, last write, volume/file id) is unchanged. Concurrent lookups of the same
+// image wait for a single verification. Entries persist between runs.
+namespace sig {
+    struct FileId {
+        uint64_t size = 0;
+        uint64_t lastWrite = 0;   // FILETIME / ns since epoch, only compared for equality
+        uint64_t volume = 0;
+        uint64_t fileIndex = 0;
+        bool operator==(const FileId& o) const {
+            return size == o.size && lastWrite == o.lastWrite && volume == o.volume && fileIndex == o.fileIndex;
+        }
+        bool operator!=(const FileId& o) const { return !(*this == o); }
+    };
+
+    // GetFileInformationByHandle on Windows, stat() elsewhere.
+    bool QueryFileId(const std::wstring& path, FileId& out);
+
+    // Lowercase, '/' -> '\', strips a leading \\?\ or \??\ prefix.
+    std::wstring NormalizePath(std::wstring_view path);
+
+    struct CacheStats {
+        uint64_t hits = 0;        // answered from the cache (memory or persisted)
+        uint64_t misses = 0;      // verified by the inner verifier
+        uint64_t coalesced = 0;   // waited on a verification already in flight (also counted as hits)
+        uint64_t stale = 0;       // cached entry dropped because the file changed or the verdict expired
+        uint64_t uncached = 0;    // file identity unavailable; verified without caching
+        uint64_t loaded = 0;      // entries read from the cache file
+    };
+
+    class Cache : public scan::ISignatureVerifier {
+    public:
+        using IdFn = std::function<bool(const std::wstring&, FileId&)>;
+        using ClockFn = std::function<uint64_t()>;   // seconds since 1970
+
+        static constexpr uint64_t kMaxAge = 7 * 24 * 3600;
+
+        explicit Cache(scan::ISignatureVerifier& inner, IdFn id = QueryFileId, ClockFn clock = nullptr);
+
+        // A verdict older than the maximum age is verified again (revocation may have changed),
+        // so a resident process (--watch, --serve) does not keep one forever.
+        SignInfo Verify(const std::wstring& path) override;
+
+        // Entries verified more than maxAgeSeconds ago are not loaded; it also becomes the
+        // maximum age of entries in memory.
+        bool Load(const std::wstring& file, uint64_t maxAgeSeconds = kMaxAge);
+        bool Save(const std::wstring& file) const;   // write-to-temp + rename
+
+        CacheStats Stats() const;
+        size_t Size() const;
+
+    private:
+        struct Entry {
+            FileId id;
+            uint64_t verifiedAt = 0;
+            uint64_t seq = 0;   // which Verify call created the entry (0 = loaded)
+            std::shared_future<SignInfo> result;
+        };
+
+        scan::ISignatureVerifier& inner_;
+        IdFn id_;
+        ClockFn clock_;
+        mutable std::mutex m_;
+        std::unordered_map<std::wstring, Entry> map_;
+        uint64_t maxAge_ = kMaxAge, seq_ = 0;
+        std::atomic<uint64_t> hits_{ 0 }, misses_{ 0 }, coalesced_{ 0 }, stale_{ 0 }, uncached_{ 0 };
+        uint64_t loaded_ = 0;
+    };
+} // namespace sig
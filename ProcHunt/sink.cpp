@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: MIT
+#include "sink.h"
+#include <cerrno>
+#include <cstring>
+#include "utils.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace sink {
+    FileTarget::~FileTarget() { Close(); }
+
+    bool FileTarget::Open(const std::wstring& path, uint64_t rotateBytes, uint64_t rotateRecords, unsigned keep, std::wstring* err) {
+        Close();
+        f_ = util::open_file(path, "wb");
+        if (!f_) {
+            if (err) *err = L"cannot open output file";
+            f_ = stdout;
+            return false;
+        }
+        path_ = path;
+        rotateBytes_ = rotateBytes;
+        rotateRecords_ = rotateRecords;
+        keep_ = keep;
+        size_ = records_ = 0;
+        return true;
+    }
+
+    bool FileTarget::Write(const char* data, size_t n) {
+        bool ok = true;
+        for (;;) {
+            // Whole lines up to the limits, then the next file.
+            size_t cut = n;
+            bool full = false;
+            if (rotateBytes_ && size_ + n > rotateBytes_) {
+                const size_t room = size_ < rotateBytes_ ? (size_t)(rotateBytes_ - size_) : 0;
+                cut = room < n ? room : n;
+                while (cut && data[cut - 1] != '\n') --cut;
+                if (!cut && !size_) {   // a line longer than the limit gets a file of its own
+                    const char* nl = (const char*)memchr(data, '\n', n);
+                    cut = nl ? (size_t)(nl - data) + 1 : n;
+                }
+                full = true;
+            }
+            if (rotateRecords_) {
+                size_t end = 0;
+                while (records_ < rotateRecords_) {
+                    const char* nl = (const char*)memchr(data + end, '\n', cut - end);
+                    if (!nl) break;
+                    end = (size_t)(nl - data) + 1;
+                    ++records_;
+                }
+                if (records_ == rotateRecords_) { cut = end; full = true; }
+            }
+            if (cut) { ok = Put(data, cut) && ok; data += cut; n -= cut; }
+            if (!full || !n) return ok;
+            if (!Rotate()) return false;
+        }
+    }
+
+    bool FileTarget::Put(const char* data, size_t n) {
+        if (!f_) return false;
+        const size_t put = fwrite(data, 1, n, f_);
+        size_ += put;
+        return put == n;
+    }
+
+    bool FileTarget::Flush() {
+        return f_ && fflush(f_) == 0;
+    }
+
+    bool FileTarget::Sync() {
+        if (!Flush()) return false;
+        if (f_ == stdout) return true;   // a console or pipe has no device to sync
+#if defined(_WIN32)
+        return _commit(_fileno(f_)) == 0;
+#else
+        return fsync(fileno(f_)) == 0 || errno == EINVAL;   // EINVAL: a device such as /dev/null
+#endif
+    }
+
+    bool FileTarget::Close() {
+        if (!f_) { f_ = stdout; return false; }
+        if (f_ == stdout) return Flush();
+        const bool ok = Sync();
+        const bool closed = fclose(f_) == 0;
+        f_ = stdout;
+        path_.clear();
+        rotateBytes_ = rotateRecords_ = 0;
+        return ok && closed;
+    }
+
+    bool FileTarget::Rotate() {
+        bool ok = Sync();
+        fclose(f_);
+        auto name = [&](unsigned k) { return path_ + L"." + std::to_wstring(k); };
+        // keep == 0: the filled file is truncated, nothing is kept.
+        if (keep_) {
+            for (unsigned k = keep_ - 1; k >= 1; --k) util::replace_file(name(k), name(k + 1));   // gaps are fine
+            ok = util::replace_file(path_, name(1)) && ok;
+        }
+        f_ = util::open_file(path_, "wb");
+        size_ = records_ = 0;
+        ++rotations_;
+        return ok && f_;
+    }
+
+    Async::Async(std::unique_ptr<Target> target, Options opt)
+        : target_(std::move(target)), cap_(opt.bufferBytes < 4096 ? 4096 : opt.bufferBytes),
+        slots_(opt.buffers < 2 ? 2 : opt.buffers) {
+        for (Slot& s : slots_) s.data.reserve(cap_);
+        cur_.reserve(cap_);
+        writer_ = std::thread([this] { Writer(); });
+    }
+
+    void Async::Write(const char* data, size_t n) {
+        if (closed_ || !n) return;
+        if (!cur_.empty() && cur_.size() + n > cap_) Handoff(0);
+        cur_.append(data, n);
+        if (cur_.size() >= cap_) Handoff(0);
+    }
+
+    void Async::Flush() {
+        if (closed_ || (cur_.empty() && !dirty_)) return;
+        Handoff(OP_FLUSH);
+    }
+
+    bool Async::Sync() {
+        if (closed_) return errors_ == 0;
+        WaitTail(Handoff(OP_FLUSH | OP_SYNC));
+        return syncOk_;
+    }
+
+    bool Async::Close() {
+        if (closed_) return errors_ == 0;
+        Sync();
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        writer_.join();
+        if (!target_->Close()) ++errors_;
+        closed_ = true;
+        return errors_ == 0;
+    }
+
+    Stats Async::GetStats() const {
+        Stats s;
+        s.bytes = bytes_; s.handoffs = handoffs_; s.waits = waits_; s.errors = errors_;
+        return s;
+    }
+
+    // Returns the sequence number the writer has to reach for this slot to be done.
+    uint64_t Async::Handoff(uint8_t op) {
+        const uint64_t h = head_.load(std::memory_order_relaxed);
+        if (h - tail_.load(std::memory_order_acquire) >= slots_.size()) {
+            ++waits_;
+            WaitTail(h + 1 - slots_.size());
+        }
+        Slot& s = slots_[h % slots_.size()];
+        s.data.swap(cur_);   // cur_ gets the buffer the writer emptied
+        s.op = op;
+        dirty_ = !(op & OP_FLUSH);
+        ++handoffs_;
+        head_.store(h + 1);
+        // head_ is stored before writerParked_ is read, and the writer sets writerParked_
+        // before reading head_ (both seq_cst): one of them sees the other.
+        if (writerParked_) { std::lock_guard<std::mutex> lk(m_); cv_.notify_all(); }
+        return h + 1;
+    }
+
+    void Async::WaitTail(uint64_t want) {
+        if (tail_.load(std::memory_order_acquire) >= want) return;
+        std::unique_lock<std::mutex> lk(m_);
+        producerParked_ = true;
+        cv_.wait(lk, [&] { return tail_.load() >= want; });
+        producerParked_ = false;
+    }
+
+    void Async::Writer() {
+        uint64_t t = 0;
+        for (;;) {
+            if (head_.load(std::memory_order_acquire) == t) {
+                std::unique_lock<std::mutex> lk(m_);
+                writerParked_ = true;
+                cv_.wait(lk, [&] { return head_.load() != t || stop_; });
+                writerParked_ = false;
+                if (head_.load() == t) return;   // stopped and drained
+                continue;
+            }
+            Slot& s = slots_[t % slots_.size()];
+            if (!s.data.empty()) {
+                if (target_->Write(s.data.data(), s.data.size())) bytes_ += s.data.size();
+                else ++errors_;
+            }
+            if (s.op & OP_SYNC) {
+                const bool ok = target_->Sync();
+                if (!ok) ++errors_;
+                syncOk_ = ok && errors_ == 0;
+            }
+            else if ((s.op & OP_FLUSH) && !target_->Flush()) ++errors_;
+            s.data.clear();
+            tail_.store(++t);
+            if (producerParked_) { std::lock_guard<std::mutex> lk(m_); cv_.notify_all(); }
+        }
+    }
+} // namespace sink
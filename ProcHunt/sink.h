@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous output (output.cpp). The scanning thread appends to a buffer and hands full
+// buffers to a writer thread through a fixed ring of slots (one producer, one consumer,
+// lock-free while neither side has to wait); the emptied buffers come back the same way,
+// so steady-state output allocates nothing. A slow disk or a console pipe that is not
+// being read stalls the scan only once every slot is queued.
+namespace sink {
+    // Where the writer thread puts the bytes. Only the writer thread calls it.
+    class Target {
+    public:
+        virtual ~Target() = default;
+        virtual bool Write(const char* data, size_t n) = 0;
+        virtual bool Flush() { return true; }      // to the OS (visible to readers)
+        virtual bool Sync() { return Flush(); }    // to the device
+        virtual bool Close() { return Sync(); }
+    };
+
+    // stdout, or a file that can be rotated by size or line count, for line-oriented output
+    // (NDJSON): when the next line would take it past rotateBytes, or it holds rotateRecords
+    // lines, the file is synced and closed, path.N-1 .. path.1 are renamed to path.N ..
+    // path.2 (path.N is replaced), path is renamed to path.1 and a new path is opened. Each
+    // rename is atomic; every file ends with a whole line and stays under the limits unless a
+    // single line is longer.
+    class FileTarget : public Target {
+    public:
+        FileTarget() = default;                      // stdout
+        ~FileTarget() override;
+        bool Open(const std::wstring& path, uint64_t rotateBytes = 0, uint64_t rotateRecords = 0, unsigned keep = 5,
+            std::wstring* err = nullptr);
+
+        bool Write(const char* data, size_t n) override;
+        bool Flush() override;
+        bool Sync() override;
+        bool Close() override;
+        uint64_t Rotations() const { return rotations_; }
+
+    private:
+        bool Rotate();
+        bool Put(const char* data, size_t n);
+
+        FILE* f_ = stdout;
+        std::wstring path_;
+        uint64_t rotateBytes_ = 0, size_ = 0, rotations_ = 0;
+        uint64_t rotateRecords_ = 0, records_ = 0;   // records_: lines ended in the current file
+        unsigned keep_ = 0;
+    };
+
+    struct Options {
+        size_t bufferBytes = 256 * 1024;   // hand-off size; a larger single write gets a buffer of its own
+        unsigned buffers = 8;              // ring slots; the producer waits when all are queued
+    };
+
+    struct Stats {
+        uint64_t bytes = 0;       // written to the target
+        uint64_t handoffs = 0;    // buffers queued
+        uint64_t waits = 0;       // times the producer found every slot queued
+        uint64_t errors = 0;      // target writes, flushes or syncs that failed
+    };
+
+    class Async {
+    public:
+        explicit Async(std::unique_ptr<Target> target, Options opt = {});
+        ~Async() { Close(); }
+
+        // Producer side: one thread at a time. Bytes of one Write() call are never split
+        // across buffers unless the call is larger than a buffer.
+        void Write(const char* data, size_t n);
+        void Flush();   // queue the current buffer; the writer flushes the target after it
+        bool Sync();    // Flush, then wait until everything queued is on the device
+        bool Close();   // Sync, stop the writer, close the target; false if any write failed
+        Stats GetStats() const;
+
+    private:
+        enum : uint8_t { OP_FLUSH = 1, OP_SYNC = 2 };
+        struct Slot {
+            std::string data;
+            uint8_t op = 0;
+        };
+
+        uint64_t Handoff(uint8_t op);
+        void WaitTail(uint64_t want);
+        void Writer();
+
+        std::unique_ptr<Target> target_;
+        size_t cap_;
+        std::vector<Slot> slots_;
+        std::string cur_;
+        bool dirty_ = false;          // data queued since the last flush request
+        bool closed_ = false;
+
+        alignas(64) std::atomic<uint64_t> head_{ 0 };   // slots queued (producer)
+        alignas(64) std::atomic<uint64_t> tail_{ 0 };   // slots written (writer)
+        std::atomic<bool> writerParked_{ false }, producerParked_{ false }, stop_{ false };
+        std::atomic<bool> syncOk_{ true };
+        std::mutex m_;                // only for parking
+        std::condition_variable cv_;
+        std::atomic<uint64_t> bytes_{ 0 }, handoffs_{ 0 }, waits_{ 0 }, errors_{ 0 };
+        std::thread writer_;
+    };
+} // namespace sink
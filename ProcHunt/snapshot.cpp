@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: MIT
+#include "snapshot.h"
+#include <cstring>
+#include "utils.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char kMagic[8] = { 'P', 'H', 'S', 'N', 'A', 'P', '0', '1' };
+} // anon
+
+namespace snap {
+
+    void Table::Add(uint32_t pid, uint32_t ppid, uint64_t createTime, const ProcParams& pp, const SignView& sig) {
+        Row r{};
+        r.pid = pid; r.ppid = ppid; r.createTime = createTime;
+        r.flags = sig.trusted ? (uint32_t)REC_SIG_TRUSTED : 0u;
+        r.s[S_NAME] = pool_.Add(pp.name);
+        r.s[S_IMAGE] = pool_.Add(pp.imagePath);
+        r.s[S_CMD] = pool_.Add(pp.commandLine);
+        r.s[S_CWD] = pool_.Add(pp.currentDirectory);
+        r.s[S_WTITLE] = pool_.Add(pp.windowTitle);
+        r.s[S_DESK] = pool_.Add(pp.desktopInfo);
+        r.s[S_SHELL] = pool_.Add(pp.shellInfo);
+        r.s[S_RTD] = pool_.Add(pp.runtimeData);
+        r.s[S_STATUS] = pool_.Add(sig.trustStatus);
+        r.s[S_PUBLISHER] = pool_.Add(sig.publisher);
+        r.s[S_THUMBPRINT] = pool_.Add(sig.thumbprint);
+        rows_.push_back(r);
+    }
+
+    void Table::AddUnreadable(uint32_t pid, uint32_t ppid, uint64_t createTime, std::wstring_view name) {
+        Row r{};
+        r.pid = pid; r.ppid = ppid; r.createTime = createTime;
+        r.flags = REC_UNREADABLE;
+        r.s[S_NAME] = pool_.Add(name);
+        rows_.push_back(r);
+    }
+
+    void Table::Reserve(size_t processes) {
+        rows_.reserve(processes);
+        pool_.Reserve(processes * 4, processes * 64);
+    }
+
+    void Table::Clear() {
+        rows_.clear(); pool_.Clear(); scratch_.clear();
+    }
+
+    size_t Table::MemoryBytes() const {
+        return rows_.capacity() * sizeof(Row) + pool_.MemoryBytes() + scratch_.capacity() * sizeof(wchar_t);
+    }
+
+    std::wstring_view Table::View(intern::Handle h, wchar_t*& scratch) const {
+        const std::u16string_view u = pool_.Get(h);
+        if (sizeof(wchar_t) == sizeof(char16_t)) return std::wstring_view((const wchar_t*)u.data(), u.size());
+        wchar_t* const start = scratch;
+        // Surrogates are rare; without any the copy is a plain widening loop.
+        unsigned surrogates = 0;
+        for (char16_t c : u) surrogates |= (c & 0xF800) == 0xD800;
+        if (!surrogates) {
+            for (size_t i = 0; i < u.size(); ++i) scratch[i] = (wchar_t)u[i];
+            scratch += u.size();
+            return std::wstring_view(start, u.size());
+        }
+        for (size_t i = 0; i < u.size(); ++i) {
+            uint32_t c = u[i];
+            if ((c & 0xFC00) == 0xD800 && i + 1 < u.size() && (u[i + 1] & 0xFC00) == 0xDC00)
+                c = 0x10000 + ((c - 0xD800) << 10) + (u[++i] - 0xDC00);
+            *scratch++ = (wchar_t)c;
+        }
+        return std::wstring_view(start, (size_t)(scratch - start));
+    }
+
+    void Table::Get(size_t i, ProcView& out) const {
+        const Row& r = rows_[i];
+        wchar_t* scratch = nullptr;
+        if (sizeof(wchar_t) != sizeof(char16_t)) {
+            size_t units = 0;
+            for (intern::Handle h : r.s) units += pool_.Ref(h).len;
+            if (scratch_.size() < units) scratch_.resize(units);
+            scratch = &scratch_[0];
+        }
+        out.pid = r.pid; out.ppid = r.ppid; out.createTime = r.createTime;
+        out.readable = !(r.flags & REC_UNREADABLE);
+        out.name = View(r.s[S_NAME], scratch);
+        out.imagePath = View(r.s[S_IMAGE], scratch);
+        out.commandLine = View(r.s[S_CMD], scratch);
+        out.currentDirectory = View(r.s[S_CWD], scratch);
+        out.windowTitle = View(r.s[S_WTITLE], scratch);
+        out.desktopInfo = View(r.s[S_DESK], scratch);
+        out.shellInfo = View(r.s[S_SHELL], scratch);
+        out.runtimeData = View(r.s[S_RTD], scratch);
+        out.sig.trusted = (r.flags & REC_SIG_TRUSTED) != 0;
+        out.sig.trustStatus = View(r.s[S_STATUS], scratch);
+        out.sig.publisher = View(r.s[S_PUBLISHER], scratch);
+        out.sig.thumbprint = View(r.s[S_THUMBPRINT], scratch);
+    }
+
+    Record Table::Raw(size_t i) const {
+        const Row& r = rows_[i];
+        auto ref = [&](int k) { const intern::Span sp = pool_.Ref(r.s[k]); return StrRef{ sp.off, sp.len }; };
+        Record out{};
+        out.pid = r.pid; out.ppid = r.ppid; out.flags = r.flags; out.createTime = r.createTime;
+        out.name = ref(S_NAME); out.imagePath = ref(S_IMAGE); out.commandLine = ref(S_CMD); out.currentDirectory = ref(S_CWD);
+        out.windowTitle = ref(S_WTITLE); out.desktopInfo = ref(S_DESK); out.shellInfo = ref(S_SHELL); out.runtimeData = ref(S_RTD);
+        out.trustStatus = ref(S_STATUS); out.publisher = ref(S_PUBLISHER); out.thumbprint = ref(S_THUMBPRINT);
+        return out;
+    }
+
+    bool Writer::Open(const std::wstring& path) {
+        Close();
+        f_ = util::open_file(path, "wb");
+        hdr_ = Header{};
+        host_ = 0;
+        table_.Clear();
+        return f_ != nullptr;
+    }
+
+    void Writer::SetOrigin(std::wstring_view host, uint64_t timestamp) {
+        host_ = table_.Strings().Add(host);
+        hdr_.timestamp = timestamp;
+    }
+
+    void Writer::Add(uint32_t pid, uint32_t ppid, uint64_t createTime, const ProcParams& pp, const SignInfo& sig) {
+        table_.Add(pid, ppid, createTime, pp, sig);
+    }
+
+    void Writer::AddUnreadable(uint32_t pid, uint32_t ppid, uint64_t createTime, std::wstring_view name) {
+        table_.AddUnreadable(pid, ppid, createTime, name);
+    }
+
+    bool Writer::Close() {
+        if (!f_) return false;
+        const std::u16string& arena = table_.Strings().Arena();
+        const size_t count = table_.Count();
+        std::memcpy(hdr_.magic, kMagic, sizeof(kMagic));
+        hdr_.version = kVersion;
+        hdr_.recordSize = sizeof(Record);
+        hdr_.count = (uint32_t)count;
+        hdr_.arenaOffset = sizeof(Header) + (uint64_t)count * sizeof(Record);
+        hdr_.arenaUnits = arena.size();
+        const intern::Span host = table_.Strings().Ref(host_);
+        hdr_.host = StrRef{ host.off, host.len };
+        bool ok = fwrite(&hdr_, sizeof(hdr_), 1, f_) == 1;
+        // File records are built a few at a time; the table stays the only full copy.
+        Record buf[128];
+        for (size_t i = 0; ok && i < count;) {
+            size_t n = 0;
+            for (; n < 128 && i < count; ++n, ++i) buf[n] = table_.Raw(i);
+            ok = fwrite(buf, sizeof(Record), n, f_) == n;
+        }
+        if (ok && !arena.empty()) ok = fwrite(arena.data(), sizeof(char16_t), arena.size(), f_) == arena.size();
+        ok = (fclose(f_) == 0) && ok;
+        f_ = nullptr;
+        table_.Clear();
+        return ok;
+    }
+
+    bool Reader::Open(const std::wstring& path, std::wstring* err) {
+        Close();
+        auto fail = [&](const wchar_t* why) { if (err) *err = why; Close(); return false; };
+#if defined(_WIN32)
+        HANDLE f = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (f == INVALID_HANDLE_VALUE) return fail(L"cannot open file");
+        file_ = f;
+        LARGE_INTEGER sz{};
+        if (!GetFileSizeEx(f, &sz) || sz.QuadPart < (LONGLONG)sizeof(Header)) return fail(L"file too small");
+        size_ = (size_t)sz.QuadPart;
+        mapping_ = CreateFileMappingW(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return fail(L"cannot map file");
+        base_ = (const uint8_t*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!base_) return fail(L"cannot map file");
+#else
+        int fd = open(util::to_utf8(path).c_str(), O_RDONLY);
+        if (fd < 0) return fail(L"cannot open file");
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) { close(fd); return fail(L"file too small"); }
+        size_ = (size_t)st.st_size;
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) { size_ = 0; return fail(L"cannot map file"); }
+        base_ = (const uint8_t*)p;
+#endif
+        hdr_ = (const Header*)base_;
+        if (std::memcmp(hdr_->magic, kMagic, sizeof(kMagic)) != 0) return fail(L"not a ProcHunt snapshot");
+        if (!(hdr_->version == kVersion && hdr_->recordSize == sizeof(Record))
+            && !(hdr_->version == 1 && hdr_->recordSize == kRecordSizeV1)) return fail(L"unsupported snapshot version");
+        recSize_ = hdr_->recordSize;
+        const uint64_t tableEnd = sizeof(Header) + (uint64_t)hdr_->count * recSize_;
+        if (tableEnd > hdr_->arenaOffset || (hdr_->arenaOffset & 1)
+            || hdr_->arenaOffset > size_ || hdr_->arenaUnits > (size_ - hdr_->arenaOffset) / sizeof(char16_t))
+            return fail(L"truncated or corrupt snapshot");
+
+        recs_ = base_ + sizeof(Header);
+        count_ = hdr_->count;
+        arenaUnits_ = hdr_->arenaUnits;
+        const char16_t* u16 = (const char16_t*)(base_ + hdr_->arenaOffset);
+        if (sizeof(wchar_t) == sizeof(char16_t)) {
+            arena_ = (const wchar_t*)u16;
+        }
+        else {
+            // Code units are widened 1:1 so arena offsets stay valid; surrogate pairs
+            // are recombined by util::to_utf8 on output.
+            widened_.assign(u16, u16 + arenaUnits_);
+            arena_ = widened_.data();
+        }
+        return true;
+    }
+
+    void Reader::Close() {
+#if defined(_WIN32)
+        if (base_) UnmapViewOfFile(base_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_) CloseHandle(file_);
+        mapping_ = nullptr; file_ = nullptr;
+#else
+        if (base_) munmap((void*)base_, size_);
+#endif
+        base_ = nullptr; size_ = 0; hdr_ = nullptr; recs_ = nullptr; count_ = 0; recSize_ = 0;
+        arena_ = nullptr; arenaUnits_ = 0;
+        widened_.clear(); widened_.shrink_to_fit();
+    }
+
+    std::wstring_view Reader::View(const StrRef& r, bool& ok) const {
+        if (!r.len) return {};
+        if ((uint64_t)r.off + r.len > arenaUnits_) { ok = false; return {}; }
+        return std::wstring_view(arena_ + r.off, r.len);
+    }
+
+    std::wstring_view Reader::Host() const {
+        bool ok = true;
+        return hdr_ ? View(hdr_->host, ok) : std::wstring_view{};
+    }
+
+    bool Reader::Get(size_t i, ProcView& out) const {
+        if (i >= count_) return false;
+        Record r{};
+        std::memcpy(&r, recs_ + i * recSize_, recSize_);   // v1 records end before createTime
+        bool ok = true;
+        out.pid = r.pid; out.ppid = r.ppid; out.createTime = r.createTime;
+        out.readable = !(r.flags & REC_UNREADABLE);
+        out.name = View(r.name, ok);
+        out.imagePath = View(r.imagePath, ok);
+        out.commandLine = View(r.commandLine, ok);
+        out.currentDirectory = View(r.currentDirectory, ok);
+        out.windowTitle = View(r.windowTitle, ok);
+        out.desktopInfo = View(r.desktopInfo, ok);
+        out.shellInfo = View(r.shellInfo, ok);
+        out.runtimeData = View(r.runtimeData, ok);
+        out.sig.trusted = (r.flags & REC_SIG_TRUSTED) != 0;
+        out.sig.trustStatus = View(r.trustStatus, ok);
+        out.sig.publisher = View(r.publisher, ok);
+        out.sig.thumbprint = View(r.thumbprint, ok);
+        return ok;
+    }
+} // namespace snap
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "codesign.h"
+#include "intern.h"
+#include "proc_peb.h"
+
+// Binary scan snapshot (--record / --replay), little-endian, memory-mappable:
+//   Header | Record[count] | UTF-16 string arena
+// Strings are (offset, length) pairs in UTF-16 code units into the arena; identical
+// strings are stored once. Version 2 adds the creation time and keeps processes that
+// could not be read (name only), so a replay sees the whole process tree; version 1
+// files are still read.
+namespace snap {
+    struct StrRef { uint32_t off = 0, len = 0; };
+
+    struct Header {
+        char     magic[8];        // "PHSNAP01"
+        uint32_t version;         // kVersion
+        uint32_t recordSize;      // sizeof(Record)
+        uint32_t count;
+        uint32_t flags;
+        uint64_t arenaOffset;     // bytes from file start
+        uint64_t arenaUnits;      // UTF-16 code units
+        uint64_t timestamp;       // capture time, seconds since 1970 (0 = unknown)
+        StrRef   host;
+    };
+
+    enum : uint32_t { REC_SIG_TRUSTED = 1u << 0, REC_UNREADABLE = 1u << 1 };
+
+    struct Record {
+        uint32_t pid, ppid;
+        uint32_t flags;
+        uint32_t reserved;
+        StrRef name, imagePath, commandLine, currentDirectory;
+        StrRef windowTitle, desktopInfo, shellInfo, runtimeData;
+        StrRef trustStatus, publisher, thumbprint;
+        uint64_t createTime;      // FILETIME units, 0 = unknown (v2)
+    };
+
+    constexpr uint32_t kVersion = 2;
+    constexpr uint32_t kRecordSizeV1 = 104;
+    static_assert(sizeof(Header) == 56 && sizeof(Record) == 112, "snapshot layout is part of the file format");
+
+    // One process as seen through a snapshot; views stay valid while the Reader is open.
+    struct ProcView {
+        uint32_t pid = 0, ppid = 0;
+        uint64_t createTime = 0;
+        bool readable = true;   // false: only pid, ppid, createTime and name are known
+        std::wstring_view name, imagePath, commandLine, currentDirectory;
+        std::wstring_view windowTitle, desktopInfo, shellInfo, runtimeData;
+        SignView sig;
+    };
+
+    // A scan held in memory: per process a 64-byte row of 32-bit handles into one
+    // deduplicating UTF-16 pool (intern.h) instead of eleven owned strings. The pool is
+    // the snapshot arena, so Writer::Close() writes it as it is.
+    class Table {
+    public:
+        void Add(uint32_t pid, uint32_t ppid, uint64_t createTime, const ProcParams& pp, const SignView& sig);
+        void AddUnreadable(uint32_t pid, uint32_t ppid, uint64_t createTime, std::wstring_view name);
+        void Reserve(size_t processes);
+        void Clear();
+
+        size_t Count() const { return rows_.size(); }
+        // Views point into the pool where wchar_t is UTF-16 (Windows); elsewhere they are
+        // widened into a scratch buffer that the next Get() reuses.
+        void Get(size_t i, ProcView& out) const;
+        Record Raw(size_t i) const;   // the file record: strings as (offset, length) into Strings().Arena()
+
+        intern::Pool& Strings() { return pool_; }
+        const intern::Pool& Strings() const { return pool_; }
+        size_t MemoryBytes() const;
+
+    private:
+        enum { S_NAME, S_IMAGE, S_CMD, S_CWD, S_WTITLE, S_DESK, S_SHELL, S_RTD, S_STATUS, S_PUBLISHER, S_THUMBPRINT, S_COUNT };
+        struct Row {
+            uint64_t createTime;
+            uint32_t pid, ppid, flags;
+            intern::Handle s[S_COUNT];
+        };
+        static_assert(sizeof(Row) == 64, "one cache line per process");
+
+        std::wstring_view View(intern::Handle h, wchar_t*& scratch) const;
+
+        intern::Pool pool_;
+        std::vector<Row> rows_;
+        mutable std::wstring scratch_;
+    };
+
+    class Writer {
+    public:
+        ~Writer() { Close(); }
+        bool Open(const std::wstring& path);
+        void SetOrigin(std::wstring_view host, uint64_t timestamp);
+        void Add(uint32_t pid, uint32_t ppid, uint64_t createTime, const ProcParams& pp, const SignInfo& sig);
+        void AddUnreadable(uint32_t pid, uint32_t ppid, uint64_t createTime, std::wstring_view name);
+        bool Close();   // writes header, record table and arena
+
+        const Table& Records() const { return table_; }   // the scan so far
+
+    private:
+        FILE* f_ = nullptr;
+        Header hdr_{};
+        intern::Handle host_ = 0;
+        Table table_;
+    };
+
+    // Maps the file read-only. On Windows (16-bit wchar_t) string views point straight
+    // into the mapping; elsewhere the arena is widened once at open.
+    class Reader {
+    public:
+        ~Reader() { Close(); }
+        bool Open(const std::wstring& path, std::wstring* err = nullptr);
+        void Close();
+
+        size_t Count() const { return count_; }
+        bool Get(size_t i, ProcView& out) const;   // false if the record points outside the arena
+        std::wstring_view Host() const;
+        uint64_t Timestamp() const { return hdr_ ? hdr_->timestamp : 0; }
+
+    private:
+        std::wstring_view View(const StrRef& r, bool& ok) const;
+
+        const uint8_t* base_ = nullptr;
+        size_t size_ = 0;
+        const Header* hdr_ = nullptr;
+        const uint8_t* recs_ = nullptr;
+        size_t count_ = 0, recSize_ = 0;
+        const wchar_t* arena_ = nullptr;
+        uint64_t arenaUnits_ = 0;
+        std::wstring widened_;
+#if defined(_WIN32)
+        void* file_ = nullptr;
+        void* mapping_ = nullptr;
+#endif
+    };
+} // namespace snap
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: MIT
+#include "stats.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "serializer.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    int highest_bit(uint64_t v) {   // v != 0
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long i; _BitScanReverse64(&i, v); return (int)i;
+#elif defined(_MSC_VER)
+        unsigned long i;
+        if (v >> 32) { _BitScanReverse(&i, (unsigned long)(v >> 32)); return (int)i + 32; }
+        _BitScanReverse(&i, (unsigned long)v); return (int)i;
+#else
+        return 63 - __builtin_clzll(v);
+#endif
+    }
+
+    const char* const kStageNames[stats::S_COUNT] = { "read", "verify", "evaluate", "output" };
+
+#if PROCHUNT_STATS
+    struct ThreadStats { stats::StageStats st[stats::S_COUNT]; };
+
+    // Live per-thread blocks, plus the merged totals of threads that have exited
+    // (pool threads come and go every --watch tick).
+    std::mutex g_m;
+    std::vector<ThreadStats*> g_live;
+    ThreadStats g_retired;
+
+    void merge_into(ThreadStats& dst, const ThreadStats& src) {
+        for (int s = 0; s < stats::S_COUNT; ++s) {
+            dst.st[s].ns.Merge(src.st[s].ns);
+            dst.st[s].failures += src.st[s].failures;
+        }
+    }
+
+    double g_ns_per_tick = 1.0;
+
+    struct Slot {
+        ThreadStats* p = nullptr;
+        ThreadStats& get() {
+            if (!p) {
+                p = new ThreadStats();
+                std::lock_guard<std::mutex> lk(g_m);
+                g_live.push_back(p);
+            }
+            return *p;
+        }
+        ~Slot() {
+            if (!p) return;
+            std::lock_guard<std::mutex> lk(g_m);
+            merge_into(g_retired, *p);
+            for (auto& q : g_live) if (q == p) { q = g_live.back(); g_live.pop_back(); break; }
+            delete p;
+        }
+    };
+    thread_local Slot t_slot;
+    thread_local ThreadStats* t_stats = nullptr;   // trivial TLS: no init guard on the hot path
+
+    ThreadStats& local() {
+        if (!t_stats) t_stats = &t_slot.get();
+        return *t_stats;
+    }
+#endif
+} // anon
+
+namespace stats {
+
+    const char* StageName(Stage s) { return s >= 0 && s < S_COUNT ? kStageNames[s] : "?"; }
+
+    int Histogram::BucketOf(uint64_t v) {
+        if (v < (uint64_t)kSub) return (int)v;
+        const int e = highest_bit(v);
+        return (e - kSubBits + 1) * kSub + (int)((v >> (e - kSubBits)) & (kSub - 1));
+    }
+    uint64_t Histogram::BucketLow(int b) {
+        if (b < kSub) return (uint64_t)b;
+        const int e = b / kSub + kSubBits - 1;
+        return (uint64_t)(kSub + b % kSub) << (e - kSubBits);
+    }
+    uint64_t Histogram::BucketHigh(int b) {
+        if (b < kSub) return (uint64_t)b;
+        const int e = b / kSub + kSubBits - 1;
+        return BucketLow(b) + ((uint64_t)1 << (e - kSubBits)) - 1;
+    }
+
+    void Histogram::Merge(const Histogram& o) {
+        if (!o.count_) return;
+        for (int i = 0; i < kBuckets; ++i) counts_[i] += o.counts_[i];
+        count_ += o.count_; sum_ += o.sum_;
+        if (o.max_ > max_) max_ = o.max_;
+        if (o.min_ < min_) min_ = o.min_;
+    }
+
+    uint64_t Histogram::Percentile(double p) const {
+        if (!count_) return 0;
+        if (p < 0) p = 0;
+        if (p > 100) p = 100;
+        uint64_t rank = (uint64_t)(p / 100.0 * (double)count_ + 0.999999);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return BucketHigh(i) < max_ ? BucketHigh(i) : max_;
+        }
+        return max_;
+    }
+
+    void WriteJson(ser::Buffer& b, const Snapshot& s) {
+        b.Put('{');
+        for (int i = 0; i < S_COUNT; ++i) {
+            const StageStats& st = s.stage[i];
+            if (i) b.Put(',');
+            b.Put('"'); b.Put(kStageNames[i]); b.Put("\":{\"count\":"); b.Uint(st.ns.Count());
+            b.Put(",\"failures\":"); b.Uint(st.failures);
+            b.Put(",\"totalMs\":"); b.Fixed((double)st.ns.Sum() / 1e6, 3);
+            b.Put(",\"p50Us\":"); b.Fixed((double)st.ns.Percentile(50) / 1e3, 1);
+            b.Put(",\"p90Us\":"); b.Fixed((double)st.ns.Percentile(90) / 1e3, 1);
+            b.Put(",\"p99Us\":"); b.Fixed((double)st.ns.Percentile(99) / 1e3, 1);
+            b.Put(",\"maxUs\":"); b.Fixed((double)st.ns.Max() / 1e3, 1);
+            b.Put('}');
+        }
+        b.Put('}');
+    }
+
+    void WriteText(ser::Buffer& b, const Snapshot& s) {
+        char line[160];
+        snprintf(line, sizeof(line), "%-9s %10s %9s %12s %10s %10s %10s %10s\n",
+            "stage", "count", "failures", "total ms", "p50 us", "p90 us", "p99 us", "max us");
+        b.Put(line);
+        for (int i = 0; i < S_COUNT; ++i) {
+            const Histogram& h = s.stage[i].ns;
+            snprintf(line, sizeof(line), "%-9s %10llu %9llu %12.3f %10.1f %10.1f %10.1f %10.1f\n",
+                kStageNames[i], (unsigned long long)h.Count(), (unsigned long long)s.stage[i].failures,
+                (double)h.Sum() / 1e6, (double)h.Percentile(50) / 1e3, (double)h.Percentile(90) / 1e3,
+                (double)h.Percentile(99) / 1e3, (double)h.Max() / 1e3);
+            b.Put(line);
+        }
+    }
+
+#if PROCHUNT_STATS
+    namespace detail { std::atomic<bool> g_enabled{ false }; }
+
+    void Enable(bool on) {
+        if (on && !detail::g_enabled.load()) {
+            using clock = std::chrono::steady_clock;
+            const auto c0 = clock::now();
+            const uint64_t k0 = Ticks();
+            while (clock::now() - c0 < std::chrono::milliseconds(5)) {}
+            const uint64_t k1 = Ticks();
+            const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - c0).count();
+            g_ns_per_tick = k1 > k0 ? ns / (double)(k1 - k0) : 1.0;
+        }
+        detail::g_enabled.store(on);
+    }
+
+    void Record(Stage s, uint64_t ns) { local().st[s].ns.Record(ns); }
+    void RecordTicks(Stage s, uint64_t ticks) {
+        // Ticks can step back when a thread migrates between cores with unsynchronized TSCs.
+        local().st[s].ns.Record((int64_t)ticks < 0 ? 0 : (uint64_t)((double)ticks * g_ns_per_tick));
+    }
+    void Fail(Stage s) { ++local().st[s].failures; }
+
+    Snapshot Collect() {
+        ThreadStats all;
+        std::lock_guard<std::mutex> lk(g_m);
+        merge_into(all, g_retired);
+        for (auto* p : g_live) merge_into(all, *p);
+        Snapshot snap;
+        for (int s = 0; s < S_COUNT; ++s) snap.stage[s] = all.st[s];
+        return snap;
+    }
+
+    void Reset() {
+        std::lock_guard<std::mutex> lk(g_m);
+        g_retired = ThreadStats();
+        for (auto* p : g_live) *p = ThreadStats();
+    }
+#endif
+} // namespace stats
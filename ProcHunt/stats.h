@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Per-stage latency statistics (--stats). Each thread records into its own histograms;
+// Collect() merges them once the scan is done. Nothing is measured unless Enable(true)
+// was called, and building with PROCHUNT_STATS=0 compiles the recording out entirely.
+#ifndef PROCHUNT_STATS
+#define PROCHUNT_STATS 1
+#endif
+
+namespace ser { class Buffer; }
+
+namespace stats {
+    enum Stage { S_READ, S_VERIFY, S_EVALUATE, S_OUTPUT, S_COUNT };
+    const char* StageName(Stage s);   // "read", "verify", "evaluate", "output"
+
+    // Log-linear histogram: exact below 16, then 16 linear sub-buckets per power of two,
+    // so a reported percentile is within 1/16 (6.25%) of the true value.
+    class Histogram {
+    public:
+        static constexpr int kSubBits = 4;
+        static constexpr int kSub = 1 << kSubBits;
+        static constexpr int kBuckets = (64 - kSubBits + 1) * kSub;
+
+        static int BucketOf(uint64_t v);
+        static uint64_t BucketLow(int b);
+        static uint64_t BucketHigh(int b);   // inclusive
+
+        void Record(uint64_t v) {
+            ++counts_[BucketOf(v)]; ++count_; sum_ += v;
+            if (v > max_) max_ = v;
+            if (v < min_) min_ = v;
+        }
+        void Merge(const Histogram& o);
+        void Clear() { *this = Histogram(); }
+
+        uint64_t Count() const { return count_; }
+        uint64_t Sum() const { return sum_; }
+        uint64_t Max() const { return count_ ? max_ : 0; }
+        uint64_t Min() const { return count_ ? min_ : 0; }
+        // Upper bound of the bucket holding the p-th percentile (0..100), capped at Max().
+        uint64_t Percentile(double p) const;
+
+    private:
+        uint64_t counts_[kBuckets] = {};
+        uint64_t count_ = 0, sum_ = 0, max_ = 0, min_ = UINT64_MAX;
+    };
+
+    struct StageStats {
+        Histogram ns;             // durations in nanoseconds
+        uint64_t failures = 0;    // e.g. read: process could not be opened (protected, exited)
+    };
+    struct Snapshot {
+        StageStats stage[S_COUNT];
+    };
+
+    // {"read":{"count":..,"failures":..,"totalMs":..,"p50Us":..,"p90Us":..,"p99Us":..,"maxUs":..},...}
+    void WriteJson(ser::Buffer& b, const Snapshot& s);
+    void WriteText(ser::Buffer& b, const Snapshot& s);   // one aligned line per stage
+
+#if PROCHUNT_STATS
+    namespace detail { extern std::atomic<bool> g_enabled; }
+    void Enable(bool on);   // on: also calibrates Ticks() against steady_clock (~5 ms)
+    inline bool Enabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+    void Record(Stage s, uint64_t ns);
+    void RecordTicks(Stage s, uint64_t ticks);
+    void Fail(Stage s);
+    Snapshot Collect();   // merges every thread's histograms; call while no stage is running
+    void Reset();
+
+    // Raw timestamp for stage timing: the TSC on x86 (a few ns to read, where steady_clock
+    // can cost 20-40 ns), steady_clock nanoseconds elsewhere.
+    inline uint64_t Ticks() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+        return __builtin_ia32_rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Times the enclosing scope into `stage` when stats are enabled.
+    class Timer {
+    public:
+        explicit Timer(Stage s) : s_(s), t0_(Enabled() ? Ticks() : 0) {}
+        ~Timer() { if (t0_) RecordTicks(s_, Ticks() - t0_); }
+        void Failed() { if (t0_) Fail(s_); }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    private:
+        Stage s_;
+        uint64_t t0_;
+    };
+
+    // Back-to-back stages with one timestamp per boundary instead of two per stage.
+    class Laps {
+    public:
+        Laps() : t_(Enabled() ? Ticks() : 0) {}
+        void Lap(Stage s) { if (t_) { const uint64_t n = Ticks(); RecordTicks(s, n - t_); t_ = n; } }
+        void Failed(Stage s) { if (t_) Fail(s); }
+    private:
+        uint64_t t_;
+    };
+#else
+    inline void Enable(bool) {}
+    inline bool Enabled() { return false; }
+    inline void Record(Stage, uint64_t) {}
+    inline void Fail(Stage) {}
+    inline Snapshot Collect() { return Snapshot(); }
+    inline void Reset() {}
+
+    class Timer {
+    public:
+        explicit Timer(Stage) {}
+        void Failed() {}
+    };
+    class Laps {
+    public:
+        void Lap(Stage) {}
+        void Failed(Stage) {}
+    };
+#endif
+} // namespace stats
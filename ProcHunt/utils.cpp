@@ -1,18 +1,23 @@
 #include "utils.h"
 #include <algorithm>
+#include <cstdint>
 #include <cwchar>
 #include <cstdio>
-#include <windows.h>
+#include <cstring>
+#include <cwctype>
 #include <vector>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
 
 namespace util {
-    std::wstring lcase(const std::wstring& s) { std::wstring o = s; std::transform(o.begin(), o.end(), o.begin(), ::towlower); return o; }
-    bool iequals(const std::wstring& a, const std::wstring& b) {
+    std::wstring lcase(std::wstring_view s) { std::wstring o(s); std::transform(o.begin(), o.end(), o.begin(), ::towlower); return o; }
+    bool iequals(std::wstring_view a, std::wstring_view b) {
         if (a.size() != b.size()) return false;
         for (size_t i = 0; i < a.size(); ++i) if (::towlower(a[i]) != ::towlower(b[i])) return false;
         return true;
     }
-    bool icmp(const std::wstring& a, const std::wstring& b) { return iequals(a, b); }
+    bool icmp(std::wstring_view a, std::wstring_view b) { return iequals(a, b); }
 
     std::wstring basenameW(const std::wstring& path) {
         size_t p1 = path.find_last_of(L'\\'), p2 = path.find_last_of(L'/');
@@ -43,7 +48,99 @@ namespace util {
         return s;
     }
 
-    std::wstring json_escape(const std::wstring& s) {
+    std::string to_utf8(std::wstring_view w) {
+        std::string o; o.reserve(w.size());
+        for (size_t i = 0; i < w.size(); ++i) {
+            uint32_t cp = (uint32_t)w[i];
+            if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < w.size()
+                && (uint32_t)w[i + 1] >= 0xDC00 && (uint32_t)w[i + 1] <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + ((uint32_t)w[++i] - 0xDC00);
+            }
+            else if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) cp = 0xFFFD;
+            if (cp < 0x80) o.push_back((char)cp);
+            else if (cp < 0x800) { o.push_back((char)(0xC0 | (cp >> 6))); o.push_back((char)(0x80 | (cp & 0x3F))); }
+            else if (cp < 0x10000) {
+                o.push_back((char)(0xE0 | (cp >> 12))); o.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+                o.push_back((char)(0x80 | (cp & 0x3F)));
+            }
+            else {
+                o.push_back((char)(0xF0 | (cp >> 18))); o.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+                o.push_back((char)(0x80 | ((cp >> 6) & 0x3F))); o.push_back((char)(0x80 | (cp & 0x3F)));
+            }
+        }
+        return o;
+    }
+    std::wstring from_utf8(std::string_view s) {
+        std::wstring o;
+        append_from_utf8(o, s);
+        return o;
+    }
+
+    void append_from_utf8(std::wstring& o, std::string_view s) {
+        // Never more wide characters than input bytes: size once, write through a pointer.
+        const size_t at = o.size();
+        o.resize(at + s.size());
+        wchar_t* d = &o[0] + at;
+        const unsigned char* p = (const unsigned char*)s.data();
+        const unsigned char* end = p + s.size();
+        while (p < end) {
+            // Most text here is ASCII: widen 8 bytes at a time while no high bit is set.
+            uint64_t w;
+            while (end - p >= 8 && (memcpy(&w, p, 8), !(w & 0x8080808080808080ull))) {
+                for (int k = 0; k < 8; ++k) d[k] = (wchar_t)p[k];
+                d += 8; p += 8;
+            }
+            if (p == end) break;
+            unsigned char c = *p;
+            uint32_t cp; size_t n;
+            if (c < 0x80) { *d++ = (wchar_t)c; ++p; continue; }
+            else if ((c >> 5) == 0x6) { cp = c & 0x1F; n = 2; }
+            else if ((c >> 4) == 0xE) { cp = c & 0x0F; n = 3; }
+            else if ((c >> 3) == 0x1E) { cp = c & 0x07; n = 4; }
+            else { *d++ = (wchar_t)0xFFFD; ++p; continue; }
+            if ((size_t)(end - p) < n) { *d++ = (wchar_t)0xFFFD; break; }
+            bool ok = true;
+            for (size_t k = 1; k < n; ++k) {
+                unsigned char cc = p[k];
+                if ((cc & 0xC0) != 0x80) { ok = false; break; }
+                cp = (cp << 6) | (cc & 0x3F);
+            }
+            if (!ok) { *d++ = (wchar_t)0xFFFD; ++p; continue; }
+            p += n;
+            if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+                cp -= 0x10000;
+                *d++ = (wchar_t)(0xD800 + (cp >> 10)); *d++ = (wchar_t)(0xDC00 + (cp & 0x3FF));
+            }
+            else *d++ = (wchar_t)cp;
+        }
+        o.resize((size_t)(d - o.data()));
+    }
+
+    std::u16string to_u16(std::wstring_view s) {
+        std::u16string o; o.reserve(s.size());
+        for (wchar_t wc : s) {
+            uint32_t c = (uint32_t)wc;
+            if (c >= 0x10000 && c <= 0x10FFFF) {
+                c -= 0x10000;
+                o.push_back((char16_t)(0xD800 + (c >> 10)));
+                o.push_back((char16_t)(0xDC00 + (c & 0x3FF)));
+            }
+            else o.push_back((char16_t)(c > 0x10FFFF ? 0xFFFD : c));
+        }
+        return o;
+    }
+    std::wstring from_u16(std::u16string_view s) {
+        std::wstring o; o.reserve(s.size());
+        for (size_t i = 0; i < s.size(); ++i) {
+            uint32_t c = s[i];
+            if (sizeof(wchar_t) == 4 && c >= 0xD800 && c <= 0xDBFF && i + 1 < s.size() && s[i + 1] >= 0xDC00 && s[i + 1] <= 0xDFFF)
+                c = 0x10000 + ((c - 0xD800) << 10) + (s[++i] - 0xDC00u);
+            o.push_back((wchar_t)c);
+        }
+        return o;
+    }
+
+    std::wstring json_escape(std::wstring_view s) {
         std::wstring o; o.reserve(s.size() + 8);
         for (wchar_t c : s) {
             switch (c) {
@@ -55,25 +152,75 @@ namespace util {
             case L'\r': o += L"\\r"; break;
             case L'\t': o += L"\\t"; break;
             default:
-                if (c < 0x20) { wchar_t buf[7]; _snwprintf_s(buf, _TRUNCATE, L"\\u%04X", (unsigned)c); o += buf; }
+                if (c < 0x20) { wchar_t buf[7]; swprintf(buf, 7, L"\\u%04X", (unsigned)c); o += buf; }
                 else o.push_back(c);
             }
         }
         return o;
     }
 
+    std::wstring filetime_iso8601(uint64_t ft) {
+        const uint64_t ms = ft / 10000;
+        int64_t days = (int64_t)(ms / 86400000) - 134774;   // 1601-01-01 -> 1970-01-01
+        const unsigned rem = (unsigned)(ms % 86400000);
+        // civil-from-days (proleptic Gregorian)
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned doe = (unsigned)(days - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+        const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+        const int64_t y = (int64_t)yoe + era * 400 + (m <= 2);
+        wchar_t buf[32];
+        swprintf(buf, 32, L"%04lld-%02u-%02uT%02u:%02u:%02u.%03uZ", (long long)y, m, d,
+            rem / 3600000, rem / 60000 % 60, rem / 1000 % 60, rem % 1000);
+        return buf;
+    }
+
+    FILE* open_file(const std::wstring& path, const char* mode) {
+        FILE* f = nullptr;
+#if defined(_MSC_VER)
+        std::wstring wmode(mode, mode + strlen(mode));
+        if (_wfopen_s(&f, path.c_str(), wmode.c_str()) != 0) f = nullptr;
+#elif defined(_WIN32)
+        std::wstring wmode(mode, mode + strlen(mode));
+        f = _wfopen(path.c_str(), wmode.c_str());
+#else
+        f = fopen(to_utf8(path).c_str(), mode);
+#endif
+        return f;
+    }
+
+    bool replace_file(const std::wstring& from, const std::wstring& to) {
+#if defined(_WIN32)
+        return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        return rename(to_utf8(from).c_str(), to_utf8(to).c_str()) == 0;
+#endif
+    }
+
     bool load_list_file(const std::wstring& path, std::vector<std::wstring>& out) {
         if (path.empty()) return false;
         FILE* f = nullptr;
 #if defined(_MSC_VER)
         _wfopen_s(&f, path.c_str(), L"rt, ccs=UTF-8");
-#else
+#elif defined(_WIN32)
         f = _wfopen(path.c_str(), L"rt, ccs=UTF-8");
+#else
+        f = fopen(to_utf8(path).c_str(), "rb");
 #endif
         if (!f) return false;
+#if defined(_WIN32)
         wchar_t line[4096];
-        while (fgetws(line, _countof(line), f)) {
+        while (fgetws(line, (int)(sizeof(line) / sizeof(line[0])), f)) {
             std::wstring s(line);
+#else
+        char raw[4096 * 4];
+        while (fgets(raw, sizeof(raw), f)) {
+            std::wstring s = from_utf8(raw);
+#endif
             // trim
             while (!s.empty() && (s.back() == L'\r' || s.back() == L'\n' || s.back() == L' ' || s.back() == L'\t')) s.pop_back();
             size_t start = 0; while (start < s.size() && (s[start] == L' ' || s[start] == L'\t')) ++start;
@@ -84,4 +231,19 @@ namespace util {
         fclose(f);
         return true;
     }
+
+    bool read_text_file(const std::wstring& path, std::wstring& out) {
+        FILE* f = open_file(path, "rb");
+        if (!f) return false;
+        std::string raw;
+        char chunk[65536];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) raw.append(chunk, n);
+        const bool ok = !ferror(f);
+        fclose(f);
+        std::string_view v(raw);
+        if (v.size() >= 3 && v.compare(0, 3, "\xEF\xBB\xBF") == 0) v.remove_prefix(3);
+        out = from_utf8(v);
+        return ok;
+    }
 } // namespace util
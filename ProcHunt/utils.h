@@ -1,11 +1,14 @@
 #pragma once
+#include <cstdint>
+#include <cstdio>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace util {
-	std::wstring lcase(const std::wstring& s);
-	bool iequals(const std::wstring& a, const std::wstring& b);
-	bool icmp(const std::wstring& a, const std::wstring& b);
+	std::wstring lcase(std::wstring_view s);
+	bool iequals(std::wstring_view a, std::wstring_view b);
+	bool icmp(std::wstring_view a, std::wstring_view b);
 
 	std::wstring basenameW(const std::wstring& path);
 	std::wstring dirnameW(const std::wstring& path);
@@ -13,9 +16,23 @@ namespace util {
 	std::wstring rstrip_slash(const std::wstring& p);
 	std::wstring replace_common_lookalikes(std::wstring s);
 
+	// UTF-8 <-> wide (UTF-16 on Windows, UTF-32 elsewhere)
+	std::string to_utf8(std::wstring_view w);
+	std::wstring from_utf8(std::string_view s);
+	void append_from_utf8(std::wstring& out, std::string_view s);   // from_utf8 into a reused string
+	// wide <-> UTF-16 code units (identity on Windows)
+	std::u16string to_u16(std::wstring_view w);
+	std::wstring from_u16(std::u16string_view s);
+
 	// JSON
-	std::wstring json_escape(const std::wstring& s);
+	std::wstring json_escape(std::wstring_view s);
+
+	// Time: FILETIME (100 ns since 1601, UTC) -> "YYYY-MM-DDTHH:MM:SS.mmmZ"
+	std::wstring filetime_iso8601(uint64_t ft);
 
 	// IO
+	FILE* open_file(const std::wstring& path, const char* mode);   // mode: "rb", "wb", ...
+	bool replace_file(const std::wstring& from, const std::wstring& to);
 	bool load_list_file(const std::wstring& path, std::vector<std::wstring>& out);
+	bool read_text_file(const std::wstring& path, std::wstring& out);   // UTF-8, BOM skipped
 } // namespace util
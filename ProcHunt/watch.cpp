@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: MIT
+#include "watch.h"
+#include <algorithm>
+
+namespace watch {
+
+    const wchar_t* EventName(Event e) {
+        switch (e) {
+        case Event::Started:      return L"started";
+        case Event::Exited:       return L"exited";
+        case Event::ScoreChanged: return L"score_changed";
+        default:                  return L"none";
+        }
+    }
+
+    const Delta& Tracker::Update(const std::vector<scan::ProcEntry>& now) {
+        delta_.started.clear();
+        delta_.exited.clear();
+        ++gen_;
+        for (const auto& e : now) {
+            auto ins = live_.try_emplace(Key{ e.pid, e.createTime });
+            Tracked& t = ins.first->second;
+            if (ins.second) {
+                t.entry = e;
+                delta_.started.push_back(e);
+            }
+            t.seen = gen_;
+        }
+        // Anything not refreshed by this enumeration has exited.
+        for (auto it = live_.begin(); it != live_.end();) {
+            if (it->second.seen == gen_) { ++it; continue; }
+            if (it->second.reported) delta_.exited.push_back(std::move(it->second));
+            it = live_.erase(it);
+        }
+        return delta_;
+    }
+
+    Event Tracker::Score(const scan::ProcEntry& e, int score, int minScore, int& previous) {
+        auto it = live_.find(Key{ e.pid, e.createTime });
+        previous = -1;
+        if (it == live_.end()) return Event::None;   // exited meanwhile
+        Tracked& t = it->second;
+        previous = t.score;
+        t.score = score;
+        const bool above = minScore < 0 || score >= minScore;
+        if (previous < 0) {
+            if (!above) return Event::None;
+            t.reported = true;
+            return Event::Started;
+        }
+        if (score == previous || (!t.reported && !above)) return Event::None;
+        t.reported = true;
+        return Event::ScoreChanged;
+    }
+
+    std::vector<scan::ProcEntry> Tracker::Entries() const {
+        std::vector<scan::ProcEntry> v;
+        v.reserve(live_.size());
+        for (auto& kv : live_) v.push_back(kv.second.entry);
+        std::sort(v.begin(), v.end(), [](const scan::ProcEntry& a, const scan::ProcEntry& b) {
+            return a.pid != b.pid ? a.pid < b.pid : a.createTime < b.createTime;
+            });
+        return v;
+    }
+} // namespace watch
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "pipeline.h"
+
+// Incremental --watch engine: diffs consecutive process enumerations keyed by
+// (PID, creation time), so a reused PID is a new process, and decides which
+// NDJSON events to emit. Only processes reported in `started` need a PEB read.
+namespace watch {
+    enum class Event { None, Started, Exited, ScoreChanged };
+    const wchar_t* EventName(Event e);   // "started", "exited", "score_changed"
+
+    struct Tracked {
+        scan::ProcEntry entry;
+        int score = -1;          // -1: not evaluated yet (or unreadable)
+        bool reported = false;   // a started/score_changed event was emitted
+        uint64_t seen = 0;       // generation of the last enumeration containing it
+    };
+
+    struct Delta {
+        std::vector<scan::ProcEntry> started;   // to be evaluated
+        std::vector<Tracked> exited;            // only processes that were reported
+    };
+
+    class Tracker {
+    public:
+        // Diffs a fresh enumeration against the previous one. The returned delta is
+        // reused by the next call. On the first call every process is "started".
+        const Delta& Update(const std::vector<scan::ProcEntry>& now);
+
+        // Stores an evaluation result and returns the event to emit (None, Started or
+        // ScoreChanged). minScore < 0 reports everything; once a process was reported,
+        // any later score change is reported too. `previous` receives the old score.
+        Event Score(const scan::ProcEntry& e, int score, int minScore, int& previous);
+
+        // Every tracked process (re-evaluation after a configuration change).
+        std::vector<scan::ProcEntry> Entries() const;
+        size_t Size() const { return live_.size(); }
+
+    private:
+        struct Key {
+            uint32_t pid; uint64_t createTime;
+            bool operator==(const Key& o) const { return pid == o.pid && createTime == o.createTime; }
+        };
+        struct KeyHash {
+            size_t operator()(const Key& k) const {
+                uint64_t h = (k.createTime ^ ((uint64_t)k.pid << 32 | k.pid)) * 0x9E3779B97F4A7C15ull;
+                return (size_t)(h ^ (h >> 29));
+            }
+        };
+
+        std::unordered_map<Key, Tracked, KeyHash> live_;
+        Delta delta_;
+        uint64_t gen_ = 0;
+    };
+} // namespace watch
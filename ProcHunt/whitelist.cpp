@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+#include "whitelist.h"
+#include "utils.h"
+
+namespace {
+    bool is_sep(wchar_t c) { return c == L'\\' || c == L'/'; }
+
+    // Splits a path into components. A leading separator run becomes its own component
+    // ("\" rooted, "\\" UNC) so "\\srv\share" and "srv\share" stay distinct.
+    class Components {
+    public:
+        explicit Components(std::wstring_view p) : rest_(p) {
+            if (rest_.size() >= 4 && is_sep(rest_[0]) && (is_sep(rest_[1]) || rest_[1] == L'?')
+                && rest_[2] == L'?' && is_sep(rest_[3]))
+                rest_.remove_prefix(4);   // \\?\ or \??\ (NT / long-path form)
+            size_t n = 0;
+            while (n < rest_.size() && is_sep(rest_[n])) ++n;
+            if (n) root_ = n >= 2 ? std::wstring_view(L"\\\\") : std::wstring_view(L"\\");
+            rest_.remove_prefix(n);
+        }
+        bool Next(std::wstring_view& c) {
+            if (!root_.empty()) { c = root_; root_ = {}; return true; }
+            while (!rest_.empty() && is_sep(rest_.front())) rest_.remove_prefix(1);
+            if (rest_.empty()) return false;
+            size_t i = 0;
+            while (i < rest_.size() && !is_sep(rest_[i])) ++i;
+            c = rest_.substr(0, i);
+            rest_.remove_prefix(i);
+            return true;
+        }
+    private:
+        std::wstring_view rest_, root_;
+    };
+} // anon
+
+namespace heur {
+
+    bool PathPrefixSet::Add(std::wstring_view path) {
+        const std::wstring folded = util::lcase(path);
+        Components it(folded);
+        uint32_t node = 0;
+        std::wstring_view c;
+        while (it.Next(c)) {
+            auto f = children_.find(Edge{ node, c });
+            if (f != children_.end()) { node = f->second; continue; }
+            names_.emplace_back(c);
+            const uint32_t child = (uint32_t)terminal_.size();
+            terminal_.push_back(0);
+            children_.emplace(Edge{ node, names_.back() }, child);
+            node = child;
+        }
+        if (node == 0 || terminal_[node]) return false;
+        terminal_[node] = 1;
+        ++entries_;
+        return true;
+    }
+
+    bool PathPrefixSet::Match(std::wstring_view foldedPath) const {
+        if (!entries_) return false;
+        Components it(foldedPath);
+        uint32_t node = 0;
+        std::wstring_view c;
+        while (it.Next(c)) {
+            auto f = children_.find(Edge{ node, c });
+            if (f == children_.end()) return false;
+            node = f->second;
+            if (terminal_[node]) return true;
+        }
+        return false;
+    }
+
+    void PathPrefixSet::Clear() {
+        children_.clear();
+        names_.clear();
+        terminal_.assign(1, 0);
+        entries_ = 0;
+    }
+
+    bool FoldedSet::Add(std::wstring_view s) {
+        if (s.empty()) return false;
+        std::wstring f = util::lcase(s);
+        if (set_.count(f)) return false;
+        items_.push_back(std::move(f));
+        set_.insert(items_.back());
+        return true;
+    }
+} // namespace heur
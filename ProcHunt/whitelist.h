@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Whitelist indexes. Entries are case-folded once when added; lookups take views that
+// are already case-folded and do not allocate, so cost does not grow with list size.
+namespace heur {
+    // Path prefixes matched on whole components: "C:\Program Files" matches
+    // "c:\program files\app\a.exe" but not "c:\program files evil\a.exe".
+    // '\' and '/' are equivalent, repeated and trailing separators are ignored and a
+    // leading \\?\ or \??\ is dropped.
+    class PathPrefixSet {
+    public:
+        PathPrefixSet() { terminal_.push_back(0); }
+        PathPrefixSet(const PathPrefixSet&) = delete;   // edges point into names_
+        PathPrefixSet& operator=(const PathPrefixSet&) = delete;
+
+        bool Add(std::wstring_view path);                  // false if empty or already present
+        bool Match(std::wstring_view foldedPath) const;    // some entry is a prefix of the path
+        size_t Size() const { return entries_; }
+        void Clear();
+
+    private:
+        struct Edge {
+            uint32_t parent;
+            std::wstring_view name;
+            bool operator==(const Edge& o) const { return parent == o.parent && name == o.name; }
+        };
+        struct EdgeHash {
+            size_t operator()(const Edge& e) const {
+                return std::hash<std::wstring_view>()(e.name) ^ (size_t)((uint64_t)e.parent * 0x9E3779B97F4A7C15ull);
+            }
+        };
+
+        std::deque<std::wstring> names_;                  // component storage; stable addresses
+        std::unordered_map<Edge, uint32_t, EdgeHash> children_;
+        std::vector<uint8_t> terminal_;                   // per node: an entry ends here
+        size_t entries_ = 0;
+    };
+
+    // Case-folded exact-match set (publisher names).
+    class FoldedSet {
+    public:
+        FoldedSet() = default;
+        FoldedSet(const FoldedSet&) = delete;   // set_ points into items_
+        FoldedSet& operator=(const FoldedSet&) = delete;
+
+        bool Add(std::wstring_view s);          // false if empty or already present
+        bool Contains(std::wstring_view folded) const { return set_.count(folded) != 0; }
+        size_t Size() const { return set_.size(); }
+        void Clear() { set_.clear(); items_.clear(); }
+
+    private:
+        std::deque<std::wstring> items_;
+        std::unordered_set<std::wstring_view> set_;
+    };
+} // namespace heur
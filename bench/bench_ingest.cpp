@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: MIT
+// Fleet re-scoring (--ingest): records written by the --json/--ndjson/--watch printers are
+// read back and re-scored to the same bytes (NDJSON, array, text; tiny chunks and several
+// threads keep input order), watch/stats lines, malformed input and escapes are handled,
+// memory stays flat on a large input; then records/s per thread for parse and end to end.
+// build: cmake -S . -B build && cmake --build build --target bench_ingest
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "corpus.h"
+#include "heuristics.h"
+#include "ingest.h"
+#include "lineage.h"
+#include "output.h"
+#include "print.h"
+#include "serializer.h"
+#include "utils.h"
+
+namespace {
+    const char* const kIn = "/tmp/bench_ingest_in.json";
+    const char* const kOut = "/tmp/bench_ingest_out.json";
+    const char* const kRef = "/tmp/bench_ingest_ref.json";
+
+    std::wstring W(const char* s) { return std::wstring(s, s + strlen(s)); }
+
+    std::string slurp(const char* path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    void spit(const char* path, const std::string& s) {
+        FILE* f = fopen(path, "wb");
+        fwrite(s.data(), 1, s.size(), f);
+        fclose(f);
+    }
+
+    // Corpus records with a made-up lineage, so parent rules fire on some of them.
+    struct Fixture {
+        std::vector<bench::ProcRecord> recs;
+        std::vector<lin::Chain> chains;
+    };
+
+    const wchar_t* const kParents[] = { L"explorer.exe", L"WINWORD.EXE", L"services.exe", L"cmd.exe", L"svchost.exe" };
+
+    Fixture fixture(size_t n, uint32_t seed) {
+        Fixture f;
+        f.recs = bench::MakeCorpus(n, seed);
+        f.chains.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            lin::Chain& c = f.chains[i];
+            c.n = i % 4;
+            for (size_t k = 0; k < c.n; ++k) c.v[k] = lin::Ancestor{ 4 * (uint32_t)(i + k + 1), kParents[(i + k) % 5] };
+        }
+        return f;
+    }
+
+    heur::Result score(const bench::ProcRecord& r, const lin::Chain& c) {
+        return heur::EvaluateProcess(r.img, r.cmd, r.cwd, r.name, r.sig, c.n ? c.v[0].name : std::wstring_view{});
+    }
+
+    // What the regular printers write for these records, into `path`.
+    void print_fixture(const Fixture& f, const char* path, OutputMode mode, int minScore = -1) {
+        OutInit(W(path));
+        PrintBegin(mode);
+        for (size_t i = 0; i < f.recs.size(); ++i) {
+            const auto& r = f.recs[i];
+            const heur::Result res = score(r, f.chains[i]);
+            if (minScore >= 0 && res.score < minScore) continue;
+            PrintProcess(r.pid, r.name, r.img, r.cmd, r.cwd, r.wtitle, r.desk, r.shell, r.rtd, r.sig, res, &f.chains[i]);
+        }
+        PrintEnd();
+        OutClose();
+    }
+
+    bool ingest_to(const std::vector<std::wstring>& paths, const ingest::Options& opt, ingest::Totals& t, std::string& out) {
+        std::wstring err;
+        OutInit(W(kOut));
+        const bool ok = ingest::Run(paths, opt, t, &err);
+        OutClose();
+        out = slurp(kOut);
+        if (!ok) printf("ingest error: %ls\n", err.c_str());
+        return ok;
+    }
+
+    bool same(const char* what, const std::string& got, const std::string& want) {
+        if (got == want) return true;
+        size_t i = 0;
+        while (i < got.size() && i < want.size() && got[i] == want[i]) ++i;
+        const size_t from = i > 60 ? i - 60 : 0;
+        printf("FAIL: %s differs at byte %zu of %zu/%zu\n  got:  %.160s\n  want: %.160s\n", what, i, got.size(), want.size(),
+            got.c_str() + from, want.c_str() + from);
+        return false;
+    }
+
+    bool check_round_trip(const Fixture& f) {
+        print_fixture(f, kRef, OutputMode::Ndjson);
+        const std::string ndjson = slurp(kRef);
+        print_fixture(f, kRef, OutputMode::JsonArray);
+        const std::string array = slurp(kRef);
+        print_fixture(f, kRef, OutputMode::Text);
+        const std::string text = slurp(kRef);
+        print_fixture(f, kRef, OutputMode::Ndjson, 40);
+        const std::string filtered = slurp(kRef);
+
+        spit(kIn, ndjson);
+        std::string out;
+        ingest::Totals t;
+        for (unsigned threads : { 1u, 4u }) {
+            for (size_t chunk : { (size_t)1 << 20, (size_t)4096, (size_t)1 }) {
+                ingest::Options o;
+                o.threads = threads; o.chunkBytes = chunk;
+                if (!ingest_to({ W(kIn) }, o, t, out) || !same("NDJSON -> NDJSON", out, ndjson)) return false;
+                if (t.records != f.recs.size() || t.emitted != t.records || t.malformed || t.skipped) {
+                    printf("FAIL: totals %llu/%llu/%llu/%llu\n", (unsigned long long)t.records, (unsigned long long)t.emitted,
+                        (unsigned long long)t.malformed, (unsigned long long)t.skipped);
+                    return false;
+                }
+            }
+        }
+        ingest::Options o;
+        o.threads = 3; o.chunkBytes = 8192;
+        o.mode = OutputMode::JsonArray;
+        if (!ingest_to({ W(kIn) }, o, t, out) || !same("NDJSON -> array", out, array)) return false;
+        o.mode = OutputMode::Text;
+        if (!ingest_to({ W(kIn) }, o, t, out) || !same("NDJSON -> text", out, text)) return false;
+        o.mode = OutputMode::Ndjson;
+        o.minScore = 40;
+        if (!ingest_to({ W(kIn) }, o, t, out) || !same("--min-score 40", out, filtered)) return false;
+        o.minScore = -1;
+
+        spit(kIn, array);
+        if (!ingest_to({ W(kIn) }, o, t, out) || !same("array -> NDJSON", out, ndjson)) return false;
+        o.mode = OutputMode::JsonArray;
+        if (!ingest_to({ W(kIn) }, o, t, out) || !same("array -> array", out, array)) return false;
+
+        // Empty input: an empty array, as PrintBegin/PrintEnd would write.
+        spit(kIn, "");
+        if (!ingest_to({ W(kIn) }, o, t, out) || !same("empty -> array", out, "[\n]\n")) return false;
+        return true;
+    }
+
+    // --watch output: started/score_changed carry the process, exited and stats lines do not.
+    bool check_watch(const Fixture& f) {
+        OutInit(W(kIn));
+        for (size_t i = 0; i < 200; ++i) {
+            const auto& r = f.recs[i];
+            const heur::Result res = score(r, f.chains[i]);
+            PrintJsonEvent(i % 3 ? L"started" : L"score_changed", 133000000000000000ull + i, 132000000000000000ull, i % 3 ? -1 : 10,
+                r.pid, r.name, r.img, r.cmd, r.cwd, r.wtitle, r.desk, r.shell, r.rtd, r.sig, res, &f.chains[i]);
+            if (i % 10 == 0) PrintJsonExitEvent(133000000000000000ull, 132000000000000000ull, 9000 + (unsigned long)i, L"gone.exe", 35);
+        }
+        stats::Snapshot s;
+        PrintStats(s);
+        OutClose();
+
+        Fixture head;
+        head.recs.assign(f.recs.begin(), f.recs.begin() + 200);
+        head.chains.assign(f.chains.begin(), f.chains.begin() + 200);
+        print_fixture(head, kRef, OutputMode::Ndjson);
+        std::string out;
+        ingest::Totals t;
+        ingest::Options o;
+        o.threads = 2;
+        if (!ingest_to({ W(kIn) }, o, t, out) || !same("watch events -> NDJSON", out, slurp(kRef))) return false;
+        if (t.records != 200 || t.skipped != 21 || t.malformed) { printf("FAIL: watch totals\n"); return false; }
+        return true;
+    }
+
+    bool check_malformed() {
+        // Good records around: junk text, a bad escape, a number where a string belongs, a
+        // truncated record at the end of the file. Braces inside strings do not split.
+        const std::string in =
+            "{\"pid\":1,\"name\":\"a{b}[c].exe\",\"imagePath\":\"C:\\\\x\\\\\\\"}\\\"\",\"signature\":{\"trusted\":true}}\n"
+            "this line is not JSON\n"
+            "{\"pid\":2,\"name\":\"bad\\q\"}\n"
+            "{\"pid\":3,\"name\":7}\n"
+            "{\"pid\":4,\"name\":\"ok.exe\",\"future\":{\"x\":[1,2.5e3,null,true]},\"ancestry\":null}\n"
+            "{\"pid\":5,\"name\":\"cut";
+        spit(kIn, in);
+        std::string out;
+        ingest::Totals t;
+        ingest::Options o;
+        o.threads = 2;
+        ingest_to({ W(kIn) }, o, t, out);
+        if (t.records != 2 || t.malformed != 4 || out.find("\"name\":\"a{b}[c].exe\"") == std::string::npos
+            || out.find("\"imagePath\":\"C:\\\\x\\\\\\\"}\\\"\"") == std::string::npos || out.find("\"name\":\"ok.exe\"") == std::string::npos) {
+            printf("FAIL: malformed input: %llu records, %llu malformed\n%s\n", (unsigned long long)t.records, (unsigned long long)t.malformed, out.c_str());
+            return false;
+        }
+
+        // A missing file fails the run but the others are still read.
+        std::wstring err;
+        OutInit(W(kOut));
+        const bool ok = ingest::Run({ L"/tmp/bench_ingest_missing.json", W(kIn) }, o, t, &err);
+        OutClose();
+        if (ok || err.empty() || t.records != 2) { printf("FAIL: missing file\n"); return false; }
+        return true;
+    }
+
+    bool check_strings() {
+        const std::string in =
+            "{\"pid\":7,\"name\":\"\\u0063md\\/x \\ud83d\\ude00 \xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80 \\ud800x \xff\","
+            "\"commandLine\":\"\\\"q\\\"\\t\\n\\\\\",\"imagePath\":null,\"ancestry\":[{\"pid\":4,\"name\":\"p\"},{\"name\":\"gp\",\"pid\":8}]}";
+        ingest::Record r;
+        if (!ingest::ParseRecord(in.data(), in.size(), r) || !r.isProcess) { printf("FAIL: string record did not parse\n"); return false; }
+        std::wstring name = L"cmd/x ";
+        name += util::from_u16(u"\U0001F600");
+        name += L" \u00e9\u20ac";
+        name += util::from_u16(u"\U0001F600");
+        name += L" ";
+        name += (wchar_t)0xD800;   // lone surrogate escape kept as a unit
+        name += L"x \uFFFD";       // invalid UTF-8 byte
+        if (r.pid != 7 || r.name != name || r.commandLine != L"\"q\"\t\n\\" || !r.imagePath.empty()
+            || r.ancestors != 2 || r.ancestorPid[1] != 8 || r.ancestorName[1] != L"gp") {
+            printf("FAIL: string decoding\n");
+            return false;
+        }
+        const char* notProc[] = { "{\"stats\":{\"read\":{}}}", "{\"event\":\"exited\",\"pid\":4,\"name\":\"x\",\"score\":0}", "{}" };
+        for (const char* s : notProc)
+            if (!ingest::ParseRecord(s, strlen(s), r) || r.isProcess) { printf("FAIL: %s is not a process record\n", s); return false; }
+        const char* bad[] = { "{\"pid\":1,}", "{\"pid\":-1}", "{\"pid\" 1}", "{\"pid\":1", "[1]", "{\"a\":[1,]}" };
+        for (const char* s : bad)
+            if (ingest::ParseRecord(s, strlen(s), r)) { printf("FAIL: %s parsed\n", s); return false; }
+        return true;
+    }
+
+    size_t peak_rss_kb() {
+        std::ifstream in("/proc/self/status");
+        std::string line;
+        while (std::getline(in, line))
+            if (!line.compare(0, 6, "VmHWM:")) return (size_t)atol(line.c_str() + 6);
+        return 0;
+    }
+} // anon
+
+int main() {
+    // Memory first, while the process is still small: ~120 MB of NDJSON through 4 threads.
+    {
+        const Fixture f = fixture(5000, 3);
+        print_fixture(f, kRef, OutputMode::Ndjson);
+        const std::string one = slurp(kRef);
+        FILE* big = fopen(kIn, "wb");
+        size_t bytes = 0;
+        while (bytes < (120u << 20)) { fwrite(one.data(), 1, one.size(), big); bytes += one.size(); }
+        fclose(big);
+        const size_t before = peak_rss_kb();
+        ingest::Options o;
+        o.threads = 4;
+        ingest::Totals t;
+        std::wstring err;
+        OutInit(L"/dev/null");
+        ingest::Run({ W(kIn) }, o, t, &err);
+        OutClose();
+        const size_t grown = peak_rss_kb() - before;
+        if (before && grown > 48 * 1024) { printf("FAIL: peak RSS grew %zu KB on %zu MB of input\n", grown, bytes >> 20); return 1; }
+        printf("%zu MB, %llu records, 4 threads: peak RSS +%zu KB\n", bytes >> 20, (unsigned long long)t.records, grown);
+    }
+
+    const Fixture f = fixture(20000, 11);
+    if (!check_round_trip(f) || !check_watch(f) || !check_malformed() || !check_strings()) return 1;
+    printf("round trip (NDJSON/array/text, 1-4 threads, 1 B-1 MB chunks), watch events, malformed input, escapes ok\n");
+
+    // Throughput: parse alone, scoring alone and end to end (split, parse, score, format,
+    // write to /dev/null). The corpus averages ~1.5 KB per record with 10% multi-KB base64
+    // command lines, so it is also shown restricted to the benign records.
+    Fixture benign;
+    for (size_t i = 0; i < f.recs.size(); ++i)
+        if (f.recs[i].kind == bench::Kind::Benign) { benign.recs.push_back(f.recs[i]); benign.chains.push_back(f.chains[i]); }
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (const Fixture* fx : { &f, (const Fixture*)&benign }) {
+        print_fixture(*fx, kRef, OutputMode::Ndjson);
+        const std::string ndjson = slurp(kRef);
+        std::string big;
+        for (int k = 0; k < 5; ++k) big += ndjson;
+        spit(kIn, big);
+        const double n = 5.0 * fx->recs.size();
+
+        ingest::Record rec;
+        size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t p = 0, e; p < ndjson.size(); p = e + 1) {
+            e = ndjson.find('\n', p);
+            ingest::ParseRecord(ndjson.data() + p, e - p, rec);
+            sink += rec.name.size();
+        }
+        const double parseNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / fx->recs.size();
+        t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < fx->recs.size(); ++i) sink += score(fx->recs[i], fx->chains[i]).score;
+        const double evalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / fx->recs.size();
+
+        printf("%s: %zu B/record; parse %.0f ns, score %.0f ns per record   [%zu]\n", fx == &f ? "corpus" : "benign",
+            ndjson.size() / fx->recs.size(), parseNs, evalNs, sink & 1);
+        for (unsigned threads : { 1u, cores }) {
+            ingest::Options o;
+            o.threads = threads;
+            ingest::Totals t;
+            std::wstring err;
+            OutInit(L"/dev/null");
+            t0 = std::chrono::steady_clock::now();
+            ingest::Run({ W(kIn) }, o, t, &err);
+            const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            OutClose();
+            printf("  %2u thread%s: %.0f records/s (%.0f MB/s) end to end\n", threads, threads > 1 ? "s" : " ", n / sec, big.size() / sec / 1048576.0);
+            if (cores == 1) break;
+        }
+    }
+    remove(kIn); remove(kOut); remove(kRef);
+    return 0;
+}
@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: MIT
+// Lookalike process names: the bit-parallel OSA distance against a plain DP on random
+// strings, precision/recall on a corpus of masquerading and legitimate names, the
+// reason reported through the default rules, then lookup cost vs. a linear DP scan.
+// build: cmake -S . -B build && cmake --build build --target bench_lookalike
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "heuristics.h"
+#include "lookalike.h"
+
+namespace {
+    using heur::NameIndex;
+
+    int ref_osa(const std::wstring& a, const std::wstring& b) {
+        const size_t n = a.size(), m = b.size();
+        std::vector<std::vector<int>> d(n + 1, std::vector<int>(m + 1));
+        for (size_t i = 0; i <= n; ++i) d[i][0] = (int)i;
+        for (size_t j = 0; j <= m; ++j) d[0][j] = (int)j;
+        for (size_t i = 1; i <= n; ++i)
+            for (size_t j = 1; j <= m; ++j) {
+                d[i][j] = std::min({ d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + (a[i - 1] != b[j - 1]) });
+                if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) d[i][j] = std::min(d[i][j], d[i - 2][j - 2] + 1);
+            }
+        return d[n][m];
+    }
+
+    bool check_distance() {
+        std::mt19937 rng(3);
+        const wchar_t alpha[] = { L'a', L'b', L'c', L's', L'.', L'e', L'x', L'0', 0x00E9, 0x0430, 0x4E2D };
+        auto rnd = [&](size_t maxLen) {
+            std::wstring s(rng() % (maxLen + 1), L' ');
+            for (auto& c : s) c = alpha[rng() % (rng() % 2 ? 4 : 11)];
+            return s;
+        };
+        for (int i = 0; i < 200000; ++i) {
+            std::wstring a = rnd(i % 10 ? 14 : 70), b = a;
+            if (i % 3) b = rnd(i % 10 ? 14 : 70);
+            else for (int k = (int)(rng() % 4); k > 0 && !b.empty(); --k) {   // a few edits of a
+                const size_t p = rng() % b.size();
+                switch (rng() % 4) {
+                case 0: b.erase(p, 1); break;
+                case 1: b.insert(b.begin() + p, alpha[rng() % 11]); break;
+                case 2: b[p] = alpha[rng() % 11]; break;
+                default: if (p + 1 < b.size()) std::swap(b[p], b[p + 1]); break;
+                }
+            }
+            const int exact = ref_osa(a, b);
+            for (int max : { 0, 1, 2, 3, 200 }) {
+                const int got = NameIndex::Distance(a, b, max);
+                if (got != std::min(exact, max + 1)) {
+                    printf("FAIL: distance(%ls, %ls, max %d) = %d, expected %d\n", a.c_str(), b.c_str(), max, got, std::min(exact, max + 1));
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Masquerading names seen in the wild (or one typo away from them), with the name imitated.
+    const std::pair<const wchar_t*, const wchar_t*> kMasquerades[] = {
+        { L"svch0st.exe", L"svchost.exe" },   { L"scvhost.exe", L"svchost.exe" },     { L"svhost.exe", L"svchost.exe" },
+        { L"svchosts.exe", L"svchost.exe" },  { L"svchost.exe.exe", nullptr },         { L"lsasss.exe", L"lsass.exe" },
+        { L"lsas.exe", L"lsass.exe" },        { L"isass.exe", L"lsass.exe" },          { L"1sass.exe", L"lsass.exe" },
+        { L"expl0rer.exe", L"explorer.exe" }, { L"explore.exe", L"explorer.exe" },     { L"exploer.exe", L"explorer.exe" },
+        { L"explorer1.exe", L"explorer.exe" },{ L"csrsss.exe", L"csrss.exe" },         { L"cssrs.exe", L"csrss.exe" },
+        { L"winlogin.exe", L"winlogon.exe" }, { L"wininlt.exe", L"wininit.exe" },      { L"taskhosts.exe", L"taskhostw.exe" },
+        { L"spoolsvc.exe", L"spoolsv.exe" },  { L"services32.exe", L"services.exe" },  { L"rundl32.exe", L"rundll32.exe" },
+        { L"rundll33.exe", L"rundll32.exe" }, { L"powershel.exe", L"powershell.exe" }, { L"p0wershell.exe", L"powershell.exe" },
+        { L"powershell1.exe", L"powershell.exe" }, { L"dllhst.exe", L"dllhost.exe" },  { L"conhostt.exe", L"conhost.exe" },
+        { L"service.exe", L"services.exe" },  { L"msht.exe", L"mshta.exe" },           { L"regsrv32.exe", L"regsvr32.exe" },
+        { L"certutll.exe", L"certutil.exe" }, { L"schtask.exe", L"schtasks.exe" },     { L"wmiprvsc.exe", L"wmiprvse.exe" },
+        { L"chr0me.exe", L"chrome.exe" },     { L"firef0x.exe", L"firefox.exe" },      { L"msedqe.exe", L"msedge.exe" },
+        { L"searchindexar.exe", L"searchindexer.exe" }, { L"runtimebrokerr.exe", L"runtimebroker.exe" },
+        { L"wuaucit.exe", L"wuauclt.exe" },   { L"taskmgrr.exe", L"taskmgr.exe" },     { L"mssmpeng.exe", L"msmpeng.exe" },
+    };
+    // Real process names that must not be flagged (third-party software, tools, games).
+    const wchar_t* const kLegit[] = {
+        L"slack.exe", L"discord.exe", L"spotify.exe", L"zoom.exe", L"code.exe", L"devenv.exe", L"python.exe",
+        L"pythonw.exe", L"java.exe", L"javaw.exe", L"node.exe", L"git.exe", L"ssh.exe", L"steam.exe",
+        L"steamwebhelper.exe", L"epicgameslauncher.exe", L"vlc.exe", L"7zfm.exe", L"7zg.exe", L"winrar.exe",
+        L"notepad++.exe", L"notepad2.exe", L"dropbox.exe", L"googledrivefs.exe", L"keepass.exe", L"1password.exe",
+        L"bitwarden.exe", L"postman.exe", L"docker.exe", L"dockerd.exe", L"com.docker.backend.exe", L"vmware.exe",
+        L"vmtoolsd.exe", L"vboxservice.exe", L"vboxtray.exe", L"nvcontainer.exe", L"nvdisplay.container.exe",
+        L"igfxem.exe", L"igfxtray.exe", L"rtkaudiouniversalservice.exe", L"armsvc.exe", L"adobearm.exe",
+        L"acrotray.exe", L"jusched.exe", L"skype.exe", L"whatsapp.exe", L"telegram.exe", L"signal.exe",
+        L"thunderbird.exe", L"putty.exe", L"winscp.exe", L"filezilla.exe", L"obs64.exe", L"audacity.exe",
+        L"gimp-2.10.exe", L"blender.exe", L"unity.exe", L"idea64.exe", L"pycharm64.exe", L"rider64.exe",
+        L"sublime_text.exe", L"eclipse.exe", L"mysqld.exe", L"postgres.exe", L"redis-server.exe", L"nginx.exe",
+        L"httpd.exe", L"php-cgi.exe", L"tomcat9.exe", L"mongod.exe", L"avp.exe", L"avgui.exe", L"mbam.exe",
+        L"ccsvchst.exe", L"teamviewer.exe", L"anydesk.exe", L"vncserver.exe", L"msteams.exe", L"lghub.exe",
+        L"razer synapse 3.exe", L"icue.exe", L"battle.net.exe", L"origin.exe", L"eadesktop.exe", L"upc.exe",
+        L"everything.exe", L"greenshot.exe", L"sharex.exe", L"procexp64.exe", L"procmon64.exe", L"autoruns64.exe",
+        L"wireshark.exe", L"dumpcap.exe", L"fiddler.exe", L"windbg.exe", L"x64dbg.exe", L"ida64.exe",
+        L"outlookhelper.exe", L"officeclicktorun.exe", L"msoia.exe", L"onenotem.exe", L"lync99.exe",
+        L"googleupdate.exe", L"msedgeupdate.exe", L"updater.exe", L"setup.exe", L"install.exe", L"uninstall.exe",
+        L"crashpad_handler.exe", L"helper.exe", L"agent.exe", L"launcher.exe", L"client.exe",
+        L"server.exe", L"daemon.exe", L"tray.exe", L"monitor.exe", L"sync.exe", L"backup.exe", L"hostess.exe",
+    };
+
+    bool check_precision(const NameIndex& idx) {
+        size_t tp = 0, fp = 0, fn = 0, wrong = 0;
+        NameIndex::Hit hit;
+        for (auto& m : kMasquerades) {
+            const bool h = idx.Lookalike(m.first, hit);
+            if (!m.second) { if (h) ++fp; continue; }
+            if (!h) { ++fn; printf("  missed: %ls\n", m.first); continue; }
+            if (hit.name != m.second) { ++wrong; printf("  %ls -> %ls (expected %ls)\n", m.first, std::wstring(hit.name).c_str(), m.second); }
+            ++tp;
+        }
+        size_t legitFp = 0;
+        for (const wchar_t* n : kLegit)
+            if (idx.Lookalike(n, hit)) { ++legitFp; printf("  false positive: %ls ~ %ls (%d)\n", n, std::wstring(hit.name).c_str(), hit.distance); }
+        fp += legitFp;
+        const size_t positives = sizeof(kMasquerades) / sizeof(kMasquerades[0]) - 1;
+        printf("precision corpus: %zu masquerading names, %zu legitimate: recall %.1f%%, precision %.1f%%, %zu attributed to the wrong name\n",
+            positives, sizeof(kLegit) / sizeof(kLegit[0]) + 1, 100.0 * tp / positives, tp + fp ? 100.0 * tp / (tp + fp) : 100.0, wrong);
+        return !fn && !fp && !wrong;
+    }
+} // anon
+
+int main() {
+    if (!check_distance()) return 1;
+    printf("bit-parallel OSA distance == DP on 200000 random pairs (bounds 0..3, unbounded, names > 64)\n");
+
+    // The built-in list, exactly as heuristics.cpp loads it.
+    NameIndex idx;
+    {
+        const wchar_t text[] =
+#include "protected_names.inc"
+            ;
+        std::wstring_view t = text;
+        while (!t.empty()) {
+            const size_t nl = t.find(L'\n');
+            idx.Add(t.substr(0, nl));
+            t.remove_prefix(nl == std::wstring_view::npos ? t.size() : nl + 1);
+        }
+    }
+    printf("built-in protected names: %zu\n", idx.Size());
+    std::vector<std::wstring> all;
+    {
+        const wchar_t text[] =
+#include "protected_names.inc"
+            ;
+        std::wstring_view t = text;
+        while (!t.empty()) {
+            const size_t nl = t.find(L'\n');
+            if (nl) all.emplace_back(t.substr(0, nl));
+            t.remove_prefix(nl == std::wstring_view::npos ? t.size() : nl + 1);
+        }
+    }
+    NameIndex::Hit hit;
+    for (auto& n : all) if (idx.Lookalike(n, hit)) { printf("FAIL: protected name %ls flagged as lookalike of %ls\n", n.c_str(), std::wstring(hit.name).c_str()); return 1; }
+    if (!check_precision(idx)) { printf("FAIL: precision corpus\n"); return 1; }
+
+    // Through the default rules: the reason names the imitated binary and the distance.
+    SignInfo unsigned_;
+    const heur::Result r = heur::EvaluateProcess(L"C:\\Users\\bob\\AppData\\Roaming\\scvhost.exe", L"scvhost.exe", L"C:\\Users\\bob", L"scvhost.exe", unsigned_);
+    bool reason = false, masq = false;
+    for (const wchar_t* s : r.reasons) {
+        reason |= std::wstring(s) == L"Name resembles svchost.exe (edit distance 1)";
+        masq |= std::wstring(s) == L"Masquerading name/location";
+    }
+    const heur::Result sys = heur::EvaluateProcess(L"C:\\Windows\\System32\\scvhost.exe", L"", L"", L"scvhost.exe", unsigned_);
+    bool sysFlagged = false;   // the real binary's location is exempt (unless = system_image)
+    for (const wchar_t* s : sys.reasons) sysFlagged |= std::wstring(s).find(L"resembles") != std::wstring::npos;
+    if (!reason || !masq || sysFlagged) {
+        printf("FAIL: name_lookalike rule (reason %d, masquerading %d)\n", reason, masq); return 1;
+    }
+    printf("default rules: scvhost.exe in AppData -> \"%ls\" + masquerading\n", L"Name resembles svchost.exe (edit distance 1)");
+
+    // Lookup cost on a realistic mix: mostly unrelated names, some protected, some lookalikes.
+    std::vector<std::wstring> queries;
+    for (const wchar_t* n : kLegit) queries.push_back(n);
+    for (size_t i = 0; i < all.size(); i += 4) queries.push_back(all[i]);
+    for (auto& m : kMasquerades) queries.push_back(m.first);
+    const int rounds = 200;
+    size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < rounds; ++k) for (auto& q : queries) sink += idx.Lookalike(q, hit);
+    const double idxNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / (rounds * queries.size());
+    t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < rounds / 20; ++k)
+        for (auto& q : queries) {
+            int best = 3;
+            for (auto& n : all) best = std::min(best, ref_osa(q, n));
+            sink += best;
+        }
+    const double dpNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / (rounds / 20 * queries.size());
+    printf("lookup over %zu names: index %.2f us, linear DP %.1f us (%.0fx)   [%zu]\n",
+        all.size(), idxNs / 1e3, dpNs / 1e3, dpNs / idxNs, sink & 1);
+    return 0;
+}
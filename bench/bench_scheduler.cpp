@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: MIT
+// --cpu-budget scheduler on a simulated clock and a synthetic process population with
+// churn: the budget holds, new processes go first, high scores come back sooner, the rate
+// backs off on a busy host, the reported coverage latency matches a brute-force replay;
+// then the scheduler's own cost per inspection.
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt bench_scheduler.cpp ../ProcHunt/scheduler.cpp ../ProcHunt/stats.cpp ../ProcHunt/serializer.cpp -o bench_scheduler
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "scheduler.h"
+
+namespace {
+    int g_fail = 0;
+    void check(bool ok, const char* what) {
+        if (!ok) { printf("FAIL: %s\n", what); ++g_fail; }
+    }
+
+    struct SimClock : sched::IClock {
+        uint64_t wall = 1000000, cpu = 0;
+        double busy = 0.3;
+        uint64_t WallUs() override { return wall; }
+        uint64_t CpuUs() override { return cpu; }
+        double HostBusy() override { return busy; }
+    };
+
+    // A host's process table: every process has a fixed inspection cost and score.
+    struct Population {
+        struct Info { uint64_t costUs; int score; uint64_t since; uint64_t inspections = 0; };
+        std::vector<scan::ProcEntry> procs;
+        std::unordered_map<uint32_t, Info> info;
+        std::mt19937 rng;
+        uint32_t nextPid = 4;
+        uint64_t maxLatency = 0;   // brute force: longest wait seen at an inspection
+
+        explicit Population(unsigned seed) : rng(seed) {}
+        void Spawn(uint64_t now, int score = -1) {
+            scan::ProcEntry e;
+            e.pid = nextPid += 4;
+            e.createTime = now;
+            procs.push_back(e);
+            const int s = score >= 0 ? score : (rng() % 10 == 0 ? 30 + (int)(rng() % 71) : 0);
+            info[e.pid] = Info{ 100 + rng() % 1000, s, now };
+        }
+        void Churn(uint64_t now, size_t n) {
+            for (size_t i = 0; i < n && !procs.empty(); ++i) {
+                const size_t j = rng() % procs.size();
+                const uint64_t waited = now - info[procs[j].pid].since;
+                maxLatency = std::max(maxLatency, waited);   // it went this long uninspected before exiting
+                info.erase(procs[j].pid);
+                procs[j] = procs.back();
+                procs.pop_back();
+            }
+            for (size_t i = 0; i < n; ++i) Spawn(now);
+        }
+        uint64_t OpenLatency(uint64_t now) const {
+            uint64_t m = maxLatency;
+            for (auto& kv : info) m = std::max(m, now - kv.second.since);
+            return m;
+        }
+    };
+
+    struct Run {
+        uint64_t enumEveryUs = 2000000;   // --watch 2
+        uint64_t enumCostPerProcUs = 2;
+        size_t churnPerEnum = 2;
+        bool staleReturned = false;
+        bool inspectedSinceEnum = true;
+        std::vector<scan::ProcEntry> fresh, again;
+
+        // Advances the simulated host to `until` the way the --watch loop drives the scheduler.
+        void To(uint64_t until, SimClock& clock, Population& pop, sched::Scheduler& s, uint64_t& nextEnum) {
+            while (clock.wall < until) {
+                // Under overload an enumeration waits for a quantum in between, as in --watch.
+                if (clock.wall >= nextEnum && s.DelayUs() == 0 && (inspectedSinceEnum || s.NextDueUs() != 0)) {
+                    inspectedSinceEnum = false;
+                    pop.Churn(clock.wall, churnPerEnum);
+                    clock.cpu += pop.procs.size() * enumCostPerProcUs;
+                    s.Update(pop.procs);
+                    nextEnum = clock.wall + enumEveryUs;
+                }
+                uint64_t wait = s.DelayUs();
+                if (!wait && s.Begin(fresh, again)) {
+                    const uint64_t t0 = clock.wall;
+                    for (auto* list : { &fresh, &again })
+                        for (auto& e : *list) {
+                            auto it = pop.info.find(e.pid);
+                            if (it == pop.info.end()) { staleReturned = true; continue; }
+                            pop.maxLatency = std::max(pop.maxLatency, t0 - it->second.since);
+                            it->second.since = t0;
+                            ++it->second.inspections;
+                            clock.cpu += it->second.costUs;
+                            clock.wall += it->second.costUs;
+                            s.Done(e, it->second.score);
+                        }
+                    s.End();
+                    inspectedSinceEnum = true;
+                    continue;
+                }
+                if (!wait) wait = s.NextDueUs();
+                if (clock.wall < nextEnum) wait = std::min(wait, nextEnum - clock.wall);
+                wait = std::min(wait, until - clock.wall);
+                clock.wall += std::max<uint64_t>(wait, 1);
+            }
+        }
+    };
+
+    double share(const sched::Stats& a, const sched::Stats& b) {
+        return (double)(b.cpuUs - a.cpuUs) / (double)(b.wallUs - a.wallUs);
+    }
+} // anon
+
+int main() {
+    const uint64_t kSec = 1000000;
+
+    // ---- steady state: 3000 processes, 2% of a core ----
+    {
+        SimClock clock;
+        Population pop(1);
+        for (int i = 0; i < 3000; ++i) pop.Spawn(clock.wall);
+        sched::Options o;
+        o.budget = 0.02;
+        sched::Scheduler s(clock, o);
+        Run run;
+        uint64_t nextEnum = 0;
+        run.To(clock.wall + 3600 * kSec, clock, pop, s, nextEnum);
+        const sched::Stats a = s.GetStats();
+        check(share(sched::Stats{}, a) <= o.budget * 1.01, "budget over the first hour");
+        run.To(clock.wall + 3600 * kSec, clock, pop, s, nextEnum);
+        const sched::Stats b = s.GetStats();
+        const double used = share(a, b);
+        check(used <= o.budget * 1.01, "budget over the second hour");
+        check(b.maxLatencyUs <= o.rescanUs + 10 * kSec && b.overdue < 50, "budget enough: every process within the rescan interval");
+        check(!run.staleReturned, "exited processes never handed out");
+        check(b.live == pop.procs.size(), "live count");
+        check(b.maxLatencyUs == pop.OpenLatency(clock.wall), "coverage latency matches the replay");
+
+        // Scores: an interval of rescan/(1 + score/25), so score 100 comes back 5x as often.
+        double low = 0, high = 0; size_t nLow = 0, nHigh = 0;
+        for (auto& kv : pop.info) {
+            if (kv.second.inspections < 2) continue;   // born recently
+            if (kv.second.score == 0) { low += (double)kv.second.inspections; ++nLow; }
+            if (kv.second.score >= 90) { high += (double)kv.second.inspections; ++nHigh; }
+        }
+        check(nLow && nHigh && high / (double)nHigh > 3 * low / (double)nLow, "high scores inspected more often");
+
+        // Novelty: new processes come before everything already inspected, even when the
+        // rest is overdue.
+        s.Expire();
+        const uint32_t firstNew = pop.nextPid + 4;
+        for (int i = 0; i < 20; ++i) pop.Spawn(clock.wall);
+        s.Update(pop.procs);
+        std::vector<scan::ProcEntry> fresh, again;
+        clock.wall += 10 * kSec;   // enough credit for a quantum
+        const bool began = s.DelayUs() == 0 && s.Begin(fresh, again);
+        bool allNew = fresh.size() == 20;
+        for (auto& e : fresh) { allNew &= e.pid >= firstNew; s.Done(e, 0); }
+        for (auto& e : again) s.Done(e, 0);
+        s.End();
+        check(began && allNew, "new processes first");
+
+        printf("steady   : %zu processes, %.2f%% CPU (budget %.0f%%), %llu inspections/h, coverage latency max %.0f s, p99 %.0f s\n",
+            b.live, used * 100, o.budget * 100, (unsigned long long)(b.inspections - a.inspections),
+            (double)b.maxLatencyUs / kSec, (double)b.latencyUs.Percentile(99) / kSec);
+    }
+
+    // ---- not enough budget: latency grows, the budget still holds ----
+    {
+        SimClock clock;
+        Population pop(2);
+        for (int i = 0; i < 20000; ++i) pop.Spawn(clock.wall);
+        sched::Options o;
+        o.budget = 0.005;
+        sched::Scheduler s(clock, o);
+        Run run;
+        uint64_t nextEnum = 0;
+        run.To(clock.wall + 1800 * kSec, clock, pop, s, nextEnum);
+        const sched::Stats b = s.GetStats();
+        check(share(sched::Stats{}, b) <= o.budget * 1.02, "budget holds when overloaded");
+        check(b.overdue > 0 && b.maxLatencyUs > o.rescanUs, "overload shows as overdue processes and latency");
+        check(b.maxLatencyUs == pop.OpenLatency(clock.wall), "coverage latency under overload");
+        printf("overload : %zu processes, %.2f%% CPU (budget %.1f%%), %zu overdue, coverage latency max %.0f s\n",
+            b.live, share(sched::Stats{}, b) * 100, o.budget * 100, b.overdue, (double)b.maxLatencyUs / kSec);
+    }
+
+    // ---- busy host: the rate backs off to 1/8, then recovers ----
+    {
+        SimClock clock;
+        Population pop(3);
+        for (int i = 0; i < 8000; ++i) pop.Spawn(clock.wall);
+        sched::Options o;
+        o.budget = 0.02;
+        sched::Scheduler s(clock, o);
+        Run run;
+        uint64_t nextEnum = 0;
+        run.To(clock.wall + 600 * kSec, clock, pop, s, nextEnum);
+        const sched::Stats a = s.GetStats();
+        clock.busy = 0.97;
+        run.To(clock.wall + 600 * kSec, clock, pop, s, nextEnum);
+        const sched::Stats b = s.GetStats();
+        clock.busy = 0.3;
+        run.To(clock.wall + 600 * kSec, clock, pop, s, nextEnum);
+        const sched::Stats c = s.GetStats();
+        check(share(a, b) < o.budget / 4, "busy host: rate backs off");
+        check(share(b, c) > o.budget / 2 && c.backoff == 1, "rate recovers");
+        printf("busy host: %.2f%% CPU idle, %.2f%% busy, %.2f%% after\n", share(sched::Stats{}, a) * 100, share(a, b) * 100, share(b, c) * 100);
+    }
+    // ---- the real clock ----
+    {
+        sched::SystemClock c;
+        const uint64_t w0 = c.WallUs(), c0 = c.CpuUs();
+        c.HostBusy();
+        volatile uint64_t x = 0;
+        while (c.WallUs() - w0 < 20000) x = x + 1;
+        const double busy = c.HostBusy();
+        check(c.CpuUs() - c0 >= 5000 && (busy < 0 || (busy > 0 && busy <= 1)), "SystemClock");
+    }
+    if (g_fail) return 1;
+    printf("checks: OK\n");
+
+    // ---- scheduler overhead per inspection (no simulated cost) ----
+    {
+        SimClock clock;
+        Population pop(4);
+        for (int i = 0; i < 100000; ++i) pop.Spawn(clock.wall);
+        sched::Options o;
+        o.budget = 1;
+        o.rescanUs = 1;
+        sched::Scheduler s(clock, o);
+        s.Update(pop.procs);
+        std::vector<scan::ProcEntry> fresh, again;
+        size_t n = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int q = 0; q < 2000; ++q) {
+            clock.wall += 1000;
+            if (!s.Begin(fresh, again)) continue;
+            clock.cpu += 50 * (fresh.size() + again.size());   // settles on quanta of 400
+            for (auto& e : fresh) s.Done(e, 10);
+            for (auto& e : again) s.Done(e, 10);
+            n += fresh.size() + again.size();
+            s.End();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        printf("overhead : %.0f ns/inspection (100k processes, %zu inspections)\n",
+            std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)std::max<size_t>(n, 1), n);
+    }
+    return 0;
+}
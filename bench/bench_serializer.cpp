@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: MIT
+// UTF-8 serializer (print.cpp) vs. the former per-field OutPrintf path, JSON and text.
+// Both write to /dev/null through stdio; output.cpp is replaced by the sink below.
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt bench_serializer.cpp ../ProcHunt/print.cpp ../ProcHunt/serializer.cpp ../ProcHunt/utils.cpp -o bench_serializer
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cwchar>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "output.h"
+#include "print.h"
+#include "utils.h"
+
+// ---- output sink (stands in for output.cpp) ----
+static FILE* g_sink = nullptr;
+static std::string* g_capture = nullptr;
+static size_t g_bytes = 0;
+
+static void sink(const char* p, size_t n) {
+    g_bytes += n;
+    if (g_capture) g_capture->append(p, n);
+    else fwrite(p, 1, n, g_sink);
+}
+void OutInit(const std::wstring&, uint64_t, uint64_t, unsigned) {}
+bool OutClose() { return true; }
+bool OutSync() { return true; }
+void OutFlush() { if (g_sink) fflush(g_sink); }
+void OutWrite(const char* data, size_t n) { sink(data, n); }
+void OutPrintf(const wchar_t* fmt, ...) {
+    // Former output.cpp: size pass, format into a std::wstring, UTF-8 copy, fwrite.
+    static wchar_t scratch[1 << 16];
+    va_list ap, ap2;
+    va_start(ap, fmt); va_copy(ap2, ap);
+    int need = vswprintf(scratch, sizeof(scratch) / sizeof(scratch[0]), fmt, ap);
+    va_end(ap);
+    if (need >= 0) {
+        std::wstring w((size_t)need + 1, L'\0');
+        vswprintf(&w[0], w.size(), fmt, ap2);
+        w.resize((size_t)need);
+        auto u8 = util::to_utf8(w);
+        sink(u8.data(), u8.size());
+    }
+    va_end(ap2);
+}
+
+namespace {
+    // Former print.cpp bodies. MSVC reads %s in wide formats as wchar_t*; glibc needs %ls.
+    void legacy_text(unsigned long pid, std::wstring_view name,
+        std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+        std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+        const SignView& sig, const heur::Result& heur)
+    {
+        if (name.empty()) name = L"(unknown)";
+        OutPrintf(L"\nPID %-6lu  %-30.*ls\n", pid, (int)name.size(), name.data());
+        if (!img.empty())    OutPrintf(L"  ImagePathName    : %.*ls\n", (int)img.size(), img.data());
+        if (!cmd.empty())    OutPrintf(L"  CommandLine      : %.*ls\n", (int)cmd.size(), cmd.data());
+        if (!cwd.empty())    OutPrintf(L"  CurrentDirectory : %.*ls\n", (int)cwd.size(), cwd.data());
+        if (!wtitle.empty()) OutPrintf(L"  WindowTitle      : %.*ls\n", (int)wtitle.size(), wtitle.data());
+        if (!desk.empty())   OutPrintf(L"  DesktopInfo      : %.*ls\n", (int)desk.size(), desk.data());
+        if (!shell.empty())  OutPrintf(L"  ShellInfo        : %.*ls\n", (int)shell.size(), shell.data());
+        if (!rtd.empty())    OutPrintf(L"  RuntimeData      : %.*ls\n", (int)rtd.size(), rtd.data());
+        OutPrintf(L"  Signature        : %ls (%.*ls)\n", sig.trusted ? L"VALID" : L"INVALID/UNSIGNED",
+            (int)sig.trustStatus.size(), sig.trustStatus.data());
+        if (!sig.publisher.empty())  OutPrintf(L"  Publisher        : %.*ls\n", (int)sig.publisher.size(), sig.publisher.data());
+        if (!sig.thumbprint.empty()) OutPrintf(L"  Thumbprint       : %.*ls\n", (int)sig.thumbprint.size(), sig.thumbprint.data());
+        if (heur.obf.length)
+            OutPrintf(L"  Obfuscation      : base64Run=%zu hexRun=%zu entropy=%.2f\n",
+                heur.obf.longestBase64, heur.obf.longestHex, heur.obf.entropy);
+        OutPrintf(L"  SuspicionScore   : %d\n", heur.score);
+        for (const auto& r : heur.reasons) OutPrintf(L"    - %ls\n", r);
+    }
+
+    void legacy_json(bool& first, unsigned long pid, std::wstring_view name,
+        std::wstring_view img, std::wstring_view cmd, std::wstring_view cwd,
+        std::wstring_view wtitle, std::wstring_view desk, std::wstring_view shell, std::wstring_view rtd,
+        const SignView& sig, const heur::Result& heur)
+    {
+        if (!first) OutPrintf(L",");
+        first = false;
+        OutPrintf(L"\n  {");
+        OutPrintf(L"\"pid\":%lu,", pid);
+        OutPrintf(L"\"name\":\"%ls\",", util::json_escape(name).c_str());
+        OutPrintf(L"\"ancestry\":[],");   // no process table behind these records
+        OutPrintf(L"\"imagePath\":\"%ls\",", util::json_escape(img).c_str());
+        OutPrintf(L"\"commandLine\":\"%ls\",", util::json_escape(cmd).c_str());
+        OutPrintf(L"\"currentDirectory\":\"%ls\",", util::json_escape(cwd).c_str());
+        OutPrintf(L"\"windowTitle\":\"%ls\",", util::json_escape(wtitle).c_str());
+        OutPrintf(L"\"desktopInfo\":\"%ls\",", util::json_escape(desk).c_str());
+        OutPrintf(L"\"shellInfo\":\"%ls\",", util::json_escape(shell).c_str());
+        OutPrintf(L"\"runtimeData\":\"%ls\",", util::json_escape(rtd).c_str());
+        OutPrintf(L"\"signature\":{");
+        OutPrintf(L"\"trusted\":%ls,", sig.trusted ? L"true" : L"false");
+        OutPrintf(L"\"status\":\"%ls\",", util::json_escape(sig.trustStatus).c_str());
+        OutPrintf(L"\"publisher\":\"%ls\",", util::json_escape(sig.publisher).c_str());
+        OutPrintf(L"\"thumbprint\":\"%ls\"},", util::json_escape(sig.thumbprint).c_str());
+        OutPrintf(L"\"heuristics\":{");
+        OutPrintf(L"\"score\":%d,", heur.score);
+        OutPrintf(L"\"obfuscation\":{\"length\":%zu,\"longestBase64\":%zu,\"longestHex\":%zu,\"entropy\":%.3f,",
+            heur.obf.length, heur.obf.longestBase64, heur.obf.longestHex, heur.obf.entropy);
+        OutPrintf(L"\"upperRatio\":%.3f,\"lowerRatio\":%.3f,\"digitRatio\":%.3f,\"symbolRatio\":%.3f,\"nonAsciiRatio\":%.3f},",
+            heur.obf.upperRatio, heur.obf.lowerRatio, heur.obf.digitRatio, heur.obf.symbolRatio, heur.obf.nonAsciiRatio);
+        OutPrintf(L"\"reasons\":[");
+        for (size_t i = 0; i < heur.reasons.size(); ++i)
+            OutPrintf(L"\"%ls\"%ls", util::json_escape(heur.reasons[i]).c_str(), (i + 1 < heur.reasons.size()) ? L"," : L"");
+        OutPrintf(L"]}}");
+    }
+
+    struct Rec {
+        unsigned long pid;
+        std::wstring name, img, cmd, cwd, title, desk, shell, rtd, status, pub, thumb;
+        bool trusted;
+        heur::Result res;
+    };
+
+    std::vector<Rec> make_corpus(size_t n, unsigned seed) {
+        static const wchar_t* names[] = { L"svchost.exe", L"powershell.exe", L"chrome.exe", L"r\x00e9sum\x00e9.exe", L"\x6587\x4ef6.exe" };
+        static const wchar_t* reasons[] = { L"Executable in user-writable/Temp/Downloads path", L"LOLBin/suspicious command line",
+            L"Obfuscated/encoded command line", L"Unsigned or untrusted binary", L"Publisher whitelisted" };
+        std::mt19937 rng(seed);
+        std::vector<Rec> v(n);
+        for (size_t i = 0; i < n; ++i) {
+            Rec& r = v[i];
+            r.pid = 4 + 4 * (unsigned long)i;
+            r.name = names[rng() % 5];
+            r.img = L"C:\\Users\\alice\\AppData\\Local\\Temp\\" + r.name;
+            r.cmd = L"\"" + r.img + L"\" -k netsvcs -p -s \"Schedule\"\t--flag=\x0001";
+            if (rng() % 4 == 0) r.cmd += L" -enc " + std::wstring(200 + rng() % 600, L'A');
+            if (rng() % 8 == 0) r.cmd += L" \xD83D\xDE00";   // surrogate pair (emoji on UTF-16)
+            r.cwd = L"C:\\Windows\\system32\\";
+            r.title = r.img;
+            r.desk = L"WinSta0\\Default";
+            r.status = L"ERROR_SUCCESS";
+            r.pub = L"Microsoft Windows";
+            r.thumb = L"3B1EFD3A66EA28B16697394703A72CA340A05BD5";
+            r.trusted = rng() % 2 != 0;
+            r.res.score = (int)(rng() % 101);
+            for (size_t k = 0, m = rng() % 4; k < m; ++k) r.res.reasons.push_back(reasons[rng() % 5]);
+            r.res.obf.length = r.cmd.size();
+            r.res.obf.longestBase64 = rng() % 800; r.res.obf.longestHex = rng() % 40;
+            r.res.obf.entropy = (rng() % 6000) / 1000.0;
+            r.res.obf.upperRatio = 0.125; r.res.obf.lowerRatio = 0.6; r.res.obf.digitRatio = 0.0625;
+            r.res.obf.symbolRatio = 0.2; r.res.obf.nonAsciiRatio = 0.0;
+        }
+        return v;
+    }
+
+    void run_legacy(const std::vector<Rec>& recs, bool json) {
+        bool first = true;
+        if (json) OutPrintf(L"[");
+        for (auto& r : recs) {
+            SignInfo si{ r.trusted, r.status, r.pub, r.thumb, {} };
+            if (json) legacy_json(first, r.pid, r.name, r.img, r.cmd, r.cwd, r.title, r.desk, r.shell, r.rtd, si, r.res);
+            else legacy_text(r.pid, r.name, r.img, r.cmd, r.cwd, r.title, r.desk, r.shell, r.rtd, si, r.res);
+        }
+        if (json) OutPrintf(L"\n]\n");
+    }
+
+    void run_new(const std::vector<Rec>& recs, OutputMode mode) {
+        PrintBegin(mode);
+        for (auto& r : recs) {
+            SignInfo si{ r.trusted, r.status, r.pub, r.thumb, {} };
+            PrintProcess(r.pid, r.name, r.img, r.cmd, r.cwd, r.title, r.desk, r.shell, r.rtd, si, r.res);
+        }
+        PrintEnd();
+    }
+
+    template <class F> double time_ms(F f) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+} // anon
+
+int main() {
+    const auto small = make_corpus(2000, 7);
+    for (bool json : { true, false }) {
+        std::string a, b;
+        g_capture = &a; run_legacy(small, json);
+        g_capture = &b; run_new(small, json ? OutputMode::JsonArray : OutputMode::Text);
+        g_capture = nullptr;
+        if (a != b) {
+            size_t i = 0; while (i < a.size() && i < b.size() && a[i] == b[i]) ++i;
+            printf("MISMATCH (%s) at byte %zu:\n  old: %.80s\n  new: %.80s\n", json ? "json" : "text", i,
+                a.c_str() + (i > 20 ? i - 20 : 0), b.c_str() + (i > 20 ? i - 20 : 0));
+            return 1;
+        }
+    }
+    printf("output identical (json, text)\n");
+
+    g_sink = fopen("/dev/null", "wb");
+    if (!g_sink) { printf("FAIL: /dev/null\n"); return 1; }
+    const auto recs = make_corpus(50000, 11);
+    struct Case { const char* label; bool legacy; OutputMode mode; };
+    const Case cases[] = {
+        { "legacy json   ", true,  OutputMode::JsonArray },
+        { "buffered json ", false, OutputMode::JsonArray },
+        { "buffered ndjson", false, OutputMode::Ndjson },
+        { "legacy text   ", true,  OutputMode::Text },
+        { "buffered text ", false, OutputMode::Text },
+    };
+    for (auto& c : cases) {
+        g_bytes = 0;
+        double ms = time_ms([&] { if (c.legacy) run_legacy(recs, c.mode != OutputMode::Text); else run_new(recs, c.mode); });
+        printf("%s: %8.0f records/s  %7.1f MB/s\n", c.label, recs.size() / (ms / 1000), g_bytes / (ms / 1000) / 1e6);
+    }
+    fclose(g_sink);
+    return 0;
+}
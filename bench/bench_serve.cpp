@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: MIT
+// Resident scorer (--serve) over the Unix-socket transport with a synthetic machine:
+// "score <pid>", "record <json>" and "scan" answer what a one-shot run would print, new
+// processes are found, bad requests and oversized frames are refused, concurrent refreshes
+// never enter the enumerator together, a configuration reload waits for the requests in
+// flight, 8 concurrent clients get their own answers; then
+// request latency (cold and warm) against starting the prochunt executable once per query.
+// build: cmake -S . -B build && cmake --build build --target bench_serve prochunt
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "corpus.h"
+#include "heuristics.h"
+#include "lineage.h"
+#include "print.h"
+#include "serializer.h"
+#include "serve.h"
+#include "sigcache.h"
+
+namespace {
+    const char* const kSock = "/tmp/bench_serve.sock";
+
+    std::wstring W(const char* s) { return std::wstring(s, s + strlen(s)); }
+
+    // The machine: corpus processes with a made-up tree. Costs stand in for the Windows
+    // calls: enumeration 1 ms, PEB read 50 us, WinVerifyTrust 5 ms per image.
+    struct Machine {
+        std::mutex m;
+        std::vector<bench::ProcRecord> recs;
+        std::unordered_map<uint32_t, size_t> byPid;
+        std::unordered_map<std::wstring, SignInfo> sigs;   // per image, as a file has one signature
+
+        void Add(const bench::ProcRecord& r) {
+            std::lock_guard<std::mutex> lk(m);
+            byPid[r.pid] = recs.size();
+            recs.push_back(r);
+            sigs.emplace(r.img, r.sig);
+        }
+        bool Enumerate(std::vector<scan::ProcEntry>& out) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::lock_guard<std::mutex> lk(m);
+            out.clear();
+            for (size_t i = 0; i < recs.size(); ++i) out.push_back({ recs[i].pid, recs[i].ppid, recs[i].name, 1000 + i });
+            return true;
+        }
+    };
+
+    struct Reader : scan::IProcessReader {
+        Machine& mc;
+        explicit Reader(Machine& m) : mc(m) {}
+        bool Read(const scan::ProcEntry& e, ProcParams& out) override {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            std::lock_guard<std::mutex> lk(mc.m);
+            auto it = mc.byPid.find(e.pid);
+            if (it == mc.byPid.end()) return false;
+            const bench::ProcRecord& r = mc.recs[it->second];
+            out.name = r.name; out.imagePath = r.img; out.commandLine = r.cmd; out.currentDirectory = r.cwd;
+            out.windowTitle = r.wtitle; out.desktopInfo = r.desk; out.shellInfo = r.shell; out.runtimeData = r.rtd;
+            return true;
+        }
+    };
+
+    struct Verifier : scan::ISignatureVerifier {
+        Machine& mc;
+        std::atomic<int> calls{ 0 };
+        explicit Verifier(Machine& m) : mc(m) {}
+        SignInfo Verify(const std::wstring& path) override {
+            ++calls;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            std::lock_guard<std::mutex> lk(mc.m);
+            auto it = mc.sigs.find(path);
+            return it == mc.sigs.end() ? SignInfo() : it->second;
+        }
+    };
+
+    bool file_id(const std::wstring& path, sig::FileId& id) {
+        id = sig::FileId{};
+        id.size = path.size(); id.fileIndex = std::hash<std::wstring>()(path);
+        return true;
+    }
+
+    // What a one-shot run prints for process `i` of the machine (enumeration order).
+    std::string expected(Machine& mc, size_t i) {
+        std::vector<scan::ProcEntry> procs;
+        mc.Enumerate(procs);
+        lin::Graph g;
+        g.Build(procs);
+        const bench::ProcRecord& r = mc.recs[i];
+        const SignInfo& sig = mc.sigs[r.img];
+        const heur::Result res = heur::EvaluateProcess(r.img, r.cmd, r.cwd, r.name, sig, g.ParentName(r.pid));
+        lin::Chain chain;
+        g.Ancestry(r.pid, chain);
+        ser::Buffer b(4096);
+        WriteJsonProcess(b, r.pid, r.name, r.img, r.cmd, r.cwd, r.wtitle, r.desk, r.shell, r.rtd, sig, res, &chain);
+        b.Put('\n');
+        return std::string(b.Data(), b.Size());
+    }
+
+    bool call(serve::Client& c, const std::string& req, std::string& resp) {
+        if (c.Call(req, resp)) return true;
+        printf("FAIL: call \"%.40s\" failed\n", req.c_str());
+        return false;
+    }
+
+    bool expect(const char* what, const std::string& got, const std::string& want) {
+        if (got == want) return true;
+        printf("FAIL: %s\n  got:  %.200s\n  want: %.200s\n", what, got.c_str(), want.c_str());
+        return false;
+    }
+
+    double pct(std::vector<double>& v, double p) {
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+    }
+} // anon
+
+int main(int, char** argv) {
+    Machine mc;
+    for (const auto& r : bench::MakeCorpus(300, 5)) mc.Add(r);
+    Reader reader(mc);
+    Verifier verifier(mc);
+    sig::Cache cache(verifier, file_id);
+    serve::Options opt;
+    opt.scanThreads = 4;
+    serve::Handler handler([&](std::vector<scan::ProcEntry>& out) { return mc.Enumerate(out); }, reader, cache, opt);
+    serve::Server server(handler);
+    std::wstring err;
+    if (!server.Listen(W(kSock), &err)) { printf("FAIL: listen: %ls\n", err.c_str()); return 1; }
+    std::thread srv([&] { server.Run(); });
+    auto done = [&](int rc) { server.Stop(); srv.join(); return rc; };
+
+    std::vector<std::string> want(mc.recs.size());
+    for (size_t i = 0; i < want.size(); ++i) want[i] = expected(mc, i);
+
+    serve::Client c;
+    std::string resp;
+    if (!c.Connect(W(kSock), &err)) { printf("FAIL: connect: %ls\n", err.c_str()); return done(1); }
+
+    // Cold: the first query of an image pays the signature check, later ones do not.
+    auto t0 = std::chrono::steady_clock::now();
+    if (!call(c, "score " + std::to_string(mc.recs[0].pid), resp) || !expect("score (cold)", resp, want[0])) return done(1);
+    const double coldMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    for (size_t i = 0; i < mc.recs.size(); ++i)
+        if (!call(c, "score " + std::to_string(mc.recs[i].pid), resp) || !expect("score <pid>", resp, want[i])) return done(1);
+    for (size_t i = 0; i < mc.recs.size(); ++i)
+        if (!call(c, "record " + want[i], resp) || !expect("record <json>", resp, want[i])) return done(1);
+    std::string all, above;
+    for (size_t i = 0; i < want.size(); ++i) {
+        all += want[i];
+        if (want[i].find("\"score\":") != std::string::npos) {
+            const int s = atoi(want[i].c_str() + want[i].find("\"score\":") + 8);
+            if (s >= 40) above += want[i];
+        }
+    }
+    if (!call(c, "scan", resp) || !expect("scan", resp, all)) return done(1);
+    if (!call(c, "scan 40", resp) || !expect("scan 40", resp, above)) return done(1);
+
+    // A process started after the table was taken is found by enumerating again.
+    bench::ProcRecord late = mc.recs[3];
+    late.pid = 999996; late.ppid = mc.recs[1].pid; late.name = L"late.exe";
+    mc.Add(late);
+    want.push_back(expected(mc, mc.recs.size() - 1));
+    if (!call(c, "score 999996", resp) || !expect("new process", resp, want.back())) return done(1);
+
+    const char* const bad[][2] = {
+        { "score 123456789", "{\"error\":\"no such process\"}\n" },
+        { "score x", "{\"error\":\"usage: score <pid>\"}\n" },
+        { "scan 101", "{\"error\":\"usage: scan [<min-score 0-100>]\"}\n" },
+        { "record {\"pid\":", "{\"error\":\"malformed record\"}\n" },
+        { "record {\"event\":\"exited\"}", "{\"error\":\"not a process record\"}\n" },
+        { "", "{\"error\":\"unknown request (ping, score <pid>, scan [<min-score>], record <json>)\"}\n" },
+    };
+    for (auto& b : bad)
+        if (!call(c, b[0], resp) || !expect(b[0], resp, b[1])) return done(1);
+    if (!call(c, "ping", resp) || resp.rfind("{\"ok\":true,\"requests\":", 0) != 0) { printf("FAIL: ping: %s\n", resp.c_str()); return done(1); }
+    {
+        // A frame over kMaxRequest closes the connection without an answer.
+        serve::Client big;
+        big.Connect(W(kSock));
+        std::string huge(serve::kMaxRequest + 1, 'x');
+        if (big.Call(huge, resp)) { printf("FAIL: oversized frame answered\n"); return done(1); }
+    }
+
+    {
+        // Refreshing requests on many threads: the enumerator, which like EnumProcesses reuses
+        // one buffer, is never entered twice at once, and every request still gets an answer.
+        std::atomic<int> inside{ 0 }, overlaps{ 0 }, calls{ 0 };
+        std::vector<scan::ProcEntry> shared;
+        serve::Handler h([&](std::vector<scan::ProcEntry>& out) {
+            if (++inside > 1) ++overlaps;
+            ++calls;
+            mc.Enumerate(shared);
+            out = shared;
+            --inside;
+            return true;
+            }, reader, cache, opt);
+        std::atomic<int> bad{ 0 };
+        std::vector<std::thread> ths;
+        for (int t = 0; t < 8; ++t) ths.emplace_back([&] {
+            ser::Buffer b(256);
+            for (int k = 0; k < 20; ++k) {
+                b.Clear();
+                h.Handle("score 123456789", b);   // unknown PID: always enumerates again
+                if (std::string(b.Data(), b.Size()) != "{\"error\":\"no such process\"}\n") ++bad;
+            }
+            });
+        for (auto& x : ths) x.join();
+        if (overlaps || bad) { printf("FAIL: concurrent refresh: %d overlapping enumerations, %d wrong answers\n", overlaps.load(), bad.load()); return done(1); }
+        printf("concurrent refresh: %d enumerations for 160 requests, none overlapping\n", calls.load());
+    }
+
+    {
+        // Reload between requests: apply() never runs while a request reads a process, and
+        // every change seen by changed() is applied.
+        struct Counting : scan::IProcessReader {
+            Reader& inner;
+            std::atomic<int> active{ 0 };
+            explicit Counting(Reader& r) : inner(r) {}
+            bool Read(const scan::ProcEntry& e, ProcParams& out) override {
+                ++active;
+                const bool ok = inner.Read(e, out);
+                --active;
+                return ok;
+            }
+        } counting(reader);
+        serve::Options ro = opt;
+        ro.reloadCheckMs = 0;
+        serve::Handler h([&](std::vector<scan::ProcEntry>& out) { return mc.Enumerate(out); }, counting, cache, ro);
+        std::atomic<int> checks{ 0 }, applied{ 0 }, busy{ 0 }, bad{ 0 };
+        h.SetReload({ [&] { return ++checks % 16 == 0; }, [&] { if (counting.active) ++busy; ++applied; } });
+        std::vector<std::thread> ths;
+        for (int t = 0; t < 8; ++t) ths.emplace_back([&, t] {
+            ser::Buffer b(4096);
+            for (int k = 0; k < 40; ++k) {
+                const size_t i = (size_t)(t * 40 + k) % want.size();
+                b.Clear();
+                h.Handle("score " + std::to_string(mc.recs[i].pid), b);
+                if (std::string(b.Data(), b.Size()) != want[i]) ++bad;
+            }
+            });
+        for (auto& x : ths) x.join();
+        if (busy || bad || !applied || h.Reloads() != (uint64_t)applied) {
+            printf("FAIL: reload: %d applied (%llu counted), %d during a request, %d wrong answers\n",
+                applied.load(), (unsigned long long)h.Reloads(), busy.load(), bad.load());
+            return done(1);
+        }
+        printf("reload: %d reloads for %d checks over 320 requests, none during a request\n", applied.load(), checks.load());
+    }
+
+    // 8 clients, mixed requests, each checks its own answers.
+    std::atomic<int> wrong{ 0 };
+    std::vector<double> lat[8];
+    std::vector<std::thread> th;
+    for (int t = 0; t < 8; ++t) th.emplace_back([&, t] {
+        serve::Client cl;
+        std::string r;
+        std::mt19937 rng(t + 1);
+        if (!cl.Connect(W(kSock))) { ++wrong; return; }
+        for (int k = 0; k < 300; ++k) {
+            const size_t i = rng() % want.size();
+            const std::string req = k % 2 ? "score " + std::to_string(mc.recs[i].pid) : "record " + want[i];
+            const auto s = std::chrono::steady_clock::now();
+            if (!cl.Call(req, r) || r != want[i]) ++wrong;
+            lat[t].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s).count());
+        }
+        });
+    for (auto& x : th) x.join();
+    if (wrong) { printf("FAIL: %d wrong answers with 8 clients\n", wrong.load()); return done(1); }
+    printf("score/record/scan == one-shot output, new process, errors, oversized frame, 8 concurrent clients ok\n");
+
+    // Latency, one client, warm.
+    auto measure = [&](const std::function<std::string(size_t)>& req, int n) {
+        std::vector<double> v;
+        for (int k = 0; k < n; ++k) {
+            const std::string q = req((size_t)k % mc.recs.size());
+            const auto s = std::chrono::steady_clock::now();
+            c.Call(q, resp);
+            v.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s).count());
+        }
+        return v;
+    };
+    std::vector<double> score = measure([&](size_t i) { return "score " + std::to_string(mc.recs[i].pid); }, 2000);
+    std::vector<double> record = measure([&](size_t i) { return "record " + want[i]; }, 2000);
+    std::vector<double> scans = measure([&](size_t) { return std::string("scan"); }, 20);
+    std::vector<double> conc;
+    for (auto& v : lat) conc.insert(conc.end(), v.begin(), v.end());
+    printf("cold score (signature check): %.2f ms\n", coldMs);
+    printf("warm score <pid>:    p50 %.3f ms  p99 %.3f ms\n", pct(score, 0.5), pct(score, 0.99));
+    printf("warm record <json>:  p50 %.3f ms  p99 %.3f ms\n", pct(record, 0.5), pct(record, 0.99));
+    printf("8 clients (mixed):   p50 %.3f ms  p99 %.3f ms\n", pct(conc, 0.5), pct(conc, 0.99));
+    printf("scan (%zu processes, 4 threads): p50 %.1f ms\n", mc.recs.size(), pct(scans, 0.5));
+    const auto st = cache.Stats();
+    printf("signature checks: %d for %zu images (%llu cache hits)\n", verifier.calls.load(), mc.sigs.size(), (unsigned long long)st.hits);
+    c.Close();
+
+    // The alternative: one process per query. prochunt re-scores a record file, which is the
+    // same work as "record" plus process start, rule compilation and output setup.
+    std::string exe = argv[0];
+    exe = exe.substr(0, exe.rfind('/') + 1) + "prochunt";
+    if (access(exe.c_str(), X_OK) == 0) {
+        FILE* f = fopen("/tmp/bench_serve_rec.json", "wb");
+        fwrite(want[0].data(), 1, want[0].size(), f);
+        fclose(f);
+        const std::string cmd = exe + " --ingest /tmp/bench_serve_rec.json -o /dev/null 2>/dev/null";
+        std::vector<double> v;
+        for (int k = 0; k < 20; ++k) {
+            const auto s = std::chrono::steady_clock::now();
+            if (system(cmd.c_str()) != 0) break;
+            v.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s).count());
+        }
+        remove("/tmp/bench_serve_rec.json");
+        if (!v.empty()) printf("one prochunt process per record: p50 %.2f ms (%.0fx the resident answer)\n", pct(v, 0.5), pct(v, 0.5) / pct(record, 0.5));
+    }
+    return done(0);
+}
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: MIT
+// Asynchronous output sink (sink.h, output.cpp): bytes arrive in order and whole, size
+// and line-count rotation keeps N files that each end on a whole line, Sync() is a
+// durability point, a failing target is reported; then a simulated scan (per-record work
+// plus formatting) writing to an artificially slow device, synchronously as output.cpp
+// used to and through the sink.
+// build: cmake -S . -B build && cmake --build build --target bench_sink
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "corpus.h"
+#include "heuristics.h"
+#include "output.h"
+#include "print.h"
+#include "serializer.h"
+#include "sink.h"
+
+namespace {
+    const char* const kOut = "/tmp/bench_sink.ndjson";
+
+    std::wstring W(const char* s) { return std::wstring(s, s + strlen(s)); }
+
+    std::string slurp(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+    bool exists(const std::string& path) { std::ifstream in(path); return (bool)in; }
+    void cleanup() {
+        remove(kOut);
+        for (int k = 1; k <= 8; ++k) remove((std::string(kOut) + "." + std::to_string(k)).c_str());
+    }
+
+    // Collects what it is given; optionally slow: `latency` per write, and one `pause` on
+    // the write that starts at `pauseAt` bytes (a console nobody reads, a disk hiccup).
+    struct SlowTarget : sink::Target {
+        std::string got;
+        std::chrono::microseconds latency{ 0 }, pause{ 0 };
+        size_t pauseAt = (size_t)-1;
+        int syncs = 0;
+        bool fail = false;
+        bool Write(const char* p, size_t n) override {
+            if (fail) return false;
+            if (got.size() <= pauseAt && got.size() + n > pauseAt) std::this_thread::sleep_for(pause);
+            std::this_thread::sleep_for(latency);
+            got.append(p, n);
+            return true;
+        }
+        bool Sync() override { ++syncs; return !fail; }
+    };
+
+    // One formatted --ndjson line per corpus record.
+    std::vector<std::string> make_lines(size_t n) {
+        std::vector<std::string> lines;
+        ser::Buffer b(8192);
+        for (const auto& r : bench::MakeCorpus(n, 11)) {
+            b.Clear();
+            const heur::Result res = heur::EvaluateProcess(r.img, r.cmd, r.cwd, r.name, r.sig);
+            WriteJsonProcess(b, r.pid, r.name, r.img, r.cmd, r.cwd, r.wtitle, r.desk, r.shell, r.rtd, r.sig, res);
+            b.Put('\n');
+            lines.emplace_back(b.Data(), b.Size());
+        }
+        return lines;
+    }
+
+    bool check(const std::vector<std::string>& lines) {
+        std::string all;
+        for (const auto& l : lines) all += l;
+
+        // In order and whole, with writes larger than a buffer and a ring that fills up.
+        {
+            auto t = std::make_unique<SlowTarget>();
+            SlowTarget* tp = t.get();
+            tp->latency = std::chrono::microseconds(200);
+            sink::Options o;
+            o.bufferBytes = 4096; o.buffers = 2;
+            sink::Async a(std::move(t), o);
+            std::string big(100000, 'x');
+            a.Write(big.data(), big.size());
+            for (const auto& l : lines) a.Write(l.data(), l.size());
+            if (!a.Sync() || tp->got != big + all || tp->syncs != 1) { printf("FAIL: Sync did not deliver everything\n"); return false; }
+            a.Write("z", 1);
+            const sink::Stats st = a.GetStats();
+            if (!a.Close() || tp->got != big + all + "z" || st.waits == 0) { printf("FAIL: close / producer waits (%llu)\n", (unsigned long long)st.waits); return false; }
+        }
+        // A target that fails is reported by Sync and Close.
+        {
+            auto t = std::make_unique<SlowTarget>();
+            t->fail = true;
+            sink::Async a(std::move(t));
+            a.Write("abc", 3);
+            if (a.Sync() || a.Close() || a.GetStats().errors == 0) { printf("FAIL: write errors not reported\n"); return false; }
+        }
+        // Rotation through output.cpp: 64 KB files, 700 lines, or both, 3 kept, written a
+        // line at a time and as one 6 MB write (--ingest hands over whole chunks). Every file
+        // ends on a line and stays under the limits, a file rotated by count holds exactly
+        // that many lines; the kept files are the end of the stream.
+        const uint64_t limit = 64 * 1024, count = 700;
+        const uint64_t limits[][2] = { { limit, 0 }, { 0, count }, { limit, count }, { 1 << 20, count } };
+        for (int run = 0; run < 8; ++run) {
+            const uint64_t bytes = limits[run / 2][0], records = limits[run / 2][1];
+            const bool whole = run % 2;
+            cleanup();
+            OutInit(W(kOut), bytes, records, 3);
+            if (whole) OutWrite(all.data(), all.size());
+            else for (const auto& l : lines) OutWrite(l.data(), l.size());
+            if (!OutClose()) { printf("FAIL: OutClose\n"); return false; }
+            std::string kept;
+            for (int k = 3; k >= 0; --k) {
+                const std::string p = k ? std::string(kOut) + "." + std::to_string(k) : std::string(kOut);
+                const std::string f = slurp(p);
+                const size_t n = (size_t)std::count(f.begin(), f.end(), '\n');
+                if (f.empty() || (bytes && f.size() > bytes) || f.back() != '\n' || (records && n > records)
+                    || (k && records && !bytes && n != records)) {
+                    printf("FAIL: %s: %zu bytes, %zu lines (limits %llu bytes, %llu lines)\n", p.c_str(), f.size(), n,
+                        (unsigned long long)bytes, (unsigned long long)records);
+                    return false;
+                }
+                kept += f;
+            }
+            if (exists(std::string(kOut) + ".4") || all.compare(all.size() - kept.size(), kept.size(), kept) != 0
+                || (kept.size() != all.size() && all[all.size() - kept.size() - 1] != '\n')) {
+                printf("FAIL: rotated files are not the end of the output\n");
+                return false;
+            }
+        }
+        // Without rotation: one file with everything.
+        OutInit(W(kOut));
+        for (const auto& l : lines) OutWrite(l.data(), l.size());
+        if (!OutSync() || slurp(kOut) != all) { printf("FAIL: OutSync\n"); return false; }
+        OutClose();
+        cleanup();
+        return true;
+    }
+
+    // The scan: per-record work (PEB read, scoring), formatting into a 60 KB buffer written
+    // when full, as print.cpp does. Returns the seconds until the scan loop is done; `tail`
+    // gets the time after that until every byte is on the target.
+    template <class WriteFn, class DoneFn>
+    double run_scan(const std::vector<std::string>& lines, std::chrono::microseconds work, WriteFn write, DoneFn done, double& tail) {
+        ser::Buffer b(64 * 1024);
+        const auto t0 = std::chrono::steady_clock::now();
+        for (const auto& l : lines) {
+            const auto until = std::chrono::steady_clock::now() + work;
+            while (std::chrono::steady_clock::now() < until) {}
+            b.Put(l);
+            if (b.Size() >= 60 * 1024) { write(b.Data(), b.Size()); b.Clear(); }
+        }
+        if (b.Size()) write(b.Data(), b.Size());
+        const auto t1 = std::chrono::steady_clock::now();
+        done();
+        tail = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+        return std::chrono::duration<double>(t1 - t0).count();
+    }
+} // anon
+
+int main() {
+    const std::vector<std::string> lines = make_lines(4000);
+    if (!check(lines)) { cleanup(); return 1; }
+    printf("order and completeness, producer back-pressure, Sync/Close errors, rotation by size and count (whole records, 3 kept) ok\n");
+
+    size_t total = 0;
+    for (const auto& l : lines) total += l.size();
+    printf("%zu records, %.1f MB, 20 us of work per record\n", lines.size(), total / 1048576.0);
+    struct Device { const char* name; int latencyUs; int pauseMs; };
+    const Device devices[] = {
+        { "fast device", 0, 0 },
+        { "2 ms per write", 2000, 0 },
+        { "8 ms per write", 8000, 0 },
+        { "one 40 ms stall", 0, 40 },
+        { "one 150 ms stall", 0, 150 },
+    };
+    const auto work = std::chrono::microseconds(20);
+    for (const Device& d : devices) {
+        double syncScan, syncTail, asyncScan, asyncTail;
+        {
+            SlowTarget t;
+            t.latency = std::chrono::microseconds(d.latencyUs);
+            t.pause = std::chrono::milliseconds(d.pauseMs);
+            t.pauseAt = total / 3;
+            syncScan = run_scan(lines, work, [&](const char* p, size_t n) { t.Write(p, n); }, [&] { t.Sync(); }, syncTail);
+            if (t.got.size() != total) { printf("FAIL: synchronous run lost bytes\n"); return 1; }
+        }
+        sink::Stats st;
+        {
+            auto t = std::make_unique<SlowTarget>();
+            SlowTarget* tp = t.get();
+            tp->latency = std::chrono::microseconds(d.latencyUs);
+            tp->pause = std::chrono::milliseconds(d.pauseMs);
+            tp->pauseAt = total / 3;
+            sink::Async a(std::move(t));
+            asyncScan = run_scan(lines, work, [&](const char* p, size_t n) { a.Write(p, n); }, [&] { st = a.GetStats(); a.Close(); }, asyncTail);
+            if (tp->got.size() != total) { printf("FAIL: asynchronous run lost bytes\n"); return 1; }
+        }
+        printf("  %-18s synchronous: scan %6.1f ms (+%5.1f)   sink: scan %6.1f ms (+%5.1f), %llu hand-offs, %llu waits\n",
+            d.name, syncScan * 1e3, syncTail * 1e3, asyncScan * 1e3, asyncTail * 1e3,
+            (unsigned long long)st.handoffs, (unsigned long long)st.waits);
+    }
+    printf("  (+ = time after the scan loop until the output is complete)\n");
+    return 0;
+}
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: MIT
+// --stats instrumentation: histogram bucket bounds and percentile error, merging,
+// per-thread recording, then the cost of the timers on an in-memory scan (worst case:
+// no I/O at all) and on a scan with the cheapest realistic per-process I/O.
+// build: cmake -S . -B build && cmake --build build --target bench_stats
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "corpus.h"
+#include "pipeline.h"
+#include "stats.h"
+
+namespace {
+    using stats::Histogram;
+
+    bool check_buckets() {
+        std::mt19937_64 rng(5);
+        std::vector<uint64_t> vals;
+        for (uint64_t v = 0; v < (1u << 16); ++v) vals.push_back(v);
+        for (int i = 0; i < 200000; ++i) vals.push_back(rng() >> (rng() % 64));
+        vals.push_back(UINT64_MAX);
+        for (uint64_t v : vals) {
+            const int b = Histogram::BucketOf(v);
+            if (b < 0 || b >= Histogram::kBuckets || Histogram::BucketLow(b) > v || Histogram::BucketHigh(b) < v) {
+                printf("FAIL: %llu -> bucket %d [%llu, %llu]\n", (unsigned long long)v, b,
+                    (unsigned long long)Histogram::BucketLow(b), (unsigned long long)Histogram::BucketHigh(b));
+                return false;
+            }
+        }
+        for (int b = 1; b < Histogram::kBuckets; ++b) {
+            if (Histogram::BucketLow(b) != Histogram::BucketHigh(b - 1) + 1) { printf("FAIL: gap before bucket %d\n", b); return false; }
+            const double width = (double)(Histogram::BucketHigh(b) - Histogram::BucketLow(b) + 1);
+            if (b >= Histogram::kSub && width / (double)Histogram::BucketLow(b) > 1.0 / Histogram::kSub + 1e-12) {
+                printf("FAIL: bucket %d wider than 1/%d\n", b, Histogram::kSub); return false;
+            }
+        }
+        if (Histogram::BucketOf(UINT64_MAX) != Histogram::kBuckets - 1) { printf("FAIL: last bucket\n"); return false; }
+        return true;
+    }
+
+    bool check_percentiles() {
+        // Latency-like: log-uniform between 1 us and 50 ms, in ns.
+        std::mt19937 rng(9);
+        std::vector<uint64_t> v;
+        Histogram h, a, b;
+        for (int i = 0; i < 100000; ++i) {
+            const double u = (double)rng() / 4294967296.0;
+            const uint64_t ns = (uint64_t)(1000.0 * std::exp(u * std::log(50000.0)));
+            v.push_back(ns);
+            h.Record(ns);
+            (i % 3 ? a : b).Record(ns);
+        }
+        std::sort(v.begin(), v.end());
+        for (double p : { 1.0, 50.0, 90.0, 99.0, 99.9, 100.0 }) {
+            size_t rank = (size_t)std::ceil(p / 100.0 * (double)v.size());
+            const uint64_t exact = v[std::max<size_t>(rank, 1) - 1];
+            const uint64_t got = h.Percentile(p);
+            if (got < exact || (double)got > (double)exact * (1.0 + 1.0 / Histogram::kSub)) {
+                printf("FAIL: p%.1f = %llu, exact %llu\n", p, (unsigned long long)got, (unsigned long long)exact);
+                return false;
+            }
+        }
+        a.Merge(b);
+        if (a.Count() != h.Count() || a.Sum() != h.Sum() || a.Max() != h.Max() || a.Min() != h.Min()
+            || a.Percentile(50) != h.Percentile(50) || a.Percentile(99) != h.Percentile(99)) {
+            printf("FAIL: merged histogram differs\n"); return false;
+        }
+        Histogram empty;
+        if (empty.Percentile(50) || empty.Max() || empty.Min() || empty.Count()) { printf("FAIL: empty histogram\n"); return false; }
+        return true;
+    }
+
+    bool check_recording() {
+#if PROCHUNT_STATS
+        stats::Reset();
+        stats::Enable(false);
+        { stats::Timer t(stats::S_READ); }
+        if (stats::Collect().stage[stats::S_READ].ns.Count()) { printf("FAIL: recorded while disabled\n"); return false; }
+
+        stats::Enable(true);
+        const int threads = 8, per = 10000;
+        std::vector<std::thread> ts;
+        for (int i = 0; i < threads; ++i)
+            ts.emplace_back([=] {
+                for (int k = 0; k < per; ++k) stats::Record(stats::S_VERIFY, (uint64_t)(k + 1));
+                stats::Fail(stats::S_READ);
+            });
+        for (int k = 0; k < per; ++k) stats::Record(stats::S_VERIFY, (uint64_t)(k + 1));   // a thread still alive
+        for (auto& t : ts) t.join();
+        const stats::Snapshot s = stats::Collect();
+        const Histogram& h = s.stage[stats::S_VERIFY].ns;
+        if (h.Count() != (uint64_t)(threads + 1) * per || h.Sum() != (uint64_t)(threads + 1) * per * (per + 1) / 2
+            || s.stage[stats::S_READ].failures != (uint64_t)threads || h.Max() != (uint64_t)per) {
+            printf("FAIL: per-thread totals (count %llu)\n", (unsigned long long)h.Count()); return false;
+        }
+        stats::Reset();
+        if (stats::Collect().stage[stats::S_VERIFY].ns.Count()) { printf("FAIL: reset\n"); return false; }
+        stats::Enable(false);
+#endif
+        return true;
+    }
+
+    void spin_us(double us) {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::micro>(us);
+        while (std::chrono::steady_clock::now() < end) {}
+    }
+
+    // Records from the corpus; readUs/verifyUs > 0 stand in for the OS calls (busy wait).
+    struct CorpusReader : scan::IProcessReader {
+        const std::vector<bench::ProcRecord>* recs;
+        double readUs = 0;
+        bool Read(const scan::ProcEntry& e, ProcParams& out) override {
+            if (readUs > 0) spin_us(readUs);
+            const auto& r = (*recs)[e.pid];
+            if (r.pid % 23 == 0) return false;
+            out.name = r.name; out.imagePath = r.img; out.commandLine = r.cmd; out.currentDirectory = r.cwd;
+            return true;
+        }
+    };
+    struct CorpusVerifier : scan::ISignatureVerifier {
+        double verifyUs = 0;
+        SignInfo Verify(const std::wstring& path) override {
+            if (verifyUs > 0) spin_us(verifyUs);
+            SignInfo s;
+            s.trusted = path.find(L"Windows") != std::wstring::npos;
+            if (s.trusted) s.publisher = L"Microsoft Windows";
+            return s;
+        }
+    };
+
+    double scan_ms(const std::vector<bench::ProcRecord>& recs, double readUs, double verifyUs, uint64_t& sink) {
+        std::vector<scan::ProcEntry> table(recs.size());
+        for (size_t i = 0; i < recs.size(); ++i) table[i].pid = (uint32_t)i;
+        scan::ListSource src(std::move(table));
+        CorpusReader reader; reader.recs = &recs; reader.readUs = readUs;
+        CorpusVerifier verifier; verifier.verifyUs = verifyUs;
+        scan::Options opt; opt.threads = 1;
+        auto t0 = std::chrono::steady_clock::now();
+        scan::Run(src, reader, verifier, opt, [&](scan::ScanItem& it) { sink += it.ok ? (uint64_t)it.res.score : 0; });
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // Best-of-5 scan time with stats off and on.
+    void compare(const std::vector<bench::ProcRecord>& recs, double readUs, double verifyUs, double& off, double& on, uint64_t& sink) {
+        off = on = 1e300;
+        for (int r = 0; r < 5; ++r) {
+            stats::Enable(false); off = std::min(off, scan_ms(recs, readUs, verifyUs, sink));
+            stats::Enable(true);  on = std::min(on, scan_ms(recs, readUs, verifyUs, sink));
+        }
+    }
+} // anon
+
+int main() {
+    if (!check_buckets() || !check_percentiles() || !check_recording()) return 1;
+    printf("histogram buckets, percentiles (<= 1/%d error), merge, per-thread recording: ok\n", Histogram::kSub);
+
+#if PROCHUNT_STATS
+    // Cost of one enabled timer (two Ticks() reads + a histogram update) and of one lap.
+    stats::Enable(true);
+    const int n = 2000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) { stats::Timer t(stats::S_EVALUATE); }
+    const double timerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+    stats::Laps lap;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) lap.Lap(stats::S_EVALUATE);
+    const double lapNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+    stats::Enable(false);
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) { stats::Timer t(stats::S_EVALUATE); }
+    const double offNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+    printf("timer: %.1f ns, lap: %.1f ns, disabled: %.2f ns\n", timerNs, lapNs, offNs);
+    // Per scanned process: Laps start + 3 laps (read, verify, evaluate) + an output timer.
+    const double perProcessNs = 4 * lapNs + timerNs;
+
+    stats::Reset();
+    uint64_t sink = 0;
+    double off, on;
+    // Worst case: everything in memory, so only heuristics and copies remain per process.
+    const auto recs = bench::MakeCorpus(20000, 3);
+    compare(recs, 0, 0, off, on, sink);
+    printf("in-memory scan, %zu processes: %.1f ms off, %.1f ms on (%+.2f%% measured, %.2f%% from timer cost)\n",
+        recs.size(), off, on, (on / off - 1.0) * 100.0, perProcessNs * recs.size() / (off * 1e6) * 100.0);
+
+    // Cheapest live scan: ~15 us of PEB reads per process, signatures answered by --sig-cache.
+    const std::vector<bench::ProcRecord> live(recs.begin(), recs.begin() + 3000);
+    compare(live, 15, 2, off, on, sink);
+    const double estimate = perProcessNs * live.size() / (off * 1e6) * 100.0;
+    printf("live-like scan, %zu processes (15 us read, 2 us cached verify): %.1f ms off, %.1f ms on (%+.2f%% measured, %.2f%% from timer cost)\n",
+        live.size(), off, on, (on / off - 1.0) * 100.0, estimate);
+
+    const stats::Snapshot s = stats::Collect();
+    printf("read: %llu (%llu failed), verify p50 %.1f us, evaluate p50 %.1f us p99 %.1f us   [%llu]\n",
+        (unsigned long long)s.stage[stats::S_READ].ns.Count(), (unsigned long long)s.stage[stats::S_READ].failures,
+        s.stage[stats::S_VERIFY].ns.Percentile(50) / 1e3,
+        s.stage[stats::S_EVALUATE].ns.Percentile(50) / 1e3, s.stage[stats::S_EVALUATE].ns.Percentile(99) / 1e3,
+        (unsigned long long)(sink & 1));
+    if (estimate > 1.0) { printf("FAIL: instrumentation above 1%% of a live-like scan\n"); return 1; }
+#else
+    printf("PROCHUNT_STATS=0: instrumentation compiled out\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: MIT
+// Benchmark suite over the seeded synthetic corpus (corpus.h): ns/record, heap
+// allocations/record and throughput for the platform-neutral modules, plus a JSON
+// results file so runs can be compared over time.
+// build: cmake -S . -B build && cmake --build build --target bench_suite
+// run:   build/bench_suite [--records N] [--seed S] [--rounds R] [--json results.json]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "corpus.h"
+#include "heuristics.h"
+#include "output.h"
+#include "print.h"
+#include "utils.h"
+
+// ---- counting allocator ----
+static std::atomic<uint64_t> g_allocs{ 0 };
+void* operator new(size_t n) {
+    ++g_allocs;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+#if defined(_WIN32)
+    const wchar_t* const kNullDevice = L"NUL";
+#else
+    const wchar_t* const kNullDevice = L"/dev/null";
+#endif
+
+    struct Measurement {
+        const char* name;
+        size_t records;           // per pass
+        double nsPerRecord;       // best pass
+        double allocsPerRecord;   // mean over all passes
+        double recordsPerSec;
+        double mbPerSec;          // bytes the benchmark reads or writes, per second
+    };
+
+    // Runs `pass` (one pass over `records` items) `rounds` times; keeps the fastest pass.
+    Measurement measure(const char* name, size_t records, uint64_t bytesPerPass, int rounds,
+        const std::function<uint64_t()>& pass, uint64_t& sink) {
+        sink += pass();   // warm-up: caches, thread-local arenas
+        double best = 1e300;
+        const uint64_t a0 = g_allocs.load();
+        for (int r = 0; r < rounds; ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            sink += pass();
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+            best = std::min(best, ns);
+        }
+        Measurement m;
+        m.name = name;
+        m.records = records;
+        m.nsPerRecord = best / (double)records;
+        m.allocsPerRecord = (double)(g_allocs.load() - a0) / ((double)rounds * (double)records);
+        m.recordsPerSec = 1e9 / m.nsPerRecord;
+        m.mbPerSec = (double)bytesPerPass / best * 1e3;
+        return m;
+    }
+
+    uint64_t u8size(std::wstring_view s) { return util::to_utf8(s).size(); }
+
+    uint64_t file_size(const std::wstring& path) {
+        FILE* f = util::open_file(path, "rb");
+        if (!f) return 0;
+        fseek(f, 0, SEEK_END);
+        const long n = ftell(f);
+        fclose(f);
+        return n > 0 ? (uint64_t)n : 0;
+    }
+
+    bool write_results(const std::string& path, const std::vector<Measurement>& ms, size_t records, uint32_t seed) {
+        FILE* f = util::open_file(util::from_utf8(path), "wb");
+        if (!f) return false;
+        const uint64_t ft = ((uint64_t)time(nullptr) + 11644473600ull) * 10000000ull;
+#if defined(__clang__)
+        const char* compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+        const char* compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        const char* compiler = "MSVC " _CRT_STRINGIZE(_MSC_FULL_VER);
+#else
+        const char* compiler = "unknown";
+#endif
+        fprintf(f, "{\n  \"suite\": \"prochunt\",\n  \"time\": \"%s\",\n  \"compiler\": \"%s\",\n  \"records\": %zu,\n  \"seed\": %u,\n  \"results\": [\n",
+            util::to_utf8(util::filetime_iso8601(ft)).c_str(), compiler, records, seed);
+        for (size_t i = 0; i < ms.size(); ++i) {
+            const Measurement& m = ms[i];
+            fprintf(f, "    { \"name\": \"%s\", \"records\": %zu, \"nsPerRecord\": %.1f, \"allocsPerRecord\": %.2f, \"recordsPerSec\": %.0f, \"mbPerSec\": %.1f }%s\n",
+                m.name, m.records, m.nsPerRecord, m.allocsPerRecord, m.recordsPerSec, m.mbPerSec, i + 1 < ms.size() ? "," : "");
+        }
+        fprintf(f, "  ]\n}\n");
+        return fclose(f) == 0;
+    }
+} // anon
+
+int main(int argc, char** argv) {
+    size_t records = 20000;
+    uint32_t seed = 1;
+    int rounds = 5;
+    std::string jsonPath = "bench_results.json";
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--records") && i + 1 < argc) records = (size_t)strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+        else { fprintf(stderr, "usage: %s [--records N] [--seed S] [--rounds R] [--json file]\n", argv[0]); return 2; }
+    }
+    if (records == 0 || rounds < 1) { fprintf(stderr, "--records and --rounds must be positive\n"); return 2; }
+
+    const auto corpus = bench::MakeCorpus(records, seed);
+
+    // ---- correctness first ----
+    {
+        const auto again = bench::MakeCorpus(records, seed);
+        const auto other = bench::MakeCorpus(records, seed + 1);
+        bool same = true, differs = false;
+        size_t kinds[5] = {};
+        for (size_t i = 0; i < records; ++i) {
+            same = same && again[i].cmd == corpus[i].cmd && again[i].img == corpus[i].img && again[i].pid == corpus[i].pid;
+            differs = differs || other[i].cmd != corpus[i].cmd;
+            ++kinds[(int)corpus[i].kind];
+        }
+        if (!same || (records > 1 && !differs)) { printf("FAIL: corpus is not a pure function of the seed\n"); return 1; }
+        if (records >= 1000)
+            for (int k = 0; k < 5; ++k)
+                if (!kinds[k]) { printf("FAIL: no %s records\n", util::to_utf8(bench::KindName((bench::Kind)k)).c_str()); return 1; }
+
+        double benign = 0, dropped = 0;
+        for (auto& r : corpus) {
+            const SignView sv(r.sig);
+            const int a = heur::EvaluateProcess(r.img, r.cmd, r.cwd, r.name, sv).score;
+            const int b = heur::EvaluateProcess(r.img, r.cmd, r.cwd, r.name, sv).score;
+            if (a != b) { printf("FAIL: EvaluateProcess is not deterministic (pid %u)\n", r.pid); return 1; }
+            if (r.kind == bench::Kind::Benign) benign += a;
+            if (r.kind == bench::Kind::Dropped) dropped += a;
+            for (const std::wstring* s : { &r.cmd, &r.img, &r.rtd }) {
+                const std::wstring e = util::json_escape(*s);
+                for (wchar_t c : e) if ((uint32_t)c < 0x20) { printf("FAIL: raw control character after json_escape\n"); return 1; }
+            }
+        }
+        if (records >= 1000 && dropped / std::max<size_t>(kinds[(int)bench::Kind::Dropped], 1) <= benign / std::max<size_t>(kinds[0], 1)) {
+            printf("FAIL: dropped binaries do not score above benign ones\n"); return 1;
+        }
+        printf("corpus: %zu records, seed %u (benign %zu, lolbin %zu, base64 %zu, unicode %zu, dropped %zu): ok\n",
+            records, seed, kinds[0], kinds[1], kinds[2], kinds[3], kinds[4]);
+    }
+
+    std::vector<Measurement> results;
+    uint64_t sink = 0;
+
+    // heuristics
+    {
+        uint64_t bytes = 0;
+        for (auto& r : corpus) bytes += u8size(r.img) + u8size(r.cmd) + u8size(r.cwd) + u8size(r.name);
+        results.push_back(measure("evaluate", records, bytes, rounds, [&] {
+            uint64_t s = 0;
+            for (auto& r : corpus) s += heur::EvaluateProcess(r.img, r.cmd, r.cwd, r.name, SignView(r.sig)).score;
+            return s;
+        }, sink));
+    }
+
+    // string utilities
+    {
+        uint64_t bytes = 0;
+        for (auto& r : corpus) bytes += u8size(r.img) + u8size(r.cmd);
+        results.push_back(measure("json_escape", records, bytes, rounds, [&] {
+            uint64_t s = 0;
+            for (auto& r : corpus) s += util::json_escape(r.img).size() + util::json_escape(r.cmd).size();
+            return s;
+        }, sink));
+        results.push_back(measure("lcase", records, bytes, rounds, [&] {
+            uint64_t s = 0;
+            for (auto& r : corpus) s += util::lcase(r.img).size() + util::lcase(r.cmd).size();
+            return s;
+        }, sink));
+    }
+
+    // list files (whitelists): one image directory per line
+    {
+        const std::wstring listPath = L"bench_suite_list.tmp";
+        std::vector<std::wstring> written;
+        std::string text = "# generated by bench_suite\n";
+        for (auto& r : corpus) {
+            std::wstring dir = r.img.substr(0, r.img.find_last_of(L'\\') + 1);
+            written.push_back(dir + std::to_wstring(r.pid));
+            text += util::to_utf8(written.back()) + "\r\n";
+        }
+        FILE* f = util::open_file(listPath, "wb");
+        if (!f || fwrite(text.data(), 1, text.size(), f) != text.size()) { printf("FAIL: cannot write %s\n", util::to_utf8(listPath).c_str()); return 1; }
+        fclose(f);
+        std::vector<std::wstring> read;
+        if (!util::load_list_file(listPath, read) || read != written) { printf("FAIL: load_list_file round trip\n"); return 1; }
+        results.push_back(measure("load_list_file", records, text.size(), rounds, [&] {
+            std::vector<std::wstring> v;
+            util::load_list_file(listPath, v);
+            return (uint64_t)v.size();
+        }, sink));
+        std::remove(util::to_utf8(listPath).c_str());
+    }
+
+    // formatters (print.cpp through output.cpp)
+    {
+        std::vector<heur::Result> res;
+        res.reserve(records);
+        for (auto& r : corpus) res.push_back(heur::EvaluateProcess(r.img, r.cmd, r.cwd, r.name, SignView(r.sig)));
+        auto print_all = [&](OutputMode mode) {
+            PrintBegin(mode);
+            for (size_t i = 0; i < records; ++i) {
+                const auto& r = corpus[i];
+                PrintProcess(r.pid, r.name, r.img, r.cmd, r.cwd, r.wtitle, r.desk, r.shell, r.rtd, SignView(r.sig), res[i]);
+            }
+            PrintEnd();
+            return (uint64_t)records;
+        };
+        const struct { const char* name; OutputMode mode; } formats[] = {
+            { "print_text", OutputMode::Text }, { "print_json", OutputMode::JsonArray }, { "print_ndjson", OutputMode::Ndjson } };
+        for (auto& fm : formats) {
+            const std::wstring outPath = L"bench_suite_out.tmp";
+            OutInit(outPath);
+            print_all(fm.mode);
+            OutClose();
+            const uint64_t bytes = file_size(outPath);
+            std::string head(2, '\0');
+            if (FILE* f = util::open_file(outPath, "rb")) { head.resize(fread(&head[0], 1, 2, f)); fclose(f); }
+            std::remove(util::to_utf8(outPath).c_str());
+            const bool shapeOk = fm.mode == OutputMode::Text ? bytes > records : (fm.mode == OutputMode::JsonArray ? head[0] == '[' : head[0] == '{');
+            if (!bytes || !shapeOk) { printf("FAIL: %s output looks wrong (%llu bytes)\n", fm.name, (unsigned long long)bytes); return 1; }
+
+            OutInit(kNullDevice);
+            results.push_back(measure(fm.name, records, bytes, rounds, [&] { return print_all(fm.mode); }, sink));
+            OutClose();
+        }
+    }
+
+    printf("%-16s %12s %12s %14s %10s\n", "benchmark", "ns/record", "allocs/rec", "records/s", "MB/s");
+    for (auto& m : results)
+        printf("%-16s %12.1f %12.2f %14.0f %10.1f\n", m.name, m.nsPerRecord, m.allocsPerRecord, m.recordsPerSec, m.mbPerSec);
+    if (!write_results(jsonPath, results, records, seed)) { printf("FAIL: cannot write %s\n", jsonPath.c_str()); return 1; }
+    printf("results written to %s   [%llu]\n", jsonPath.c_str(), (unsigned long long)(sink & 1));
+    return 0;
+}
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MIT
+// --watch diff engine against scripted enumerations: event correctness, then per-tick cost.
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt bench_watch.cpp ../ProcHunt/watch.cpp -o bench_watch
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "watch.h"
+
+namespace {
+    scan::ProcEntry P(uint32_t pid, uint64_t ct, const wchar_t* name = L"x.exe") {
+        scan::ProcEntry e; e.pid = pid; e.ppid = 4; e.createTime = ct; e.exeName = name;
+        return e;
+    }
+
+    int g_fail = 0;
+    void check(bool ok, const char* what) {
+        if (!ok) { printf("FAIL: %s\n", what); ++g_fail; }
+    }
+
+    void correctness() {
+        watch::Tracker t;
+        int prev = 0;
+
+        // tick 1: baseline, everything is new
+        auto& d1 = t.Update({ P(10, 100), P(20, 100), P(30, 100) });
+        check(d1.started.size() == 3 && d1.exited.empty(), "tick1 started 3");
+        check(t.Score(P(10, 100), 10, 50, prev) == watch::Event::None && prev == -1, "below threshold not reported");
+        check(t.Score(P(20, 100), 60, 50, prev) == watch::Event::Started, "above threshold started");
+        check(t.Score(P(30, 100), 80, 50, prev) == watch::Event::Started, "above threshold started (2)");
+
+        // tick 2: idle host, nothing to evaluate
+        auto& d2 = t.Update({ P(10, 100), P(20, 100), P(30, 100) });
+        check(d2.started.empty() && d2.exited.empty(), "steady state empty delta");
+
+        // tick 3: 10 (unreported) exits, 40 appears, 20 exits and its PID is reused
+        auto& d3 = t.Update({ P(20, 300), P(30, 100), P(40, 300) });
+        check(d3.started.size() == 2, "tick3 started 2 (new + reused PID)");
+        check(d3.exited.size() == 1 && d3.exited[0].entry.pid == 20 && d3.exited[0].entry.createTime == 100
+            && d3.exited[0].score == 60, "only the reported process exits, with its last score");
+        check(t.Size() == 3, "tracked after tick3");
+        check(t.Score(P(20, 300), 0, 50, prev) == watch::Event::None && prev == -1, "reused PID scored fresh");
+
+        // re-score (e.g. whitelist edited)
+        check(t.Score(P(30, 100), 80, 50, prev) == watch::Event::None, "unchanged score silent");
+        check(t.Score(P(30, 100), 40, 50, prev) == watch::Event::ScoreChanged && prev == 80, "reported drops below");
+        check(t.Score(P(20, 300), 55, 50, prev) == watch::Event::ScoreChanged && prev == 0, "unreported rises above");
+        check(t.Score(P(40, 300), 5, -1, prev) == watch::Event::Started, "no threshold reports all");
+        check(t.Score(P(99, 1), 90, 50, prev) == watch::Event::None, "unknown process ignored");
+        check(t.Entries().size() == 3 && t.Entries()[0].pid == 20, "entries sorted");
+
+        // tick 4: everything exits
+        auto& d4 = t.Update({});
+        check(d4.exited.size() == 3 && t.Size() == 0, "all reported exit");
+    }
+
+    double now_us() {
+        using namespace std::chrono;
+        return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+    }
+} // anon
+
+int main() {
+    correctness();
+    if (g_fail) return 1;
+    printf("events: ok\n");
+
+    for (size_t n : { 300u, 1000u, 5000u }) {
+        std::vector<scan::ProcEntry> procs;
+        for (size_t i = 0; i < n; ++i) procs.push_back(P((uint32_t)(i * 4 + 8), 1000 + i, L"svchost.exe"));
+        watch::Tracker t;
+        t.Update(procs);
+
+        const int ticks = 2000;
+        double t0 = now_us();
+        size_t started = 0;
+        for (int k = 0; k < ticks; ++k) started += t.Update(procs).started.size();
+        double idle = (now_us() - t0) / ticks;
+        if (started) { printf("FAIL: steady state reported %zu starts\n", started); return 1; }
+
+        // 1% churn per tick: the oldest processes exit, new ones start
+        uint64_t ct = 1000000;
+        t0 = now_us();
+        for (int k = 0; k < ticks; ++k) {
+            for (size_t i = 0; i < n / 100 + 1; ++i) procs[(k * (n / 100 + 1) + i) % n].createTime = ct++;
+            started += t.Update(procs).started.size();
+        }
+        double churn = (now_us() - t0) / ticks;
+        printf("%5zu procs: idle tick %.1f us, 1%% churn tick %.1f us (%zu starts)\n", n, idle, churn, started);
+    }
+    return 0;
+}
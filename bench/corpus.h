@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "codesign.h"
+
+// Seeded synthetic process table for the benchmarks. The same (count, seed) always gives
+// the same records. Roughly: 55% benign system/vendor processes, 15% LOLBin command
+// lines, 10% long base64 payloads, 10% non-ASCII names and paths, 10% user-writable,
+// UNC or unsigned images.
+namespace bench {
+    enum class Kind { Benign, Lolbin, Base64, Unicode, Dropped };
+
+    struct ProcRecord {
+        Kind kind = Kind::Benign;
+        uint32_t pid = 0, ppid = 0;
+        std::wstring name, img, cmd, cwd;
+        std::wstring wtitle, desk, shell, rtd;
+        SignInfo sig;
+    };
+
+    std::vector<ProcRecord> MakeCorpus(size_t count, uint32_t seed);
+
+    // Base64 of `bytes` random bytes (the shape of powershell -enc payloads).
+    std::wstring RandomBase64(size_t bytes, uint32_t seed);
+
+    const wchar_t* KindName(Kind k);
+} // namespace bench
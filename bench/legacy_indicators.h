@@ -0,0 +1,55 @@
+#pragma once
+// Frozen copy of the former hardcoded indicator table (now default_rules.inc), used by
+// the benchmarks that compare against earlier evaluators.
+#include <cstdint>
+#include <vector>
+#include "matcher.h"
+
+namespace legacy {
+    enum Indicator : uint32_t {
+        IND_USER_WRITABLE = 1u << 0,
+        IND_UNC_WEB       = 1u << 1,
+        IND_TEMP_DL       = 1u << 2,
+        IND_SYSTEM_PATH   = 1u << 3,
+        IND_SYSTEM32_DIR  = 1u << 4,
+        IND_LOLBIN        = 1u << 5,
+    };
+    struct Needle { const wchar_t* text; uint32_t tags; };
+
+    inline const std::vector<Needle>& IndicatorNeedles() {
+        static const std::vector<Needle> needles = {
+            { L"\\users\\", IND_USER_WRITABLE }, { L"\\appdata\\", IND_USER_WRITABLE },
+            { L"\\temp\\", IND_USER_WRITABLE | IND_TEMP_DL }, { L"\\downloads\\", IND_USER_WRITABLE | IND_TEMP_DL },
+            { L"\\public\\", IND_USER_WRITABLE }, { L"\\tasks\\", IND_USER_WRITABLE },
+            { L"\\onedrive\\", IND_USER_WRITABLE }, { L"\\recycle.bin\\", IND_USER_WRITABLE },
+            { L"\\desktop\\", IND_USER_WRITABLE }, { L"\\documents\\", IND_USER_WRITABLE },
+            { L"\\programdata\\", IND_USER_WRITABLE },
+            { L"\\tmp\\", IND_TEMP_DL },
+            { L"http://", IND_UNC_WEB }, { L"https://", IND_UNC_WEB },
+            { L"\\windows\\system32\\", IND_SYSTEM_PATH }, { L"\\windows\\syswow64\\", IND_SYSTEM_PATH },
+            { L"\\program files\\", IND_SYSTEM_PATH }, { L"\\program files (x86)\\", IND_SYSTEM_PATH },
+            { L"\\windows\\system32", IND_SYSTEM32_DIR },
+            { L"powershell", IND_LOLBIN }, { L" -enc", IND_LOLBIN }, { L"-w hidden", IND_LOLBIN },
+            { L"-nop", IND_LOLBIN }, { L"iex ", IND_LOLBIN },
+            { L"wscript", IND_LOLBIN }, { L"cscript", IND_LOLBIN }, { L".js ", IND_LOLBIN }, { L".vbs ", IND_LOLBIN },
+            { L"mshta", IND_LOLBIN }, { L"javascript:", IND_LOLBIN }, { L"vbscript:", IND_LOLBIN },
+            { L"rundll32 ", IND_LOLBIN }, { L"regsvr32 /s", IND_LOLBIN }, { L"/i:http", IND_LOLBIN },
+            { L"scrobj.dll", IND_LOLBIN },
+            { L"certutil -urlcache", IND_LOLBIN }, { L"bitsadmin /transfer", IND_LOLBIN },
+            { L"curl ", IND_LOLBIN }, { L"wget ", IND_LOLBIN }, { L"invoke-webrequest", IND_LOLBIN },
+            { L"schtasks /create", IND_LOLBIN }, { L"reg add ", IND_LOLBIN }, { L"netsh add helper", IND_LOLBIN },
+            { L"add-mppreference -exclusionpath", IND_LOLBIN },
+        };
+        return needles;
+    }
+
+    inline const heur::Matcher& IndicatorMatcher() {
+        static const heur::Matcher m = [] {
+            heur::Matcher b;
+            for (auto& n : IndicatorNeedles()) b.Add(n.text, n.tags);
+            b.Build();
+            return b;
+        }();
+        return m;
+    }
+} // namespace legacy